@@ -0,0 +1,267 @@
+/* SPDX-License-Identifier: GPL-3.0+ */
+/*
+ * web-stress - an HTTP/1.1 load generator for the hibenchmarks web server
+ *
+ * Every thread opens a keep-alive connection and sends PIPELINE requests
+ * at once, then reads their responses, again and again, for SECONDS.
+ * A PIPELINE of 1 waits for every response before sending the next request.
+ */
+#include <stdlib.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <pthread.h>
+
+size_t run_threads = 1;
+size_t pipeline = 1;
+int seconds = 10;
+volatile int stop = 0;
+
+struct sockaddr_in server;
+char *request = NULL;
+size_t request_len = 0;
+
+struct thread_data {
+	size_t id;
+	size_t requests;
+	size_t errors;
+	size_t bytes;
+	size_t reconnects;
+};
+
+static int connect_to_server(void) {
+	int s = socket(AF_INET, SOCK_STREAM, 0);
+	if(s == -1) {
+		perror("socket");
+		return -1;
+	}
+
+	int one = 1;
+	setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	if(connect(s, (struct sockaddr *)&server, sizeof(server)) == -1) {
+		perror("connect");
+		close(s);
+		return -1;
+	}
+
+	return s;
+}
+
+// parses one response at the beginning of buf
+// returns its length, 0 when it is incomplete, -1 when it cannot be parsed
+static ssize_t parse_response(char *buf, size_t len, int *code, int *close_connection) {
+	char *end = strstr(buf, "\r\n\r\n");
+	if(!end) return 0;
+
+	size_t header_len = end - buf + 4;
+
+	if(strncmp(buf, "HTTP/1.", 7) != 0) return -1;
+	*code = atoi(&buf[9]);
+
+	*end = '\0';
+	*close_connection = (strcasestr(buf, "\r\nConnection: close") != NULL);
+	int chunked = (strcasestr(buf, "\r\nTransfer-Encoding: chunked") != NULL);
+	char *cl = strcasestr(buf, "\r\nContent-Length:");
+	*end = '\r';
+
+	if(!chunked) {
+		size_t body = (cl) ? strtoul(&cl[17], NULL, 10) : 0;
+		if(len < header_len + body) return 0;
+		return header_len + body;
+	}
+
+	// chunked - every chunk is its hex size, \r\n, the data and \r\n
+	size_t pos = header_len;
+	for(;;) {
+		char *crlf = memmem(&buf[pos], len - pos, "\r\n", 2);
+		if(!crlf) return 0;
+
+		size_t chunk = strtoul(&buf[pos], NULL, 16);
+		pos = crlf - buf + 2 + chunk + 2;
+		if(pos > len) return 0;
+		if(!chunk) return pos;
+	}
+}
+
+static void *stress_thread(void *__data) {
+	struct thread_data *data = (struct thread_data *)__data;
+
+	size_t size = 1024 * 1024, len = 0;
+	char *buf = malloc(size + 1);
+	int s = -1;
+
+	while(!stop) {
+		if(s == -1) {
+			s = connect_to_server();
+			if(s == -1) break;
+			data->reconnects++;
+			len = 0;
+		}
+
+		// send all the requests of the pipeline at once
+		if(send(s, request, request_len * pipeline, 0) != (ssize_t)(request_len * pipeline)) {
+			close(s);
+			s = -1;
+			data->errors++;
+			continue;
+		}
+
+		size_t responses = 0;
+		int closed = 0;
+		while(responses < pipeline && !closed) {
+			if(len == size) {
+				size *= 2;
+				buf = realloc(buf, size + 1);
+			}
+
+			ssize_t bytes = recv(s, &buf[len], size - len, 0);
+			if(bytes <= 0) {
+				closed = 1;
+				break;
+			}
+			len += bytes;
+			buf[len] = '\0';
+			data->bytes += bytes;
+
+			ssize_t r;
+			int code, close_connection;
+			while(responses < pipeline && (r = parse_response(buf, len, &code, &close_connection)) > 0) {
+				if(code == 200 || code == 304) data->requests++;
+				else data->errors++;
+				responses++;
+
+				memmove(buf, &buf[r], len - r);
+				len -= r;
+				buf[len] = '\0';
+
+				if(close_connection) {
+					closed = 1;
+					break;
+				}
+			}
+
+			if(r == -1) {
+				fprintf(stderr, "thread %zu: cannot parse the response\n", data->id);
+				closed = 1;
+			}
+		}
+
+		if(closed) {
+			data->errors += pipeline - responses;
+			close(s);
+			s = -1;
+		}
+	}
+
+	if(s != -1) close(s);
+	free(buf);
+	return NULL;
+}
+
+static size_t total_requests(struct thread_data *data) {
+	size_t i, total = 0;
+	for(i = 0; i < run_threads ;i++)
+		total += data[i].requests;
+
+	return total;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 7) {
+		fprintf(stderr, "Usage: '%s THREADS PIPELINE SECONDS IP PORT URL'\n", argv[0]);
+		exit(-1);
+	}
+
+	run_threads = atoi(argv[1]);
+	pipeline = atoi(argv[2]);
+	seconds = atoi(argv[3]);
+	char *ip = argv[4];
+	int port = atoi(argv[5]);
+	char *url = argv[6];
+
+	if(!run_threads || !pipeline || seconds <= 0) {
+		fprintf(stderr, "THREADS, PIPELINE and SECONDS have to be positive numbers\n");
+		exit(1);
+	}
+
+	memset(&server, 0, sizeof(server));
+	server.sin_family = AF_INET;
+	server.sin_port = htons(port);
+	if (inet_aton(ip, &server.sin_addr)==0) {
+		fprintf(stderr, "inet_aton() of ip '%s' failed\n", ip);
+		exit(1);
+	}
+
+	char one[8192];
+	request_len = snprintf(one, sizeof(one), "GET %s HTTP/1.1\r\nHost: %s:%d\r\nConnection: keep-alive\r\n\r\n", url, ip, port);
+	if(request_len >= sizeof(one)) {
+		fprintf(stderr, "URL is too long\n");
+		exit(1);
+	}
+
+	size_t i;
+	request = malloc(request_len * pipeline + 1);
+	for(i = 0; i < pipeline ;i++)
+		memcpy(&request[i * request_len], one, request_len);
+
+	struct thread_data data[run_threads];
+	pthread_t threads[run_threads];
+
+	printf("\n");
+	printf("THREADS     : %zu\n", run_threads);
+	printf("PIPELINE    : %zu\n", pipeline);
+	printf("SECONDS     : %d\n", seconds);
+	printf("DESTINATION : %s:%d%s\n", ip, port, url);
+	printf("\n");
+
+	struct timespec started, ended;
+	clock_gettime(CLOCK_MONOTONIC, &started);
+
+	for (i = 0; i < run_threads; ++i) {
+		memset(&data[i], 0, sizeof(struct thread_data));
+		data[i].id = i;
+		pthread_create(&threads[i], NULL, stress_thread, &data[i]);
+	}
+
+	size_t last = 0;
+	int t;
+	for(t = 0; t < seconds ; t++) {
+		sleep(1);
+		size_t total = total_requests(data);
+		printf("%zu requests/s\n", total - last);
+		last = total;
+	}
+	stop = 1;
+
+	for (i = 0; i < run_threads; ++i)
+		pthread_join(threads[i], NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &ended);
+	double duration = (ended.tv_sec - started.tv_sec) + (ended.tv_nsec - started.tv_nsec) / 1000000000.0;
+
+	size_t requests = 0, errors = 0, bytes = 0, reconnects = 0;
+	for(i = 0; i < run_threads ;i++) {
+		requests += data[i].requests;
+		errors += data[i].errors;
+		bytes += data[i].bytes;
+		reconnects += data[i].reconnects;
+	}
+
+	printf("\n");
+	printf("REQUESTS    : %zu (%zu errors)\n", requests, errors);
+	printf("CONNECTIONS : %zu\n", reconnects);
+	printf("RECEIVED    : %zu bytes\n", bytes);
+	printf("RATE        : %0.0f requests/s\n", requests / duration);
+
+	free(request);
+	return 0;
+}
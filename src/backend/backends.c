@@ -60,9 +60,13 @@ inline calculated_number backend_calculate_value_from_stored_data(
     RRDHOST *host = st->rrdhost;
 
     // find the edges of the rrd database for this chart
-    time_t first_t = rrdset_first_entry_t(st);
-    time_t last_t  = rrdset_last_entry_t(st);
-    time_t update_every = st->update_every;
+    // the chart is not locked, so we work on a consistent copy of its state
+    struct rrdset_tier ring;
+    rrdset_ring_snapshot(st, &ring);
+
+    time_t first_t = rrdset_first_entry_t(&ring);
+    time_t last_t  = rrdset_last_entry_t(&ring);
+    time_t update_every = ring.update_every;
 
     // step back a little, to make sure we have complete data collection
     // for all metrics
@@ -103,26 +107,63 @@ inline calculated_number backend_calculate_value_from_stored_data(
     size_t counter = 0;
     calculated_number sum = 0;
 
-    long    start_at_slot = rrdset_time2slot(st, before),
-            stop_at_slot  = rrdset_time2slot(st, after),
+    long    start_at_slot = rrdset_time2slot(&ring, before),
+            stop_at_slot  = rrdset_time2slot(&ring, after),
             slot, stop_now = 0;
 
-    for(slot = start_at_slot; !stop_now ; slot--) {
+    if(unlikely(rd->storage_format == RRD_STORAGE_FORMAT_64BIT)) {
+        // unpacking 64-bit storage numbers is just masking their flags
+        storage_number64 *values64 = rrddim_values64(rd);
+
+        for(slot = start_at_slot; !stop_now ; slot--) {
 
-        if(unlikely(slot < 0)) slot = st->entries - 1;
-        if(unlikely(slot == stop_at_slot)) stop_now = 1;
+            if(unlikely(slot < 0)) slot = ring.entries - 1;
+            if(unlikely(slot == stop_at_slot)) stop_now = 1;
 
-        storage_number n = rd->values[slot];
+            storage_number64 n = values64[slot];
 
-        if(unlikely(!does_storage_number_exist(n))) {
-            // not collected
-            continue;
+            if(unlikely(!does_storage_number64_exist(n))) {
+                // not collected
+                continue;
+            }
+
+            sum += unpack_storage_number64(n);
+            counter++;
         }
+    }
+    else {
+        RRDDIM_PAGE_ITERATOR page_iterator;
+        rrddim_page_iterator_init(&page_iterator, rd);
 
-        calculated_number value = unpack_storage_number(n);
-        sum += value;
+        // the stored values are collected in batches and unpacked together
+        storage_number batch[RRDDIM_PAGE_ENTRIES];
+        calculated_number values[RRDDIM_PAGE_ENTRIES];
+        size_t batched = 0, i;
 
-        counter++;
+        for(slot = start_at_slot; !stop_now ; slot--) {
+
+            if(unlikely(slot < 0)) slot = ring.entries - 1;
+            if(unlikely(slot == stop_at_slot)) stop_now = 1;
+
+            batch[batched++] = (unlikely(rd->pages)) ? rrddim_page_iterator_get(&page_iterator, slot) : rd->values[slot];
+
+            if(likely(batched < RRDDIM_PAGE_ENTRIES && !stop_now))
+                continue;
+
+            unpack_storage_number_batch(batch, values, batched);
+
+            for(i = 0; i < batched ; i++) {
+                if(unlikely(isnan(values[i]))) {
+                    // not collected
+                    continue;
+                }
+
+                sum += values[i];
+                counter++;
+            }
+
+            batched = 0;
+        }
     }
 
     if(unlikely(!counter)) {
@@ -224,14 +265,14 @@ static inline int format_dimension_stored_graphite_plaintext(
 
         buffer_sprintf(
                 b
-                , "%s.%s.%s.%s " CALCULATED_NUMBER_FORMAT " %u\n"
+                , "%s.%s.%s.%s "
                 , prefix
                 , hostname
                 , chart_name
                 , dimension_name
-                , value
-                , (uint32_t) last_t
         );
+        buffer_rrd_value(b, value);
+        buffer_sprintf(b, " %u\n", (uint32_t) last_t);
 
         return 1;
     }
@@ -308,12 +349,16 @@ static inline int format_dimension_stored_opentsdb_telnet(
 
         buffer_sprintf(
                 b
-                , "put %s.%s.%s %u " CALCULATED_NUMBER_FORMAT " host=%s%s%s\n"
+                , "put %s.%s.%s %u "
                 , prefix
                 , chart_name
                 , dimension_name
                 , (uint32_t) last_t
-                , value
+        );
+        buffer_rrd_value(b, value);
+        buffer_sprintf(
+                b
+                , " host=%s%s%s\n"
                 , hostname
                 , (host->tags)?" ":""
                 , (host->tags)?host->tags:""
@@ -445,9 +490,7 @@ static inline int format_dimension_stored_json_plaintext(
 
             "\"id\":\"%s\","
             "\"name\":\"%s\","
-            "\"value\":" CALCULATED_NUMBER_FORMAT ","
-
-            "\"timestamp\": %u}\n", 
+            "\"value\":",
                 prefix,
                 hostname,
                 tags_pre, tags, tags_post,
@@ -460,12 +503,12 @@ static inline int format_dimension_stored_json_plaintext(
                 st->units,
 
                 rd->id,
-                rd->name,
-                value, 
-                
-                (uint32_t) last_t
+                rd->name
         );
-        
+
+        buffer_rrd_value(b, value);
+        buffer_sprintf(b, ",\"timestamp\": %u}\n", (uint32_t) last_t);
+
         return 1;
     }
     return 0;
@@ -748,12 +791,11 @@ void *backends_main(void *ptr) {
             RRDSET *st;
             rrdset_foreach_read(st, host) {
                 if(likely(backends_can_send_rrdset(backend_options, st))) {
-                    rrdset_rdlock(st);
-
+                    // the host read lock keeps the chart from being freed
                     count_charts++;
 
                     RRDDIM *rd;
-                    rrddim_foreach_read(rd, st) {
+                    for(rd = st->dimensions; rd ; rd = rd->next) {
                         if (likely(rd->last_collected_time.tv_sec >= after)) {
                             chart_buffered_metrics += backend_request_formatter(b, backend_prefix, host, __hostname, st, rd, after, before, backend_options);
                             count_dims++;
@@ -763,8 +805,6 @@ void *backends_main(void *ptr) {
                             count_dims_skipped++;
                         }
                     }
-
-                    rrdset_unlock(st);
                 }
             }
 
@@ -22,6 +22,10 @@ void hibenchmarks_cleanup_and_exit(int ret) {
         info("EXIT: stopping master threads...");
         cancel_main_threads();
 
+        // the web server is stopped, no more queries to run
+        info("EXIT: stopping the query threads...");
+        hibenchmarks_workers_stop();
+
         // free the database
         info("EXIT: freeing database memory...");
         rrdhost_free_all();
@@ -107,6 +111,20 @@ void web_server_config_options(void) {
     web_x_frame_options = config_get(CONFIG_SECTION_WEB, "x-frame-options response header", "");
     if(!*web_x_frame_options) web_x_frame_options = NULL;
 
+    rrdr_cache_entries = config_get_number(CONFIG_SECTION_WEB, "query cache entries", rrdr_cache_entries);
+    if(rrdr_cache_entries < 0) rrdr_cache_entries = 0;
+
+    rrdr_stream_values = config_get_number(CONFIG_SECTION_WEB, "stream query results above values", rrdr_stream_values);
+    if(rrdr_stream_values < 0) rrdr_stream_values = 0;
+
+    web_files_cache_mb = config_get_number(CONFIG_SECTION_WEB, "static files cache size MB", web_files_cache_mb);
+    if(web_files_cache_mb < 0) web_files_cache_mb = 0;
+
+    poll_events_backend = poll_events_backend_id(config_get(CONFIG_SECTION_WEB, "socket events backend", poll_events_backend_name(poll_events_backend)));
+
+    hibenchmarks_workers_threads = config_get_number(CONFIG_SECTION_WEB, "query threads", get_system_cpus());
+    if(hibenchmarks_workers_threads < 0) hibenchmarks_workers_threads = 0;
+
     web_allow_connections_from = simple_pattern_create(config_get(CONFIG_SECTION_WEB, "allow connections from", "localhost *"), NULL, SIMPLE_PATTERN_EXACT);
     web_allow_dashboard_from   = simple_pattern_create(config_get(CONFIG_SECTION_WEB, "allow dashboard from", "localhost *"), NULL, SIMPLE_PATTERN_EXACT);
     web_allow_badges_from      = simple_pattern_create(config_get(CONFIG_SECTION_WEB, "allow badges from", "*"), NULL, SIMPLE_PATTERN_EXACT);
@@ -142,6 +160,15 @@ void web_server_config_options(void) {
         error("Invalid compression level %d. Valid levels are 1 (fastest) to 9 (best ratio). Proceeding with level 9 (best compression).", web_gzip_level);
         web_gzip_level = 9;
     }
+
+    web_gzip_shared_entries = (int)config_get_number(CONFIG_SECTION_WEB, "shared gzip responses", web_gzip_shared_entries);
+    if(web_gzip_shared_entries < 0) web_gzip_shared_entries = 0;
+
+    web_gzip_shared_level = (int)config_get_number(CONFIG_SECTION_WEB, "shared gzip responses compression level", web_gzip_level);
+    if(web_gzip_shared_level < 1 || web_gzip_shared_level > 9) {
+        error("Invalid shared gzip responses compression level %d. Valid levels are 1 (fastest) to 9 (best ratio). Proceeding with level %d.", web_gzip_shared_level, web_gzip_level);
+        web_gzip_shared_level = web_gzip_level;
+    }
 #endif /* HIBENCHMARKS_WITH_ZLIB */
 }
 
@@ -304,6 +331,7 @@ int help(int exitcode) {
             "  -W stacksize=N           Set the stacksize (in bytes).\n\n"
             "  -W debug_flags=N         Set runtime tracing to debug.log.\n\n"
             "  -W unittest              Run internal unittests and exit.\n\n"
+            "  -W querybenchmark        Benchmark the queries of 1000 dimensions x 1 day and exit.\n\n"
             "  -W set section option value\n"
             "                           set hibenchmarks.conf option from the command line.\n\n"
             "  -W simple-pattern pattern string\n"
@@ -478,6 +506,18 @@ static void get_hibenchmarks_configured_variables() {
 
     default_rrd_memory_mode = rrd_memory_mode_id(config_get(CONFIG_SECTION_GLOBAL, "memory mode", rrd_memory_mode_name(default_rrd_memory_mode)));
 
+    if(default_rrd_memory_mode == RRD_MEMORY_MODE_TIERED) {
+        default_rrd_tier_history_entries[0] = config_get_number(CONFIG_SECTION_GLOBAL, "per minute tier history", default_rrd_tier_history_entries[0]);
+        default_rrd_tier_history_entries[1] = config_get_number(CONFIG_SECTION_GLOBAL, "per hour tier history", default_rrd_tier_history_entries[1]);
+    }
+
+    rrddim_summaries_enabled = config_get_boolean(CONFIG_SECTION_GLOBAL, "summarize dimensions", rrddim_summaries_enabled);
+
+    if(default_rrd_memory_mode == RRD_MEMORY_MODE_DBENGINE) {
+        default_rrdeng_disk_space_mb = config_get_number(CONFIG_SECTION_GLOBAL, "dbengine disk space", default_rrdeng_disk_space_mb);
+        default_rrdeng_page_cache_mb = config_get_number(CONFIG_SECTION_GLOBAL, "page cache size", default_rrdeng_page_cache_mb);
+    }
+
     // ------------------------------------------------------------------------
 
     hibenchmarks_configured_host_prefix = config_get(CONFIG_SECTION_GLOBAL, "host access prefix", "");
@@ -743,6 +783,15 @@ int main(int argc, char **argv) {
                             fprintf(stderr, "\n\nALL TESTS PASSED\n\n");
                             return 0;
                         }
+                        else if(strcmp(optarg, "querybenchmark") == 0) {
+                            get_hibenchmarks_configured_variables();
+                            default_rrd_update_every = 1;
+                            default_rrd_memory_mode = RRD_MEMORY_MODE_RAM;
+                            default_health_enabled = 0;
+                            rrd_init("querybenchmark");
+                            default_rrdpush_enabled = 0;
+                            return benchmark_queries(1000, 86400, 5);
+                        }
                         else if(strcmp(optarg, "simple-pattern") == 0) {
                             if(optind + 2 > argc) {
                                 fprintf(stderr, "%s", "\nUSAGE: -W simple-pattern 'pattern' 'string'\n\n"
@@ -484,6 +484,71 @@ int listen_sockets_setup(LISTEN_SOCKETS *sockets) {
     return (int)sockets->opened;
 }
 
+// open, for a worker thread, its own listening sockets on the addresses of another set.
+// The TCP sockets are opened again with SO_REUSEPORT, so that the kernel spreads the
+// new connections among the workers. The rest (and the ones that fail) are shared (dup()).
+int listen_sockets_shard(LISTEN_SOCKETS *shard, LISTEN_SOCKETS *sockets) {
+    listen_sockets_init(shard);
+
+    shard->config_section  = sockets->config_section;
+    shard->default_bind_to = sockets->default_bind_to;
+    shard->default_port    = sockets->default_port;
+    shard->backlog         = sockets->backlog;
+
+    size_t i;
+    for(i = 0; i < sockets->opened ;i++) {
+        int fd = -1, family = sockets->fds_families[i], socktype = sockets->fds_types[i];
+
+#ifdef SO_REUSEPORT
+        if(socktype == SOCK_STREAM && (family == AF_INET || family == AF_INET6)) {
+            struct sockaddr_storage addr;
+            socklen_t addrlen = sizeof(addr);
+            char ip[INET6_ADDRSTRLEN + 1] = "";
+
+            if(getsockname(sockets->fds[i], (struct sockaddr *)&addr, &addrlen) == -1)
+                error("LISTENER: getsockname() failed on %s", sockets->fds_names[i]);
+
+            else if(family == AF_INET) {
+                struct sockaddr_in *sin = (struct sockaddr_in *)&addr;
+                inet_ntop(AF_INET, &sin->sin_addr, ip, INET6_ADDRSTRLEN);
+                fd = create_listen_socket4(socktype, ip, ntohs(sin->sin_port), sockets->backlog);
+            }
+
+            else {
+                struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&addr;
+                inet_ntop(AF_INET6, &sin6->sin6_addr, ip, INET6_ADDRSTRLEN);
+                fd = create_listen_socket6(socktype, sin6->sin6_scope_id, ip, ntohs(sin6->sin6_port), sockets->backlog);
+            }
+
+            if(fd == -1)
+                error("LISTENER: cannot open another listening socket for %s - sharing it", sockets->fds_names[i]);
+        }
+#endif
+
+        if(fd == -1) {
+            fd = dup(sockets->fds[i]);
+            if(fd == -1) {
+                error("LISTENER: cannot dup() listening socket %s", sockets->fds_names[i]);
+                shard->failed++;
+                continue;
+            }
+        }
+
+        if(shard->opened >= MAX_LISTEN_FDS) {
+            close(fd);
+            break;
+        }
+
+        shard->fds[shard->opened] = fd;
+        shard->fds_types[shard->opened] = socktype;
+        shard->fds_families[shard->opened] = family;
+        shard->fds_names[shard->opened] = strdupz(sockets->fds_names[i]);
+        shard->opened++;
+    }
+
+    return (int)shard->opened;
+}
+
 
 // --------------------------------------------------------------------------------------------------------------------
 // connect to another host/port
@@ -959,10 +1024,154 @@ int accept_socket(int fd, int flags, char *client_ip, size_t ipsize, char *clien
 // --------------------------------------------------------------------------------------------------------------------
 // poll() based listener
 // this should be the fastest possible listener for up to 100 sockets
-// above 100, an epoll() interface is needed on Linux
+// above 100, the epoll() backend is used on Linux (the default, when available)
 
 #define POLL_FDS_INCREASE_STEP 10
 
+#ifdef HAVE_SYS_EPOLL_H
+POLL_EVENTS_BACKEND poll_events_backend = POLL_EVENTS_BACKEND_EPOLL;
+#else
+POLL_EVENTS_BACKEND poll_events_backend = POLL_EVENTS_BACKEND_POLL;
+#endif
+
+const char *poll_events_backend_name(POLL_EVENTS_BACKEND backend) {
+    switch(backend) {
+        case POLL_EVENTS_BACKEND_EPOLL:
+            return "epoll";
+
+        case POLL_EVENTS_BACKEND_POLL:
+        default:
+            return "poll";
+    }
+}
+
+POLL_EVENTS_BACKEND poll_events_backend_id(const char *name) {
+    if(!strcmp(name, "epoll")) {
+#ifdef HAVE_SYS_EPOLL_H
+        return POLL_EVENTS_BACKEND_EPOLL;
+#else
+        error("POLLFD: epoll() is not available on this system - using poll()");
+        return POLL_EVENTS_BACKEND_POLL;
+#endif
+    }
+
+    if(strcmp(name, "poll") != 0)
+        error("POLLFD: unknown socket events backend '%s' - using poll()", name);
+
+    return POLL_EVENTS_BACKEND_POLL;
+}
+
+// ----------------------------------------------------------------------------
+// epoll() backend
+//
+// The callbacks keep changing the events of struct pollfd, like they do for
+// poll(). After every callback, the events of its slot are synced to epoll().
+// The slot is the data of the epoll() event, so epoll_wait() returns the slots
+// that are ready, without scanning all of them.
+//
+// epoll() refuses regular files (the web server reads files with them), that
+// poll() reports always ready. These are kept aside and processed on every
+// loop, without waiting, when they expect events.
+
+#define POLL_EPOLL_EVENTS 1024
+
+static void poll_ready_add(POLLJOB *p, size_t slot) {
+    if(unlikely(p->ready_used == p->ready_size)) {
+        p->ready_size += POLL_FDS_INCREASE_STEP;
+        p->ready = reallocz(p->ready, sizeof(size_t) * p->ready_size);
+        p->ready_copy = reallocz(p->ready_copy, sizeof(size_t) * p->ready_size);
+    }
+
+    p->ready[p->ready_used++] = slot;
+}
+
+static void poll_ready_del(POLLJOB *p, size_t slot) {
+    size_t i;
+    for(i = 0; i < p->ready_used ; i++) {
+        if(p->ready[i] == slot) {
+            p->ready[i] = p->ready[--p->ready_used];
+            return;
+        }
+    }
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+static inline uint32_t poll_to_epoll_events(short int events) {
+    uint32_t e = 0;
+    if(events & POLLIN)  e |= EPOLLIN;
+    if(events & POLLPRI) e |= EPOLLPRI;
+    if(events & POLLOUT) e |= EPOLLOUT;
+    return e;
+}
+
+static inline short int epoll_to_poll_events(uint32_t e) {
+    short int events = 0;
+    if(e & EPOLLIN)  events |= POLLIN;
+    if(e & EPOLLPRI) events |= POLLPRI;
+    if(e & EPOLLOUT) events |= POLLOUT;
+    if(e & EPOLLERR) events |= POLLERR;
+    if(e & EPOLLHUP) events |= POLLHUP;
+    return events;
+}
+#endif
+
+static inline void poll_epoll_sync(POLLJOB *p, size_t slot) {
+#ifdef HAVE_SYS_EPOLL_H
+    POLLINFO *pi = &p->inf[slot];
+    short int events = p->fds[slot].events;
+
+    if(likely(p->epoll_fd == -1 || pi->fd == -1 || pi->epoll_events == events || (pi->flags & POLLINFO_FLAG_ALWAYS_READY)))
+        return;
+
+    // the fd is added even without events, so that errors and hang ups are reported
+    int op = (pi->epoll_events == -1) ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+
+    struct epoll_event ev = {
+            .events = poll_to_epoll_events(events),
+            .data.u64 = (uint64_t)slot
+    };
+
+    if(unlikely(epoll_ctl(p->epoll_fd, op, pi->fd, &ev) == -1)) {
+        if(op == EPOLL_CTL_ADD && errno == EPERM) {
+            debug(D_POLLFD, "POLLFD: EPOLL: fd %d of slot %zu cannot be watched - it is always ready", pi->fd, slot);
+            pi->flags |= POLLINFO_FLAG_ALWAYS_READY;
+            poll_ready_add(p, slot);
+        }
+        else
+            error("POLLFD: EPOLL: epoll_ctl() failed for fd %d of slot %zu", pi->fd, slot);
+
+        return;
+    }
+
+    pi->epoll_events = events;
+#else
+    (void)p;
+    (void)slot;
+#endif
+}
+
+static inline void poll_epoll_del(POLLJOB *p, POLLINFO *pi) {
+    if(unlikely(pi->flags & POLLINFO_FLAG_ALWAYS_READY))
+        poll_ready_del(p, pi->slot);
+
+#ifdef HAVE_SYS_EPOLL_H
+    // closing the fd does not remove it from epoll() when another process
+    // (like a plugin forked before it was accepted) still has it open
+    else if(pi->epoll_events != -1) {
+        if(unlikely(epoll_ctl(p->epoll_fd, EPOLL_CTL_DEL, pi->fd, NULL) == -1))
+            error("POLLFD: EPOLL: failed to remove fd %d of slot %zu", pi->fd, pi->slot);
+    }
+#endif
+
+    pi->epoll_events = -1;
+}
+
+// the callbacks of a slot may change the events of another slot
+// (the web server does this for file copies) - they call this after that
+void poll_fd_events_changed(POLLINFO *pi) {
+    poll_epoll_sync(pi->p, pi->slot);
+}
+
 inline POLLINFO *poll_add_fd(POLLJOB *p
                              , int fd
                              , int socktype
@@ -1003,6 +1212,7 @@ inline POLLINFO *poll_add_fd(POLLJOB *p
             p->inf[i].p = p;
             p->inf[i].slot = (size_t)i;
             p->inf[i].flags = 0;
+            p->inf[i].epoll_events = -1;
             p->inf[i].socktype = -1;
             p->inf[i].client_ip = NULL;
             p->inf[i].client_port = NULL;
@@ -1061,6 +1271,8 @@ inline POLLINFO *poll_add_fd(POLLJOB *p
     if(pi->flags & POLLINFO_FLAG_SERVER_SOCKET) {
         p->min = pi->slot;
     }
+
+    poll_epoll_sync(p, pi->slot);
     hibenchmarks_thread_enable_cancelability();
 
     debug(D_POLLFD, "POLLFD: ADD: completed, slots = %zu, used = %zu, min = %zu, max = %zu, next free = %zd", p->slots, p->used, p->min, p->max, p->first_free?(ssize_t)p->first_free->slot:(ssize_t)-1);
@@ -1078,9 +1290,12 @@ inline void poll_close_fd(POLLINFO *pi) {
 
     hibenchmarks_thread_disable_cancelability();
 
-    if(pi->flags & POLLINFO_FLAG_CLIENT_SOCKET) {
+    if(pi->flags & POLLINFO_FLAG_CLIENT_SOCKET)
         pi->del_callback(pi);
 
+    poll_epoll_del(p, pi);
+
+    if(pi->flags & POLLINFO_FLAG_CLIENT_SOCKET) {
         if(likely(!(pi->flags & POLLINFO_FLAG_DONT_CLOSE))) {
             if(close(pf->fd) == -1)
                 error("Failed to close() poll_events() socket %d", pf->fd);
@@ -1183,6 +1398,15 @@ static void poll_events_cleanup(void *data) {
         poll_close_fd(pi);
     }
 
+    if(p->epoll_fd != -1)
+        close(p->epoll_fd);
+
+#ifdef HAVE_SYS_EPOLL_H
+    freez(p->epoll_events);
+#endif
+    freez(p->ready);
+    freez(p->ready_copy);
+
     freez(p->fds);
     freez(p->inf);
 }
@@ -1242,7 +1466,7 @@ static void poll_events_process(POLLJOB *p, POLLINFO *pi, struct pollfd *pf, sho
                         char client_port[NI_MAXSERV + 1];
 
                         debug(D_POLLFD, "POLLFD: LISTENER: calling accept4() slot %zu (fd %d)", i, fd);
-                        nfd = accept_socket(fd, SOCK_NONBLOCK, client_ip, NI_MAXHOST + 1, client_port, NI_MAXSERV + 1, p->access_list);
+                        nfd = accept_socket(fd, SOCK_NONBLOCK | SOCK_CLOEXEC, client_ip, NI_MAXHOST + 1, client_port, NI_MAXSERV + 1, p->access_list);
                         if (unlikely(nfd < 0)) {
                             // accept failed
 
@@ -1327,6 +1551,8 @@ static void poll_events_process(POLLJOB *p, POLLINFO *pi, struct pollfd *pf, sho
 #endif
     }
 
+    poll_epoll_sync(p, i);
+
     if(unlikely(revents & POLLERR)) {
         error("POLLFD: LISTENER: processing POLLERR events for slot %zu fd %d (events = %d, revents = %d)", i, events, revents, fd);
         pf->events = 0;
@@ -1349,6 +1575,89 @@ static void poll_events_process(POLLJOB *p, POLLINFO *pi, struct pollfd *pf, sho
     }
 }
 
+// wait with poll() and process the slots that are ready
+static int poll_events_wait_poll(POLLJOB *p, int timeout_ms, time_t *now) {
+    debug(D_POLLFD, "POLLFD: LISTENER: Waiting on %zu sockets for %zu ms...", p->max + 1, (size_t)timeout_ms);
+    int retval = poll(p->fds, p->max + 1, timeout_ms);
+    *now = now_boottime_sec();
+
+    if(unlikely(retval == -1)) {
+        error("POLLFD: LISTENER: poll() failed while waiting on %zu sockets.", p->max + 1);
+        return -1;
+    }
+    else if(unlikely(!retval)) {
+        debug(D_POLLFD, "POLLFD: LISTENER: poll() timeout.");
+    }
+    else {
+        size_t i;
+        for (i = 0; i <= p->max; i++) {
+            struct pollfd *pf     = &p->fds[i];
+            short int     revents = pf->revents;
+            if (unlikely(revents))
+                poll_events_process(p, &p->inf[i], pf, revents, *now);
+        }
+    }
+
+    return retval;
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+// wait with epoll() and process only the slots that are ready
+static int poll_events_wait_epoll(POLLJOB *p, int timeout_ms, time_t *now) {
+    size_t i, ready = 0;
+
+    // the fds epoll() cannot watch are ready now, if they expect anything
+    for(i = 0; i < p->ready_used ; i++) {
+        size_t slot = p->ready[i];
+        if(p->fds[slot].events & (POLLIN|POLLOUT))
+            p->ready_copy[ready++] = slot;
+    }
+
+    debug(D_POLLFD, "POLLFD: LISTENER: Waiting with epoll() on %zu sockets for %zu ms...", p->used, (size_t)((ready) ? 0 : timeout_ms));
+    int retval = epoll_wait(p->epoll_fd, p->epoll_events, POLL_EPOLL_EVENTS, (ready) ? 0 : timeout_ms);
+    *now = now_boottime_sec();
+
+    if(unlikely(retval == -1)) {
+        error("POLLFD: LISTENER: epoll_wait() failed while waiting on %zu sockets.", p->used);
+        return -1;
+    }
+
+    if(unlikely(!retval && !ready)) {
+        debug(D_POLLFD, "POLLFD: LISTENER: epoll_wait() timeout.");
+        return 0;
+    }
+
+    // set all the revents first - closing or adding a slot while processing
+    // resets its revents, so stale events are not processed
+    int j;
+    for(j = 0; j < retval ; j++) {
+        size_t slot = (size_t)p->epoll_events[j].data.u64;
+        p->fds[slot].revents = epoll_to_poll_events(p->epoll_events[j].events);
+    }
+
+    for(i = 0; i < ready ; i++) {
+        size_t slot = p->ready_copy[i];
+        p->fds[slot].revents = (short int)(p->fds[slot].events & (POLLIN|POLLOUT));
+    }
+
+    for(j = 0; j < retval ; j++) {
+        size_t slot = (size_t)p->epoll_events[j].data.u64;
+        short int revents = p->fds[slot].revents;
+        if(likely(revents))
+            poll_events_process(p, &p->inf[slot], &p->fds[slot], revents, *now);
+    }
+
+    for(i = 0; i < ready ; i++) {
+        size_t slot = p->ready_copy[i];
+        short int revents = p->fds[slot].revents;
+        if(likely(revents))
+            poll_events_process(p, &p->inf[slot], &p->fds[slot], revents, *now);
+    }
+
+    return retval + (int)ready;
+}
+#endif
+
 void poll_events(LISTEN_SOCKETS *sockets
         , void *(*add_callback)(POLLINFO *pi, short int *events, void *data)
         , void  (*del_callback)(POLLINFO *pi)
@@ -1381,6 +1690,15 @@ void poll_events(LISTEN_SOCKETS *sockets
             .inf = NULL,
             .first_free = NULL,
 
+            .epoll_fd = -1,
+#ifdef HAVE_SYS_EPOLL_H
+            .epoll_events = NULL,
+#endif
+            .ready = NULL,
+            .ready_copy = NULL,
+            .ready_used = 0,
+            .ready_size = 0,
+
             .complete_request_timeout = tcp_request_timeout_seconds,
             .idle_timeout = tcp_idle_timeout_seconds,
             .checks_every = (tcp_idle_timeout_seconds / 3) + 1,
@@ -1397,6 +1715,16 @@ void poll_events(LISTEN_SOCKETS *sockets
             .tmr_callback = tmr_callback?tmr_callback:poll_default_tmr_callback
     };
 
+#ifdef HAVE_SYS_EPOLL_H
+    if(poll_events_backend == POLL_EVENTS_BACKEND_EPOLL) {
+        p.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if(p.epoll_fd == -1)
+            error("POLLFD: LISTENER: epoll_create1() failed - using poll()");
+        else
+            p.epoll_events = mallocz(sizeof(struct epoll_event) * POLL_EPOLL_EVENTS);
+    }
+#endif
+
     size_t i;
     for(i = 0; i < sockets->opened ;i++) {
 
@@ -1457,29 +1785,22 @@ void poll_events(LISTEN_SOCKETS *sockets
             for (i = 0; i <= p.max; i++) {
                 if(p.inf[i].flags & POLLINFO_FLAG_SERVER_SOCKET && p.inf[i].socktype == SOCK_STREAM) {
                     p.fds[i].events = (short int) ((listen_sockets_active) ? POLLIN : 0);
+                    poll_epoll_sync(&p, i);
                 }
             }
         }
 
-        debug(D_POLLFD, "POLLFD: LISTENER: Waiting on %zu sockets for %zu ms...", p.max + 1, (size_t)timeout_ms);
-        retval = poll(p.fds, p.max + 1, timeout_ms);
-        time_t now = now_boottime_sec();
+        time_t now;
 
-        if(unlikely(retval == -1)) {
-            error("POLLFD: LISTENER: poll() failed while waiting on %zu sockets.", p.max + 1);
+#ifdef HAVE_SYS_EPOLL_H
+        if(p.epoll_fd != -1)
+            retval = poll_events_wait_epoll(&p, timeout_ms, &now);
+        else
+#endif
+            retval = poll_events_wait_poll(&p, timeout_ms, &now);
+
+        if(unlikely(retval == -1))
             break;
-        }
-        else if(unlikely(!retval)) {
-            debug(D_POLLFD, "POLLFD: LISTENER: poll() timeout.");
-        }
-        else {
-            for (i = 0; i <= p.max; i++) {
-                struct pollfd *pf     = &p.fds[i];
-                short int     revents = pf->revents;
-                if (unlikely(revents))
-                    poll_events_process(&p, &p.inf[i], pf, revents, now);
-            }
-        }
 
         if(unlikely(p.checks_every > 0 && now - last_check > p.checks_every)) {
             last_check = now;
@@ -180,3 +180,192 @@ int hibenchmarks_thread_detach(pthread_t thread) {
 
     return ret;
 }
+
+// ----------------------------------------------------------------------------
+// hibenchmarks_workers_run - a pool of threads executing jobs in parallel
+//
+// The jobs of a run are claimed one by one, by the threads of the pool and
+// the thread that called hibenchmarks_workers_run(), which returns when all of
+// them have been executed. The threads of the pool are started on the first
+// run, and stopped by hibenchmarks_workers_stop().
+
+long hibenchmarks_workers_threads = 0;
+
+struct hibenchmarks_workers_run {
+    void (*execute)(void *data, size_t job);
+    void *data;
+
+    size_t jobs;
+    size_t claimed;     // the jobs taken by a thread
+    size_t completed;   // the jobs executed
+
+    struct hibenchmarks_workers_run *next; // in the queue of the pool, while it has jobs to be claimed
+};
+
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t work;        // a run has been queued, or the pool is stopped
+    pthread_cond_t completed;   // a run has been completed
+
+    struct hibenchmarks_workers_run *queue;
+    int started;
+    int stop;
+
+    hibenchmarks_thread_t *threads;
+    long running;               // the threads created
+} hibenchmarks_workers = {
+        .mutex = PTHREAD_MUTEX_INITIALIZER,
+        .work = PTHREAD_COND_INITIALIZER,
+        .completed = PTHREAD_COND_INITIALIZER,
+        .queue = NULL,
+        .started = 0,
+        .stop = 0,
+        .threads = NULL,
+        .running = 0
+};
+
+// remove a run from the queue - call it with the mutex of the pool locked
+static inline void hibenchmarks_workers_dequeue(struct hibenchmarks_workers_run *run) {
+    struct hibenchmarks_workers_run **p;
+    for(p = &hibenchmarks_workers.queue; *p ; p = &(*p)->next) {
+        if(*p == run) {
+            *p = run->next;
+            break;
+        }
+    }
+}
+
+// claim the next job of a run - call it with the mutex of the pool locked
+static inline int hibenchmarks_workers_claim(struct hibenchmarks_workers_run *run, size_t *job) {
+    if(unlikely(run->claimed >= run->jobs))
+        return 0;
+
+    *job = run->claimed++;
+
+    // the last one is claimed, the run leaves the queue
+    if(unlikely(run->claimed == run->jobs))
+        hibenchmarks_workers_dequeue(run);
+
+    return 1;
+}
+
+static void *hibenchmarks_workers_main(void *ptr) {
+    (void)ptr;
+
+    pthread_mutex_lock(&hibenchmarks_workers.mutex);
+    for(;;) {
+        struct hibenchmarks_workers_run *run = NULL;
+        size_t job = 0;
+
+        // the runs queued are executed, even when the pool is stopped
+        while(!run) {
+            while(!hibenchmarks_workers.queue && !hibenchmarks_workers.stop)
+                pthread_cond_wait(&hibenchmarks_workers.work, &hibenchmarks_workers.mutex);
+
+            if(unlikely(!hibenchmarks_workers.queue))
+                break;
+
+            run = hibenchmarks_workers.queue;
+            if(unlikely(!hibenchmarks_workers_claim(run, &job))) {
+                // all its jobs are claimed already
+                hibenchmarks_workers_dequeue(run);
+                run = NULL;
+            }
+        }
+
+        if(unlikely(!run))
+            break;
+
+        pthread_mutex_unlock(&hibenchmarks_workers.mutex);
+
+        run->execute(run->data, job);
+
+        pthread_mutex_lock(&hibenchmarks_workers.mutex);
+        if(++run->completed == run->jobs)
+            pthread_cond_broadcast(&hibenchmarks_workers.completed);
+    }
+    pthread_mutex_unlock(&hibenchmarks_workers.mutex);
+
+    return NULL;
+}
+
+void hibenchmarks_workers_run(size_t jobs, void (*execute)(void *data, size_t job), void *data) {
+    if(unlikely(!jobs)) return;
+
+    struct hibenchmarks_workers_run run = {
+            .execute = execute,
+            .data = data,
+            .jobs = jobs,
+            .claimed = 0,
+            .completed = 0,
+            .next = NULL
+    };
+
+    pthread_mutex_lock(&hibenchmarks_workers.mutex);
+
+    if(unlikely(!hibenchmarks_workers.started && !hibenchmarks_workers.stop)) {
+        hibenchmarks_workers.started = 1;
+
+        if(hibenchmarks_workers_threads > 0)
+            hibenchmarks_workers.threads = mallocz(hibenchmarks_workers_threads * sizeof(hibenchmarks_thread_t));
+
+        long i;
+        for(i = 0; i < hibenchmarks_workers_threads ; i++) {
+            char tag[HIBENCHMARKS_THREAD_TAG_MAX + 1];
+            snprintfz(tag, HIBENCHMARKS_THREAD_TAG_MAX, "WORKER[%ld]", i + 1);
+
+            if(hibenchmarks_thread_create(&hibenchmarks_workers.threads[hibenchmarks_workers.running], tag, HIBENCHMARKS_THREAD_OPTION_JOINABLE | HIBENCHMARKS_THREAD_OPTION_DONT_LOG, hibenchmarks_workers_main, NULL) != 0)
+                error("Cannot create the worker thread %s.", tag);
+            else
+                hibenchmarks_workers.running++;
+        }
+    }
+
+    // more than one job, the pool gets a share of them
+    if(likely(jobs > 1 && hibenchmarks_workers.running)) {
+        struct hibenchmarks_workers_run **p;
+        for(p = &hibenchmarks_workers.queue; *p ; p = &(*p)->next) ;
+        *p = &run;
+        pthread_cond_broadcast(&hibenchmarks_workers.work);
+    }
+
+    // this thread executes jobs too, so the run completes even without a pool
+    size_t job;
+    while(hibenchmarks_workers_claim(&run, &job)) {
+        pthread_mutex_unlock(&hibenchmarks_workers.mutex);
+        execute(data, job);
+        pthread_mutex_lock(&hibenchmarks_workers.mutex);
+        run.completed++;
+    }
+
+    while(run.completed < run.jobs)
+        pthread_cond_wait(&hibenchmarks_workers.completed, &hibenchmarks_workers.mutex);
+
+    pthread_mutex_unlock(&hibenchmarks_workers.mutex);
+}
+
+// stop the threads of the pool and wait for them to exit
+// the runs in progress are completed - the next run starts the pool again
+void hibenchmarks_workers_stop(void) {
+    pthread_mutex_lock(&hibenchmarks_workers.mutex);
+    if(unlikely(!hibenchmarks_workers.started || hibenchmarks_workers.stop)) {
+        pthread_mutex_unlock(&hibenchmarks_workers.mutex);
+        return;
+    }
+    hibenchmarks_workers.stop = 1;
+    pthread_cond_broadcast(&hibenchmarks_workers.work);
+    pthread_mutex_unlock(&hibenchmarks_workers.mutex);
+
+    // the threads are joined without the mutex, they need it to exit
+    long i;
+    for(i = 0; i < hibenchmarks_workers.running ; i++)
+        hibenchmarks_thread_join(hibenchmarks_workers.threads[i], NULL);
+
+    pthread_mutex_lock(&hibenchmarks_workers.mutex);
+    freez(hibenchmarks_workers.threads);
+    hibenchmarks_workers.threads = NULL;
+    hibenchmarks_workers.running = 0;
+    hibenchmarks_workers.started = 0;
+    hibenchmarks_workers.stop = 0;
+    pthread_mutex_unlock(&hibenchmarks_workers.mutex);
+}
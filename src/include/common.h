@@ -65,6 +65,11 @@
 #include <net/if.h>
 
 #include <poll.h>
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 #include <signal.h>
 #include <syslog.h>
 #include <sys/mman.h>
@@ -265,8 +270,11 @@
 #include "log.h"
 #include "threads.h"
 #include "locks.h"
+#include "string_intern.h"
+#include "hash_index.h"
 #include "simple_pattern.h"
 #include "avl.h"
+#include "slab.h"
 #include "global_statistics.h"
 #include "storage_number.h"
 #include "web_buffer.h"
@@ -312,12 +320,14 @@ typedef enum rrdcalc_status {
 #include "statistical.h"
 #include "socket.h"
 #include "rrd.h"
+#include "rrdengine.h"
 #include "plugin_tc.h"
 #include "plugins_d.h"
 #include "statsd.h"
 #include "rrd2json.h"
 #include "rrd2json_api_old.h"
 #include "web_client.h"
+#include "web_files_cache.h"
 #include "web_server.h"
 #include "registry.h"
 #include "signals.h"
@@ -32,6 +32,19 @@ extern void finished_web_request_statistics(uint64_t dt,
 extern uint64_t web_client_connected(void);
 extern void web_client_disconnected(void);
 
+// ----------------------------------------------------------------------------
+// per web server worker statistics
+// every worker updates only its own counters, so that the balance of the
+// workers can be verified
+
+struct web_worker_statistics {
+    volatile uint64_t connections;
+    volatile uint64_t requests;
+};
+
+extern __thread int web_worker_statistics_id;
+extern void web_workers_statistics_init(size_t workers);
+
 #define GLOBAL_STATS_RESET_WEB_USEC_MAX 0x01
 extern void global_statistics_copy(struct global_statistics *gs, uint8_t options);
 extern void global_statistics_charts(void);
@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: GPL-3.0+
+#ifndef HIBENCHMARKS_HASH_INDEX_H
+#define HIBENCHMARKS_HASH_INDEX_H 1
+
+/*
+ * HASH INDEX
+ * An open addressing (linear probing) hash table of items that have
+ * a string key (a const char * member) and a hash of it (simple_hash()).
+ *
+ * The slots keep the hash of each item, so that probing does not have to
+ * touch the items - only the item that has the same hash is compared,
+ * with a pointer comparison first (the keys are usually interned).
+ *
+ * All functions lock the index - searches with a read lock, the rest
+ * with a write lock.
+ */
+
+typedef struct hash_index_slot {
+    uint32_t hash;
+    void *item;                 // NULL when empty, HASH_INDEX_DELETED when deleted
+} HASH_INDEX_SLOT;
+
+typedef struct hash_index {
+    HASH_INDEX_SLOT *slots;
+    size_t size;                // the number of slots, a power of 2 (or 0)
+    size_t used;                // the items in the index
+    size_t deleted;             // the slots marked deleted
+
+    size_t key_offset;          // the offset of the key in the items
+
+    hibenchmarks_rwlock_t rwlock;
+} HASH_INDEX;
+
+#define HASH_INDEX_DELETED ((void *)1)
+#define HASH_INDEX_MIN_SIZE 8
+
+extern void hash_index_init(HASH_INDEX *index, size_t key_offset);
+extern void hash_index_destroy(HASH_INDEX *index);
+
+// returns item, or the item already in the index with the same key
+extern void *hash_index_insert(HASH_INDEX *index, void *item, uint32_t hash);
+
+// returns item, or NULL if item is not in the index
+extern void *hash_index_remove(HASH_INDEX *index, void *item, uint32_t hash);
+
+extern void *hash_index_search(HASH_INDEX *index, const char *key, uint32_t hash);
+
+#endif /* HIBENCHMARKS_HASH_INDEX_H */
@@ -14,8 +14,8 @@ extern int gap_when_lost_iterations_above;
 
 #define RRD_ID_LENGTH_MAX 200
 
-#define RRDSET_MAGIC        "HIBENCHMARKS RRD SET FILE V019"
-#define RRDDIMENSION_MAGIC  "HIBENCHMARKS RRD DIMENSION FILE V019"
+#define RRDSET_MAGIC        "HIBENCHMARKS RRD SET FILE V020"
+#define RRDDIMENSION_MAGIC  "HIBENCHMARKS RRD DIMENSION FILE V020"
 
 typedef long long total_number;
 #define TOTAL_NUMBER_FORMAT "%lld"
@@ -49,7 +49,10 @@ typedef enum rrd_memory_mode {
     RRD_MEMORY_MODE_RAM  = 1,
     RRD_MEMORY_MODE_MAP  = 2,
     RRD_MEMORY_MODE_SAVE = 3,
-    RRD_MEMORY_MODE_ALLOC = 4
+    RRD_MEMORY_MODE_ALLOC = 4,
+    RRD_MEMORY_MODE_TIERED = 5,
+    RRD_MEMORY_MODE_COMPRESSED = 6,
+    RRD_MEMORY_MODE_DBENGINE = 7
 } RRD_MEMORY_MODE;
 
 #define RRD_MEMORY_MODE_NONE_NAME "none"
@@ -57,6 +60,12 @@ typedef enum rrd_memory_mode {
 #define RRD_MEMORY_MODE_MAP_NAME "map"
 #define RRD_MEMORY_MODE_SAVE_NAME "save"
 #define RRD_MEMORY_MODE_ALLOC_NAME "alloc"
+#define RRD_MEMORY_MODE_TIERED_NAME "tiered"
+#define RRD_MEMORY_MODE_COMPRESSED_NAME "compressed"
+#define RRD_MEMORY_MODE_DBENGINE_NAME "dbengine"
+
+// the memory modes that keep the history of dimensions in compressed pages
+#define rrd_memory_mode_has_pages(mode) ((mode) == RRD_MEMORY_MODE_COMPRESSED || (mode) == RRD_MEMORY_MODE_DBENGINE)
 
 extern RRD_MEMORY_MODE default_rrd_memory_mode;
 
@@ -64,6 +73,153 @@ extern const char *rrd_memory_mode_name(RRD_MEMORY_MODE id);
 extern RRD_MEMORY_MODE rrd_memory_mode_id(const char *name);
 
 
+// ----------------------------------------------------------------------------
+// storage format - the width of the values kept in the round robin database
+
+typedef enum rrd_storage_format {
+    RRD_STORAGE_FORMAT_32BIT = 0,                   // storage_number, 24-bit mantissa
+    RRD_STORAGE_FORMAT_64BIT = 1                    // storage_number64, a double
+} RRD_STORAGE_FORMAT;
+
+#define RRD_STORAGE_FORMAT_32BIT_NAME "32bit"
+#define RRD_STORAGE_FORMAT_64BIT_NAME "64bit"
+
+#define rrd_storage_format_size(format) (((format) == RRD_STORAGE_FORMAT_64BIT) ? sizeof(storage_number64) : sizeof(storage_number))
+
+extern const char *rrd_storage_format_name(RRD_STORAGE_FORMAT id);
+extern RRD_STORAGE_FORMAT rrd_storage_format_id(const char *name);
+
+
+// ----------------------------------------------------------------------------
+// tiers - downsampled copies of the collected data (memory mode tiered)
+
+#define RRD_STORAGE_TIERS 2                         // tier 0 = per-minute, tier 1 = per-hour
+#define RRD_TIER_GROUPING 60                        // every tier slot groups 60 slots of the previous level
+
+#define RRD_TIER0_DEFAULT_HISTORY_ENTRIES (7 * 1440) // one week of per-minute slots
+#define RRD_TIER1_DEFAULT_HISTORY_ENTRIES (365 * 24) // one year of per-hour slots
+
+extern long default_rrd_tier_history_entries[RRD_STORAGE_TIERS];
+
+// a downsampled slot
+// count is the number of collected values that were aggregated in it
+// 0 means the slot is empty
+typedef struct rrd_tier_slot {
+    storage_number min;
+    storage_number max;
+    storage_number sum;
+    uint32_t count;
+} RRD_TIER_SLOT;
+
+// the round robin state of a tier of a chart
+// the members have the same names with the RRDSET ones, so that the
+// rrdset_*_slot(), rrdset_*_entry_t() and rrdset_time2slot() macros can be used on tiers too
+struct rrdset_tier {
+    int update_every;                               // the duration of each slot in seconds
+    long entries;                                   // the number of slots
+    long current_entry;                             // the slot that will be written next
+    size_t counter;                                 // the number of slots written so far
+    struct timeval last_updated;                    // the end of the time covered by the last slot written
+};
+
+// the per dimension state of a tier
+struct rrddim_tier {
+    calculated_number min;                          // the slot being aggregated, not stored yet
+    calculated_number max;
+    calculated_number sum;
+    uint32_t count;
+
+    RRD_TIER_SLOT *slots;                           // the round robin array of the stored slots
+};
+
+// ----------------------------------------------------------------------------
+// summaries - the min, max, sum and count of every RRDDIM_SUMMARY_SLOTS slots
+// of the round robin database of each dimension
+//
+// they are kept in every memory mode, next to the slots they summarize, so
+// that the queries grouping many slots (badges, alarm lookups, sparklines)
+// read one summary instead of RRDDIM_SUMMARY_SLOTS slots.
+
+#define RRDDIM_SUMMARY_SLOTS 60
+
+extern int rrddim_summaries_enabled;
+
+// min and max are by absolute value, like the grouping methods min and max
+typedef struct rrddim_summary {
+    calculated_number min;                          // the value with the smallest absolute value, the newest on ties
+    calculated_number max;                          // the value with the biggest absolute value, the newest on ties
+    calculated_number sum;
+    uint32_t count;                                 // the number of values that exist, 0 = all empty
+    uint32_t reset;                                 // 1 when any of the values has SN_EXISTS_RESET
+    time_t last_t;                                  // the time of the last slot summarized, 0 = not valid
+} RRDDIM_SUMMARY;
+
+// the per dimension state of the summaries
+struct rrddim_summaries {
+    RRDDIM_SUMMARY open;                            // the block being stored, not complete yet
+    long next_slot;                                 // the slot that continues the open block
+    time_t next_t;                                  // and its time
+    int open_valid;                                 // 0 when a slot of the open block was missed or stored twice
+
+    RRDDIM_SUMMARY *blocks;                         // the complete blocks, one per RRDDIM_SUMMARY_SLOTS slots
+};
+
+// add newer to the summary s
+static inline void rrddim_summary_merge(RRDDIM_SUMMARY *s, const RRDDIM_SUMMARY *newer) {
+    s->reset |= newer->reset;
+
+    if(unlikely(!newer->count))
+        return;
+
+    if(unlikely(!s->count)) {
+        s->min = newer->min;
+        s->max = newer->max;
+        s->sum = newer->sum;
+        s->count = newer->count;
+        return;
+    }
+
+    if(calculated_number_fabs(newer->min) <= calculated_number_fabs(s->min)) s->min = newer->min;
+    if(calculated_number_fabs(newer->max) >= calculated_number_fabs(s->max)) s->max = newer->max;
+    s->sum += newer->sum;
+    s->count += newer->count;
+}
+
+
+// ----------------------------------------------------------------------------
+// compressed pages - the history of a dimension in memory mode compressed
+//
+// the round robin database of each dimension is split in pages of
+// RRDDIM_PAGE_ENTRIES slots. Only the page being written is kept
+// uncompressed (in rd->values), all the others are XOR encoded.
+
+#define RRDDIM_PAGE_ENTRIES 256
+
+// the worst case size of a compressed page of n entries
+// the first value needs 32 bits, every other value up to 44 bits
+#define RRDDIM_PAGE_MAX_BYTES(n) ((size_t)(32 + 44 * (n) + 7) / 8)
+
+struct rrddim_page {
+    uint32_t bytes;                                 // the size of data
+    uint8_t data[];                                 // the compressed values
+};
+
+// the per dimension state of the compressed pages
+struct rrddim_pages {
+    hibenchmarks_mutex_t mutex;                     // serializes page switches with queries
+
+    long pages;                                     // the number of pages of the dimension
+    long current_page;                              // the page kept uncompressed in rd->values
+    size_t compressed_bytes;                        // the memory used by the compressed pages
+
+    long last_slot;                                 // the last slot written in the current page, -1 when none
+    time_t last_slot_t;                             // the time of the last slot written
+    long flushed_slots;                             // the slots of the current page already saved to the dbengine
+
+    struct rrddim_page **page;                      // the compressed pages, NULL when empty
+};
+
+
 // ----------------------------------------------------------------------------
 // algorithms types
 
@@ -125,23 +281,18 @@ typedef enum rrddim_flags {
 // RRD DIMENSION - this is a metric
 
 struct rrddim {
-    // ------------------------------------------------------------------------
-    // binary indexing structures
-
-    avl avl;                                        // the binary index - this has to be first member!
-
     // ------------------------------------------------------------------------
     // the dimension definition
 
-    const char *id;                                 // the id of this dimension (for internal identification)
+    const char *id;                                 // the id of this dimension (for internal identification) (interned)
     const char *name;                               // the name of this dimension (as presented to user)
-                                                    // this is a pointer to the config structure
+                                                    // this is interned from the config structure
                                                     // since the config always has a higher priority
                                                     // (the user overwrites the name of the charts)
-                                                    // DO NOT FREE THIS - IT IS ALLOCATED IN CONFIG
 
     RRD_ALGORITHM algorithm;                        // the algorithm that is applied to add new collected values
     RRD_MEMORY_MODE rrd_memory_mode;                // the memory mode for this dimension
+    RRD_STORAGE_FORMAT storage_format;              // the width of the values, the same with the chart
 
     collected_number multiplier;                    // the multiplier of the collected values
     collected_number divisor;                       // the divider of the collected values
@@ -159,22 +310,20 @@ struct rrddim {
 
     char *cache_filename;                           // the filename we load/save from/to this set
 
-    size_t collections_counter;                     // the number of times we added values to this rrdim
+    size_t collection_slot;                         // the slot of this dimension in the collection arrays of its chart
     size_t unused[10];
 
-    int updated:1;                                  // 1 when the dimension has been updated since the last processing
     int exposed:1;                                  // 1 when set what have sent this dimension to the central hibenchmarks
 
     struct timeval last_collected_time;             // when was this dimension last updated
                                                     // this is actual date time we updated the last_collected_value
                                                     // THIS IS DIFFERENT FROM THE SAME MEMBER OF RRDSET
 
-    calculated_number calculated_value;             // the current calculated value, after applying the algorithm - resets to zero after being used
-    calculated_number last_calculated_value;        // the last calculated value processed
+    // the collection state (the collected and calculated values) is kept by the chart
+    // in struct rrdset_collection - these are copies, updated by rrdset_done()
+    // so that health variables and backends can point to them
 
     calculated_number last_stored_value;            // the last value as stored in the database (after interpolation)
-
-    collected_number collected_value;               // the current value, as collected - resets to 0 after being used
     collected_number last_collected_value;          // the last value that was collected, after being processed
 
     char* collected_string_value;
@@ -203,13 +352,54 @@ struct rrddim {
 
     struct rrddimvar *variables;
 
+    struct rrddim_tier *tiers;                      // RRD_STORAGE_TIERS downsampled copies, or NULL
+    struct rrddim_summaries *summaries;             // the summaries of blocks of slots, or NULL
+    struct rrddim_pages *pages;                     // the compressed history, or NULL
+    struct rrdeng_metric *rrdeng_metric;            // the history of the dimension in the dbengine, or NULL
+
     // ------------------------------------------------------------------------
     // the values stored in this dimension, using our floating point numbers
+    // with storage format 64bit, these are storage_number64 - use rrddim_values64()
+    // in the memory mapped modes they follow the structure, in the same file
+    // (the structure ends with this pointer, so it is aligned for them)
+    // in the other modes they are allocated separately from the structure
 
-    storage_number values[];                        // the array of values - THIS HAS TO BE THE LAST MEMBER
+    storage_number *values;                         // the array of values
 };
 typedef struct rrddim RRDDIM;
 
+// ----------------------------------------------------------------------------
+// RRDSET collection state
+//
+// the values being collected for the dimensions of a chart, kept in contiguous
+// arrays indexed by rd->collection_slot, so that rrdset_done() walks tight
+// arrays instead of the linked list of the dimensions.
+// slots are added by rrddim_add() and removed by rrddim_free(), with the chart
+// write locked.
+
+struct rrdset_collection {
+    size_t size;                                    // the number of slots allocated
+    size_t used;                                    // the number of slots used
+
+    RRDDIM **rd;                                    // the dimension of every slot
+
+    uint8_t *updated;                               // 1 when the dimension has been updated since the last processing
+    size_t *collections_counter;                    // the number of times we added values to the dimension
+
+    RRD_ALGORITHM *algorithm;                       // copies of the dimension configuration
+    calculated_number *multiplier;
+    calculated_number *divisor;
+
+    collected_number *collected_value;              // the current value, as collected - resets to 0 after being used
+    collected_number *last_collected_value;         // the last value that was collected, after being processed
+
+    calculated_number *calculated_value;            // the current calculated value, after applying the algorithm - resets to zero after being used
+    calculated_number *last_calculated_value;       // the last calculated value processed
+};
+
+// access the collection state of a dimension
+#define rrddim_collection(rd, member) ((rd)->rrdset->collection.member[(rd)->collection_slot])
+
 // ----------------------------------------------------------------------------
 // these loop macros make sure the linked list is accessed with the right lock
 
@@ -253,30 +443,24 @@ typedef enum rrdset_flags {
 #endif
 
 struct rrdset {
-    // ------------------------------------------------------------------------
-    // binary indexing structures
-
-    avl avl;                                        // the index, with key the id - this has to be first!
-    avl avlname;                                    // the index, with key the name
-
     // ------------------------------------------------------------------------
     // the set configuration
 
-    char id[RRD_ID_LENGTH_MAX + 1];                 // id of the data set
+    const char *id;                                 // id of the data set (interned)
 
     const char *name;                               // the name of this dimension (as presented to user)
-                                                    // this is a pointer to the config structure
+                                                    // this is interned from the config structure
                                                     // since the config always has a higher priority
                                                     // (the user overwrites the name of the charts)
 
     char *config_section;                           // the config section for the chart
 
     char *type;                                     // the type of graph RRD_TYPE_* (a category, for determining graphing options)
-    char *family;                                   // grouping sets under the same family
+    const char *family;                             // grouping sets under the same family (interned)
     char *title;                                    // title shown to user
-    char *units;                                    // units of measurement
+    const char *units;                              // units of measurement (interned)
 
-    char *context;                                  // the template of this data set
+    const char *context;                            // the template of this data set (interned)
     uint32_t hash_context;                          // the hash of the chart's context
 
     RRDSET_TYPE chart_type;                         // line, area, stacked
@@ -300,20 +484,24 @@ struct rrdset {
     // members for temporary data we need for calculations
 
     RRD_MEMORY_MODE rrd_memory_mode;                // if set to 1, this is memory mapped
+    RRD_STORAGE_FORMAT storage_format;              // the width of the values of all its dimensions
 
     char *cache_dir;                                // the directory to store dimensions
     char cache_filename[FILENAME_MAX+1];            // the filename to store this set
 
     hibenchmarks_rwlock_t rrdset_rwlock;                 // protects dimensions linked list
 
+    size_t seq;                                     // odd while rrdset_done() stores a slot, seq / 2 is the slots stored
+    size_t readers;                                 // the queries reading the chart without its lock
+
     size_t counter;                                 // the number of times we added values to this database
     size_t counter_done;                            // the number of times rrdset_done() has been called
 
     time_t last_accessed_time;                      // the last time this RRDSET has been accessed
     time_t upstream_resync_time;                    // the timestamp up to which we should resync clock upstream
 
-    char *plugin_name;                              // the name of the plugin that generated this
-    char *module_name;                              // the name of the plugin module that generated this
+    const char *plugin_name;                        // the name of the plugin that generated this (interned)
+    const char *module_name;                        // the name of the plugin module that generated this (interned)
 
     size_t unused[6];
 
@@ -351,13 +539,20 @@ struct rrdset {
     unsigned long memsize;                          // how much mem we have allocated for this (without dimensions)
 
     char magic[sizeof(RRDSET_MAGIC) + 1];           // our magic
+    char cache_id[RRD_ID_LENGTH_MAX + 1];           // the id of the chart, saved to check the file (the id is interned)
+
+    // ------------------------------------------------------------------------
+    // downsampled tiers (memory mode tiered)
+
+    struct rrdset_tier tiers[RRD_STORAGE_TIERS];
 
     // ------------------------------------------------------------------------
     // the dimensions
 
-    avl_tree_lock dimensions_index;                 // the root of the dimensions index
+    HASH_INDEX dimensions_index;                    // the dimensions index (by id)
     RRDDIM *dimensions;                             // the actual data for every dimension
 
+    struct rrdset_collection collection;            // the collection state of the dimensions
 };
 typedef struct rrdset RRDSET;
 
@@ -365,6 +560,69 @@ typedef struct rrdset RRDSET;
 #define rrdset_wrlock(st) hibenchmarks_rwlock_wrlock(&((st)->rrdset_rwlock))
 #define rrdset_unlock(st) hibenchmarks_rwlock_unlock(&((st)->rrdset_rwlock))
 
+// ----------------------------------------------------------------------------
+// RRDSET lock-free readers of the round robin database
+//
+// rrdset_done() is the only writer of the round robin database of a chart.
+// It makes st->seq odd before storing a slot, and even again after it,
+// adding 2 for every slot stored.
+//
+// Queries do not take the chart lock, so that they never delay data collection:
+//  - rrdset_read_begin() / rrdset_read_end() keep the chart from being freed
+//  - rrdset_ring_snapshot() copies a consistent state of the round robin database
+//  - rrdset_ring_overwritten() checks if the slots read were overwritten meanwhile
+//
+// Dimensions are appended to a chart, and freed only with it, so readers
+// can walk the dimensions they have counted.
+//
+// rrdset_free() does not wait for the readers. It removes the chart from its
+// host and sets RRDSET_READERS_FREED on its readers. The last reader to call
+// rrdset_read_end() frees the memory of the chart.
+
+#define RRDSET_READERS_FREED ((size_t)1 << (sizeof(size_t) * 8 - 1))
+
+#if defined(HAVE_C___ATOMIC) && !defined(HIBENCHMARKS_NO_ATOMIC_INSTRUCTIONS)
+#define rrdset_seq_load(st) __atomic_load_n(&(st)->seq, __ATOMIC_ACQUIRE)
+#define rrdset_seq_store(st, value) __atomic_store_n(&(st)->seq, (value), __ATOMIC_RELEASE)
+#define rrdset_seq_fence() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define rrdset_read_begin(st) __atomic_add_fetch(&(st)->readers, 1, __ATOMIC_SEQ_CST)
+#define rrdset_readers_sub(st, n) __atomic_sub_fetch(&(st)->readers, (n), __ATOMIC_SEQ_CST)
+#define rrdset_readers_add(st, n) __atomic_add_fetch(&(st)->readers, (n), __ATOMIC_SEQ_CST)
+#define rrdset_readers(st) (__atomic_load_n(&(st)->readers, __ATOMIC_SEQ_CST) & ~RRDSET_READERS_FREED)
+#else
+#define rrdset_seq_load(st) ({ size_t _seq = *((volatile size_t *)&(st)->seq); __sync_synchronize(); _seq; })
+#define rrdset_seq_store(st, value) do { __sync_synchronize(); *((volatile size_t *)&(st)->seq) = (value); } while(0)
+#define rrdset_seq_fence() __sync_synchronize()
+#define rrdset_read_begin(st) __sync_add_and_fetch(&(st)->readers, 1)
+#define rrdset_readers_sub(st, n) __sync_sub_and_fetch(&(st)->readers, (n))
+#define rrdset_readers_add(st, n) __sync_add_and_fetch(&(st)->readers, (n))
+#define rrdset_readers(st) (__sync_add_and_fetch(&(st)->readers, 0) & ~RRDSET_READERS_FREED)
+#endif
+
+extern void rrdset_free(RRDSET *st);
+extern void rrdset_free_deferred(RRDSET *st);
+
+static inline void rrdset_read_end(RRDSET *st) {
+    // the chart has been freed, while we were reading it
+    if(unlikely(rrdset_readers_sub(st, 1) == RRDSET_READERS_FREED))
+        rrdset_free_deferred(st);
+}
+
+// called by the data collection thread, before changing the round robin database
+static inline void rrdset_ring_write_begin(RRDSET *st) {
+    rrdset_seq_store(st, st->seq + 1);
+    rrdset_seq_fence();
+}
+
+// called by the data collection thread, after changing slots of the round robin database
+// slots should be at least 1, so that readers notice all the changes
+static inline void rrdset_ring_write_end(RRDSET *st, size_t slots) {
+    rrdset_seq_store(st, st->seq + 2 * slots - 1);
+}
+
+extern size_t rrdset_ring_snapshot(RRDSET *st, struct rrdset_tier *ring);
+extern int rrdset_ring_overwritten(RRDSET *st, struct rrdset_tier *ring, size_t seq, long oldest_slot);
+
 
 // ----------------------------------------------------------------------------
 // these loop macros make sure the linked list is accessed with the right lock
@@ -438,6 +696,8 @@ struct rrdhost {
     char *cache_dir;                                // the directory to save RRD cache files
     char *varlib_dir;                               // the directory to save health log
 
+    struct rrdengine *rrdeng;                       // the datafiles of memory mode dbengine, or NULL
+
     char *program_name;                             // the program name that collects metrics for this host
     char *program_version;                          // the program version that collects metrics for this host
 
@@ -506,6 +766,10 @@ struct rrdhost {
 
     RRDSET *rrdset_root;                            // the host charts
 
+    SLAB_SET slabs;                                 // the memory of its charts, dimensions, their variables and names
+                                                    // it is released all together when the host is freed
+
+    size_t rrdset_deferred;                         // the charts freed, that are still read by queries
 
     // ------------------------------------------------------------------------
     // locks
@@ -515,8 +779,8 @@ struct rrdhost {
     // ------------------------------------------------------------------------
     // indexes
 
-    avl_tree_lock rrdset_root_index;                // the host's charts index (by id)
-    avl_tree_lock rrdset_root_index_name;           // the host's charts index (by name)
+    HASH_INDEX rrdset_root_index;                   // the host's charts index (by id)
+    HASH_INDEX rrdset_root_index_name;              // the host's charts index (by name)
 
     avl_tree_lock rrdfamily_root_index;             // the host's chart families index
     avl_tree_lock rrdvar_root_index;                // the host's chart variables index
@@ -619,10 +883,11 @@ extern RRDSET *rrdset_create_custom(RRDHOST *host
                              , int update_every
                              , RRDSET_TYPE chart_type
                              , RRD_MEMORY_MODE memory_mode
-                             , long history_entries);
+                             , long history_entries
+                             , RRD_STORAGE_FORMAT storage_format);
 
 #define rrdset_create(host, type, id, name, family, context, title, units, plugin, module, priority, update_every, chart_type) \
-    rrdset_create_custom(host, type, id, name, family, context, title, units, plugin, module, priority, update_every, chart_type, (host)->rrd_memory_mode, (host)->rrd_history_entries)
+    rrdset_create_custom(host, type, id, name, family, context, title, units, plugin, module, priority, update_every, chart_type, (host)->rrd_memory_mode, (host)->rrd_history_entries, RRD_STORAGE_FORMAT_32BIT)
 
 #define rrdset_create_localhost(type, id, name, family, context, title, units, plugin, module, priority, update_every, chart_type) \
     rrdset_create(localhost, type, id, name, family, context, title, units, plugin, module, priority, update_every, chart_type)
@@ -695,6 +960,16 @@ extern void rrdset_isnot_obsolete(RRDSET *st);
                 ( (rrdset_last_slot(st) - (unsigned long)(slot)) )) \
         ))
 
+// ----------------------------------------------------------------------------
+// RRDSET tiers functions
+
+extern void rrdset_tiers_init(RRDSET *st);
+extern void rrdset_tiers_store(RRDSET *st, time_t now);
+extern struct rrdset_tier *rrdset_tier_for_query(RRDSET *st, time_t after, time_t before, long points, int *tier_id);
+extern time_t rrdset_tiers_first_entry_t(RRDSET *st);
+
+#define rrdset_has_tiers(st) ((st)->rrd_memory_mode == RRD_MEMORY_MODE_TIERED)
+
 // ----------------------------------------------------------------------------
 // RRD DIMENSION functions
 
@@ -717,6 +992,110 @@ extern collected_number rrddim_set(RRDSET *st, const char *id, collected_number
 
 extern long align_entries_to_pagesize(RRD_MEMORY_MODE mode, long entries);
 
+extern void rrddim_tiers_init(RRDSET *st, RRDDIM *rd);
+extern void rrddim_tiers_free(RRDDIM *rd);
+extern void rrddim_tiers_add(RRDDIM *rd, calculated_number value);
+
+extern void rrddim_summaries_init(RRDSET *st, RRDDIM *rd);
+extern void rrddim_summaries_free(RRDDIM *rd);
+extern void rrddim_summary_add(RRDDIM *rd, long slot, time_t t, calculated_number value, int reset);
+
+// ----------------------------------------------------------------------------
+// RRD DIMENSION compressed pages functions
+
+extern size_t storage_number_page_compress(const storage_number *values, long entries, uint8_t *data);
+extern void storage_number_page_decompress(const uint8_t *data, size_t bytes, storage_number *values, long entries);
+
+extern void rrddim_pages_init(RRDSET *st, RRDDIM *rd);
+extern void rrddim_pages_free(RRDDIM *rd);
+extern void rrddim_pages_flush(RRDDIM *rd);
+extern void rrddim_page_store(RRDDIM *rd, long slot, time_t t, storage_number n);
+extern storage_number rrddim_page_value(RRDDIM *rd, long slot);
+
+#define rrddim_page_of_slot(slot) ((slot) / RRDDIM_PAGE_ENTRIES)
+
+// store a value in a slot of the round robin database of a dimension
+// t is the time of the slot
+static inline void rrddim_store_slot(RRDDIM *rd, long slot, time_t t, storage_number n) {
+    if(unlikely(rd->pages))
+        rrddim_page_store(rd, slot, t, n);
+    else
+        rd->values[slot] = n;
+}
+
+// get the value of a slot of the round robin database of a dimension
+// for scanning many slots, use a page iterator
+static inline storage_number rrddim_slot_value(RRDDIM *rd, long slot) {
+    if(unlikely(rd->pages))
+        return rrddim_page_value(rd, slot);
+
+    return rd->values[slot];
+}
+
+// ----------------------------------------------------------------------------
+// RRD DIMENSION storage formats
+//
+// the charts with storage format 64bit keep storage_number64 values in
+// rd->values. They do not have compressed pages (the memory modes with pages
+// switch them to 32bit), so their values are always in rd->values.
+// Loops that scan many slots should check the format once and use the
+// specialized accessors.
+
+#define rrddim_values64(rd) ((storage_number64 *)(rd)->values)
+
+// store a value in a slot of the round robin database of a dimension, in any storage format
+// the summaries get the value as it is stored, so that they match the slots
+static inline void rrddim_store_value(RRDDIM *rd, long slot, time_t t, calculated_number value, uint32_t flags) {
+    if(unlikely(rd->storage_format == RRD_STORAGE_FORMAT_64BIT)) {
+        storage_number64 n = pack_storage_number64(value, flags);
+        rrddim_values64(rd)[slot] = n;
+
+        if(likely(rd->summaries))
+            rrddim_summary_add(rd, slot, t, (does_storage_number64_exist(n)) ? unpack_storage_number64(n) : NAN, did_storage_number64_reset(n));
+    }
+    else {
+        storage_number n = pack_storage_number(value, flags);
+        rrddim_store_slot(rd, slot, t, n);
+
+        if(likely(rd->summaries))
+            rrddim_summary_add(rd, slot, t, (does_storage_number_exist(n)) ? unpack_storage_number(n) : NAN, did_storage_number_reset(n));
+    }
+}
+
+// get the value of a slot of the round robin database of a dimension, in any storage format
+// returns the flags of the slot - the value is valid only when it exists
+static inline uint32_t rrddim_slot_get(RRDDIM *rd, long slot, calculated_number *value) {
+    if(unlikely(rd->storage_format == RRD_STORAGE_FORMAT_64BIT)) {
+        storage_number64 n = rrddim_values64(rd)[slot];
+        *value = unpack_storage_number64(n);
+        return get_storage_number64_flags(n);
+    }
+
+    storage_number n = rrddim_slot_value(rd, slot);
+    *value = unpack_storage_number(n);
+    return get_storage_number_flags(n);
+}
+
+// a page iterator decodes the page of a dimension once, and then
+// serves all the slots of it from its own buffer.
+typedef struct rrddim_page_iterator {
+    RRDDIM *rd;
+    long page;                                      // the page decoded in values, -1 when none
+    storage_number values[RRDDIM_PAGE_ENTRIES];
+} RRDDIM_PAGE_ITERATOR;
+
+extern void rrddim_page_iterator_init(RRDDIM_PAGE_ITERATOR *it, RRDDIM *rd);
+extern void rrddim_page_iterator_load(RRDDIM_PAGE_ITERATOR *it, long page);
+
+static inline storage_number rrddim_page_iterator_get(RRDDIM_PAGE_ITERATOR *it, long slot) {
+    long page = rrddim_page_of_slot(slot);
+
+    if(unlikely(page != it->page))
+        rrddim_page_iterator_load(it, page);
+
+    return it->values[slot - page * RRDDIM_PAGE_ENTRIES];
+}
+
 // ----------------------------------------------------------------------------
 // RRD internal functions
 
@@ -729,20 +1108,20 @@ extern char *rrdset_cache_dir(RRDHOST *host, const char *id, const char *config_
 
 extern void rrddim_free(RRDSET *st, RRDDIM *rd);
 
-extern int rrddim_compare(void* a, void* b);
-extern int rrdset_compare(void* a, void* b);
-extern int rrdset_compare_name(void* a, void* b);
 extern int rrdfamily_compare(void *a, void *b);
 
 extern RRDFAMILY *rrdfamily_create(RRDHOST *host, const char *id);
 extern void rrdfamily_free(RRDHOST *host, RRDFAMILY *rc);
 
-#define rrdset_index_add(host, st) (RRDSET *)avl_insert_lock(&((host)->rrdset_root_index), (avl *)(st))
-#define rrdset_index_del(host, st) (RRDSET *)avl_remove_lock(&((host)->rrdset_root_index), (avl *)(st))
+#define rrdset_index_add(host, st) (RRDSET *)hash_index_insert(&((host)->rrdset_root_index), (st), (st)->hash)
+#define rrdset_index_del(host, st) (RRDSET *)hash_index_remove(&((host)->rrdset_root_index), (st), (st)->hash)
 extern RRDSET *rrdset_index_del_name(RRDHOST *host, RRDSET *st);
 
-extern void rrdset_free(RRDSET *st);
 extern void rrdset_reset(RRDSET *st);
+
+extern void rrdset_collection_add(RRDSET *st, RRDDIM *rd);
+extern void rrdset_collection_del(RRDSET *st, RRDDIM *rd);
+extern void rrdset_collection_free(RRDSET *st);
 extern void rrdset_save(RRDSET *st);
 extern void rrdset_delete(RRDSET *st);
 
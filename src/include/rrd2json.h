@@ -19,6 +19,7 @@
 #define DATASOURCE_JS_ARRAY 8
 #define DATASOURCE_SSV_COMMA 9
 #define DATASOURCE_CSV_JSON_ARRAY 10
+#define DATASOURCE_BINARY 11
 
 #define DATASOURCE_FORMAT_JSON "json"
 #define DATASOURCE_FORMAT_DATATABLE_JSON "datatable"
@@ -31,6 +32,27 @@
 #define DATASOURCE_FORMAT_JS_ARRAY "array"
 #define DATASOURCE_FORMAT_SSV_COMMA "ssvcomma"
 #define DATASOURCE_FORMAT_CSV_JSON_ARRAY "csvjsonarray"
+#define DATASOURCE_FORMAT_BINARY "binary"
+
+// the binary format - all numbers are little endian, all arrays are 8 bytes aligned
+//
+//  header      RRDR_BINARY_HEADER
+//  names       'id\0name\0' of every dimension, zero padded to names_bytes
+//  timestamps  rows x float64, in seconds (milliseconds with option ms)
+//  values      dimensions x rows x float64, a column per dimension, NaN for null
+#define RRDR_BINARY_MAGIC "HBRR"
+#define RRDR_BINARY_VERSION 1
+
+typedef struct rrdr_binary_header {
+    char magic[4];
+    uint32_t version;
+    uint32_t dimensions;
+    uint32_t rows;
+    uint32_t update_every;
+    uint32_t names_bytes;
+    double after;
+    double before;
+} RRDR_BINARY_HEADER;
 
 #define ALLMETRICS_FORMAT_SHELL                 "shell"
 #define ALLMETRICS_FORMAT_PROMETHEUS            "prometheus"
@@ -48,6 +70,12 @@
 #define GROUP_MAX               3
 #define GROUP_SUM               4
 #define GROUP_INCREMENTAL_SUM   5
+#define GROUP_MEDIAN            6
+#define GROUP_PERCENTILE95      7
+#define GROUP_PERCENTILE99      8
+#define GROUP_STDDEV            9
+#define GROUP_CV                10 // the coefficient of variation, as a percentage
+#define GROUP_RATE              11 // the change per second
 
 #define RRDR_OPTION_NONZERO         0x00000001 // don't output dimensions will just zero values
 #define RRDR_OPTION_REVERSED        0x00000002 // output the rows in reverse order (oldest to newest)
@@ -73,9 +101,50 @@ extern void rrd_stats_api_v1_charts_allmetrics_json(RRDHOST *host, BUFFER *wb);
 extern void rrd_stats_api_v1_charts_allmetrics_shell(RRDHOST *host, BUFFER *wb);
 
 extern int rrdset2anything_api_v1(RRDSET *st, BUFFER *out, BUFFER *dimensions, uint32_t format, long points
+                            , long long after, long long before, int group_method, long group_time, uint32_t options
+                            , const char *cursor, time_t *latest_timestamp);
+
+// the results of more than rrdr_stream_values values, are streamed a block of rows at a time
+typedef struct rrdr_stream RRDR_STREAM;
+
+extern long rrdr_stream_values;
+extern RRDR_STREAM *rrdset2anything_api_v1_stream(RRDSET *st, BUFFER *out, BUFFER *dimensions, uint32_t format, long points
+                            , long long after, long long before, int group_method, long group_time, uint32_t options);
+extern int rrdr_stream_next(RRDR_STREAM *s, BUFFER *out);
+extern void rrdr_stream_free(RRDR_STREAM *s);
+
+// the aggregation of the dimensions of the charts of a context
+#define RRDR_AGGREGATION_SUM        0
+#define RRDR_AGGREGATION_AVERAGE    1
+#define RRDR_AGGREGATION_MIN        2
+#define RRDR_AGGREGATION_MAX        3
+
+extern int rrdcontext2anything_api_v1(RRDHOST *host, const char *context, const char *hosts, const char *charts, int aggregation
+                            , BUFFER *out, BUFFER *dimensions, uint32_t format, long points
                             , long long after, long long before, int group_method, long group_time, uint32_t options
                             , time_t *latest_timestamp);
 
+// the grouping kernels of rrd2rrdr()
+// they reduce the values of the slots of a row, NAN are the slots that do not exist
+// they return the number of values that exist, and set *nonzero if any of them is not zero
+extern long rrdr_grouping_sum(const calculated_number *values, long entries, calculated_number *sum, int *nonzero);
+extern long rrdr_grouping_min(const calculated_number *values, long entries, calculated_number *min, int *nonzero);
+extern long rrdr_grouping_max(const calculated_number *values, long entries, calculated_number *max, int *nonzero);
+extern long rrdr_grouping_oldest_newest(const calculated_number *values, long entries, long *oldest, long *newest, int *nonzero);
+extern long rrdr_grouping_percentile(const calculated_number *values, long entries, calculated_number percentile, calculated_number *scratch, calculated_number *result, int *nonzero);
+extern long rrdr_grouping_stddev(const calculated_number *values, long entries, calculated_number *average, calculated_number *stddev, int *nonzero);
+
+// the query cache of rrdset2anything_api_v1()
+struct rrdr_cache_stats {
+    size_t hits;        // results reused, no new rows since
+    size_t updates;     // results slid to the slots stored since
+    size_t misses;      // results queried from scratch
+};
+
+extern long rrdr_cache_entries;
+extern void rrdr_cache_get_stats(struct rrdr_cache_stats *stats);
+extern void rrdr_cache_free_chart(RRDSET *st);
+
 extern int rrdset2value_api_v1(RRDSET *st, BUFFER *wb, calculated_number *n, const char *dimensions, long points
                             , long long after, long long before, int group_method, long group_time, uint32_t options
                             , time_t *db_after, time_t *db_before, int *value_is_null);
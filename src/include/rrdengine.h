@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: GPL-3.0+
+#ifndef HIBENCHMARKS_RRDENGINE_H
+#define HIBENCHMARKS_RRDENGINE_H
+
+// ----------------------------------------------------------------------------
+// dbengine - the append-only on-disk database of memory mode dbengine
+
+#define RRDENG_DATAFILES_MAX 8                      // the number of datafiles the disk space is split to
+#define RRDENG_DATAFILE_MIN_SIZE (1024 * 1024)      // the minimum size of a datafile
+#define RRDENG_WRITE_BUFFER_SIZE (64 * 1024)        // pages are written to disk in chunks of this size
+
+#define RRDENG_DEFAULT_DISK_SPACE_MB 256
+#define RRDENG_DEFAULT_PAGE_CACHE_MB 32
+
+extern long default_rrdeng_disk_space_mb;
+extern long default_rrdeng_page_cache_mb;
+
+struct rrdengine;
+struct rrdeng_metric;
+struct rrdeng_page;
+
+// a query on the history of a dimension
+// the recent values are read from the round robin database of the dimension,
+// the older from the pages on disk (through the page cache)
+typedef struct rrdeng_query_handle {
+    RRDDIM *rd;
+    time_t ring_first_t;                            // the round robin database has the values after this
+
+    RRDDIM_PAGE_ITERATOR ring;                      // the iterator of the round robin database
+
+    time_t page_start_t;                            // the time of the first value of the page in values
+    time_t page_end_t;                              // the time of the last value of the page in values
+    int page_update_every;
+    storage_number values[RRDDIM_PAGE_ENTRIES];     // the values of the disk page
+
+    struct rrdeng_page *page;                       // the disk page in values, to search the next one from it
+    size_t deletions;                               // the datafiles deleted when it was loaded
+} RRDENG_QUERY_HANDLE;
+
+extern struct rrdengine *rrdeng_init(const char *path, long disk_space_mb);
+extern void rrdeng_exit(struct rrdengine *ctx);
+extern void rrdeng_sync(struct rrdengine *ctx);
+
+extern struct rrdeng_metric *rrdeng_metric_get(struct rrdengine *ctx, const char *chart_id, const char *dimension_id);
+extern void rrdeng_store_page(struct rrdengine *ctx, struct rrdeng_metric *metric, time_t start_t, int update_every, const storage_number *values, long entries);
+
+extern time_t rrdeng_first_entry_t(RRDSET *st);
+extern void rrdeng_query_range(RRDSET *st, struct rrdset_tier *range);
+extern void rrdeng_query_init(RRDENG_QUERY_HANDLE *h, RRDDIM *rd);
+extern storage_number rrdeng_query_value(RRDENG_QUERY_HANDLE *h, time_t t);
+
+#define rrdset_has_dbengine(st) ((st)->rrd_memory_mode == RRD_MEMORY_MODE_DBENGINE && (st)->rrdhost->rrdeng)
+
+#endif //HIBENCHMARKS_RRDENGINE_H
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: GPL-3.0+
+#ifndef HIBENCHMARKS_SLAB_H
+#define HIBENCHMARKS_SLAB_H 1
+
+/*
+ * SLAB ALLOCATOR
+ * Keeps objects of the same size in big pages, so that creating and freeing
+ * thousands of small objects (charts, dimensions, their variables and names)
+ * does not fragment the heap.
+ *
+ * A SLAB_SET has one slab per object size. The first page of a slab is small
+ * and every next one is as big as the objects already allocated, up to
+ * SLAB_PAGE_SIZE, so a host with a few charts gets a few small pages.
+ * The objects freed go to the free list of their page and are given again to
+ * the next allocation of the same size. A page with all its objects freed is
+ * released, except one that is kept for the next allocations of its slab.
+ *
+ * To release a whole set, call slab_set_destroy_begin() before freeing its
+ * objects: they are not returned to their pages one by one, and
+ * slab_set_destroy() releases all the pages in one pass.
+ *
+ * All the functions of a SLAB_SET are thread safe.
+ */
+
+typedef struct slab_page {
+    avl avl;                    // in the index of the set, by address
+
+    struct slab *slab;
+    char *objects;              // the first object, right after this header
+    size_t objects_count;
+    size_t used;                // the objects of this page given to callers
+
+    void *free_objects;         // a linked list, via the first pointer of each object
+
+    struct slab_page *prev, *next; // the pages with free objects first, the full ones last
+} SLAB_PAGE;
+
+typedef struct slab {
+    size_t object_size;         // the size of the objects, aligned to SLAB_ALIGN
+    size_t min_objects_per_page;
+    size_t max_objects_per_page;
+
+    SLAB_PAGE *pages;
+    SLAB_PAGE *spare;           // an empty page that is not released
+
+    size_t objects;             // the objects given to callers
+    size_t pages_count;
+    size_t memory;              // the bytes of all the pages
+
+    struct slab *next;
+} SLAB;
+
+typedef struct slab_set {
+    hibenchmarks_mutex_t mutex;
+    SLAB *slabs;
+    avl_tree pages_index;       // the pages of all the slabs, to find the page of an object
+    int destroying;             // the objects freed are released with the set
+} SLAB_SET;
+
+#define SLAB_ALIGN 16
+#define SLAB_FIRST_PAGE_SIZE 4096
+#define SLAB_PAGE_SIZE (256 * 1024)
+#define SLAB_MIN_OBJECTS_PER_PAGE 4
+
+// strings longer than this are allocated with mallocz()
+#define SLAB_STRING_MAX 256
+
+extern void slab_set_init(SLAB_SET *set);
+extern void slab_set_destroy_begin(SLAB_SET *set);
+extern void slab_set_destroy(SLAB_SET *set);
+
+extern void *slab_set_callocz(SLAB_SET *set, size_t size);
+extern void slab_set_freez(SLAB_SET *set, void *ptr, size_t size);
+
+extern char *slab_set_strdupz(SLAB_SET *set, const char *s);
+extern void slab_set_freez_string(SLAB_SET *set, char *s);
+
+extern size_t slab_set_allocated_memory(SLAB_SET *set);
+
+#endif /* HIBENCHMARKS_SLAB_H */
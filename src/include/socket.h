@@ -24,6 +24,7 @@ extern char *strdup_client_description(int family, const char *protocol, const c
 
 extern int listen_sockets_setup(LISTEN_SOCKETS *sockets);
 extern void listen_sockets_close(LISTEN_SOCKETS *sockets);
+extern int listen_sockets_shard(LISTEN_SOCKETS *shard, LISTEN_SOCKETS *sockets);
 
 extern int connect_to_this(const char *definition, int default_port, struct timeval *timeout);
 extern int connect_to_one_of(const char *destination, int default_port, struct timeval *timeout, size_t *reconnects_counter, char *connected_to, size_t connected_to_size);
@@ -60,6 +61,16 @@ extern int accept4(int sock, struct sockaddr *addr, socklen_t *addrlen, int flag
 #define POLLINFO_FLAG_SERVER_SOCKET 0x00000001
 #define POLLINFO_FLAG_CLIENT_SOCKET 0x00000002
 #define POLLINFO_FLAG_DONT_CLOSE    0x00000004
+#define POLLINFO_FLAG_ALWAYS_READY  0x00000008  // epoll() cannot watch the fd (a regular file) - it is always ready
+
+typedef enum poll_events_backend {
+    POLL_EVENTS_BACKEND_POLL  = 0,
+    POLL_EVENTS_BACKEND_EPOLL = 1
+} POLL_EVENTS_BACKEND;
+
+extern POLL_EVENTS_BACKEND poll_events_backend;
+extern const char *poll_events_backend_name(POLL_EVENTS_BACKEND backend);
+extern POLL_EVENTS_BACKEND poll_events_backend_id(const char *name);
 
 typedef struct poll POLLJOB;
 
@@ -81,6 +92,8 @@ typedef struct pollinfo {
 
     uint32_t flags;         // internal flags
 
+    short int epoll_events; // the events epoll() watches for the fd, -1 when it does not watch it
+
     // callbacks for this socket
     void  (*del_callback)(struct pollinfo *pi);
     int   (*rcv_callback)(struct pollinfo *pi, short int *events);
@@ -115,6 +128,16 @@ struct poll {
     struct pollinfo *inf;
     struct pollinfo *first_free;
 
+    int epoll_fd;                       // -1 when poll() is used
+#ifdef HAVE_SYS_EPOLL_H
+    struct epoll_event *epoll_events;   // the events returned by epoll_wait()
+#endif
+
+    size_t *ready;                      // the slots of the fds epoll() cannot watch
+    size_t *ready_copy;                 // scratch space, to process them while they change
+    size_t ready_used;
+    size_t ready_size;
+
     SIMPLE_PATTERN *access_list;
 
     void *(*add_callback)(POLLINFO *pi, short int *events, void *data);
@@ -144,6 +167,7 @@ extern POLLINFO *poll_add_fd(POLLJOB *p
                              , void *data
 );
 extern void poll_close_fd(POLLINFO *pi);
+extern void poll_fd_events_changed(POLLINFO *pi);
 
 extern void poll_events(LISTEN_SOCKETS *sockets
         , void *(*add_callback)(POLLINFO *pi, short int *events, void *data)
@@ -47,6 +47,7 @@ typedef long double collected_number;
 #define calculated_number_llrint(x) llrintl(x)
 #define calculated_number_round(x) roundl(x)
 #define calculated_number_fabs(x) fabsl(x)
+#define calculated_number_sqrt(x) sqrtl(x)
 #define calculated_number_epsilon (calculated_number)0.0000001
 
 #define calculated_number_equal(a, b) (calculated_number_fabs((a) - (b)) < calculated_number_epsilon)
@@ -75,6 +76,27 @@ typedef uint32_t storage_number;
 storage_number pack_storage_number(calculated_number value, uint32_t flags);
 calculated_number unpack_storage_number(storage_number value);
 
+// convert arrays of values - the slots that do not exist are unpacked as NAN
+void pack_storage_number_batch(const calculated_number *values, storage_number *out, size_t entries, uint32_t flags);
+void unpack_storage_number_batch(const storage_number *values, calculated_number *out, size_t entries);
+
+// ----------------------------------------------------------------------------
+// 64-bit storage numbers
+//
+// a double, with the flags of storage_number in the 3 lowest bits of its mantissa
+// (the value keeps 49 bits of precision, instead of the 24 bits of storage_number)
+
+typedef uint64_t storage_number64;
+
+#define get_storage_number64_flags(value) ((storage_number)(((value) & 0x7) << 24))
+#define SN64_EMPTY_SLOT 0x0000000000000000ULL
+
+#define does_storage_number64_exist(value) (((value) & 0x7)?1:0)
+#define did_storage_number64_reset(value)  ((get_storage_number64_flags(value) == SN_EXISTS_RESET)?1:0)
+
+storage_number64 pack_storage_number64(calculated_number value, uint32_t flags);
+calculated_number unpack_storage_number64(storage_number64 value);
+
 int print_calculated_number(char *str, calculated_number value);
 
 #define STORAGE_NUMBER_POSITIVE_MAX (167772150000000.0)
@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: GPL-3.0+
+#ifndef HIBENCHMARKS_STRING_INTERN_H
+#define HIBENCHMARKS_STRING_INTERN_H 1
+
+/*
+ * INTERNED STRINGS
+ * A global table that keeps a single, reference counted, copy of each string.
+ *
+ * The same ids, families, contexts and units are used by the charts of all
+ * the hosts. When they are interned, all of them point to the same memory
+ * and two interned strings are equal only if their pointers are equal.
+ *
+ * string_intern() returns the interned copy of a string, with a reference
+ * for the caller. string_intern_release() gives the reference back.
+ * The interned strings are read only - do not modify or free them.
+ */
+
+struct string_intern_stats {
+    size_t entries;             // the distinct strings in the table
+    size_t references;          // the references given to callers
+    size_t memory;              // the memory used by the strings
+};
+
+extern const char *string_intern(const char *s);
+extern const char *string_intern_dup(const char *interned);
+extern void string_intern_release(const char *interned);
+
+// find the interned copy of a string, without taking a reference
+// returns NULL when the string is not interned
+extern const char *string_intern_find(const char *s, uint32_t hash);
+
+extern void string_intern_get_stats(struct string_intern_stats *stats);
+
+#endif /* HIBENCHMARKS_STRING_INTERN_H */
@@ -28,6 +28,10 @@ extern int hibenchmarks_thread_cancel(hibenchmarks_thread_t thread);
 extern int hibenchmarks_thread_join(hibenchmarks_thread_t thread, void **retval);
 extern int hibenchmarks_thread_detach(pthread_t thread);
 
+extern long hibenchmarks_workers_threads;
+extern void hibenchmarks_workers_run(size_t jobs, void (*execute)(void *data, size_t job), void *data);
+extern void hibenchmarks_workers_stop(void);
+
 #define hibenchmarks_thread_self pthread_self
 #define hibenchmarks_thread_testcancel pthread_testcancel
 
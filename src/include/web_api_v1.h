@@ -16,6 +16,7 @@ extern int web_client_api_request_v1_allmetrics(RRDHOST *host, struct web_client
 extern int web_client_api_request_v1_chart(RRDHOST *host, struct web_client *w, char *url);
 extern int web_client_api_request_v1_badge(RRDHOST *host, struct web_client *w, char *url);
 extern int web_client_api_request_v1_data(RRDHOST *host, struct web_client *w, char *url);
+extern int web_client_api_request_v1_batch(RRDHOST *host, struct web_client *w, char *url);
 extern int web_client_api_request_v1_registry(RRDHOST *host, struct web_client *w, char *url);
 extern int web_client_api_request_v1(RRDHOST *host, struct web_client *w, char *url);
 
@@ -6,6 +6,13 @@
 extern int web_enable_gzip,
         web_gzip_level,
         web_gzip_strategy;
+
+extern int web_gzip_shared_entries,
+        web_gzip_shared_level;
+
+extern size_t web_gzip_compress(const char *data, size_t len, int level, char **gzip);
+extern int web_gzip_shared_find(const char *key, time_t now, BUFFER *wb);
+extern int web_gzip_shared_compress(const char *key, time_t now, BUFFER *wb);
 #endif /* HIBENCHMARKS_WITH_ZLIB */
 
 extern int respect_web_browser_do_not_track_policy;
@@ -80,6 +87,7 @@ typedef enum web_client_flags {
 #define HIBENCHMARKS_WEB_RESPONSE_HEADER_SIZE 4096
 #define HIBENCHMARKS_WEB_REQUEST_COOKIE_SIZE 1024
 #define HIBENCHMARKS_WEB_REQUEST_ORIGIN_HEADER_SIZE 1024
+#define HIBENCHMARKS_WEB_REQUEST_IF_NONE_MATCH_SIZE 256
 #define HIBENCHMARKS_WEB_RESPONSE_INITIAL_SIZE 16384
 #define HIBENCHMARKS_WEB_REQUEST_RECEIVE_SIZE 16384
 #define HIBENCHMARKS_WEB_REQUEST_MAX_SIZE 16384
@@ -94,6 +102,11 @@ struct response {
     size_t rlen;                    // if non-zero, the excepted size of ifd (input of firecopy)
     size_t sent;                    // current data length sent to output
 
+    void *stream;                   // if set, more data will be generated as data is sent (chunked)
+    int (*stream_next)(void *stream, BUFFER *wb); // appends the next part of the response, returns 0 at the end
+    void (*stream_free)(void *stream);
+    size_t streamed;                // the data length already sent and flushed, of a streamed response
+
     int zoutput;                    // if set to 1, web_client_send() will send compressed data
 #ifdef HIBENCHMARKS_WITH_ZLIB
     z_stream zstream;               // zlib stream for sending compressed output to client
@@ -130,6 +143,9 @@ struct web_client {
     WEB_CLIENT_MODE mode;           // the operational mode of the client
     WEB_CLIENT_ACL acl;             // the access list of the client
 
+    BUFFER *request;                // the received data: the request being processed, and the pipelined ones after it
+    size_t request_len;             // the length of the request being processed, 0 until it is complete
+
     size_t header_parse_tries;
     size_t header_parse_last_size;
 
@@ -141,7 +157,7 @@ struct web_client {
     char client_ip[NI_MAXHOST+1];
     char client_port[NI_MAXSERV+1];
 
-    char decoded_url[HIBENCHMARKS_WEB_REQUEST_URL_SIZE + 1];  // we decode the URL in this buffer
+    char *decoded_url;                                        // the URL, decoded in place in the request buffer
     char last_url[HIBENCHMARKS_WEB_REQUEST_URL_SIZE+1];       // we keep a copy of the decoded URL here
 
     struct timeval tv_in, tv_ready;
@@ -149,6 +165,7 @@ struct web_client {
     char cookie1[HIBENCHMARKS_WEB_REQUEST_COOKIE_SIZE+1];
     char cookie2[HIBENCHMARKS_WEB_REQUEST_COOKIE_SIZE+1];
     char origin[HIBENCHMARKS_WEB_REQUEST_ORIGIN_HEADER_SIZE+1];
+    char if_none_match[HIBENCHMARKS_WEB_REQUEST_IF_NONE_MATCH_SIZE+1]; // the entity tags the client has cached
     char *user_agent;
 
     struct response response;
@@ -181,6 +198,9 @@ extern ssize_t web_client_read_file(struct web_client *w);
 extern void web_client_process_request(struct web_client *w);
 extern void web_client_request_done(struct web_client *w);
 
+extern int web_client_shared_gzip_find(struct web_client *w, RRDHOST *host, const char *client);
+extern void web_client_shared_gzip_store(struct web_client *w, RRDHOST *host, const char *client);
+
 extern int web_client_api_request_v1_data_group(char *name, int def);
 extern const char *group_method2string(int group);
 
@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: GPL-3.0+
+#ifndef HIBENCHMARKS_WEB_FILES_CACHE_H
+#define HIBENCHMARKS_WEB_FILES_CACHE_H 1
+
+/*
+ * WEB FILES CACHE
+ * Keeps the static files of the dashboard in memory, together with their
+ * gzip compressed contents, so that they are read and compressed once,
+ * not on every request. A file is read again when its inode, size or
+ * modification time change.
+ *
+ * The files returned are referenced - they stay valid, even if they are
+ * evicted or replaced, until they are released.
+ */
+
+#define WEB_FILE_ETAG_SIZE 64
+
+typedef struct web_file {
+    char *filename;
+    uint32_t hash;
+
+    dev_t dev;                      // the identity of the file when it was read
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+    long mtime_nsec;
+
+    char etag[WEB_FILE_ETAG_SIZE + 1]; // the entity tag of the uncompressed contents, without quotes
+
+    char *data;                     // the contents of the file
+    size_t len;
+
+    char *gzip;                     // the gzip compressed contents, NULL when they are not smaller
+    size_t gzip_len;
+
+    size_t references;
+    int obsolete;                   // it is not in the cache any more, the last release frees it
+
+    struct web_file *next;
+} WEB_FILE;
+
+struct web_files_cache_stats {
+    size_t files;
+    size_t bytes;
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+};
+
+extern long web_files_cache_mb;
+
+extern WEB_FILE *web_files_cache_get(const char *filename, const struct stat *st);
+extern void web_files_cache_release(WEB_FILE *f);
+extern void web_files_cache_get_stats(struct web_files_cache_stats *stats);
+
+#endif /* HIBENCHMARKS_WEB_FILES_CACHE_H */
@@ -330,7 +330,10 @@ inline size_t pluginsd_process(RRDHOST *host, struct plugind *cd, FILE *fp, int
                   , update_every
             );
 
-            st = rrdset_create(
+            // the storage format can only be set when the chart is created
+            RRD_STORAGE_FORMAT storage_format = (options && strstr(options, RRD_STORAGE_FORMAT_64BIT_NAME)) ? RRD_STORAGE_FORMAT_64BIT : RRD_STORAGE_FORMAT_32BIT;
+
+            st = rrdset_create_custom(
                     host
                     , type
                     , id
@@ -344,6 +347,9 @@ inline size_t pluginsd_process(RRDHOST *host, struct plugind *cd, FILE *fp, int
                     , priority
                     , update_every
                     , chart_type
+                    , host->rrd_memory_mode
+                    , host->rrd_history_entries
+                    , storage_format
             );
 
             if(options && *options) {
@@ -37,6 +37,15 @@ inline const char *rrd_memory_mode_name(RRD_MEMORY_MODE id) {
 
         case RRD_MEMORY_MODE_ALLOC:
             return RRD_MEMORY_MODE_ALLOC_NAME;
+
+        case RRD_MEMORY_MODE_TIERED:
+            return RRD_MEMORY_MODE_TIERED_NAME;
+
+        case RRD_MEMORY_MODE_COMPRESSED:
+            return RRD_MEMORY_MODE_COMPRESSED_NAME;
+
+        case RRD_MEMORY_MODE_DBENGINE:
+            return RRD_MEMORY_MODE_DBENGINE_NAME;
     }
 
     return RRD_MEMORY_MODE_SAVE_NAME;
@@ -55,10 +64,41 @@ RRD_MEMORY_MODE rrd_memory_mode_id(const char *name) {
     else if(unlikely(!strcmp(name, RRD_MEMORY_MODE_ALLOC_NAME)))
         return RRD_MEMORY_MODE_ALLOC;
 
+    else if(unlikely(!strcmp(name, RRD_MEMORY_MODE_TIERED_NAME)))
+        return RRD_MEMORY_MODE_TIERED;
+
+    else if(unlikely(!strcmp(name, RRD_MEMORY_MODE_COMPRESSED_NAME)))
+        return RRD_MEMORY_MODE_COMPRESSED;
+
+    else if(unlikely(!strcmp(name, RRD_MEMORY_MODE_DBENGINE_NAME)))
+        return RRD_MEMORY_MODE_DBENGINE;
+
     return RRD_MEMORY_MODE_SAVE;
 }
 
 
+// ----------------------------------------------------------------------------
+// RRD - storage formats
+
+const char *rrd_storage_format_name(RRD_STORAGE_FORMAT id) {
+    switch(id) {
+        case RRD_STORAGE_FORMAT_64BIT:
+            return RRD_STORAGE_FORMAT_64BIT_NAME;
+
+        case RRD_STORAGE_FORMAT_32BIT:
+        default:
+            return RRD_STORAGE_FORMAT_32BIT_NAME;
+    }
+}
+
+RRD_STORAGE_FORMAT rrd_storage_format_id(const char *name) {
+    if(unlikely(!strcmp(name, RRD_STORAGE_FORMAT_64BIT_NAME)))
+        return RRD_STORAGE_FORMAT_64BIT;
+
+    return RRD_STORAGE_FORMAT_32BIT;
+}
+
+
 // ----------------------------------------------------------------------------
 // RRD - algorithms types
 
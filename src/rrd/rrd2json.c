@@ -39,7 +39,7 @@ void rrd_stats_api_v1_chart_with_data(RRDSET *st, BUFFER *wb, size_t *dimensions
         , st->name
         , rrdset_type_name(st->chart_type)
         , st->entries * st->update_every
-        , rrdset_first_entry_t(st)
+        , rrdset_tiers_first_entry_t(st)
         , rrdset_last_entry_t(st)
         , st->update_every
         );
@@ -52,6 +52,8 @@ void rrd_stats_api_v1_chart_with_data(RRDSET *st, BUFFER *wb, size_t *dimensions
         if(rrddim_flag_check(rd, RRDDIM_FLAG_HIDDEN)) continue;
 
         memory += rd->memsize;
+        if(unlikely(rd->pages))
+            memory += rd->pages->compressed_bytes;
 
         buffer_sprintf(
                 wb
@@ -244,7 +246,7 @@ void rrd_stats_api_v1_charts_allmetrics_shell(RRDHOST *host, BUFFER *wb) {
             // for each dimension
             RRDDIM *rd;
             rrddim_foreach_read(rd, st) {
-                if(rd->collections_counter) {
+                if(rrddim_collection(rd, collections_counter)) {
                     char dimension[SHELL_ELEMENT_MAX + 1];
                     shell_name_copy(dimension, rd->name?rd->name:rd->id, SHELL_ELEMENT_MAX);
 
@@ -331,7 +333,7 @@ void rrd_stats_api_v1_charts_allmetrics_json(RRDHOST *host, BUFFER *wb) {
             // for each dimension
             RRDDIM *rd;
             rrddim_foreach_read(rd, st) {
-                if(rd->collections_counter) {
+                if(rrddim_collection(rd, collections_counter)) {
 
                     buffer_sprintf(wb, "%s\n"
                             "\t\t\t\"%s\": {\n"
@@ -401,11 +403,22 @@ typedef struct rrdresult {
     time_t before;
     time_t after;
 
-    int has_st_lock;        // if st is read locked by us
+    int has_st_reader;      // if st is kept from being freed by us
+
+    long cursor_entry;          // the query cache entry of the result, to resume it
+    size_t cursor_generation;   // the generation of the entry, 0 = not cached
 } RRDR;
 
 #define rrdr_rows(r) ((r)->rows)
 
+// the parts of a result the formatters print
+// the streamed results are printed a block of rows at a time
+#define RRDR_PRINT_HEADER   0x01
+#define RRDR_PRINT_ROWS     0x02
+#define RRDR_PRINT_FOOTER   0x04
+#define RRDR_PRINT_CONTINUE 0x08    // rows have been printed before these
+#define RRDR_PRINT_ALL      (RRDR_PRINT_HEADER | RRDR_PRINT_ROWS | RRDR_PRINT_FOOTER)
+
 /*
 static void rrdr_dump(RRDR *r)
 {
@@ -463,7 +476,6 @@ static void rrdr_dump(RRDR *r)
 */
 
 void rrdr_disable_not_selected_dimensions(RRDR *r, uint32_t options, const char *dims) {
-    rrdset_check_rdlock(r->st);
 
     if(unlikely(!dims || !*dims || (dims[0] == '*' && dims[1] == '\0'))) return;
 
@@ -562,6 +574,10 @@ void rrdr_buffer_print_format(BUFFER *wb, uint32_t format)
         buffer_strcat(wb, DATASOURCE_FORMAT_SSV_COMMA);
         break;
 
+    case DATASOURCE_BINARY:
+        buffer_strcat(wb, DATASOURCE_FORMAT_BINARY);
+        break;
+
     default:
         buffer_strcat(wb, "unknown");
         break;
@@ -570,7 +586,6 @@ void rrdr_buffer_print_format(BUFFER *wb, uint32_t format)
 
 uint32_t rrdr_check_options(RRDR *r, uint32_t options, const char *dims)
 {
-    rrdset_check_rdlock(r->st);
 
     (void)dims;
 
@@ -607,7 +622,6 @@ uint32_t rrdr_check_options(RRDR *r, uint32_t options, const char *dims)
 
 void rrdr_json_wrapper_begin(RRDR *r, BUFFER *wb, uint32_t format, uint32_t options, int string_value)
 {
-    rrdset_check_rdlock(r->st);
 
     long rows = rrdr_rows(r);
     long c, i;
@@ -636,16 +650,22 @@ void rrdr_json_wrapper_begin(RRDR *r, BUFFER *wb, uint32_t format, uint32_t opti
             "   %slast_entry%s: %u,\n"
             "   %sbefore%s: %u,\n"
             "   %safter%s: %u,\n"
-            "   %sdimension_names%s: ["
             , kq, kq
             , kq, kq, sq, r->st->id, sq
             , kq, kq, sq, r->st->name, sq
             , kq, kq, r->update_every
             , kq, kq, r->st->update_every
-            , kq, kq, (uint32_t)rrdset_first_entry_t(r->st)
+            , kq, kq, (uint32_t)rrdset_tiers_first_entry_t(r->st)
             , kq, kq, (uint32_t)rrdset_last_entry_t(r->st)
             , kq, kq, (uint32_t)r->before
             , kq, kq, (uint32_t)r->after
+            );
+
+    // give the client the cursor to resume this result
+    if(r->cursor_generation)
+        buffer_sprintf(wb, "   %scursor%s: %s%ld-%zu%s,\n", kq, kq, sq, r->cursor_entry, r->cursor_generation, sq);
+
+    buffer_sprintf(wb, "   %sdimension_names%s: ["
             , kq, kq);
 
     for(c = 0, i = 0, rd = r->st->dimensions; rd && c < r->d ;c++, rd = rd->next) {
@@ -700,12 +720,11 @@ void rrdr_json_wrapper_begin(RRDR *r, BUFFER *wb, uint32_t format, uint32_t opti
         if(i) buffer_strcat(wb, ", ");
         i++;
 
-        storage_number n = rd->values[rrdset_last_slot(r->st)];
-
-        if(!does_storage_number_exist(n))
+        calculated_number value;
+        if(!rrddim_slot_get(rd, rrdset_last_slot(r->st), &value))
             buffer_strcat(wb, "null");
         else
-            buffer_rrd_value(wb, unpack_storage_number(n));
+            buffer_rrd_value(wb, value);
     }
     if(!i) {
         rows = 0;
@@ -817,9 +836,8 @@ void rrdr_json_wrapper_end(RRDR *r, BUFFER *wb, uint32_t format, uint32_t option
 #define JSON_DATES_JS 1
 #define JSON_DATES_TIMESTAMP 2
 
-static void rrdr2json(RRDR *r, BUFFER *wb, uint32_t options, int datatable)
+static void rrdr2json(RRDR *r, BUFFER *wb, uint32_t options, int datatable, int parts)
 {
-    rrdset_check_rdlock(r->st);
 
     //info("RRD2JSON(): %s: BEGIN", r->st->id);
     int row_annotations = 0, dates, dates_with_new = 0;
@@ -861,10 +879,12 @@ static void rrdr2json(RRDR *r, BUFFER *wb, uint32_t options, int datatable)
         snprintfz(overflow_annotation, 200, ",{%sv%s:%sRESET OR OVERFLOW%s},{%sv%s:%sThe counters have been wrapped.%s}", kq, kq, sq, sq, kq, kq, sq, sq);
         snprintfz(normal_annotation,   200, ",{%sv%s:null},{%sv%s:null}", kq, kq, kq, kq);
 
-        buffer_sprintf(wb, "{\n %scols%s:\n [\n", kq, kq);
-        buffer_sprintf(wb, "        {%sid%s:%s%s,%slabel%s:%stime%s,%spattern%s:%s%s,%stype%s:%sdatetime%s},\n", kq, kq, sq, sq, kq, kq, sq, sq, kq, kq, sq, sq, kq, kq, sq, sq);
-        buffer_sprintf(wb, "        {%sid%s:%s%s,%slabel%s:%s%s,%spattern%s:%s%s,%stype%s:%sstring%s,%sp%s:{%srole%s:%sannotation%s}},\n", kq, kq, sq, sq, kq, kq, sq, sq, kq, kq, sq, sq, kq, kq, sq, sq, kq, kq, kq, kq, sq, sq);
-        buffer_sprintf(wb, "        {%sid%s:%s%s,%slabel%s:%s%s,%spattern%s:%s%s,%stype%s:%sstring%s,%sp%s:{%srole%s:%sannotationText%s}}", kq, kq, sq, sq, kq, kq, sq, sq, kq, kq, sq, sq, kq, kq, sq, sq, kq, kq, kq, kq, sq, sq);
+        if(parts & RRDR_PRINT_HEADER) {
+            buffer_sprintf(wb, "{\n %scols%s:\n [\n", kq, kq);
+            buffer_sprintf(wb, "        {%sid%s:%s%s,%slabel%s:%stime%s,%spattern%s:%s%s,%stype%s:%sdatetime%s},\n", kq, kq, sq, sq, kq, kq, sq, sq, kq, kq, sq, sq, kq, kq, sq, sq);
+            buffer_sprintf(wb, "        {%sid%s:%s%s,%slabel%s:%s%s,%spattern%s:%s%s,%stype%s:%sstring%s,%sp%s:{%srole%s:%sannotation%s}},\n", kq, kq, sq, sq, kq, kq, sq, sq, kq, kq, sq, sq, kq, kq, sq, sq, kq, kq, kq, kq, sq, sq);
+            buffer_sprintf(wb, "        {%sid%s:%s%s,%slabel%s:%s%s,%spattern%s:%s%s,%stype%s:%sstring%s,%sp%s:{%srole%s:%sannotationText%s}}", kq, kq, sq, sq, kq, kq, sq, sq, kq, kq, sq, sq, kq, kq, sq, sq, kq, kq, kq, kq, sq, sq);
+        }
 
         // remove the valueobjects flag
         // google wants its own keys
@@ -896,8 +916,10 @@ static void rrdr2json(RRDR *r, BUFFER *wb, uint32_t options, int datatable)
         snprintfz(data_begin, 100, "],\n    %sdata%s:\n [\n", kq, kq);
         strcpy(finish,             "\n  ]\n}");
 
-        buffer_sprintf(wb, "{\n %slabels%s: [", kq, kq);
-        buffer_sprintf(wb, "%stime%s", sq, sq);
+        if(parts & RRDR_PRINT_HEADER) {
+            buffer_sprintf(wb, "{\n %slabels%s: [", kq, kq);
+            buffer_sprintf(wb, "%stime%s", sq, sq);
+        }
     }
 
     // -------------------------------------------------------------------------
@@ -911,23 +933,29 @@ static void rrdr2json(RRDR *r, BUFFER *wb, uint32_t options, int datatable)
         if(unlikely(r->od[c] & RRDR_HIDDEN)) continue;
         if(unlikely((options & RRDR_OPTION_NONZERO) && !(r->od[c] & RRDR_NONZERO))) continue;
 
-        buffer_strcat(wb, pre_label);
-        buffer_strcat(wb, rd->name);
-        buffer_strcat(wb, post_label);
+        if(parts & RRDR_PRINT_HEADER) {
+            buffer_strcat(wb, pre_label);
+            buffer_strcat(wb, rd->name);
+            buffer_strcat(wb, post_label);
+        }
         i++;
     }
-    if(!i) {
-        buffer_strcat(wb, pre_label);
-        buffer_strcat(wb, "no data");
-        buffer_strcat(wb, post_label);
-    }
 
-    // print the begin of row data
-    buffer_strcat(wb, data_begin);
+    if(parts & RRDR_PRINT_HEADER) {
+        if(!i) {
+            buffer_strcat(wb, pre_label);
+            buffer_strcat(wb, "no data");
+            buffer_strcat(wb, post_label);
+        }
+
+        // print the begin of row data
+        buffer_strcat(wb, data_begin);
+    }
 
     // if all dimensions are hidden, print a null
     if(!i) {
-        buffer_strcat(wb, finish);
+        if(parts & RRDR_PRINT_FOOTER)
+            buffer_strcat(wb, finish);
         return;
     }
 
@@ -937,6 +965,8 @@ static void rrdr2json(RRDR *r, BUFFER *wb, uint32_t options, int datatable)
         end = -1;
         step = -1;
     }
+    if(!(parts & RRDR_PRINT_ROWS))
+        end = start;
 
     // for each line in the array
     calculated_number total = 1;
@@ -951,7 +981,7 @@ static void rrdr2json(RRDR *r, BUFFER *wb, uint32_t options, int datatable)
             struct tm tmbuf, *tm = localtime_r(&now, &tmbuf);
             if(!tm) { error("localtime_r() failed."); continue; }
 
-            if(likely(i != start)) buffer_strcat(wb, ",\n");
+            if(likely(i != start || (parts & RRDR_PRINT_CONTINUE))) buffer_strcat(wb, ",\n");
             buffer_strcat(wb, pre_date);
 
             if( options & RRDR_OPTION_OBJECTSROWS )
@@ -980,7 +1010,7 @@ static void rrdr2json(RRDR *r, BUFFER *wb, uint32_t options, int datatable)
         }
         else {
             // print the timestamp of the line
-            if(likely(i != start)) buffer_strcat(wb, ",\n");
+            if(likely(i != start || (parts & RRDR_PRINT_CONTINUE))) buffer_strcat(wb, ",\n");
             buffer_strcat(wb, pre_date);
 
             if( options & RRDR_OPTION_OBJECTSROWS )
@@ -1052,13 +1082,13 @@ static void rrdr2json(RRDR *r, BUFFER *wb, uint32_t options, int datatable)
         buffer_strcat(wb, post_line);
     }
 
-    buffer_strcat(wb, finish);
+    if(parts & RRDR_PRINT_FOOTER)
+        buffer_strcat(wb, finish);
     //info("RRD2JSON(): %s: END", r->st->id);
 }
 
-static void rrdr2csv(RRDR *r, BUFFER *wb, uint32_t options, const char *startline, const char *separator, const char *endline, const char *betweenlines)
+static void rrdr2csv(RRDR *r, BUFFER *wb, uint32_t options, const char *startline, const char *separator, const char *endline, const char *betweenlines, int parts)
 {
-    rrdset_check_rdlock(r->st);
 
     //info("RRD2CSV(): %s: BEGIN", r->st->id);
     long c, i;
@@ -1069,19 +1099,22 @@ static void rrdr2csv(RRDR *r, BUFFER *wb, uint32_t options, const char *startlin
         if(unlikely(r->od[c] & RRDR_HIDDEN)) continue;
         if(unlikely((options & RRDR_OPTION_NONZERO) && !(r->od[c] & RRDR_NONZERO))) continue;
 
-        if(!i) {
-            buffer_strcat(wb, startline);
+        if(parts & RRDR_PRINT_HEADER) {
+            if(!i) {
+                buffer_strcat(wb, startline);
+                if(options & RRDR_OPTION_LABEL_QUOTES) buffer_strcat(wb, "\"");
+                buffer_strcat(wb, "time");
+                if(options & RRDR_OPTION_LABEL_QUOTES) buffer_strcat(wb, "\"");
+            }
+            buffer_strcat(wb, separator);
             if(options & RRDR_OPTION_LABEL_QUOTES) buffer_strcat(wb, "\"");
-            buffer_strcat(wb, "time");
+            buffer_strcat(wb, d->name);
             if(options & RRDR_OPTION_LABEL_QUOTES) buffer_strcat(wb, "\"");
         }
-        buffer_strcat(wb, separator);
-        if(options & RRDR_OPTION_LABEL_QUOTES) buffer_strcat(wb, "\"");
-        buffer_strcat(wb, d->name);
-        if(options & RRDR_OPTION_LABEL_QUOTES) buffer_strcat(wb, "\"");
         i++;
     }
-    buffer_strcat(wb, endline);
+    if(parts & RRDR_PRINT_HEADER)
+        buffer_strcat(wb, endline);
 
     if(!i) {
         // no dimensions present
@@ -1094,6 +1127,8 @@ static void rrdr2csv(RRDR *r, BUFFER *wb, uint32_t options, const char *startlin
         end = -1;
         step = -1;
     }
+    if(!(parts & RRDR_PRINT_ROWS))
+        end = start;
 
     // for each line in the array
     calculated_number total = 1;
@@ -1176,7 +1211,6 @@ static void rrdr2csv(RRDR *r, BUFFER *wb, uint32_t options, const char *startlin
 }
 
 inline static calculated_number rrdr2value(RRDR *r, long i, uint32_t options, int *all_values_are_null) {
-    rrdset_check_rdlock(r->st);
 
     long c;
     RRDDIM *d;
@@ -1265,18 +1299,22 @@ inline static calculated_number rrdr2value(RRDR *r, long i, uint32_t options, in
     return v;
 }
 
-static void rrdr2ssv(RRDR *r, BUFFER *wb, uint32_t options, const char *prefix, const char *separator, const char *suffix)
+static void rrdr2ssv(RRDR *r, BUFFER *wb, uint32_t options, const char *prefix, const char *separator, const char *suffix, int parts)
 {
     //info("RRD2SSV(): %s: BEGIN", r->st->id);
     long i;
 
-    buffer_strcat(wb, prefix);
+    if(parts & RRDR_PRINT_HEADER)
+        buffer_strcat(wb, prefix);
+
     long start = 0, end = rrdr_rows(r), step = 1;
     if((options & RRDR_OPTION_REVERSED)) {
         start = rrdr_rows(r) - 1;
         end = -1;
         step = -1;
     }
+    if(!(parts & RRDR_PRINT_ROWS))
+        end = start;
 
     // for each line in the array
     for(i = start; i != end ;i += step) {
@@ -1292,7 +1330,7 @@ static void rrdr2ssv(RRDR *r, BUFFER *wb, uint32_t options, const char *prefix,
             r->max = v;
         }
 
-        if(likely(i != start))
+        if(likely(i != start || (parts & RRDR_PRINT_CONTINUE)))
             buffer_strcat(wb, separator);
 
         if(all_values_are_null) {
@@ -1304,7 +1342,9 @@ static void rrdr2ssv(RRDR *r, BUFFER *wb, uint32_t options, const char *prefix,
         else
             buffer_rrd_value(wb, v);
     }
-    buffer_strcat(wb, suffix);
+
+    if(parts & RRDR_PRINT_FOOTER)
+        buffer_strcat(wb, suffix);
     //info("RRD2SSV(): %s: END", r->st->id);
 }
 
@@ -1339,8 +1379,8 @@ inline static void rrdr_lock_rrdset(RRDR *r) {
         return;
     }
 
-    rrdset_rdlock(r->st);
-    r->has_st_lock = 1;
+    rrdset_read_begin(r->st);
+    r->has_st_reader = 1;
 }
 
 inline static void rrdr_unlock_rrdset(RRDR *r) {
@@ -1349,9 +1389,9 @@ inline static void rrdr_unlock_rrdset(RRDR *r) {
         return;
     }
 
-    if(likely(r->has_st_lock)) {
-        rrdset_unlock(r->st);
-        r->has_st_lock = 0;
+    if(likely(r->has_st_reader)) {
+        rrdset_read_end(r->st);
+        r->has_st_reader = 0;
     }
 }
 
@@ -1388,8 +1428,9 @@ static RRDR *rrdr_create(RRDSET *st, long n)
 
     rrdr_lock_rrdset(r);
 
+    // dimensions may be added while we read the chart - we use the ones we counted here
     RRDDIM *rd;
-    rrddim_foreach_read(rd, st) r->d++;
+    for(rd = st->dimensions; rd ; rd = rd->next) r->d++;
 
     r->n = n;
 
@@ -1400,7 +1441,7 @@ static RRDR *rrdr_create(RRDSET *st, long n)
 
     // set the hidden flag on hidden dimensions
     int c;
-    for(c = 0, rd = st->dimensions ; rd ; c++, rd = rd->next) {
+    for(c = 0, rd = st->dimensions ; rd && c < r->d ; c++, rd = rd->next) {
         if(unlikely(rrddim_flag_check(rd, RRDDIM_FLAG_HIDDEN)))
             r->od[c] = RRDR_HIDDEN;
         else
@@ -1414,15 +1455,94 @@ static RRDR *rrdr_create(RRDSET *st, long n)
     return r;
 }
 
-RRDR *rrd2rrdr(RRDSET *st, long points, long long after, long long before, int group_method, long group_time, int aligned)
+// ----------------------------------------------------------------------------
+// rrd2rrdr() grouping
+//
+// the slots of the rows of a dimension are unpacked in a contiguous array,
+// oldest first, so that the grouping kernels can reduce each row at once
+
+// the storage numbers of a dimension, in values (NAN when they do not exist) and resets
+static inline void rrdr_unpack_storage_numbers(const storage_number *packed, long entries, calculated_number *values, uint8_t *resets) {
+    unpack_storage_number_batch(packed, values, (size_t)entries);
+
+    long i;
+    for(i = 0; i < entries ; i++)
+        resets[i] = (uint8_t)did_storage_number_reset(packed[i]);
+}
+
+static inline void rrdr_unpack_storage_numbers64(const storage_number64 *packed, long entries, calculated_number *values, uint8_t *resets) {
+    long i;
+    for(i = 0; i < entries ; i++) {
+        storage_number64 n = packed[i];
+        values[i] = (likely(does_storage_number64_exist(n))) ? unpack_storage_number64(n) : NAN;
+        resets[i] = (uint8_t)did_storage_number64_reset(n);
+    }
+}
+
+// store the value of a point of the result
+static inline void rrdr_store_point(RRDR *r, long i, long c, calculated_number value, long count, int nonzero, int reset) {
+    calculated_number *cn = &r->v[i * r->d + c];
+    uint8_t *co = &r->o[i * r->d + c];
+
+    // store the specific point options
+    *co = (uint8_t)((reset) ? RRDR_RESET : 0);
+
+    if(unlikely(!count)) {
+        *cn = 0.0;
+        *co |= RRDR_EMPTY;
+        return;
+    }
+
+    if(likely(nonzero)) {
+        *co |= RRDR_NONZERO;
+        r->od[c] |= RRDR_NONZERO;
+    }
+
+    *cn = value;
+    if(value < r->min) r->min = value;
+    if(value > r->max) r->max = value;
+}
+
+// ----------------------------------------------------------------------------
+// rrd2rrdr() query
+
+// a query resolved against the round robin database of the chart
+typedef struct rrdr_query {
+    struct rrdset_tier ring;        // the snapshot of the round robin database of the chart
+    size_t seq;                     // the seq of the snapshot
+
+    struct rrdset_tier *tier;       // the downsampled tier answering the query, NULL for the chart itself
+    int tier_id;
+
+    int update_every;               // the duration of each slot of the database queried
+    long entries;                   // the number of slots of the database queried
+
+    time_t first_entry_t;
+    time_t last_entry_t;
+
+    time_t after;                   // the start time of the calculation
+    time_t before;                  // the end time of the calculation
+    long points;                    // the number of points to generate
+    long group;                     // the number of source points to aggregate / group together
+    long group_points;              // the grouping multiple gtime enforces
+    calculated_number group_sum_divisor;
+    int group_method;
+
+    int absolute_period_requested;
+} RRDR_QUERY;
+
+// the round robin database of the chart is read without locking it
+// q->ring is a snapshot of its state, taken here
+// returns 0 when there is no data to query
+static int rrdr_query_prepare(RRDSET *st, RRDR_QUERY *q, long points, long long after, long long before, int group_method, long group_time, int aligned)
 {
-#ifdef HIBENCHMARKS_INTERNAL_CHECKS
-    int debug = rrdset_flag_check(st, RRDSET_FLAG_DEBUG)?1:0;
-#endif
     int absolute_period_requested = -1;
 
-    time_t first_entry_t = rrdset_first_entry_t(st);
-    time_t last_entry_t  = rrdset_last_entry_t(st);
+    q->seq = rrdset_ring_snapshot(st, &q->ring);
+    q->group_method = group_method;
+
+    time_t first_entry_t = rrdset_tiers_first_entry_t(st);
+    time_t last_entry_t  = rrdset_last_entry_t(&q->ring);
 
     if(before == 0 && after == 0) {
         // dump the all the data
@@ -1458,6 +1578,8 @@ RRDR *rrd2rrdr(RRDSET *st, long points, long long after, long long before, int g
     if(absolute_period_requested == -1)
         absolute_period_requested = 1;
 
+    q->absolute_period_requested = absolute_period_requested;
+
     // make sure they are within our timeframe
     if(before > last_entry_t)  before = last_entry_t;
     if(before < first_entry_t) before = first_entry_t;
@@ -1472,12 +1594,46 @@ RRDR *rrd2rrdr(RRDSET *st, long points, long long after, long long before, int g
         after = tmp;
     }
 
+    // find the round robin database that will answer this query
+    // it is the chart itself, or one of its downsampled tiers
+    // the tiers do not keep the values at the edges of their slots, so the
+    // incremental sum is always calculated on the chart itself
+    q->tier_id = 0;
+    q->tier = (likely(group_method != GROUP_INCREMENTAL_SUM)) ? rrdset_tier_for_query(st, after, before, points, &q->tier_id) : NULL;
+
+    int update_every = q->ring.update_every;
+    q->entries = q->ring.entries;
+
+    if(unlikely(q->tier)) {
+        update_every = q->tier->update_every;
+        q->entries = q->tier->entries;
+
+        first_entry_t = rrdset_first_entry_t(q->tier);
+        last_entry_t  = rrdset_last_entry_t(q->tier);
+
+        if(before > last_entry_t)  before = last_entry_t;
+        if(before < first_entry_t) before = first_entry_t;
+
+        if(after > last_entry_t)  after = last_entry_t;
+        if(after < first_entry_t) after = first_entry_t;
+    }
+    else if(unlikely(group_method == GROUP_INCREMENTAL_SUM && rrdset_has_tiers(st))) {
+        first_entry_t = rrdset_first_entry_t(&q->ring);
+
+        if(before < first_entry_t) before = first_entry_t;
+        if(after < first_entry_t)  after = first_entry_t;
+    }
+
+    q->update_every = update_every;
+    q->first_entry_t = first_entry_t;
+    q->last_entry_t = last_entry_t;
+
     // the duration of the chart
     time_t duration = before - after;
-    long available_points = duration / st->update_every;
+    long available_points = duration / update_every;
 
     if(duration <= 0 || available_points <= 0)
-        return rrdr_create(st, 1);
+        return 0;
 
     // check the number of wanted points in the result
     if(unlikely(points < 0)) points = -points;
@@ -1492,7 +1648,7 @@ RRDR *rrd2rrdr(RRDSET *st, long points, long long after, long long before, int g
     // group_time enforces a certain grouping multiple
     calculated_number group_sum_divisor = 1.0;
     long group_points = 1;
-    if(unlikely(group_time > st->update_every)) {
+    if(unlikely(group_time > update_every)) {
         if (unlikely(group_time > duration)) {
             // group_time is above the available duration
 
@@ -1504,10 +1660,10 @@ RRDR *rrd2rrdr(RRDSET *st, long points, long long after, long long before, int g
         }
         else {
             // the points we should group to satisfy gtime
-            group_points = group_time / st->update_every;
+            group_points = group_time / update_every;
             if(unlikely(group_time % group_points)) {
                 #ifdef HIBENCHMARKS_INTERNAL_CHECKS
-                info("INTERNAL CHECK: %s: requested gtime %ld secs, is not a multiple of the chart's data collection frequency %d secs", st->id, group_time, st->update_every);
+                info("INTERNAL CHECK: %s: requested gtime %ld secs, is not a multiple of the chart's data collection frequency %d secs", st->id, group_time, update_every);
                 #endif
 
                 group_points++;
@@ -1518,17 +1674,21 @@ RRDR *rrd2rrdr(RRDSET *st, long points, long long after, long long before, int g
             if(unlikely(group % group_points)) group += group_points - (group % group_points); // make sure group is multiple of group_points
 
             //group_sum_divisor = group / group_points;
-            group_sum_divisor = (calculated_number)(group * st->update_every) / (calculated_number)group_time;
+            group_sum_divisor = (calculated_number)(group * update_every) / (calculated_number)group_time;
         }
     }
 
-    time_t after_new  = after  - (after  % ( ((aligned)?group:1) * st->update_every ));
-    time_t before_new = before - (before % ( ((aligned)?group:1) * st->update_every ));
-    long points_new   = (before_new - after_new) / st->update_every / group;
+    time_t after_new  = after  - (after  % ( ((aligned)?group:1) * update_every ));
+    time_t before_new = before - (before % ( ((aligned)?group:1) * update_every ));
 
-    // find the starting and ending slots in our round robin db
-    long    start_at_slot = rrdset_time2slot(st, before_new),
-            stop_at_slot  = rrdset_time2slot(st, after_new);
+    // the dbengine keeps the oldest data on disk, where no slot exists before
+    // the first page - so an aligned group that starts before it cannot be completed
+    if(unlikely(after_new < first_entry_t && !q->tier && rrdset_has_dbengine(st)))
+        after_new += ((aligned)?group:1) * update_every;
+
+    long points_new   = (before_new - after_new) / update_every / group;
+    if(unlikely(points_new <= 0))
+        return 0;
 
 #ifdef HIBENCHMARKS_INTERNAL_CHECKS
     if(after_new < first_entry_t)
@@ -1543,14 +1703,8 @@ RRDR *rrd2rrdr(RRDSET *st, long points, long long after, long long before, int g
     if(before_new > last_entry_t)
         error("INTERNAL CHECK: before_new %u is too big, maximum %u", (uint32_t)before_new, (uint32_t)last_entry_t);
 
-    if(start_at_slot < 0 || start_at_slot >= st->entries)
-        error("INTERNAL CHECK: start_at_slot is invalid %ld, expected 0 to %ld", start_at_slot, st->entries - 1);
-
-    if(stop_at_slot < 0 || stop_at_slot >= st->entries)
-        error("INTERNAL CHECK: stop_at_slot is invalid %ld, expected 0 to %ld", stop_at_slot, st->entries - 1);
-
-    if(points_new > (before_new - after_new) / group / st->update_every + 1)
-        error("INTERNAL CHECK: points_new %ld is more than points %ld", points_new, (before_new - after_new) / group / st->update_every + 1);
+    if(points_new > (before_new - after_new) / group / update_every + 1)
+        error("INTERNAL CHECK: points_new %ld is more than points %ld", points_new, (before_new - after_new) / group / update_every + 1);
 
     if(group < group_points)
         error("INTERNAL CHECK: group %ld is less than the desired group points %ld", group, group_points);
@@ -1561,19 +1715,193 @@ RRDR *rrd2rrdr(RRDSET *st, long points, long long after, long long before, int g
 
     //info("RRD2RRDR(): %s: wanted %ld points, got %ld - group=%ld, wanted duration=%u, got %u - wanted %ld - %ld, got %ld - %ld", st->id, points, points_new, group, before - after, before_new - after_new, after, before, after_new, before_new);
 
-    after = after_new;
-    before = before_new;
-    duration = before - after;
-    points = points_new;
-
     // Now we have:
     // before = the end time of the calculation
     // after = the start time of the calculation
-    // duration = the duration of the calculation
     // group = the number of source points to aggregate / group together
     // method = the method of grouping source points
     // points = the number of points to generate
 
+    q->after = after_new;
+    q->before = before_new;
+    q->points = points_new;
+    q->group = group;
+    q->group_points = group_points;
+    q->group_sum_divisor = group_sum_divisor;
+
+    return 1;
+}
+
+// ----------------------------------------------------------------------------
+// rrd2rrdr() grouping with the summaries of the dimensions
+//
+// the rows of the grouping methods min, max, sum and average are aggregated
+// from the summaries of the blocks of slots they contain, and only the slots
+// before and after the whole blocks are read (see rrdsummary.c)
+
+static inline int rrdr_group_method_is_summarized(int group_method) {
+    switch(group_method) {
+        case GROUP_MIN:
+        case GROUP_MAX:
+        case GROUP_SUM:
+        case GROUP_AVERAGE:
+        case GROUP_UNDEFINED:
+            return 1;
+
+        default:
+            return 0;
+    }
+}
+
+// values, resets and packed have to fit RRDDIM_SUMMARY_SLOTS slots
+static void rrdr_group_summarized(RRDR *r, long c, RRDSET *st, RRDDIM *rd, RRDR_QUERY *q, long rows, long oldest_slot, time_t oldest_t
+                                  , RRDDIM_PAGE_ITERATOR *page_iterator, calculated_number *values, uint8_t *resets, storage_number *packed) {
+    const RRDDIM_SUMMARY *blocks = rd->summaries->blocks;
+    long entries = q->entries, group = q->group, i, k, j;
+    time_t dt = q->update_every;
+
+    if(unlikely(page_iterator))
+        rrddim_page_iterator_init(page_iterator, rd);
+
+    for(i = 0; i < rows ; i++) {
+        // the offset of the oldest slot of the row - the newest row is the last
+        long first = (rows - 1 - i) * group;
+        time_t first_t = oldest_t + first * dt;
+
+        RRDDIM_SUMMARY g = { .count = 0, .reset = 0 };
+        int nonzero = 0;
+
+        for(k = 0; k < group ;) {
+            long slot = (oldest_slot + first + k) % entries;
+            long block_start = slot - slot % RRDDIM_SUMMARY_SLOTS;
+            long block_end = block_start + RRDDIM_SUMMARY_SLOTS;
+            if(unlikely(block_end > entries)) block_end = entries;
+
+            long n = block_end - slot;
+            if(n > group - k) n = group - k;
+
+            // a whole block, with a summary of the slots we expect
+            if(slot == block_start && n == block_end - block_start) {
+                const RRDDIM_SUMMARY *b = &blocks[slot / RRDDIM_SUMMARY_SLOTS];
+
+                if(likely(b->last_t == first_t + (k + n - 1) * dt)) {
+                    rrddim_summary_merge(&g, b);
+                    nonzero |= (b->count && b->max != 0);
+                    k += n;
+                    continue;
+                }
+            }
+
+            // read the slots
+            if(unlikely(page_iterator)) {
+                for(j = 0; j < n ; j++)
+                    packed[j] = rrddim_page_iterator_get(page_iterator, slot + j);
+
+                rrdr_unpack_storage_numbers(packed, n, values, resets);
+            }
+            else if(unlikely(st->storage_format == RRD_STORAGE_FORMAT_64BIT))
+                rrdr_unpack_storage_numbers64(&rrddim_values64(rd)[slot], n, values, resets);
+            else
+                rrdr_unpack_storage_numbers(&rd->values[slot], n, values, resets);
+
+            RRDDIM_SUMMARY v = { .reset = (memchr(resets, 1, (size_t)n)) ? 1 : 0 };
+            int nz = 0;
+
+            switch(q->group_method) {
+                case GROUP_MIN:
+                    v.count = (uint32_t)rrdr_grouping_min(values, n, &v.min, &nz);
+                    v.max = v.sum = v.min;
+                    break;
+
+                case GROUP_MAX:
+                    v.count = (uint32_t)rrdr_grouping_max(values, n, &v.max, &nz);
+                    v.min = v.sum = v.max;
+                    break;
+
+                default:
+                    v.count = (uint32_t)rrdr_grouping_sum(values, n, &v.sum, &nz);
+                    v.min = v.max = v.sum;
+                    break;
+            }
+
+            rrddim_summary_merge(&g, &v);
+            nonzero |= nz;
+            k += n;
+        }
+
+        calculated_number value = 0;
+        if(likely(g.count)) {
+            switch(q->group_method) {
+                case GROUP_MIN:
+                    value = g.min;
+                    break;
+
+                case GROUP_MAX:
+                    value = g.max;
+                    break;
+
+                case GROUP_SUM:
+                    value = g.sum;
+                    break;
+
+                default:
+                    value = (unlikely(q->group_points != 1)) ? g.sum / q->group_sum_divisor : g.sum / (calculated_number)g.count;
+                    break;
+            }
+        }
+
+        rrdr_store_point(r, i, c, value, g.count, nonzero, g.reset);
+    }
+}
+
+// *overwritten is set when the data collection thread stored over the slots we read
+static RRDR *rrdr_query_execute(RRDSET *st, RRDR_QUERY *q, int *overwritten)
+{
+#ifdef HIBENCHMARKS_INTERNAL_CHECKS
+    int debug = rrdset_flag_check(st, RRDSET_FLAG_DEBUG)?1:0;
+#endif
+
+    struct rrdset_tier *tier = q->tier;
+    int tier_id = q->tier_id;
+    int update_every = q->update_every;
+    long entries = q->entries;
+
+    time_t after = q->after;
+    time_t before = q->before;
+#ifdef HIBENCHMARKS_INTERNAL_CHECKS
+    time_t duration = before - after;
+#endif
+    long points = q->points;
+    long group = q->group;
+    long group_points = q->group_points;
+    calculated_number group_sum_divisor = q->group_sum_divisor;
+    int group_method = q->group_method;
+
+    // with memory mode dbengine, the data older than the round robin database
+    // are read from the datafiles, on a linear range from the oldest page to now
+    struct rrdset_tier disk_range;
+    int query_disk = 0;
+    if(unlikely(!tier && rrdset_has_dbengine(st) && after <= rrdset_first_entry_t(&q->ring))) {
+        rrdeng_query_range(st, &disk_range);
+        tier = &disk_range;
+        entries = tier->entries;
+        query_disk = 1;
+    }
+
+    // find the starting and ending slots in our round robin db
+    struct rrdset_tier *db = (tier) ? tier : &q->ring;
+
+    long    start_at_slot = (long)rrdset_time2slot(db, before),
+            stop_at_slot  = (long)rrdset_time2slot(db, after);
+
+#ifdef HIBENCHMARKS_INTERNAL_CHECKS
+    if(start_at_slot < 0 || start_at_slot >= entries)
+        error("INTERNAL CHECK: start_at_slot is invalid %ld, expected 0 to %ld", start_at_slot, entries - 1);
+
+    if(stop_at_slot < 0 || stop_at_slot >= entries)
+        error("INTERNAL CHECK: stop_at_slot is invalid %ld, expected 0 to %ld", stop_at_slot, entries - 1);
+#endif
+
 
     // -------------------------------------------------------------------------
     // initialize our result set
@@ -1593,7 +1921,7 @@ RRDR *rrd2rrdr(RRDSET *st, long points, long long after, long long before, int g
         return r;
     }
 
-    if(unlikely(absolute_period_requested == 1))
+    if(unlikely(q->absolute_period_requested == 1))
         r->result_options |= RRDR_RESULT_OPTION_ABSOLUTE;
     else
         r->result_options |= RRDR_RESULT_OPTION_RELATIVE;
@@ -1607,9 +1935,9 @@ RRDR *rrd2rrdr(RRDSET *st, long points, long long after, long long before, int g
 #ifdef HIBENCHMARKS_INTERNAL_CHECKS
     if(debug) debug(D_RRD_STATS, "INFO %s first_t: %u, last_t: %u, all_duration: %u, after: %u, before: %u, duration: %u, points: %ld, group: %ld, group_points: %ld"
             , st->id
-            , (uint32_t)first_entry_t
-            , (uint32_t)last_entry_t
-            , (uint32_t)(last_entry_t - first_entry_t)
+            , (uint32_t)q->first_entry_t
+            , (uint32_t)q->last_entry_t
+            , (uint32_t)(q->last_entry_t - q->first_entry_t)
             , (uint32_t)after
             , (uint32_t)before
             , (uint32_t)duration
@@ -1619,34 +1947,15 @@ RRDR *rrd2rrdr(RRDSET *st, long points, long long after, long long before, int g
             );
 #endif
 
-    // -------------------------------------------------------------------------
-    // temp arrays for keeping values per dimension
-
-    calculated_number   last_values[dimensions]; // keep the last value of each dimension
-    calculated_number   group_values[dimensions]; // keep sums when grouping
-    long                group_counts[dimensions]; // keep the number of values added to group_values
-    uint8_t             group_options[dimensions];
-    uint8_t             found_non_zero[dimensions];
-
-
-    // initialize them
-    RRDDIM *rd;
-    long c;
-    rrdset_check_rdlock(st);
-    for( rd = st->dimensions, c = 0 ; rd && c < dimensions ; rd = rd->next, c++) {
-        last_values[c] = 0;
-        group_values[c] = (group_method == GROUP_MAX || group_method == GROUP_MIN)?NAN:0;
-        group_counts[c] = 0;
-        group_options[c] = 0;
-        found_non_zero[c] = 0;
-    }
-
 
     // -------------------------------------------------------------------------
-    // the main loop
+    // find the rows
+    //
+    // each row groups the values of group consecutive slots, so the slots of
+    // all the rows are consecutive too - they are found once, for all dimensions
 
-    time_t  now = rrdset_slot2time(st, start_at_slot),
-            dt = st->update_every,
+    time_t  now = (time_t)rrdset_slot2time(db, start_at_slot),
+            dt = update_every,
             group_start_t = 0;
 
 #ifdef HIBENCHMARKS_INTERNAL_CHECKS
@@ -1657,242 +1966,837 @@ RRDR *rrd2rrdr(RRDSET *st, long points, long long after, long long before, int g
             , (uint32_t)before
             , start_at_slot
             , (uint32_t)now
-            , st->current_entry
-            , st->entries
+            , db->current_entry
+            , entries
             );
 #endif
 
     r->group = group;
-    r->update_every = (int)group * st->update_every;
+    r->update_every = (int)group * update_every;
     r->before = now;
     r->after = now;
 
-    //info("RRD2RRDR(): %s: STARTING", st->id);
+    long    slot = start_at_slot, counter = 0, stop_now = 0, added = 0, group_count = 0,
+            newest_slot = -1;   // the first slot of the first row
+    time_t  newest_t = 0;
 
-    long slot = start_at_slot, counter = 0, stop_now = 0, added = 0, group_count = 0, add_this = 0;
     for(; !stop_now ; now -= dt, slot--, counter++) {
-        if(unlikely(slot < 0)) slot = st->entries - 1;
+        if(unlikely(slot < 0)) slot = entries - 1;
         if(unlikely(slot == stop_at_slot)) stop_now = counter;
 
-#ifdef HIBENCHMARKS_INTERNAL_CHECKS
-        if(unlikely(debug)) debug(D_RRD_STATS, "ROW %s slot: %ld, entries_counter: %ld, group_count: %ld, added: %ld, now: %ld, %s %s"
-                , st->id
-                , slot
-                , counter
-                , group_count + 1
-                , added
-                , now
-                , (group_count + 1 == group)?"PRINT":"  -  "
-                , (now >= after && now <= before)?"RANGE":"  -  "
-                );
-#endif
-
         // make sure we return data in the proper time range
         if(unlikely(now > before)) continue;
         if(unlikely(now < after)) break;
 
+        if(unlikely(newest_slot == -1)) {
+            newest_slot = slot;
+            newest_t = now;
+        }
+
         if(unlikely(group_count == 0)) group_start_t = now;
         group_count++;
 
         if(unlikely(group_count == group)) {
             if(unlikely(added >= points)) break;
-            add_this = 1;
+            if(unlikely(!rrdr_line_init(r, group_start_t))) break;
+
+            r->after = now;
+            added++;
+            group_count = 0;
         }
+    }
 
-        // do the calculations
-        for(rd = st->dimensions, c = 0 ; rd && c < dimensions ; rd = rd->next, c++) {
-            storage_number n = rd->values[slot];
-            if(unlikely(!does_storage_number_exist(n))) continue;
+    long rows = r->c + 1;
 
-            group_counts[c]++;
 
-            calculated_number value = unpack_storage_number(n);
-            if(likely(value != 0.0)) {
-                group_options[c] |= RRDR_NONZERO;
-                found_non_zero[c] = 1;
-            }
+    // -------------------------------------------------------------------------
+    // group the slots of each dimension
 
-            if(unlikely(did_storage_number_reset(n)))
-                group_options[c] |= RRDR_RESET;
+    if(likely(rows > 0)) {
+        long slots = rows * group;
 
-            switch(group_method) {
-                case GROUP_MIN:
-                    if(unlikely(isnan(group_values[c])) ||
-                            calculated_number_fabs(value) < calculated_number_fabs(group_values[c]))
-                        group_values[c] = value;
-                    break;
+        // the oldest slot of the rows
+        long oldest_slot = newest_slot - (slots - 1);
+        while(oldest_slot < 0) oldest_slot += entries;
+        time_t oldest_t = newest_t - (slots - 1) * dt;
 
-                case GROUP_MAX:
-                    if(unlikely(isnan(group_values[c])) ||
-                            calculated_number_fabs(value) > calculated_number_fabs(group_values[c]))
-                        group_values[c] = value;
-                    break;
+        calculated_number *values = mallocz(slots * sizeof(calculated_number));
+        uint8_t *resets = mallocz(slots * sizeof(uint8_t));
 
-                default:
-                case GROUP_SUM:
-                case GROUP_AVERAGE:
-                case GROUP_UNDEFINED:
-                    group_values[c] += value;
-                    break;
+        // the slots of the rows may wrap around the end of the round robin database
+        long first_part = (oldest_slot + slots > entries) ? entries - oldest_slot : slots;
 
-                case GROUP_INCREMENTAL_SUM:
-                    if(unlikely(slot == start_at_slot))
-                        last_values[c] = value;
+        // the sources of the slots that are not the arrays of the dimensions
+        storage_number *packed = NULL;
+        RRDDIM_PAGE_ITERATOR *page_iterator = NULL;
+        RRDENG_QUERY_HANDLE *disk_handle = NULL;
 
-                    group_values[c] += last_values[c] - value;
-                    last_values[c] = value;
-                    break;
-            }
+        // the percentiles select the values of each row in place
+        calculated_number *scratch = NULL;
+        if(unlikely(group_method == GROUP_MEDIAN || group_method == GROUP_PERCENTILE95 || group_method == GROUP_PERCENTILE99))
+            scratch = mallocz(group * sizeof(calculated_number));
+
+        // the rows that group whole blocks of slots, use their summaries
+        int use_summaries = (!tier && group >= RRDDIM_SUMMARY_SLOTS && rrdr_group_method_is_summarized(group_method));
+
+        if(unlikely(query_disk)) {
+            disk_handle = mallocz(sizeof(RRDENG_QUERY_HANDLE));
+            packed = mallocz(slots * sizeof(storage_number));
+        }
+        else if(unlikely(!tier && rrd_memory_mode_has_pages(st->rrd_memory_mode))) {
+            page_iterator = mallocz(sizeof(RRDDIM_PAGE_ITERATOR));
+            packed = mallocz(slots * sizeof(storage_number));
         }
 
-        // added it
-        if(unlikely(add_this)) {
-            if(unlikely(!rrdr_line_init(r, group_start_t))) break;
+        RRDDIM *rd;
+        long c, i, k;
+        for(rd = st->dimensions, c = 0 ; rd && c < dimensions ; rd = rd->next, c++) {
 
-            r->after = now;
+            if(likely(use_summaries && rd->summaries)) {
+                rrdr_group_summarized(r, c, st, rd, q, rows, oldest_slot, oldest_t, page_iterator, values, resets, packed);
+                continue;
+            }
 
-            calculated_number *cn = rrdr_line_values(r);
-            uint8_t *co = rrdr_line_options(r);
+            // unpack the slots of the dimension
+            if(unlikely(disk_handle)) {
+                rrdeng_query_init(disk_handle, rd);
+                for(k = 0; k < slots ; k++)
+                    packed[k] = rrdeng_query_value(disk_handle, oldest_t + k * dt);
 
-            for(rd = st->dimensions, c = 0 ; rd && c < dimensions ; rd = rd->next, c++) {
+                rrdr_unpack_storage_numbers(packed, slots, values, resets);
+            }
+            else if(unlikely(tier)) {
+                RRD_TIER_SLOT *ts = rd->tiers[tier_id].slots;
 
-                // update the dimension options
-                if(likely(found_non_zero[c])) r->od[c] |= RRDR_NONZERO;
+                for(k = 0, slot = oldest_slot; k < slots ; k++, slot++) {
+                    if(unlikely(slot >= entries)) slot = 0;
 
-                // store the specific point options
-                co[c] = group_options[c];
+                    resets[k] = 0;
+                    if(unlikely(!ts[slot].count)) {
+                        values[k] = NAN;
+                        continue;
+                    }
 
-                // store the value
-                if(unlikely(group_counts[c] == 0)) {
-                    cn[c] = 0.0;
-                    co[c] |= RRDR_EMPTY;
-                    group_values[c] = (group_method == GROUP_MAX || group_method == GROUP_MIN)?NAN:0;
-                }
-                else {
                     switch(group_method) {
                         case GROUP_MIN:
+                            values[k] = unpack_storage_number(ts[slot].min);
+                            break;
+
                         case GROUP_MAX:
-                            if(unlikely(isnan(group_values[c])))
-                                cn[c] = 0;
-                            else {
-                                cn[c] = group_values[c];
-                                group_values[c] = NAN;
-                            }
+                            values[k] = unpack_storage_number(ts[slot].max);
                             break;
 
+                        // a slot is the sum of all the values it downsampled
                         case GROUP_SUM:
-                        case GROUP_INCREMENTAL_SUM:
-                            cn[c] = group_values[c];
-                            group_values[c] = 0;
+                            values[k] = unpack_storage_number(ts[slot].sum);
                             break;
 
+                        // the other methods group the averages of the slots
                         default:
-                        case GROUP_AVERAGE:
-                        case GROUP_UNDEFINED:
-                            if(unlikely(group_points != 1))
-                                cn[c] = group_values[c] / group_sum_divisor;
-                            else
-                                cn[c] = group_values[c] / group_counts[c];
-
-                            group_values[c] = 0;
+                            values[k] = unpack_storage_number(ts[slot].sum) / (calculated_number)ts[slot].count;
                             break;
                     }
-
-                    if(cn[c] < r->min) r->min = cn[c];
-                    if(cn[c] > r->max) r->max = cn[c];
+                }
+            }
+            else if(unlikely(page_iterator)) {
+                rrddim_page_iterator_init(page_iterator, rd);
+                for(k = 0, slot = oldest_slot; k < slots ; k++, slot++) {
+                    if(unlikely(slot >= entries)) slot = 0;
+                    packed[k] = rrddim_page_iterator_get(page_iterator, slot);
                 }
 
-                // reset for the next loop
-                group_counts[c] = 0;
-                group_options[c] = 0;
+                rrdr_unpack_storage_numbers(packed, slots, values, resets);
+            }
+            else if(unlikely(st->storage_format == RRD_STORAGE_FORMAT_64BIT)) {
+                rrdr_unpack_storage_numbers64(&rrddim_values64(rd)[oldest_slot], first_part, values, resets);
+                if(unlikely(first_part < slots))
+                    rrdr_unpack_storage_numbers64(rrddim_values64(rd), slots - first_part, &values[first_part], &resets[first_part]);
+            }
+            else {
+                rrdr_unpack_storage_numbers(&rd->values[oldest_slot], first_part, values, resets);
+                if(unlikely(first_part < slots))
+                    rrdr_unpack_storage_numbers(rd->values, slots - first_part, &values[first_part], &resets[first_part]);
             }
 
-            added++;
-            group_count = 0;
-            add_this = 0;
-        }
-    }
+            // the incremental sum starts from the first slot of the query
+            calculated_number last_value = 0;
+            if(unlikely(group_method == GROUP_INCREMENTAL_SUM && newest_slot == start_at_slot && !isnan(values[slots - 1])))
+                last_value = values[slots - 1];
 
-    rrdr_done(r);
-    //info("RRD2RRDR(): %s: END %ld loops made, %ld points generated", st->id, counter, rrdr_rows(r));
-    //error("SHIFT: %s: wanted %ld points, got %ld", st->id, points, rrdr_rows(r));
-    return r;
-}
+            // the rate is measured up to the oldest value of the newer row
+            long last_k = -1;
 
-int rrdset2value_api_v1(
-          RRDSET *st
-        , BUFFER *wb
-        , calculated_number *n
-        , const char *dimensions
-        , long points
-        , long long after
-        , long long before
-        , int group_method
-        , long group_time
-        , uint32_t options
-        , time_t *db_after
-        , time_t *db_before
-        , int *value_is_null
-) {
-    RRDR *r = rrd2rrdr(st, points, after, before, group_method, group_time, !(options & RRDR_OPTION_NOT_ALIGNED));
-    if(!r) {
-        if(value_is_null) *value_is_null = 1;
-        return 500;
-    }
+            // group them - the newest row is the last in values
+            for(i = 0; i < rows ; i++) {
+                const calculated_number *v = &values[(rows - 1 - i) * group];
 
-    if(rrdr_rows(r) == 0) {
-        rrdr_free(r);
+                calculated_number value = 0, average;
+                int nonzero = 0;
+                long count, oldest, newest;
 
-        if(db_after)  *db_after  = 0;
-        if(db_before) *db_before = 0;
-        if(value_is_null) *value_is_null = 1;
+                switch(group_method) {
+                    case GROUP_MIN:
+                        count = rrdr_grouping_min(v, group, &value, &nonzero);
+                        break;
 
-        return 400;
-    }
+                    case GROUP_MAX:
+                        count = rrdr_grouping_max(v, group, &value, &nonzero);
+                        break;
 
-    if(wb) {
-        if (r->result_options & RRDR_RESULT_OPTION_RELATIVE)
-            buffer_no_cacheable(wb);
-        else if (r->result_options & RRDR_RESULT_OPTION_ABSOLUTE)
-            buffer_cacheable(wb);
-    }
+                    case GROUP_SUM:
+                        count = rrdr_grouping_sum(v, group, &value, &nonzero);
+                        break;
 
-    options = rrdr_check_options(r, options, dimensions);
+                    case GROUP_INCREMENTAL_SUM:
+                        count = rrdr_grouping_oldest_newest(v, group, &oldest, &newest, &nonzero);
+                        if(likely(count)) {
+                            value = last_value - v[oldest];
+                            last_value = v[oldest];
+                        }
+                        break;
 
-    if(dimensions)
-        rrdr_disable_not_selected_dimensions(r, options, dimensions);
+                    case GROUP_MEDIAN:
+                        count = rrdr_grouping_percentile(v, group, 50, scratch, &value, &nonzero);
+                        break;
 
-    if(db_after)  *db_after  = r->after;
-    if(db_before) *db_before = r->before;
+                    case GROUP_PERCENTILE95:
+                        count = rrdr_grouping_percentile(v, group, 95, scratch, &value, &nonzero);
+                        break;
 
-    long i = (options & RRDR_OPTION_REVERSED)?rrdr_rows(r) - 1:0;
-    *n = rrdr2value(r, i, options, value_is_null);
+                    case GROUP_PERCENTILE99:
+                        count = rrdr_grouping_percentile(v, group, 99, scratch, &value, &nonzero);
+                        break;
 
-    rrdr_free(r);
-    return 200;
-}
+                    case GROUP_STDDEV:
+                        count = rrdr_grouping_stddev(v, group, &average, &value, &nonzero);
+                        nonzero = (value != 0);
+                        break;
 
-int rrdset2anything_api_v1(
-          RRDSET *st
+                    case GROUP_CV:
+                        count = rrdr_grouping_stddev(v, group, &average, &value, &nonzero);
+                        if(likely(count)) {
+                            if(likely(average != 0))
+                                value = 100 * value / calculated_number_fabs(average);
+                            else
+                                count = 0;
+                        }
+                        nonzero = (value != 0);
+                        break;
+
+                    case GROUP_RATE:
+                        count = rrdr_grouping_oldest_newest(v, group, &oldest, &newest, &nonzero);
+                        if(likely(count)) {
+                            // the newest row has no newer one, it is measured up to its newest value
+                            long first = (rows - 1 - i) * group + oldest;
+                            if(unlikely(last_k == -1)) last_k = (rows - 1 - i) * group + newest;
+
+                            if(likely(last_k > first))
+                                value = (values[last_k] - values[first]) / (calculated_number)((last_k - first) * dt);
+                            else
+                                count = 0;
+
+                            last_k = first;
+                        }
+                        nonzero = (value != 0);
+                        break;
+
+                    default:
+                    case GROUP_AVERAGE:
+                    case GROUP_UNDEFINED:
+                        count = rrdr_grouping_sum(v, group, &value, &nonzero);
+                        if(likely(count)) {
+                            if(unlikely(group_points != 1))
+                                value = value / group_sum_divisor;
+                            else
+                                value = value / count;
+                        }
+                        break;
+                }
+
+                rrdr_store_point(r, i, c, value, count, nonzero, (memchr(&resets[(rows - 1 - i) * group], 1, (size_t)group)) ? 1 : 0);
+            }
+        }
+
+        freez(values);
+        freez(resets);
+        freez(scratch);
+        freez(packed);
+        freez(page_iterator);
+        freez(disk_handle);
+    }
+
+    // the slots of the round robin database we read, may have been stored again meanwhile
+    if(unlikely(!tier && rrdset_ring_overwritten(st, &q->ring, q->seq, stop_at_slot)))
+        *overwritten = 1;
+
+    rrdr_done(r);
+    //info("RRD2RRDR(): %s: END %ld loops made, %ld points generated", st->id, counter, rrdr_rows(r));
+    //error("SHIFT: %s: wanted %ld points, got %ld", st->id, points, rrdr_rows(r));
+    return r;
+}
+
+// prepare and execute a query
+// again, when the data collection thread went through the slots we read
+static RRDR *rrdr_query(RRDSET *st, RRDR_QUERY *q, long points, long long after, long long before, int group_method, long group_time, int aligned)
+{
+    int tries = 3;
+
+    for(;;) {
+        if(unlikely(!rrdr_query_prepare(st, q, points, after, before, group_method, group_time, aligned)))
+            return rrdr_create(st, 1);
+
+        int overwritten = 0;
+        RRDR *r = rrdr_query_execute(st, q, &overwritten);
+
+        if(likely(!overwritten || !r || !--tries))
+            return r;
+
+        rrdr_free(r);
+    }
+}
+
+RRDR *rrd2rrdr(RRDSET *st, long points, long long after, long long before, int group_method, long group_time, int aligned)
+{
+    RRDR_QUERY q;
+    return rrdr_query(st, &q, points, after, before, group_method, group_time, aligned);
+}
+
+// ----------------------------------------------------------------------------
+// rrd2rrdr() resuming a previous result of the same query
+
+// the result of query q, from the rows of the newer slots in fresh (may be NULL)
+// followed by the rows of the previous result
+// returns NULL when they do not make up the result of q
+static RRDR *rrdr_resume_merge(RRDSET *st, RRDR_QUERY *q, RRDR *fresh, RRDR *previous)
+{
+    time_t group_duration = q->group * q->update_every;
+    long fresh_rows = (fresh) ? rrdr_rows(fresh) : 0;
+    long previous_rows = rrdr_rows(previous);
+
+    RRDR *r = rrdr_create(st, q->points);
+    if(unlikely(!r))
+        return NULL;
+
+    long d = r->d, c, i = 0;
+    if(unlikely(!d || d != previous->d || (fresh && d != fresh->d) || fresh_rows > q->points || !previous_rows))
+        goto cannot_merge;
+
+    // the newest rows come from the fresh result
+    for(c = 0; c < fresh_rows ; c++) {
+        r->t[c] = fresh->t[c];
+        memcpy(&r->v[c * d], &fresh->v[c * d], d * sizeof(calculated_number));
+        memcpy(&r->o[c * d], &fresh->o[c * d], d * sizeof(uint8_t));
+    }
+
+    // the rest come from the previous one
+    time_t t = q->before - fresh_rows * group_duration;
+    if(unlikely(t > previous->t[0] || (previous->t[0] - t) % group_duration))
+        goto cannot_merge;
+
+    for(i = (previous->t[0] - t) / group_duration; c < q->points && i < previous_rows ; c++, i++, t -= group_duration) {
+        if(unlikely(previous->t[i] != t))
+            goto cannot_merge;
+
+        r->t[c] = t;
+        memcpy(&r->v[c * d], &previous->v[i * d], d * sizeof(calculated_number));
+        memcpy(&r->o[c * d], &previous->o[i * d], d * sizeof(uint8_t));
+    }
+
+    if(unlikely(c < q->points))
+        goto cannot_merge;
+
+    // the dimension options and the min and max of the result
+    for(c = 0; c < q->points ; c++) {
+        calculated_number *cn = &r->v[c * d];
+        uint8_t *co = &r->o[c * d];
+
+        for(i = 0; i < d ; i++) {
+            if(co[i] & RRDR_NONZERO) r->od[i] |= RRDR_NONZERO;
+            if(co[i] & RRDR_EMPTY) continue;
+
+            if(cn[i] < r->min) r->min = cn[i];
+            if(cn[i] > r->max) r->max = cn[i];
+        }
+    }
+
+    r->result_options |= (q->absolute_period_requested == 1) ? RRDR_RESULT_OPTION_ABSOLUTE : RRDR_RESULT_OPTION_RELATIVE;
+    r->group = q->group;
+    r->update_every = (int)group_duration;
+    r->before = r->t[0];
+    r->after = r->t[q->points - 1] - group_duration + q->update_every;
+    r->c = q->points - 1;
+    rrdr_done(r);
+    return r;
+
+cannot_merge:
+    rrdr_free(r);
+    return NULL;
+}
+
+// check if the slots stored since the previous query, just slide its timeframe
+// by a number of whole rows (or none), so that query q can reuse its rows
+static inline int rrdr_query_can_resume(RRDR_QUERY *previous, RRDR_QUERY *q) {
+    time_t group_duration = q->group * q->update_every;
+
+    return !previous->tier && !q->tier
+           && q->group_method != GROUP_INCREMENTAL_SUM
+           && q->group_method != GROUP_RATE
+           && previous->update_every == q->update_every
+           && previous->group == q->group
+           && previous->group_points == q->group_points
+           && q->ring.counter >= previous->ring.counter
+           && q->ring.counter - previous->ring.counter == (q->seq - previous->seq) / 2
+           && q->before >= previous->before
+           && (q->before - previous->before) % group_duration == 0
+           && (q->before - previous->before) / group_duration < q->points;
+}
+
+// resume the previous result of the same query, for the timeframe of q
+// the rows that fell out of the timeframe are dropped and only the new
+// trailing rows are queried - returns NULL when it cannot be resumed
+static RRDR *rrd2rrdr_resume(RRDSET *st, RRDR_QUERY *q, RRDR_QUERY *previous_q, RRDR *previous)
+{
+    if(unlikely(!rrdr_query_can_resume(previous_q, q)))
+        return NULL;
+
+    if(q->before == previous_q->before)
+        return rrdr_resume_merge(st, q, NULL, previous);
+
+    // query only the rows of the slots stored since
+    RRDR_QUERY fresh_q = *q;
+    fresh_q.after = previous_q->before;
+    fresh_q.points = (q->before - previous_q->before) / (q->group * q->update_every);
+
+    int overwritten = 0;
+    RRDR *r = NULL, *fresh = rrdr_query_execute(st, &fresh_q, &overwritten);
+    if(likely(fresh && !overwritten && rrdr_rows(fresh) == fresh_q.points))
+        r = rrdr_resume_merge(st, q, fresh, previous);
+
+    if(likely(fresh)) rrdr_free(fresh);
+    return r;
+}
+
+// ----------------------------------------------------------------------------
+// rrd2rrdr() query cache
+//
+// the dashboards query the same charts, for the same relative timeframes,
+// every time the charts are updated. The results are kept in a bounded cache,
+// keyed by chart, timeframe and grouping. When the chart has not stored any
+// slots since, the cached result is reused. When it has, only the rows of
+// the new slots are queried and the rest are taken from the cached result.
+//
+// The results carry a cursor to their entry, given back to the clients in
+// the JSON wrapper. With it, the next request of the client resumes its
+// previous result, without looking for it.
+
+long rrdr_cache_entries = 64;
+
+typedef struct rrdr_cache_entry {
+    RRDSET *st;                     // the key of the entry
+    long points;
+    long long after;
+    long long before;
+    int group_method;
+    long group_time;
+    int aligned;
+
+    RRDR_QUERY q;                   // the query that generated the result
+    RRDR *r;                        // the result - it does not keep the chart from being freed
+
+    size_t generation;              // incremented every time the entry is given to another key
+    usec_t last_used_ut;
+} RRDR_CACHE_ENTRY;
+
+static struct rrdr_cache {
+    hibenchmarks_mutex_t mutex;
+
+    long size;
+    RRDR_CACHE_ENTRY *entries;
+    size_t generation;
+
+    struct rrdr_cache_stats stats;
+} rrdr_cache = {
+        .mutex = HIBENCHMARKS_MUTEX_INITIALIZER,
+        .size = 0,
+        .entries = NULL,
+        .generation = 0
+};
+
+void rrdr_cache_get_stats(struct rrdr_cache_stats *stats) {
+    hibenchmarks_mutex_lock(&rrdr_cache.mutex);
+    *stats = rrdr_cache.stats;
+    hibenchmarks_mutex_unlock(&rrdr_cache.mutex);
+}
+
+// a copy of the result, that does not keep the chart from being freed
+static RRDR *rrdr_duplicate(RRDR *src) {
+    RRDR *r = mallocz(sizeof(RRDR));
+    *r = *src;
+    r->has_st_reader = 0;
+    r->cursor_generation = 0;
+
+    r->t = mallocz(r->n * sizeof(time_t));
+    r->v = mallocz(r->n * r->d * sizeof(calculated_number));
+    r->o = mallocz(r->n * r->d * sizeof(uint8_t));
+    r->od = mallocz(r->d * sizeof(uint8_t));
+
+    memcpy(r->t, src->t, r->n * sizeof(time_t));
+    memcpy(r->v, src->v, r->n * r->d * sizeof(calculated_number));
+    memcpy(r->o, src->o, r->n * r->d * sizeof(uint8_t));
+    memcpy(r->od, src->od, r->d * sizeof(uint8_t));
+
+    return r;
+}
+
+static RRDR_CACHE_ENTRY *rrdr_cache_find(RRDSET *st, long points, long long after, long long before, int group_method, long group_time, int aligned) {
+    long i;
+    for(i = 0; i < rrdr_cache.size ; i++) {
+        RRDR_CACHE_ENTRY *e = &rrdr_cache.entries[i];
+        if(e->st == st && e->points == points && e->after == after && e->before == before
+           && e->group_method == group_method && e->group_time == group_time && e->aligned == aligned)
+            return e;
+    }
+
+    return NULL;
+}
+
+// the cursor is "ENTRY-GENERATION"
+static RRDR_CACHE_ENTRY *rrdr_cache_find_cursor(const char *cursor, RRDSET *st, long points, long long after, long long before, int group_method, long group_time, int aligned) {
+    if(!cursor || !*cursor) return NULL;
+
+    char *end;
+    long i = strtol(cursor, &end, 10);
+    if(*end != '-' || i < 0 || i >= rrdr_cache.size) return NULL;
+
+    size_t generation = strtoull(&end[1], &end, 10);
+    if(*end) return NULL;
+
+    RRDR_CACHE_ENTRY *e = &rrdr_cache.entries[i];
+    if(e->generation != generation || e->st != st || e->points != points || e->after != after || e->before != before
+       || e->group_method != group_method || e->group_time != group_time || e->aligned != aligned)
+        return NULL;
+
+    return e;
+}
+
+static inline void rrdr_cache_set_cursor(RRDR *r, RRDR_CACHE_ENTRY *e) {
+    r->cursor_entry = e - rrdr_cache.entries;
+    r->cursor_generation = e->generation;
+}
+
+static void rrdr_cache_store(RRDSET *st, long points, long long after, long long before, int group_method, long group_time, int aligned, RRDR_QUERY *q, RRDR *r) {
+    hibenchmarks_mutex_lock(&rrdr_cache.mutex);
+
+    if(unlikely(!rrdr_cache.entries)) {
+        rrdr_cache.size = rrdr_cache_entries;
+        rrdr_cache.entries = callocz((size_t)rrdr_cache.size, sizeof(RRDR_CACHE_ENTRY));
+    }
+
+    RRDR_CACHE_ENTRY *e = rrdr_cache_find(st, points, after, before, group_method, group_time, aligned);
+    if(unlikely(e && e->r && e->q.seq > q->seq)) {
+        // another query stored a newer result meanwhile
+        rrdr_cache_set_cursor(r, e);
+        hibenchmarks_mutex_unlock(&rrdr_cache.mutex);
+        return;
+    }
+
+    if(likely(!e)) {
+        // replace the least recently used entry
+        long i;
+        for(i = 0, e = &rrdr_cache.entries[0]; i < rrdr_cache.size ; i++) {
+            if(!rrdr_cache.entries[i].st) {
+                e = &rrdr_cache.entries[i];
+                break;
+            }
+
+            if(rrdr_cache.entries[i].last_used_ut < e->last_used_ut)
+                e = &rrdr_cache.entries[i];
+        }
+
+        e->generation = ++rrdr_cache.generation;
+    }
+
+    if(e->r) rrdr_free(e->r);
+
+    e->st = st;
+    e->points = points;
+    e->after = after;
+    e->before = before;
+    e->group_method = group_method;
+    e->group_time = group_time;
+    e->aligned = aligned;
+    e->q = *q;
+    e->r = rrdr_duplicate(r);
+    e->last_used_ut = now_monotonic_usec();
+    rrdr_cache_set_cursor(r, e);
+
+    hibenchmarks_mutex_unlock(&rrdr_cache.mutex);
+}
+
+// rrd2rrdr(), answered from the query cache when possible
+// cursor is the one returned with a previous result of the same query, or NULL
+static RRDR *rrd2rrdr_cached(RRDSET *st, long points, long long after, long long before, int group_method, long group_time, int aligned, const char *cursor)
+{
+    // only the relative timeframes are asked again and again
+    if(unlikely(rrdr_cache_entries <= 0
+                || ((after < 0)?-after:after) > API_RELATIVE_TIME_MAX
+                || ((before < 0)?-before:before) > API_RELATIVE_TIME_MAX))
+        return rrd2rrdr(st, points, after, before, group_method, group_time, aligned);
+
+    RRDR_QUERY q;
+    if(unlikely(!rrdr_query_prepare(st, &q, points, after, before, group_method, group_time, aligned)))
+        return rrdr_create(st, 1);
+
+    RRDR *r = NULL, *cached = NULL;
+    RRDR_QUERY cached_q;
+
+    hibenchmarks_mutex_lock(&rrdr_cache.mutex);
+
+    RRDR_CACHE_ENTRY *e = rrdr_cache_find_cursor(cursor, st, points, after, before, group_method, group_time, aligned);
+    if(!e) e = rrdr_cache_find(st, points, after, before, group_method, group_time, aligned);
+
+    if(e && e->r) {
+        e->last_used_ut = now_monotonic_usec();
+
+        if(e->q.seq == q.seq || (q.before == e->q.before && rrdr_query_can_resume(&e->q, &q))) {
+            // nothing has been stored since, or not a whole row yet
+            r = rrdr_resume_merge(st, &q, NULL, e->r);
+            if(likely(r)) {
+                rrdr_cache.stats.hits++;
+                rrdr_cache_set_cursor(r, e);
+            }
+        }
+        else if(rrdr_query_can_resume(&e->q, &q)) {
+            // take it, while we query the new slots
+            cached = e->r;
+            cached_q = e->q;
+            e->r = NULL;
+        }
+    }
+
+    hibenchmarks_mutex_unlock(&rrdr_cache.mutex);
+
+    if(likely(r))
+        return r;
+
+    if(cached) {
+        r = rrd2rrdr_resume(st, &q, &cached_q, cached);
+        rrdr_free(cached);
+
+        if(likely(r)) {
+            hibenchmarks_mutex_lock(&rrdr_cache.mutex);
+            rrdr_cache.stats.updates++;
+            hibenchmarks_mutex_unlock(&rrdr_cache.mutex);
+        }
+    }
+
+    if(unlikely(!r)) {
+        r = rrdr_query(st, &q, points, after, before, group_method, group_time, aligned);
+        if(unlikely(!r || !rrdr_rows(r)))
+            return r;
+
+        hibenchmarks_mutex_lock(&rrdr_cache.mutex);
+        rrdr_cache.stats.misses++;
+        hibenchmarks_mutex_unlock(&rrdr_cache.mutex);
+    }
+
+    rrdr_cache_store(st, points, after, before, group_method, group_time, aligned, &q, r);
+    return r;
+}
+
+// the chart is being freed - the caller has made sure no queries are running on it
+void rrdr_cache_free_chart(RRDSET *st) {
+    hibenchmarks_mutex_lock(&rrdr_cache.mutex);
+
+    long i;
+    for(i = 0; i < rrdr_cache.size ; i++) {
+        RRDR_CACHE_ENTRY *e = &rrdr_cache.entries[i];
+        if(e->st != st) continue;
+
+        if(e->r) rrdr_free(e->r);
+        memset(e, 0, sizeof(RRDR_CACHE_ENTRY));
+    }
+
+    hibenchmarks_mutex_unlock(&rrdr_cache.mutex);
+}
+
+int rrdset2value_api_v1(
+          RRDSET *st
         , BUFFER *wb
-        , BUFFER *dimensions
-        , uint32_t format
+        , calculated_number *n
+        , const char *dimensions
         , long points
         , long long after
         , long long before
         , int group_method
         , long group_time
         , uint32_t options
-        , time_t *latest_timestamp
+        , time_t *db_after
+        , time_t *db_before
+        , int *value_is_null
 ) {
-    st->last_accessed_time = now_realtime_sec();
-
     RRDR *r = rrd2rrdr(st, points, after, before, group_method, group_time, !(options & RRDR_OPTION_NOT_ALIGNED));
     if(!r) {
-        buffer_strcat(wb, "Cannot generate output with these parameters on this chart.");
+        if(value_is_null) *value_is_null = 1;
         return 500;
     }
 
+    if(rrdr_rows(r) == 0) {
+        rrdr_free(r);
+
+        if(db_after)  *db_after  = 0;
+        if(db_before) *db_before = 0;
+        if(value_is_null) *value_is_null = 1;
+
+        return 400;
+    }
+
+    if(wb) {
+        if (r->result_options & RRDR_RESULT_OPTION_RELATIVE)
+            buffer_no_cacheable(wb);
+        else if (r->result_options & RRDR_RESULT_OPTION_ABSOLUTE)
+            buffer_cacheable(wb);
+    }
+
+    options = rrdr_check_options(r, options, dimensions);
+
+    if(dimensions)
+        rrdr_disable_not_selected_dimensions(r, options, dimensions);
+
+    if(db_after)  *db_after  = r->after;
+    if(db_before) *db_before = r->before;
+
+    long i = (options & RRDR_OPTION_REVERSED)?rrdr_rows(r) - 1:0;
+    *n = rrdr2value(r, i, options, value_is_null);
+
+    rrdr_free(r);
+    return 200;
+}
+
+// ----------------------------------------------------------------------------
+// the binary format
+
+static inline uint32_t rrdr_binary_le32(uint32_t x) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return __builtin_bswap32(x);
+#else
+    return x;
+#endif
+}
+
+static inline double rrdr_binary_le64(double x) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    uint64_t u;
+    memcpy(&u, &x, sizeof(u));
+    u = __builtin_bswap64(u);
+    memcpy(&x, &u, sizeof(u));
+#endif
+    return x;
+}
+
+static void rrdr2binary(RRDR *r, BUFFER *wb, uint32_t options)
+{
+    long c, i, dimensions = 0, rows = rrdr_rows(r);
+    size_t names_bytes = 0;
+    RRDDIM *d;
+
+    for(c = 0, d = r->st->dimensions; d && c < r->d ;c++, d = d->next) {
+        if(unlikely(r->od[c] & RRDR_HIDDEN)) continue;
+        if(unlikely((options & RRDR_OPTION_NONZERO) && !(r->od[c] & RRDR_NONZERO))) continue;
+
+        names_bytes += strlen(d->id) + 1 + strlen(d->name) + 1;
+        dimensions++;
+    }
+    names_bytes = (names_bytes + 7) & ~((size_t)7);
+
+    size_t bytes = sizeof(RRDR_BINARY_HEADER) + names_bytes + (dimensions + 1) * rows * sizeof(double);
+    buffer_need_bytes(wb, bytes + 1);
+
+    char *start = &wb->buffer[wb->len];
+    memset(start, 0, sizeof(RRDR_BINARY_HEADER) + names_bytes);
+
+    RRDR_BINARY_HEADER h;
+    memcpy(h.magic, RRDR_BINARY_MAGIC, sizeof(h.magic));
+    h.version = rrdr_binary_le32(RRDR_BINARY_VERSION);
+    h.dimensions = rrdr_binary_le32((uint32_t)dimensions);
+    h.rows = rrdr_binary_le32((uint32_t)rows);
+    h.update_every = rrdr_binary_le32((uint32_t)r->update_every);
+    h.names_bytes = rrdr_binary_le32((uint32_t)names_bytes);
+    h.after = rrdr_binary_le64((double)r->after);
+    h.before = rrdr_binary_le64((double)r->before);
+    memcpy(start, &h, sizeof(h));
+
+    char *names = start + sizeof(RRDR_BINARY_HEADER);
+    double *timestamps = (double *)(names + names_bytes);
+    double *values = timestamps + rows;
+
+    long start_row = 0, step = 1;
+    if(options & RRDR_OPTION_REVERSED) {
+        start_row = rows - 1;
+        step = -1;
+    }
+
+    double multiplier = (options & RRDR_OPTION_MILLISECONDS) ? 1000.0 : 1.0;
+    for(i = 0; i < rows ; i++)
+        timestamps[i] = rrdr_binary_le64((double)r->t[start_row + i * step] * multiplier);
+
+    // the totals of the rows, for the percentages
+    calculated_number *totals = NULL;
+    if(unlikely(options & RRDR_OPTION_PERCENTAGE)) {
+        totals = mallocz(rows * sizeof(calculated_number));
+
+        for(i = 0; i < rows ; i++) {
+            calculated_number total = 0, *cn = &r->v[i * r->d];
+
+            for(c = 0; c < r->d ; c++)
+                total += ((options & RRDR_OPTION_ABSOLUTE) && cn[c] < 0) ? -cn[c] : cn[c];
+
+            // prevent a division by zero
+            totals[i] = (total == 0) ? 1 : total;
+        }
+    }
+
+    // a column for every dimension
+    for(c = 0, d = r->st->dimensions; d && c < r->d ;c++, d = d->next) {
+        if(unlikely(r->od[c] & RRDR_HIDDEN)) continue;
+        if(unlikely((options & RRDR_OPTION_NONZERO) && !(r->od[c] & RRDR_NONZERO))) continue;
+
+        size_t len = strlen(d->id) + 1;
+        memcpy(names, d->id, len);
+        names += len;
+
+        len = strlen(d->name) + 1;
+        memcpy(names, d->name, len);
+        names += len;
+
+        for(i = 0; i < rows ; i++) {
+            long row = start_row + i * step;
+            calculated_number n = r->v[row * r->d + c];
+
+            if(unlikely(r->o[row * r->d + c] & RRDR_EMPTY))
+                n = (options & RRDR_OPTION_NULL2ZERO) ? 0 : NAN;
+            else {
+                if(unlikely((options & RRDR_OPTION_ABSOLUTE) && n < 0))
+                    n = -n;
+
+                if(unlikely(totals))
+                    n = n * 100 / totals[row];
+            }
+
+            values[i] = rrdr_binary_le64((double)n);
+        }
+
+        values += rows;
+    }
+
+    freez(totals);
+
+    wb->len += bytes;
+    wb->buffer[wb->len] = '\0';
+}
+
+// format a result
+static void rrdr2anything(RRDR *r, BUFFER *wb, BUFFER *dimensions, uint32_t format, uint32_t options, time_t *latest_timestamp, int parts) {
     if(r->result_options & RRDR_RESULT_OPTION_RELATIVE)
         buffer_no_cacheable(wb);
     else if(r->result_options & RRDR_RESULT_OPTION_ABSOLUTE)
@@ -1911,12 +2815,12 @@ int rrdset2anything_api_v1(
         if(options & RRDR_OPTION_JSON_WRAP) {
             wb->contenttype = CT_APPLICATION_JSON;
             rrdr_json_wrapper_begin(r, wb, format, options, 1);
-            rrdr2ssv(r, wb, options, "", " ", "");
+            rrdr2ssv(r, wb, options, "", " ", "", parts);
             rrdr_json_wrapper_end(r, wb, format, options, 1);
         }
         else {
             wb->contenttype = CT_TEXT_PLAIN;
-            rrdr2ssv(r, wb, options, "", " ", "");
+            rrdr2ssv(r, wb, options, "", " ", "", parts);
         }
         break;
 
@@ -1924,12 +2828,12 @@ int rrdset2anything_api_v1(
         if(options & RRDR_OPTION_JSON_WRAP) {
             wb->contenttype = CT_APPLICATION_JSON;
             rrdr_json_wrapper_begin(r, wb, format, options, 1);
-            rrdr2ssv(r, wb, options, "", ",", "");
+            rrdr2ssv(r, wb, options, "", ",", "", parts);
             rrdr_json_wrapper_end(r, wb, format, options, 1);
         }
         else {
             wb->contenttype = CT_TEXT_PLAIN;
-            rrdr2ssv(r, wb, options, "", ",", "");
+            rrdr2ssv(r, wb, options, "", ",", "", parts);
         }
         break;
 
@@ -1937,12 +2841,12 @@ int rrdset2anything_api_v1(
         if(options & RRDR_OPTION_JSON_WRAP) {
             wb->contenttype = CT_APPLICATION_JSON;
             rrdr_json_wrapper_begin(r, wb, format, options, 0);
-            rrdr2ssv(r, wb, options, "[", ",", "]");
+            rrdr2ssv(r, wb, options, "[", ",", "]", parts);
             rrdr_json_wrapper_end(r, wb, format, options, 0);
         }
         else {
             wb->contenttype = CT_APPLICATION_JSON;
-            rrdr2ssv(r, wb, options, "[", ",", "]");
+            rrdr2ssv(r, wb, options, "[", ",", "]", parts);
         }
         break;
 
@@ -1950,12 +2854,12 @@ int rrdset2anything_api_v1(
         if(options & RRDR_OPTION_JSON_WRAP) {
             wb->contenttype = CT_APPLICATION_JSON;
             rrdr_json_wrapper_begin(r, wb, format, options, 1);
-            rrdr2csv(r, wb, options, "", ",", "\\n", "");
+            rrdr2csv(r, wb, options, "", ",", "\\n", "", parts);
             rrdr_json_wrapper_end(r, wb, format, options, 1);
         }
         else {
             wb->contenttype = CT_TEXT_PLAIN;
-            rrdr2csv(r, wb, options, "", ",", "\r\n", "");
+            rrdr2csv(r, wb, options, "", ",", "\r\n", "", parts);
         }
         break;
 
@@ -1964,15 +2868,15 @@ int rrdset2anything_api_v1(
         if(options & RRDR_OPTION_JSON_WRAP) {
             rrdr_json_wrapper_begin(r, wb, format, options, 0);
             buffer_strcat(wb, "[\n");
-            rrdr2csv(r, wb, options + RRDR_OPTION_LABEL_QUOTES, "[", ",", "]", ",\n");
+            rrdr2csv(r, wb, options + RRDR_OPTION_LABEL_QUOTES, "[", ",", "]", ",\n", parts);
             buffer_strcat(wb, "\n]");
             rrdr_json_wrapper_end(r, wb, format, options, 0);
         }
         else {
             wb->contenttype = CT_TEXT_PLAIN;
-            buffer_strcat(wb, "[\n");
-            rrdr2csv(r, wb, options + RRDR_OPTION_LABEL_QUOTES, "[", ",", "]", ",\n");
-            buffer_strcat(wb, "\n]");
+            if(parts & RRDR_PRINT_HEADER) buffer_strcat(wb, "[\n");
+            rrdr2csv(r, wb, options + RRDR_OPTION_LABEL_QUOTES, "[", ",", "]", ",\n", parts);
+            if(parts & RRDR_PRINT_FOOTER) buffer_strcat(wb, "\n]");
         }
         break;
 
@@ -1980,12 +2884,12 @@ int rrdset2anything_api_v1(
         if(options & RRDR_OPTION_JSON_WRAP) {
             wb->contenttype = CT_APPLICATION_JSON;
             rrdr_json_wrapper_begin(r, wb, format, options, 1);
-            rrdr2csv(r, wb, options, "", "\t", "\\n", "");
+            rrdr2csv(r, wb, options, "", "\t", "\\n", "", parts);
             rrdr_json_wrapper_end(r, wb, format, options, 1);
         }
         else {
             wb->contenttype = CT_TEXT_PLAIN;
-            rrdr2csv(r, wb, options, "", "\t", "\r\n", "");
+            rrdr2csv(r, wb, options, "", "\t", "\r\n", "", parts);
         }
         break;
 
@@ -1994,15 +2898,15 @@ int rrdset2anything_api_v1(
             wb->contenttype = CT_APPLICATION_JSON;
             rrdr_json_wrapper_begin(r, wb, format, options, 1);
             buffer_strcat(wb, "<html>\\n<center>\\n<table border=\\\"0\\\" cellpadding=\\\"5\\\" cellspacing=\\\"5\\\">\\n");
-            rrdr2csv(r, wb, options, "<tr><td>", "</td><td>", "</td></tr>\\n", "");
+            rrdr2csv(r, wb, options, "<tr><td>", "</td><td>", "</td></tr>\\n", "", parts);
             buffer_strcat(wb, "</table>\\n</center>\\n</html>\\n");
             rrdr_json_wrapper_end(r, wb, format, options, 1);
         }
         else {
             wb->contenttype = CT_TEXT_HTML;
-            buffer_strcat(wb, "<html>\n<center>\n<table border=\"0\" cellpadding=\"5\" cellspacing=\"5\">\n");
-            rrdr2csv(r, wb, options, "<tr><td>", "</td><td>", "</td></tr>\n", "");
-            buffer_strcat(wb, "</table>\n</center>\n</html>\n");
+            if(parts & RRDR_PRINT_HEADER) buffer_strcat(wb, "<html>\n<center>\n<table border=\"0\" cellpadding=\"5\" cellspacing=\"5\">\n");
+            rrdr2csv(r, wb, options, "<tr><td>", "</td><td>", "</td></tr>\n", "", parts);
+            if(parts & RRDR_PRINT_FOOTER) buffer_strcat(wb, "</table>\n</center>\n</html>\n");
         }
         break;
 
@@ -2012,7 +2916,7 @@ int rrdset2anything_api_v1(
         if(options & RRDR_OPTION_JSON_WRAP)
             rrdr_json_wrapper_begin(r, wb, format, options, 0);
 
-        rrdr2json(r, wb, options, 1);
+        rrdr2json(r, wb, options, 1, parts);
 
         if(options & RRDR_OPTION_JSON_WRAP)
             rrdr_json_wrapper_end(r, wb, format, options, 0);
@@ -2024,7 +2928,7 @@ int rrdset2anything_api_v1(
         if(options & RRDR_OPTION_JSON_WRAP)
             rrdr_json_wrapper_begin(r, wb, format, options, 0);
 
-        rrdr2json(r, wb, options, 1);
+        rrdr2json(r, wb, options, 1, parts);
 
         if(options & RRDR_OPTION_JSON_WRAP)
             rrdr_json_wrapper_end(r, wb, format, options, 0);
@@ -2035,12 +2939,18 @@ int rrdset2anything_api_v1(
         if(options & RRDR_OPTION_JSON_WRAP)
             rrdr_json_wrapper_begin(r, wb, format, options, 0);
 
-        rrdr2json(r, wb, options, 0);
+        rrdr2json(r, wb, options, 0, parts);
 
         if(options & RRDR_OPTION_JSON_WRAP)
             rrdr_json_wrapper_end(r, wb, format, options, 0);
         break;
 
+    case DATASOURCE_BINARY:
+        // the header of the binary format has the information of the json wrapper
+        wb->contenttype = CT_APPLICATION_OCTET_STREAM;
+        rrdr2binary(r, wb, options);
+        break;
+
     case DATASOURCE_JSON:
     default:
         wb->contenttype = CT_APPLICATION_JSON;
@@ -2048,13 +2958,654 @@ int rrdset2anything_api_v1(
         if(options & RRDR_OPTION_JSON_WRAP)
             rrdr_json_wrapper_begin(r, wb, format, options, 0);
 
-        rrdr2json(r, wb, options, 0);
+        rrdr2json(r, wb, options, 0, parts);
 
         if(options & RRDR_OPTION_JSON_WRAP)
             rrdr_json_wrapper_end(r, wb, format, options, 0);
         break;
     }
+}
 
+int rrdset2anything_api_v1(
+          RRDSET *st
+        , BUFFER *wb
+        , BUFFER *dimensions
+        , uint32_t format
+        , long points
+        , long long after
+        , long long before
+        , int group_method
+        , long group_time
+        , uint32_t options
+        , const char *cursor
+        , time_t *latest_timestamp
+) {
+    st->last_accessed_time = now_realtime_sec();
+
+    RRDR *r = rrd2rrdr_cached(st, points, after, before, group_method, group_time, !(options & RRDR_OPTION_NOT_ALIGNED), cursor);
+    if(!r) {
+        buffer_strcat(wb, "Cannot generate output with these parameters on this chart.");
+        return 500;
+    }
+
+    rrdr2anything(r, wb, dimensions, format, options, latest_timestamp, RRDR_PRINT_ALL);
     rrdr_free(r);
     return 200;
 }
+
+// ----------------------------------------------------------------------------
+// streamed results
+//
+// The results of more than rrdr_stream_values values are not generated at
+// once. They are queried and formatted a block of rows at a time, while the
+// web server sends them, so that the memory of the request is capped to a
+// block and the first bytes are sent before the whole result is ready.
+//
+// Only the formats that print their rows one after the other are streamed.
+// Not the json wrapper and the binary format, that describe all the rows
+// before them, not option nonzero, that needs all the rows to select the
+// dimensions, and not the incremental sum and the rate, that connect each
+// row to the newer one.
+//
+// A slow client should not keep the chart from being freed, so the chart is
+// found again and read only while each block is queried. The result ends
+// early when the chart is freed, or the rows left are overwritten, meanwhile.
+
+long rrdr_stream_values = 262144;
+
+// the values of each block, as a fraction of rrdr_stream_values
+#define RRDR_STREAM_BLOCKS 16
+
+struct rrdr_stream {
+    RRDSET *st;                     // with a reader, only while a block is queried
+    char machine_guid[GUID_LEN + 1];// the host of the chart, to find it again
+    char *chart_id;
+
+    RRDR_QUERY q;                   // the query of the whole result
+    size_t seq;                     // the round robin database when the last block was queried
+    struct rrdset_tier ring;
+    BUFFER *footer;                 // the end of the result, printed with the first block
+
+    char *dimensions;
+    uint32_t format;
+    uint32_t options;
+
+    long d;                         // the dimensions of the first block - the ones added later are not printed
+    long block;                     // the rows of each block
+    long requested;                 // the rows of the last block queried
+    long done;                      // the rows printed so far
+    int finished;                   // 1 = all the rows are printed, 2 = the result is closed too
+};
+
+static inline int rrdr_stream_format_is_supported(uint32_t format) {
+    switch(format) {
+        case DATASOURCE_JSON:
+        case DATASOURCE_DATATABLE_JSON:
+        case DATASOURCE_CSV:
+        case DATASOURCE_TSV:
+        case DATASOURCE_HTML:
+        case DATASOURCE_SSV:
+        case DATASOURCE_SSV_COMMA:
+        case DATASOURCE_JS_ARRAY:
+        case DATASOURCE_CSV_JSON_ARRAY:
+            return 1;
+
+        default:
+            return 0;
+    }
+}
+
+// find the chart again and keep it from being freed while the next block is queried
+// returns 0 when it has been freed since the previous block
+static int rrdr_stream_read_begin(RRDR_STREAM *s) {
+    int found = 0;
+
+    rrd_rdlock();
+
+    RRDHOST *host = rrdhost_find_by_guid(s->machine_guid, 0);
+    if(likely(host)) {
+        rrdhost_rdlock(host);
+
+        if(likely(rrdset_find(host, s->chart_id) == s->st)) {
+            rrdset_read_begin(s->st);
+            found = 1;
+        }
+
+        rrdhost_unlock(host);
+    }
+
+    rrd_unlock();
+    return found;
+}
+
+// query the next block of rows of the result, NULL when there are no more
+// the caller has to be a reader of the chart
+static RRDR *rrdr_stream_query_block(RRDR_STREAM *s) {
+    long rows = s->q.points - s->done;
+    if(rows > s->block) rows = s->block;
+    if(rows <= 0) return NULL;
+
+    s->requested = rows;
+
+    // the rows are newest first - reversed, the oldest block is printed first
+    long first = (s->options & RRDR_OPTION_REVERSED) ? s->q.points - s->done - rows : s->done;
+    time_t group_duration = s->q.group * s->q.update_every;
+
+    // the newest row left has been overwritten since the previous block
+    if(s->done && !s->q.tier && !rrdset_has_dbengine(s->st)) {
+        time_t newest_t = s->q.before - ((s->options & RRDR_OPTION_REVERSED) ? 0 : s->done) * group_duration;
+        if(unlikely(rrdset_ring_overwritten(s->st, &s->ring, s->seq, (long)rrdset_time2slot(&s->ring, newest_t))))
+            return NULL;
+    }
+
+    int tries = 3;
+    for(;;) {
+        RRDR_QUERY q = s->q;
+        q.seq = rrdset_ring_snapshot(s->st, &q.ring);
+        q.before = s->q.before - first * group_duration;
+        q.after = q.before - rows * group_duration;
+        q.points = rows;
+
+        // the oldest slots may have been overwritten while the result is streamed
+        if(likely(!rrdset_has_dbengine(s->st) || q.tier)) {
+            time_t first_entry_t = rrdset_first_entry_t((q.tier) ? q.tier : &q.ring);
+
+            if(unlikely(q.after < first_entry_t)) {
+                q.points = (q.before - first_entry_t) / group_duration;
+                q.after = q.before - q.points * group_duration;
+                if(q.points <= 0) return NULL;
+            }
+        }
+
+        int overwritten = 0;
+        RRDR *r = rrdr_query_execute(s->st, &q, &overwritten);
+
+        if(likely(!overwritten || !r || !--tries)) {
+            s->seq = q.seq;
+            s->ring = q.ring;
+            return r;
+        }
+
+        rrdr_free(r);
+    }
+}
+
+// print the rows of r, with the parts given
+static void rrdr_stream_print(RRDR_STREAM *s, RRDR *r, BUFFER *wb, int parts) {
+    rrdr_disable_not_selected_dimensions(r, s->options, s->dimensions);
+
+    long c;
+    for(c = s->d; c < r->d ; c++)
+        r->od[c] |= RRDR_HIDDEN;
+
+    rrdr2anything(r, wb, NULL, s->format, s->options, NULL, parts);
+
+    if(parts & RRDR_PRINT_ROWS) {
+        s->done += rrdr_rows(r);
+
+        // a block with less rows than requested is the last one
+        if(s->done >= s->q.points || rrdr_rows(r) < s->requested)
+            s->finished = 1;
+    }
+}
+
+// starts streaming the result, printing its first block of rows to wb
+// returns NULL, without printing anything, when the result is not streamed
+RRDR_STREAM *rrdset2anything_api_v1_stream(
+          RRDSET *st
+        , BUFFER *wb
+        , BUFFER *dimensions
+        , uint32_t format
+        , long points
+        , long long after
+        , long long before
+        , int group_method
+        , long group_time
+        , uint32_t options
+) {
+    if(rrdr_stream_values <= 0
+       || !rrdr_stream_format_is_supported(format)
+       || (options & (RRDR_OPTION_JSON_WRAP | RRDR_OPTION_NONZERO))
+       || group_method == GROUP_INCREMENTAL_SUM
+       || group_method == GROUP_RATE)
+        return NULL;
+
+    st->last_accessed_time = now_realtime_sec();
+
+    RRDR_STREAM *s = callocz(1, sizeof(RRDR_STREAM));
+    s->st = st;
+    strncpyz(s->machine_guid, st->rrdhost->machine_guid, GUID_LEN);
+    s->chart_id = strdupz(st->id);
+    rrdset_read_begin(st);
+
+    if(!rrdr_query_prepare(st, &s->q, points, after, before, group_method, group_time, !(options & RRDR_OPTION_NOT_ALIGNED)))
+        goto not_streamed;
+
+    RRDDIM *rd;
+    for(rd = st->dimensions; rd ; rd = rd->next) s->d++;
+
+    if(!s->d || s->q.points * s->d <= rrdr_stream_values)
+        goto not_streamed;
+
+    s->block = rrdr_stream_values / RRDR_STREAM_BLOCKS / s->d;
+    if(s->block < 1) s->block = 1;
+
+    s->dimensions = strdupz((dimensions) ? buffer_tostring(dimensions) : "");
+    s->format = format;
+    s->options = options;
+
+    RRDR *r = rrdr_stream_query_block(s);
+    if(!r || !rrdr_rows(r)) {
+        if(r) rrdr_free(r);
+        goto not_streamed;
+    }
+
+    rrdr_stream_print(s, r, wb, RRDR_PRINT_HEADER | RRDR_PRINT_ROWS);
+
+    // the footer does not depend on the rows - it is printed now, while the chart is read
+    s->footer = buffer_create(100);
+    rrdr_stream_print(s, r, s->footer, RRDR_PRINT_FOOTER);
+
+    rrdr_free(r);
+    rrdset_read_end(st);
+    return s;
+
+not_streamed:
+    rrdset_read_end(st);
+    rrdr_stream_free(s);
+    return NULL;
+}
+
+// prints the next block of rows to wb
+// returns 0 when the result is complete
+int rrdr_stream_next(RRDR_STREAM *s, BUFFER *wb) {
+    if(unlikely(s->finished == 2))
+        return 0;
+
+    if(likely(!s->finished && rrdr_stream_read_begin(s))) {
+        RRDR *r = rrdr_stream_query_block(s);
+
+        if(likely(r && rrdr_rows(r)))
+            rrdr_stream_print(s, r, wb, RRDR_PRINT_ROWS | RRDR_PRINT_CONTINUE);
+        else
+            s->finished = 1;
+
+        if(r) rrdr_free(r);
+        rrdset_read_end(s->st);
+
+        if(likely(!s->finished))
+            return 1;
+    }
+
+    // close the result, after its last block
+    buffer_strcat(wb, buffer_tostring(s->footer));
+
+    s->finished = 2;
+    return 0;
+}
+
+void rrdr_stream_free(RRDR_STREAM *s) {
+    if(unlikely(!s)) return;
+
+    buffer_free(s->footer);
+    freez(s->chart_id);
+    freez(s->dimensions);
+    freez(s);
+}
+
+// ----------------------------------------------------------------------------
+// context queries
+//
+// The charts of a context, on the matching hosts, are queried in parallel by
+// the worker threads. Their results are merged into one, on the timestamps
+// of the result with the longest rows. The dimensions of the same id are
+// aggregated into one, and the result is given to the formatters on a
+// virtual chart, named after the context, that has the merged dimensions.
+
+struct rrdr_context_query {
+    size_t charts;
+    RRDSET **st;            // the charts of the context, with a reader each
+    RRDR **r;               // their results
+
+    long points;
+    long long after;
+    long long before;
+    int group_method;
+    long group_time;
+    int aligned;
+};
+
+static void rrdr_context_query_execute(void *data, size_t job) {
+    struct rrdr_context_query *cq = (struct rrdr_context_query *)data;
+    cq->r[job] = rrd2rrdr(cq->st[job], cq->points, cq->after, cq->before, cq->group_method, cq->group_time, cq->aligned);
+}
+
+// find the charts of the context, keeping them from being freed
+static void rrdr_context_find_charts(struct rrdr_context_query *cq, RRDHOST *host, const char *context, SIMPLE_PATTERN *charts) {
+    size_t size = cq->charts;
+    RRDSET *st;
+
+    rrdhost_rdlock(host);
+    rrdset_foreach_read(st, host) {
+        if(strcmp(st->context, context) != 0 || !rrdset_is_available_for_viewers(st))
+            continue;
+
+        if(charts && !simple_pattern_matches(charts, st->id) && !simple_pattern_matches(charts, st->name))
+            continue;
+
+        if(cq->charts == size) {
+            size = (size) ? size * 2 : 16;
+            cq->st = reallocz(cq->st, size * sizeof(RRDSET *));
+        }
+
+        rrdset_read_begin(st);
+        cq->st[cq->charts++] = st;
+    }
+    rrdhost_unlock(host);
+}
+
+// merge the results of the charts into one, on the virtual chart vst
+static RRDR *rrdr_context_merge(struct rrdr_context_query *cq, RRDSET *vst, int aggregation) {
+    size_t i;
+    long c, k;
+
+    // the timestamps of the merged result are the ones of the result with the longest rows
+    RRDR *ref = NULL;
+    for(i = 0; i < cq->charts ; i++) {
+        RRDR *r = cq->r[i];
+        if(!r || rrdr_rows(r) <= 0) continue;
+
+        if(!ref || r->update_every > ref->update_every || (r->update_every == ref->update_every && rrdr_rows(r) > rrdr_rows(ref)))
+            ref = r;
+    }
+
+    if(!ref) return NULL;
+
+    // the merged dimensions, in the order they are found
+    long dimensions = 0, size = 0;
+    RRDDIM **sources = NULL;    // the first dimension of every merged one
+    long **map = mallocz(cq->charts * sizeof(long *));
+
+    for(i = 0; i < cq->charts ; i++) {
+        RRDR *r = cq->r[i];
+        map[i] = NULL;
+        if(!r || rrdr_rows(r) <= 0) continue;
+
+        map[i] = mallocz(r->d * sizeof(long));
+
+        RRDDIM *rd;
+        for(c = 0, rd = r->st->dimensions; rd && c < r->d ; c++, rd = rd->next) {
+            for(k = 0; k < dimensions ; k++)
+                if(sources[k]->id == rd->id || !strcmp(sources[k]->id, rd->id)) break;
+
+            if(k == dimensions) {
+                if(dimensions == size) {
+                    size = (size) ? size * 2 : 16;
+                    sources = reallocz(sources, size * sizeof(RRDDIM *));
+                }
+                sources[dimensions++] = rd;
+            }
+
+            map[i][c] = k;
+        }
+    }
+
+    // the virtual chart
+    vst->update_every = cq->st[0]->update_every;
+    vst->rrd_memory_mode = RRD_MEMORY_MODE_NONE;
+
+    time_t first_t = 0, last_t = 0;
+    for(i = 0; i < cq->charts ; i++) {
+        time_t t = rrdset_last_entry_t(cq->st[i]);
+        if(t > last_t) last_t = t;
+
+        t = rrdset_first_entry_t(cq->st[i]);
+        if(!first_t || t < first_t) first_t = t;
+    }
+    vst->last_updated.tv_sec = last_t;
+    vst->entries = (long)((last_t - first_t) / vst->update_every);
+    vst->counter = (size_t)vst->entries;
+
+    RRDDIM **last = &vst->dimensions;
+    for(k = 0; k < dimensions ; k++) {
+        RRDDIM *rd = callocz(1, sizeof(RRDDIM));
+        rd->id = sources[k]->id;
+        rd->name = sources[k]->name;
+        *last = rd;
+        last = &rd->next;
+    }
+
+    // the merged result
+    long rows = rrdr_rows(ref);
+    time_t newest_t = ref->t[0];
+    int view_update_every = ref->update_every;
+
+    RRDR *m = callocz(1, sizeof(RRDR));
+    m->st = vst;
+    m->d = (int)dimensions;
+    m->n = rows;
+    m->rows = rows;
+    m->t = mallocz(rows * sizeof(time_t));
+    m->v = callocz(rows * dimensions, sizeof(calculated_number));
+    m->o = callocz(rows * dimensions, sizeof(uint8_t));
+    m->od = callocz(dimensions, sizeof(uint8_t));
+    m->group = ref->group;
+    m->update_every = view_update_every;
+    m->result_options = ref->result_options;
+    m->before = ref->before;
+    m->after = ref->after;
+    memcpy(m->t, ref->t, rows * sizeof(time_t));
+
+    // the number of charts aggregated in every value
+    long *counts = callocz(rows * dimensions, sizeof(long));
+
+    // the values of one chart, averaged when a chart has many rows in one of the merged rows
+    calculated_number *sum = mallocz(rows * dimensions * sizeof(calculated_number));
+    long *count = mallocz(rows * dimensions * sizeof(long));
+
+    for(i = 0; i < cq->charts ; i++) {
+        RRDR *r = cq->r[i];
+        if(!r || rrdr_rows(r) <= 0) continue;
+
+        memset(sum, 0, rows * dimensions * sizeof(calculated_number));
+        memset(count, 0, rows * dimensions * sizeof(long));
+
+        long row;
+        for(row = 0; row < rrdr_rows(r) ; row++) {
+            time_t t = r->t[row];
+            if(t > newest_t) continue;
+
+            long j = (newest_t - t) / view_update_every;
+            if(j >= rows) break;
+
+            for(c = 0; c < r->d ; c++) {
+                uint8_t o = r->o[row * r->d + c];
+                long x = j * dimensions + map[i][c];
+
+                m->o[x] |= (uint8_t)(o & RRDR_RESET);
+                if(o & RRDR_EMPTY) continue;
+
+                sum[x] += r->v[row * r->d + c];
+                count[x]++;
+            }
+        }
+
+        for(k = 0; k < rows * dimensions ; k++) {
+            if(!count[k]) continue;
+
+            calculated_number v = sum[k] / (calculated_number)count[k];
+
+            if(!counts[k])
+                m->v[k] = v;
+            else switch(aggregation) {
+                case RRDR_AGGREGATION_MIN:
+                    if(v < m->v[k]) m->v[k] = v;
+                    break;
+
+                case RRDR_AGGREGATION_MAX:
+                    if(v > m->v[k]) m->v[k] = v;
+                    break;
+
+                default:
+                    m->v[k] += v;
+                    break;
+            }
+
+            counts[k]++;
+        }
+    }
+
+    int min_max_set = 0;
+    for(k = 0; k < rows * dimensions ; k++) {
+        if(!counts[k]) {
+            m->v[k] = 0;
+            m->o[k] |= RRDR_EMPTY;
+            continue;
+        }
+
+        if(aggregation == RRDR_AGGREGATION_AVERAGE)
+            m->v[k] /= (calculated_number)counts[k];
+
+        calculated_number v = m->v[k];
+        if(v != 0) {
+            m->o[k] |= RRDR_NONZERO;
+            m->od[k % dimensions] |= RRDR_NONZERO;
+        }
+
+        if(!min_max_set || v < m->min) m->min = v;
+        if(!min_max_set || v > m->max) m->max = v;
+        min_max_set = 1;
+    }
+
+    freez(count);
+    freez(sum);
+    freez(counts);
+    for(i = 0; i < cq->charts ; i++) freez(map[i]);
+    freez(map);
+    freez(sources);
+    return m;
+}
+
+int rrdcontext2anything_api_v1(
+          RRDHOST *host
+        , const char *context
+        , const char *hosts
+        , const char *charts
+        , int aggregation
+        , BUFFER *wb
+        , BUFFER *dimensions
+        , uint32_t format
+        , long points
+        , long long after
+        , long long before
+        , int group_method
+        , long group_time
+        , uint32_t options
+        , time_t *latest_timestamp
+) {
+    struct rrdr_context_query cq = {
+            .charts = 0,
+            .st = NULL,
+            .r = NULL,
+            .points = points,
+            .after = after,
+            .before = before,
+            .group_method = group_method,
+            .group_time = group_time,
+            .aligned = !(options & RRDR_OPTION_NOT_ALIGNED)
+    };
+
+    SIMPLE_PATTERN *charts_pattern = (charts && *charts) ? simple_pattern_create(charts, ",| \t\r\n\f\v", SIMPLE_PATTERN_EXACT) : NULL;
+
+    // without hosts, the context is queried on the host of the request
+    if(hosts && *hosts) {
+        SIMPLE_PATTERN *hosts_pattern = simple_pattern_create(hosts, ",| \t\r\n\f\v", SIMPLE_PATTERN_EXACT);
+
+        RRDHOST *h;
+        rrd_rdlock();
+        rrdhost_foreach_read(h) {
+            if(simple_pattern_matches(hosts_pattern, h->hostname) || simple_pattern_matches(hosts_pattern, h->machine_guid))
+                rrdr_context_find_charts(&cq, h, context, charts_pattern);
+        }
+        rrd_unlock();
+
+        simple_pattern_free(hosts_pattern);
+    }
+    else
+        rrdr_context_find_charts(&cq, host, context, charts_pattern);
+
+    simple_pattern_free(charts_pattern);
+
+    if(!cq.charts) {
+        buffer_strcat(wb, "No charts are found for context: ");
+        buffer_strcat_htmlescape(wb, context);
+        return 404;
+    }
+
+    // relative timeframes are made absolute, on the timeframe of all the charts,
+    // so that all of them are queried for the same one
+    time_t first_t = 0, last_t = 0;
+    size_t i;
+    for(i = 0; i < cq.charts ; i++) {
+        cq.st[i]->last_accessed_time = now_realtime_sec();
+
+        time_t t = rrdset_last_entry_t(cq.st[i]);
+        if(t > last_t) last_t = t;
+
+        t = rrdset_tiers_first_entry_t(cq.st[i]);
+        if(!first_t || t < first_t) first_t = t;
+    }
+
+    int relative = 0;
+    if(cq.before == 0 && cq.after == 0) {
+        cq.before = last_t;
+        cq.after = first_t;
+        relative = 1;
+    }
+
+    if(((cq.before < 0) ? -cq.before : cq.before) <= API_RELATIVE_TIME_MAX) {
+        cq.before = (cq.before > 0) ? first_t + cq.before : last_t + cq.before;
+        relative = 1;
+    }
+
+    if(((cq.after < 0) ? -cq.after : cq.after) <= API_RELATIVE_TIME_MAX) {
+        cq.after = cq.before + ((cq.after) ? cq.after : -cq.st[0]->update_every);
+        relative = 1;
+    }
+
+    cq.r = callocz(cq.charts, sizeof(RRDR *));
+    hibenchmarks_workers_run(cq.charts, rrdr_context_query_execute, &cq);
+
+    RRDSET *vst = callocz(1, sizeof(RRDSET));
+    vst->id = context;
+    vst->name = context;
+
+    int ret = 200;
+    RRDR *m = rrdr_context_merge(&cq, vst, aggregation);
+    if(m) {
+        m->result_options = (relative) ? RRDR_RESULT_OPTION_RELATIVE : RRDR_RESULT_OPTION_ABSOLUTE;
+
+        rrdr2anything(m, wb, dimensions, format, options, latest_timestamp, RRDR_PRINT_ALL);
+        rrdr_free(m);
+    }
+    else {
+        buffer_strcat(wb, "Cannot generate output with these parameters on this context.");
+        ret = 500;
+    }
+
+    while(vst->dimensions) {
+        RRDDIM *rd = vst->dimensions;
+        vst->dimensions = rd->next;
+        freez(rd);
+    }
+    freez(vst);
+
+    for(i = 0; i < cq.charts ; i++) {
+        if(cq.r[i]) rrdr_free(cq.r[i]);
+        rrdset_read_end(cq.st[i]);
+    }
+    freez(cq.r);
+    freez(cq.st);
+
+    return ret;
+}
@@ -88,10 +88,10 @@ unsigned long rrdset_info2json_api_old(RRDSET *st, char *options, BUFFER *wb) {
                 , rd->multiplier
                 , rd->divisor
                 , rd->last_collected_time.tv_sec
-                , rd->collected_value
-                , rd->calculated_value
+                , rrddim_collection(rd, collected_value)
+                , rrddim_collection(rd, calculated_value)
                 , rd->last_collected_value
-                , rd->last_calculated_value
+                , rrddim_collection(rd, last_calculated_value)
                 , rd->memsize
                 , rd->next?",":""
         );
@@ -389,14 +389,14 @@ time_t rrdset2json_api_old(
 
             // do the calculations
             for(rd = st->dimensions, c = 0 ; rd && c < dimensions ; rd = rd->next, c++) {
-                storage_number n = rd->values[t];
-                calculated_number value = unpack_storage_number(n);
+                calculated_number value;
+                uint32_t flags = rrddim_slot_get(rd, t, &value);
 
-                if(!does_storage_number_exist(n)) {
+                if(!flags) {
                     value = 0.0;
                     found_non_existing[c]++;
                 }
-                if(did_storage_number_reset(n)) annotate_reset = 1;
+                if(flags == SN_EXISTS_RESET) annotate_reset = 1;
 
                 switch(group_method) {
                     case GROUP_MAX:
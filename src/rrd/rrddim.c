@@ -5,21 +5,11 @@
 // ----------------------------------------------------------------------------
 // RRDDIM index
 
-int rrddim_compare(void* a, void* b) {
-    if(((RRDDIM *)a)->hash < ((RRDDIM *)b)->hash) return -1;
-    else if(((RRDDIM *)a)->hash > ((RRDDIM *)b)->hash) return 1;
-    else return strcmp(((RRDDIM *)a)->id, ((RRDDIM *)b)->id);
-}
-
-#define rrddim_index_add(st, rd) (RRDDIM *)avl_insert_lock(&((st)->dimensions_index), (avl *)(rd))
-#define rrddim_index_del(st,rd ) (RRDDIM *)avl_remove_lock(&((st)->dimensions_index), (avl *)(rd))
+#define rrddim_index_add(st, rd) (RRDDIM *)hash_index_insert(&((st)->dimensions_index), (rd), (rd)->hash)
+#define rrddim_index_del(st, rd) (RRDDIM *)hash_index_remove(&((st)->dimensions_index), (rd), (rd)->hash)
 
 static inline RRDDIM *rrddim_index_find(RRDSET *st, const char *id, uint32_t hash) {
-    RRDDIM tmp = {
-            .id = id,
-            .hash = (hash)?hash:simple_hash(id)
-    };
-    return (RRDDIM *)avl_search_lock(&(st->dimensions_index), (avl *) &tmp);
+    return (RRDDIM *)hash_index_search(&(st->dimensions_index), id, (hash)?hash:simple_hash(id));
 }
 
 
@@ -44,7 +34,8 @@ inline int rrddim_set_name(RRDSET *st, RRDDIM *rd, const char *name) {
 
     char varname[CONFIG_MAX_NAME + 1];
     snprintfz(varname, CONFIG_MAX_NAME, "dim %s name", rd->id);
-    rd->name = config_set_default(st->config_section, varname, name);
+    string_intern_release(rd->name);
+    rd->name = string_intern(config_set_default(st->config_section, varname, name));
     rd->hash_name = simple_hash(rd->name);
     rrddimvar_rename_all(rd);
     rd->exposed = 0;
@@ -57,6 +48,7 @@ inline int rrddim_set_algorithm(RRDSET *st, RRDDIM *rd, RRD_ALGORITHM algorithm)
 
     debug(D_RRD_CALLS, "Updating algorithm of dimension '%s/%s' from %s to %s", st->id, rd->name, rrd_algorithm_name(rd->algorithm), rrd_algorithm_name(algorithm));
     rd->algorithm = algorithm;
+    rrddim_collection(rd, algorithm) = algorithm;
     rd->exposed = 0;
     rrdset_flag_set(st, RRDSET_FLAG_HOMEGENEOUS_CHECK);
     return 1;
@@ -68,6 +60,7 @@ inline int rrddim_set_multiplier(RRDSET *st, RRDDIM *rd, collected_number multip
 
     debug(D_RRD_CALLS, "Updating multiplier of dimension '%s/%s' from " COLLECTED_NUMBER_FORMAT " to " COLLECTED_NUMBER_FORMAT, st->id, rd->name, rd->multiplier, multiplier);
     rd->multiplier = multiplier;
+    rrddim_collection(rd, multiplier) = (calculated_number)multiplier;
     rd->exposed = 0;
     rrdset_flag_set(st, RRDSET_FLAG_HOMEGENEOUS_CHECK);
     return 1;
@@ -79,6 +72,7 @@ inline int rrddim_set_divisor(RRDSET *st, RRDDIM *rd, collected_number divisor)
 
     debug(D_RRD_CALLS, "Updating divisor of dimension '%s/%s' from " COLLECTED_NUMBER_FORMAT " to " COLLECTED_NUMBER_FORMAT, st->id, rd->name, rd->divisor, divisor);
     rd->divisor = divisor;
+    rrddim_collection(rd, divisor) = (calculated_number)divisor;
     rd->exposed = 0;
     rrdset_flag_set(st, RRDSET_FLAG_HOMEGENEOUS_CHECK);
     return 1;
@@ -108,7 +102,10 @@ RRDDIM *rrddim_add_custom(RRDSET *st, const char *id, const char *name, collecte
     char fullfilename[FILENAME_MAX + 1];
 
     char varname[CONFIG_MAX_NAME + 1];
-    unsigned long size = sizeof(RRDDIM) + (st->entries * sizeof(storage_number));
+    // in memory mode compressed, only the page being written is kept in values
+    long values_entries = (rrd_memory_mode_has_pages(memory_mode) && st->entries > RRDDIM_PAGE_ENTRIES) ? RRDDIM_PAGE_ENTRIES : st->entries;
+    size_t values_size = values_entries * rrd_storage_format_size(st->storage_format);
+    unsigned long size = sizeof(RRDDIM) + values_size;
 
     debug(D_RRD_CALLS, "Adding dimension '%s/%s'.", st->id, id);
 
@@ -126,11 +123,13 @@ RRDDIM *rrddim_add_custom(RRDSET *st, const char *id, const char *name, collecte
         if(likely(rd)) {
             // we have a file mapped for rd
 
-            memset(&rd->avl, 0, sizeof(avl));
             rd->id = NULL;
             rd->name = NULL;
             rd->cache_filename = NULL;
             rd->variables = NULL;
+            rd->tiers = NULL;
+            rd->pages = NULL;
+            rd->rrdeng_metric = NULL;
             rd->next = NULL;
             rd->rrdset = NULL;
             rd->exposed = 0;
@@ -184,26 +183,31 @@ RRDDIM *rrddim_add_custom(RRDSET *st, const char *id, const char *name, collecte
             // make sure we have the right memory mode
             // even if we cleared the memory
             rd->rrd_memory_mode = memory_mode;
+
+            // the values follow the structure in the file
+            rd->values = (storage_number *)((char *)rd + sizeof(RRDDIM));
         }
     }
 
     if(unlikely(!rd)) {
         // if we didn't manage to get a mmap'd dimension, just create one
-        rd = callocz(1, size);
-        rd->rrd_memory_mode = (memory_mode == RRD_MEMORY_MODE_NONE) ? RRD_MEMORY_MODE_NONE : RRD_MEMORY_MODE_ALLOC;
+        // the slabs get only the structure, so that all the dimensions share one size
+        rd = slab_set_callocz(&host->slabs, sizeof(RRDDIM));
+        rd->values = callocz((size_t)values_entries, rrd_storage_format_size(st->storage_format));
+        rd->rrd_memory_mode = (memory_mode == RRD_MEMORY_MODE_NONE || memory_mode == RRD_MEMORY_MODE_TIERED || rrd_memory_mode_has_pages(memory_mode)) ? memory_mode : RRD_MEMORY_MODE_ALLOC;
     }
 
     rd->memsize = size;
 
     strcpy(rd->magic, RRDDIMENSION_MAGIC);
 
-    rd->id = strdupz(id);
+    rd->id = string_intern(id);
     rd->hash = simple_hash(rd->id);
 
-    rd->cache_filename = strdupz(fullfilename);
+    rd->cache_filename = slab_set_strdupz(&host->slabs, fullfilename);
 
     snprintfz(varname, CONFIG_MAX_NAME, "dim %s name", rd->id);
-    rd->name = config_get(st->config_section, varname, (name && *name)?name:rd->id);
+    rd->name = string_intern(config_get(st->config_section, varname, (name && *name)?name:rd->id));
     rd->hash_name = simple_hash(rd->name);
 
     snprintfz(varname, CONFIG_MAX_NAME, "dim %s algorithm", rd->id);
@@ -218,27 +222,26 @@ RRDDIM *rrddim_add_custom(RRDSET *st, const char *id, const char *name, collecte
 
     rd->entries = st->entries;
     rd->update_every = st->update_every;
+    rd->storage_format = st->storage_format;
 
-    if(rrdset_flag_check(st, RRDSET_FLAG_STORE_FIRST))
-        rd->collections_counter = 1;
-    else
-        rd->collections_counter = 0;
-
-    rd->updated = 0;
     rd->flags = 0x00000000;
 
-    rd->calculated_value = 0;
-    rd->last_calculated_value = 0;
-    rd->collected_value = 0;
     rd->last_collected_value = 0;
     rd->collected_volume = 0;
     rd->stored_volume = 0;
     rd->last_stored_value = 0;
-    rd->values[st->current_entry] = SN_EMPTY_SLOT; // pack_storage_number(0, SN_NOT_EXISTS);
+    rd->summaries = NULL;
+    rrddim_pages_init(st, rd);
+    rd->rrdeng_metric = (rd->rrd_memory_mode == RRD_MEMORY_MODE_DBENGINE && host->rrdeng) ? rrdeng_metric_get(host->rrdeng, st->id, rd->id) : NULL;
+    rrddim_store_value(rd, st->current_entry, st->last_updated.tv_sec, 0, SN_NOT_EXISTS);
     rd->last_collected_time.tv_sec = 0;
     rd->last_collected_time.tv_usec = 0;
     rd->rrdset = st;
 
+    rrddim_tiers_init(st, rd);
+    rrddim_summaries_init(st, rd);
+    rrdset_collection_add(st, rd);
+
     // append this dimension
     if(!st->dimensions)
         st->dimensions = rd;
@@ -298,6 +301,8 @@ void rrddim_free(RRDSET *st, RRDDIM *rd)
     }
     rd->next = NULL;
 
+    rrdset_collection_del(st, rd);
+
     while(rd->variables)
         rrddimvar_free(rd->variables);
 
@@ -306,26 +311,36 @@ void rrddim_free(RRDSET *st, RRDDIM *rd)
 
     // free(rd->annotations);
 
+    rrddim_tiers_free(rd);
+    rrddim_summaries_free(rd);
+    rrddim_pages_flush(rd);
+    rrddim_pages_free(rd);
+
+    if(rd->collected_string_value) freez(rd->collected_string_value);
+
+    SLAB_SET *slabs = &st->rrdhost->slabs;
+    string_intern_release(rd->id);
+    string_intern_release(rd->name);
+    slab_set_freez_string(slabs, rd->cache_filename);
+
     switch(rd->rrd_memory_mode) {
         case RRD_MEMORY_MODE_SAVE:
         case RRD_MEMORY_MODE_MAP:
         case RRD_MEMORY_MODE_RAM:
             debug(D_RRD_CALLS, "Unmapping dimension '%s'.", rd->name);
-            freez((void *)rd->id);
-            freez(rd->cache_filename);
             munmap(rd, rd->memsize);
             break;
 
         case RRD_MEMORY_MODE_ALLOC:
         case RRD_MEMORY_MODE_NONE:
+        case RRD_MEMORY_MODE_TIERED:
+        case RRD_MEMORY_MODE_COMPRESSED:
+        case RRD_MEMORY_MODE_DBENGINE:
             debug(D_RRD_CALLS, "Removing dimension '%s'.", rd->name);
-            freez((void *)rd->id);
-            freez(rd->cache_filename);
-            freez(rd);
+            freez(rd->values);
+            slab_set_freez(slabs, rd, sizeof(RRDDIM));
             break;
     }
-
-    if(rd->collected_string_value) freez(rd->collected_string_value);
 }
 
 
@@ -369,10 +384,10 @@ inline collected_number rrddim_set_by_pointer(RRDSET *st, RRDDIM *rd, collected_
     debug(D_RRD_CALLS, "rrddim_set_by_pointer() for chart %s, dimension %s, value " COLLECTED_NUMBER_FORMAT, st->name, rd->name, value);
 
     now_realtime_timeval(&rd->last_collected_time);
-    rd->collected_value = value;
-    rd->updated = 1;
+    rrddim_collection(rd, collected_value) = value;
+    rrddim_collection(rd, updated) = 1;
 
-    rd->collections_counter++;
+    rrddim_collection(rd, collections_counter)++;
 
     // fprintf(stderr, "%s.%s %llu " COLLECTED_NUMBER_FORMAT " dt %0.6f" " rate " CALCULATED_NUMBER_FORMAT "\n", st->name, rd->name, st->usec_since_last_update, value, (float)((double)st->usec_since_last_update / (double)1000000), (calculated_number)((value - rd->last_collected_value) * (calculated_number)rd->multiplier / (calculated_number)rd->divisor * 1000000.0 / (calculated_number)st->usec_since_last_update));
 
@@ -387,8 +402,8 @@ inline char* rrddim_set_string_by_pointer(RRDSET *st, RRDDIM *rd, char* value) {
     rd->collected_string_value = NULL; 
     free(rd->collected_string_value);  
     rd->collected_string_value = value?strdup(value):NULL;
-    rd->updated = 1;
-    rd->collections_counter++;
+    rrddim_collection(rd, updated) = 1;
+    rrddim_collection(rd, collections_counter)++;
 
     // fprintf(stderr, "%s.%s %llu " COLLECTED_NUMBER_FORMAT " dt %0.6f" " rate " CALCULATED_NUMBER_FORMAT "\n", st->name, rd->name, st->usec_since_last_update, value, (float)((double)st->usec_since_last_update / (double)1000000), (calculated_number)((value - rd->last_collected_value) * (calculated_number)rd->multiplier / (calculated_number)rd->divisor * 1000000.0 / (calculated_number)st->usec_since_last_update));
 
@@ -158,10 +158,10 @@ RRDDIMVAR *rrddimvar_create(RRDDIM *rd, RRDVAR_TYPE type, const char *prefix, co
     if(!prefix) prefix = "";
     if(!suffix) suffix = "";
 
-    RRDDIMVAR *rs = (RRDDIMVAR *)callocz(1, sizeof(RRDDIMVAR));
+    RRDDIMVAR *rs = (RRDDIMVAR *)slab_set_callocz(&st->rrdhost->slabs, sizeof(RRDDIMVAR));
 
-    rs->prefix = strdupz(prefix);
-    rs->suffix = strdupz(suffix);
+    rs->prefix = slab_set_strdupz(&st->rrdhost->slabs, prefix);
+    rs->suffix = slab_set_strdupz(&st->rrdhost->slabs, suffix);
 
     rs->type = type;
     rs->value = value;
@@ -206,8 +206,8 @@ void rrddimvar_free(RRDDIMVAR *rs) {
         else t->next = rs->next;
     }
 
-    freez(rs->prefix);
-    freez(rs->suffix);
-    freez(rs);
+    slab_set_freez_string(&st->rrdhost->slabs, rs->prefix);
+    slab_set_freez_string(&st->rrdhost->slabs, rs->suffix);
+    slab_set_freez(&st->rrdhost->slabs, rs, sizeof(RRDDIMVAR));
 }
 
@@ -0,0 +1,753 @@
+// SPDX-License-Identifier: GPL-3.0+
+#define HIBENCHMARKS_RRD_INTERNALS 1
+#include "include/common.h"
+
+// ----------------------------------------------------------------------------
+// DBENGINE
+//
+// with memory mode dbengine, every dimension keeps its recent history in RAM,
+// in compressed pages (like memory mode compressed). Every page completed is
+// also appended to the datafiles of the host, so that the retention is bounded
+// by the disk space given to it, not by RAM.
+//
+// - the datafiles are written sequentially, in chunks of RRDENG_WRITE_BUFFER_SIZE
+// - when a datafile is full, a new one is started; when there are more than
+//   RRDENG_DATAFILES_MAX, the oldest is deleted, with all its pages
+// - the index of the pages (time range and position in the datafiles) is kept
+//   in memory, and rebuilt from the datafiles when hibenchmarks starts
+// - the decompressed pages read by queries are kept in a page cache,
+//   shared by all hosts, evicting the least recently used pages
+
+long default_rrdeng_disk_space_mb = RRDENG_DEFAULT_DISK_SPACE_MB;
+long default_rrdeng_page_cache_mb = RRDENG_DEFAULT_PAGE_CACHE_MB;
+
+#define RRDENG_PAGE_MAGIC 0x48425047 // "HBPG"
+#define RRDENG_DATAFILE_PREFIX "datafile-"
+#define RRDENG_DATAFILE_SUFFIX ".hdb"
+
+// the header of every page in a datafile
+// followed by the key of the metric and the compressed values
+struct rrdeng_page_header {
+    uint32_t magic;
+    uint32_t bytes;                                 // the size of the compressed values
+    uint32_t entries;                               // the number of values in the page
+    int32_t update_every;                           // the seconds between the values
+    int64_t start_t;                                // the time of the first value
+    uint32_t key_length;                            // the length of the metric key
+    uint32_t reserved;
+};
+
+struct rrdeng_datafile {
+    unsigned fileno;
+    int fd;
+    size_t size;                                    // the bytes in the datafile, including the write buffer
+    size_t flushed;                                 // the bytes written to disk
+
+    struct rrdeng_datafile *next;
+};
+
+struct rrdeng_page {
+    time_t start_t;                                 // the time of the first value
+    int update_every;
+    uint32_t entries;
+
+    struct rrdeng_datafile *datafile;
+    size_t offset;                                  // the offset of the compressed values in the datafile
+    uint32_t bytes;                                 // the size of the compressed values
+
+    struct rrdeng_page *prev, *next;                // the pages of the metric, in time order
+
+    storage_number *cached;                         // the decompressed values, when in the page cache
+    struct rrdeng_page *lru_prev, *lru_next;        // the page cache LRU list
+};
+
+#define rrdeng_page_end_t(page) ((page)->start_t + (time_t)((page)->entries - 1) * (page)->update_every)
+
+struct rrdeng_metric {
+    char *key;                                      // chart id / dimension id, as saved in the datafiles
+    uint32_t key_length;
+
+    struct rrdeng_page *first;                      // the oldest page
+    struct rrdeng_page *last;                       // the newest page
+};
+
+struct rrdengine {
+    hibenchmarks_mutex_t mutex;                     // protects everything below
+
+    char path[FILENAME_MAX + 1];
+    size_t datafile_max_size;
+
+    struct rrdeng_datafile *datafiles;              // the oldest datafile
+    struct rrdeng_datafile *datafile;               // the datafile being written
+
+    DICTIONARY *metrics;                            // the index of the pages, by chart/dimension
+
+    char *buffer;                                   // the write buffer of the datafile being written
+    size_t buffer_used;
+
+    size_t deletions;                               // the datafiles deleted, to invalidate the cursors of the queries
+};
+
+// ----------------------------------------------------------------------------
+// the page cache
+
+static struct rrdeng_page_cache {
+    hibenchmarks_mutex_t mutex;
+
+    struct rrdeng_page *head;                       // the most recently used page
+    struct rrdeng_page *tail;                       // the least recently used page
+
+    size_t bytes;
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+} page_cache = {
+        .mutex = PTHREAD_MUTEX_INITIALIZER,
+        .head = NULL,
+        .tail = NULL,
+        .bytes = 0,
+        .hits = 0,
+        .misses = 0,
+        .evictions = 0
+};
+
+// the caller has to hold the page cache mutex
+static inline void page_cache_unlink_unsafe(struct rrdeng_page *page) {
+    if(page->lru_prev) page->lru_prev->lru_next = page->lru_next;
+    else page_cache.head = page->lru_next;
+
+    if(page->lru_next) page->lru_next->lru_prev = page->lru_prev;
+    else page_cache.tail = page->lru_prev;
+
+    page->lru_prev = page->lru_next = NULL;
+}
+
+// the caller has to hold the page cache mutex
+static inline void page_cache_link_unsafe(struct rrdeng_page *page) {
+    page->lru_prev = NULL;
+    page->lru_next = page_cache.head;
+
+    if(page_cache.head) page_cache.head->lru_prev = page;
+    page_cache.head = page;
+
+    if(!page_cache.tail) page_cache.tail = page;
+}
+
+static void page_cache_evict(struct rrdeng_page *page) {
+    hibenchmarks_mutex_lock(&page_cache.mutex);
+
+    if(page->cached) {
+        page_cache_unlink_unsafe(page);
+        freez(page->cached);
+        page->cached = NULL;
+        page_cache.bytes -= page->entries * sizeof(storage_number);
+    }
+
+    hibenchmarks_mutex_unlock(&page_cache.mutex);
+}
+
+// copy the values of a page from the page cache
+// returns 1 on hit, 0 on miss
+static int page_cache_get(struct rrdeng_page *page, storage_number *values) {
+    int ret = 0;
+
+    hibenchmarks_mutex_lock(&page_cache.mutex);
+
+    if(likely(page->cached)) {
+        memcpy(values, page->cached, page->entries * sizeof(storage_number));
+
+        page_cache_unlink_unsafe(page);
+        page_cache_link_unsafe(page);
+
+        page_cache.hits++;
+        ret = 1;
+    }
+    else
+        page_cache.misses++;
+
+    hibenchmarks_mutex_unlock(&page_cache.mutex);
+    return ret;
+}
+
+static void page_cache_add(struct rrdeng_page *page, const storage_number *values) {
+    size_t max_bytes = (size_t)default_rrdeng_page_cache_mb * 1024 * 1024;
+    size_t bytes = page->entries * sizeof(storage_number);
+
+    hibenchmarks_mutex_lock(&page_cache.mutex);
+
+    if(likely(!page->cached)) {
+        // evict the least recently used pages, of all hosts
+        while(page_cache.tail && page_cache.bytes + bytes > max_bytes) {
+            struct rrdeng_page *p = page_cache.tail;
+            page_cache_unlink_unsafe(p);
+            freez(p->cached);
+            p->cached = NULL;
+            page_cache.bytes -= p->entries * sizeof(storage_number);
+            page_cache.evictions++;
+        }
+
+        page->cached = mallocz(bytes);
+        memcpy(page->cached, values, bytes);
+        page_cache_link_unsafe(page);
+        page_cache.bytes += bytes;
+    }
+
+    hibenchmarks_mutex_unlock(&page_cache.mutex);
+}
+
+// ----------------------------------------------------------------------------
+// datafiles
+
+static inline void rrdeng_datafile_filename(struct rrdengine *ctx, unsigned fileno, char *filename) {
+    snprintfz(filename, FILENAME_MAX, "%s/" RRDENG_DATAFILE_PREFIX "%05u" RRDENG_DATAFILE_SUFFIX, ctx->path, fileno);
+}
+
+// write the write buffer to the datafile being written
+// the caller has to hold the mutex
+static void rrdeng_flush_unsafe(struct rrdengine *ctx) {
+    struct rrdeng_datafile *df = ctx->datafile;
+    if(unlikely(!df || !ctx->buffer_used)) return;
+
+    size_t written = 0;
+    while(written < ctx->buffer_used) {
+        ssize_t ret = write(df->fd, &ctx->buffer[written], ctx->buffer_used - written);
+        if(unlikely(ret <= 0)) {
+            if(ret == -1 && errno == EINTR) continue;
+            error("DBENGINE: cannot write %zu bytes to datafile %05u of '%s'. Dropping them.", ctx->buffer_used - written, df->fileno, ctx->path);
+            break;
+        }
+        written += (size_t)ret;
+    }
+
+    df->flushed += ctx->buffer_used;
+    ctx->buffer_used = 0;
+}
+
+static struct rrdeng_datafile *rrdeng_datafile_open(struct rrdengine *ctx, unsigned fileno, int create) {
+    char filename[FILENAME_MAX + 1];
+    rrdeng_datafile_filename(ctx, fileno, filename);
+
+    int fd = open(filename, O_RDWR | O_APPEND | ((create) ? (O_CREAT | O_TRUNC) : 0), 0664);
+    if(unlikely(fd == -1)) {
+        error("DBENGINE: cannot open datafile '%s'", filename);
+        return NULL;
+    }
+
+    struct rrdeng_datafile *df = callocz(1, sizeof(struct rrdeng_datafile));
+    df->fileno = fileno;
+    df->fd = fd;
+    return df;
+}
+
+// the caller has to hold the mutex
+static void rrdeng_datafile_link_unsafe(struct rrdengine *ctx, struct rrdeng_datafile *df) {
+    if(ctx->datafile) ctx->datafile->next = df;
+    else ctx->datafiles = df;
+
+    ctx->datafile = df;
+}
+
+static int rrdeng_delete_datafile_pages_callback(void *entry, void *data) {
+    struct rrdeng_metric *metric = (struct rrdeng_metric *)entry;
+    struct rrdeng_datafile *df = (struct rrdeng_datafile *)data;
+
+    // the pages of each metric are in time order,
+    // so the pages of the oldest datafile are the first ones
+    while(metric->first && metric->first->datafile == df) {
+        struct rrdeng_page *page = metric->first;
+
+        metric->first = page->next;
+        if(metric->first) metric->first->prev = NULL;
+        else metric->last = NULL;
+
+        page_cache_evict(page);
+        freez(page);
+    }
+
+    return 0;
+}
+
+// delete the oldest datafile and all its pages
+// the caller has to hold the mutex
+static void rrdeng_datafile_delete_oldest_unsafe(struct rrdengine *ctx) {
+    struct rrdeng_datafile *df = ctx->datafiles;
+    if(unlikely(!df || df == ctx->datafile)) return;
+
+    char filename[FILENAME_MAX + 1];
+    rrdeng_datafile_filename(ctx, df->fileno, filename);
+    info("DBENGINE: deleting datafile '%s', to free disk space.", filename);
+
+    dictionary_get_all(ctx->metrics, rrdeng_delete_datafile_pages_callback, df);
+    ctx->deletions++;
+
+    ctx->datafiles = df->next;
+    close(df->fd);
+    if(unlikely(unlink(filename) == -1))
+        error("DBENGINE: cannot delete datafile '%s'", filename);
+
+    freez(df);
+}
+
+// start a new datafile
+// the caller has to hold the mutex
+static void rrdeng_datafile_rotate_unsafe(struct rrdengine *ctx) {
+    rrdeng_flush_unsafe(ctx);
+
+    unsigned fileno = (ctx->datafile) ? ctx->datafile->fileno + 1 : 0;
+    struct rrdeng_datafile *df = rrdeng_datafile_open(ctx, fileno, 1);
+    if(unlikely(!df)) return;
+
+    rrdeng_datafile_link_unsafe(ctx, df);
+
+    size_t count = 0;
+    for(df = ctx->datafiles; df ; df = df->next) count++;
+
+    while(count-- > RRDENG_DATAFILES_MAX)
+        rrdeng_datafile_delete_oldest_unsafe(ctx);
+}
+
+// ----------------------------------------------------------------------------
+// the index of the pages
+
+static inline struct rrdeng_metric *rrdeng_metric_get_unsafe(struct rrdengine *ctx, const char *key) {
+    struct rrdeng_metric *metric = dictionary_get(ctx->metrics, key);
+
+    if(unlikely(!metric)) {
+        struct rrdeng_metric tmp = {
+                .key = strdupz(key),
+                .key_length = (uint32_t)strlen(key),
+                .first = NULL,
+                .last = NULL
+        };
+        metric = dictionary_set(ctx->metrics, key, &tmp, sizeof(struct rrdeng_metric));
+    }
+
+    return metric;
+}
+
+static inline void rrdeng_metric_add_page_unsafe(struct rrdeng_metric *metric, struct rrdeng_page *page) {
+    page->next = NULL;
+    page->prev = metric->last;
+
+    if(metric->last) metric->last->next = page;
+    else metric->first = page;
+
+    metric->last = page;
+}
+
+struct rrdeng_metric *rrdeng_metric_get(struct rrdengine *ctx, const char *chart_id, const char *dimension_id) {
+    char key[RRD_ID_LENGTH_MAX * 2 + 2];
+    snprintfz(key, RRD_ID_LENGTH_MAX * 2 + 1, "%s/%s", chart_id, dimension_id);
+
+    hibenchmarks_mutex_lock(&ctx->mutex);
+    struct rrdeng_metric *metric = rrdeng_metric_get_unsafe(ctx, key);
+    hibenchmarks_mutex_unlock(&ctx->mutex);
+
+    return metric;
+}
+
+// ----------------------------------------------------------------------------
+// loading the index from the datafiles
+
+static void rrdeng_datafile_load(struct rrdengine *ctx, struct rrdeng_datafile *df) {
+    char filename[FILENAME_MAX + 1];
+    rrdeng_datafile_filename(ctx, df->fileno, filename);
+
+    struct stat sb;
+    size_t file_size = (fstat(df->fd, &sb) == 0) ? (size_t)sb.st_size : 0;
+
+    char *buffer = mallocz(RRDENG_WRITE_BUFFER_SIZE);
+    size_t offset = 0, buffer_offset = 0, buffer_len = 0, pages = 0;
+    char key[RRD_ID_LENGTH_MAX * 2 + 2];
+
+    for(;;) {
+        // make sure the header and the key of the page are in the buffer
+        size_t pos = offset - buffer_offset;
+
+        if(pos + sizeof(struct rrdeng_page_header) + sizeof(key) > buffer_len && buffer_offset + buffer_len < file_size) {
+            ssize_t ret = pread(df->fd, buffer, RRDENG_WRITE_BUFFER_SIZE, (off_t)offset);
+            if(ret <= 0) break;
+
+            buffer_offset = offset;
+            buffer_len = (size_t)ret;
+            pos = 0;
+        }
+
+        if(pos + sizeof(struct rrdeng_page_header) > buffer_len) break;
+
+        struct rrdeng_page_header h;
+        memcpy(&h, &buffer[pos], sizeof(h));
+
+        if(unlikely(h.magic != RRDENG_PAGE_MAGIC
+                    || !h.entries || h.entries > RRDDIM_PAGE_ENTRIES
+                    || h.update_every <= 0
+                    || h.bytes > RRDDIM_PAGE_MAX_BYTES(RRDDIM_PAGE_ENTRIES)
+                    || h.key_length >= sizeof(key)
+                    || pos + sizeof(h) + h.key_length > buffer_len))
+            break;
+
+        size_t record = sizeof(h) + h.key_length + h.bytes;
+        if(unlikely(offset + record > file_size))
+            break;
+
+        memcpy(key, &buffer[pos + sizeof(h)], h.key_length);
+        key[h.key_length] = '\0';
+
+        struct rrdeng_page *page = callocz(1, sizeof(struct rrdeng_page));
+        page->start_t = (time_t)h.start_t;
+        page->update_every = h.update_every;
+        page->entries = h.entries;
+        page->datafile = df;
+        page->offset = offset + sizeof(h) + h.key_length;
+        page->bytes = h.bytes;
+
+        rrdeng_metric_add_page_unsafe(rrdeng_metric_get_unsafe(ctx, key), page);
+
+        offset += record;
+        pages++;
+    }
+
+    freez(buffer);
+
+    if(file_size > offset) {
+        error("DBENGINE: datafile '%s' has %zu bytes of invalid data at its end. Truncating it.", filename, file_size - offset);
+        if(ftruncate(df->fd, (off_t)offset) == -1)
+            error("DBENGINE: cannot truncate datafile '%s'", filename);
+    }
+
+    df->size = df->flushed = offset;
+    info("DBENGINE: loaded %zu pages from datafile '%s'", pages, filename);
+}
+
+static int rrdeng_compare_fileno(const void *a, const void *b) {
+    unsigned x = *(const unsigned *)a, y = *(const unsigned *)b;
+    return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+static void rrdeng_load(struct rrdengine *ctx) {
+    DIR *dir = opendir(ctx->path);
+    if(unlikely(!dir)) {
+        error("DBENGINE: cannot open directory '%s'", ctx->path);
+        return;
+    }
+
+    unsigned *filenos = NULL;
+    size_t count = 0, size = 0;
+
+    struct dirent *de;
+    while((de = readdir(dir))) {
+        unsigned fileno;
+        char suffix[sizeof(RRDENG_DATAFILE_SUFFIX) + 1];
+
+        if(sscanf(de->d_name, RRDENG_DATAFILE_PREFIX "%u%5s", &fileno, suffix) != 2 || strcmp(suffix, RRDENG_DATAFILE_SUFFIX) != 0)
+            continue;
+
+        if(count == size) {
+            size = (size) ? size * 2 : 16;
+            filenos = reallocz(filenos, size * sizeof(unsigned));
+        }
+        filenos[count++] = fileno;
+    }
+    closedir(dir);
+
+    qsort(filenos, count, sizeof(unsigned), rrdeng_compare_fileno);
+
+    size_t i;
+    for(i = 0; i < count ; i++) {
+        struct rrdeng_datafile *df = rrdeng_datafile_open(ctx, filenos[i], 0);
+        if(unlikely(!df)) continue;
+
+        rrdeng_datafile_load(ctx, df);
+        rrdeng_datafile_link_unsafe(ctx, df);
+    }
+
+    freez(filenos);
+}
+
+// ----------------------------------------------------------------------------
+// init / exit
+
+struct rrdengine *rrdeng_init(const char *path, long disk_space_mb) {
+    struct rrdengine *ctx = callocz(1, sizeof(struct rrdengine));
+
+    hibenchmarks_mutex_init(&ctx->mutex);
+    snprintfz(ctx->path, FILENAME_MAX, "%s/dbengine", path);
+
+    if(mkdir(ctx->path, 0775) == -1 && errno != EEXIST) {
+        error("DBENGINE: cannot create directory '%s'", ctx->path);
+        freez(ctx);
+        return NULL;
+    }
+
+    if(disk_space_mb < 1) disk_space_mb = 1;
+    ctx->datafile_max_size = (size_t)disk_space_mb * 1024 * 1024 / RRDENG_DATAFILES_MAX;
+    if(ctx->datafile_max_size < RRDENG_DATAFILE_MIN_SIZE) ctx->datafile_max_size = RRDENG_DATAFILE_MIN_SIZE;
+
+    ctx->metrics = dictionary_create(DICTIONARY_FLAG_SINGLE_THREADED);
+    ctx->buffer = mallocz(RRDENG_WRITE_BUFFER_SIZE);
+
+    hibenchmarks_mutex_lock(&ctx->mutex);
+    rrdeng_load(ctx);
+    rrdeng_datafile_rotate_unsafe(ctx);
+    hibenchmarks_mutex_unlock(&ctx->mutex);
+
+    if(unlikely(!ctx->datafile)) {
+        error("DBENGINE: cannot create a datafile in '%s'. Disabling it.", ctx->path);
+        rrdeng_exit(ctx);
+        return NULL;
+    }
+
+    info("DBENGINE: initialized '%s' with %zu datafiles of up to %zu bytes", ctx->path, (size_t)RRDENG_DATAFILES_MAX, ctx->datafile_max_size);
+    return ctx;
+}
+
+void rrdeng_sync(struct rrdengine *ctx) {
+    if(!ctx) return;
+
+    hibenchmarks_mutex_lock(&ctx->mutex);
+    rrdeng_flush_unsafe(ctx);
+    if(ctx->datafile && fdatasync(ctx->datafile->fd) == -1)
+        error("DBENGINE: cannot sync datafile %05u of '%s'", ctx->datafile->fileno, ctx->path);
+    hibenchmarks_mutex_unlock(&ctx->mutex);
+}
+
+static int rrdeng_free_metric_pages_callback(void *entry, void *data) {
+    (void)data;
+    struct rrdeng_metric *metric = (struct rrdeng_metric *)entry;
+
+    while(metric->first) {
+        struct rrdeng_page *page = metric->first;
+        metric->first = page->next;
+
+        page_cache_evict(page);
+        freez(page);
+    }
+    metric->last = NULL;
+
+    freez(metric->key);
+    metric->key = NULL;
+
+    return 0;
+}
+
+void rrdeng_exit(struct rrdengine *ctx) {
+    if(!ctx) return;
+
+    rrdeng_sync(ctx);
+
+    hibenchmarks_mutex_lock(&ctx->mutex);
+
+    dictionary_get_all(ctx->metrics, rrdeng_free_metric_pages_callback, NULL);
+    dictionary_destroy(ctx->metrics);
+
+    while(ctx->datafiles) {
+        struct rrdeng_datafile *df = ctx->datafiles;
+        ctx->datafiles = df->next;
+        close(df->fd);
+        freez(df);
+    }
+    ctx->datafile = NULL;
+
+    hibenchmarks_mutex_unlock(&ctx->mutex);
+
+    freez(ctx->buffer);
+    freez(ctx);
+}
+
+// ----------------------------------------------------------------------------
+// data collection
+
+// append a page of values to the datafiles
+// called by the data collection threads, when they complete a page
+void rrdeng_store_page(struct rrdengine *ctx, struct rrdeng_metric *metric, time_t start_t, int update_every, const storage_number *values, long entries) {
+    // empty slots at the edges of the page are not stored
+    while(entries > 0 && !does_storage_number_exist(values[0])) {
+        values++;
+        entries--;
+        start_t += update_every;
+    }
+    while(entries > 0 && !does_storage_number_exist(values[entries - 1]))
+        entries--;
+
+    if(unlikely(entries <= 0 || entries > RRDDIM_PAGE_ENTRIES))
+        return;
+
+    uint8_t data[RRDDIM_PAGE_MAX_BYTES(RRDDIM_PAGE_ENTRIES)];
+    size_t bytes = storage_number_page_compress(values, entries, data);
+
+    struct rrdeng_page_header h = {
+            .magic = RRDENG_PAGE_MAGIC,
+            .bytes = (uint32_t)bytes,
+            .entries = (uint32_t)entries,
+            .update_every = update_every,
+            .start_t = (int64_t)start_t,
+            .key_length = metric->key_length,
+            .reserved = 0
+    };
+    size_t record = sizeof(h) + h.key_length + bytes;
+
+    hibenchmarks_mutex_lock(&ctx->mutex);
+
+    if(unlikely(!ctx->datafile || ctx->datafile->size + record > ctx->datafile_max_size))
+        rrdeng_datafile_rotate_unsafe(ctx);
+
+    struct rrdeng_datafile *df = ctx->datafile;
+    if(unlikely(!df)) {
+        hibenchmarks_mutex_unlock(&ctx->mutex);
+        return;
+    }
+
+    if(unlikely(ctx->buffer_used + record > RRDENG_WRITE_BUFFER_SIZE))
+        rrdeng_flush_unsafe(ctx);
+
+    char *b = &ctx->buffer[ctx->buffer_used];
+    memcpy(b, &h, sizeof(h));
+    memcpy(&b[sizeof(h)], metric->key, h.key_length);
+    memcpy(&b[sizeof(h) + h.key_length], data, bytes);
+    ctx->buffer_used += record;
+
+    struct rrdeng_page *page = callocz(1, sizeof(struct rrdeng_page));
+    page->start_t = start_t;
+    page->update_every = update_every;
+    page->entries = (uint32_t)entries;
+    page->datafile = df;
+    page->offset = df->size + sizeof(h) + h.key_length;
+    page->bytes = (uint32_t)bytes;
+    rrdeng_metric_add_page_unsafe(metric, page);
+
+    df->size += record;
+
+    hibenchmarks_mutex_unlock(&ctx->mutex);
+}
+
+// ----------------------------------------------------------------------------
+// queries
+
+// read the values of a page, from the page cache or the datafile
+// the caller has to hold the mutex
+static int rrdeng_page_values_unsafe(struct rrdengine *ctx, struct rrdeng_page *page, storage_number *values) {
+    if(likely(page_cache_get(page, values)))
+        return 0;
+
+    struct rrdeng_datafile *df = page->datafile;
+    uint8_t data[RRDDIM_PAGE_MAX_BYTES(RRDDIM_PAGE_ENTRIES)];
+
+    if(df == ctx->datafile && page->offset >= df->flushed) {
+        // it is still in the write buffer
+        memcpy(data, &ctx->buffer[page->offset - df->flushed], page->bytes);
+    }
+    else {
+        ssize_t ret = pread(df->fd, data, page->bytes, (off_t)page->offset);
+        if(unlikely(ret != (ssize_t)page->bytes)) {
+            error("DBENGINE: cannot read %u bytes at offset %zu of datafile %05u of '%s'", page->bytes, page->offset, df->fileno, ctx->path);
+            return -1;
+        }
+    }
+
+    storage_number_page_decompress(data, page->bytes, values, page->entries);
+    page_cache_add(page, values);
+    return 0;
+}
+
+// the oldest time there are data for, in the datafiles and the round robin database of the chart
+time_t rrdeng_first_entry_t(RRDSET *st) {
+    struct rrdengine *ctx = st->rrdhost->rrdeng;
+    time_t first_entry_t = 0;
+    RRDDIM *rd;
+
+    hibenchmarks_mutex_lock(&ctx->mutex);
+
+    rrddim_foreach_read(rd, st) {
+        struct rrdeng_metric *metric = rd->rrdeng_metric;
+        if(unlikely(!metric || !metric->first)) continue;
+
+        if(!first_entry_t || metric->first->start_t < first_entry_t)
+            first_entry_t = metric->first->start_t;
+    }
+
+    hibenchmarks_mutex_unlock(&ctx->mutex);
+
+    return first_entry_t;
+}
+
+// set the round robin geometry of a query on the datafiles,
+// so that the rrdset_*_slot(), rrdset_*_entry_t() and rrdset_time2slot() macros
+// map times to slots linearly, from the oldest entry to the last one
+void rrdeng_query_range(RRDSET *st, struct rrdset_tier *range) {
+    time_t last_entry_t = rrdset_last_entry_t(st);
+    time_t first_entry_t = rrdeng_first_entry_t(st);
+
+    if(!first_entry_t || first_entry_t > last_entry_t)
+        first_entry_t = last_entry_t;
+
+    range->update_every = st->update_every;
+    range->entries = (long)((last_entry_t - first_entry_t) / st->update_every) + 2;
+    range->current_entry = 0;
+    range->counter = (size_t)range->entries;
+    range->last_updated = st->last_updated;
+}
+
+void rrdeng_query_init(RRDENG_QUERY_HANDLE *h, RRDDIM *rd) {
+    h->rd = rd;
+    h->ring_first_t = rrdset_first_entry_t(rd->rrdset);
+    h->page_start_t = 0;
+    h->page_end_t = -1;
+    h->page_update_every = 0;
+    h->page = NULL;
+    h->deletions = 0;
+    rrddim_page_iterator_init(&h->ring, rd);
+}
+
+// find the page that has the value at time t and load it in the handle
+static int rrdeng_query_load_page(RRDENG_QUERY_HANDLE *h, time_t t) {
+    struct rrdengine *ctx = h->rd->rrdset->rrdhost->rrdeng;
+    struct rrdeng_metric *metric = h->rd->rrdeng_metric;
+    int ret = -1;
+
+    hibenchmarks_mutex_lock(&ctx->mutex);
+
+    // search from the page loaded last, unless pages have been deleted since then
+    // queries read the values in time order, so it is usually the next one
+    struct rrdeng_page *page = h->page;
+    if(!page || h->deletions != ctx->deletions)
+        page = metric->last;
+
+    while(page && page->start_t > t)
+        page = page->prev;
+
+    while(page && page->next && page->next->start_t <= t)
+        page = page->next;
+
+    if(page && t <= rrdeng_page_end_t(page) && !rrdeng_page_values_unsafe(ctx, page, h->values)) {
+        h->page = page;
+        h->deletions = ctx->deletions;
+        h->page_start_t = page->start_t;
+        h->page_end_t = rrdeng_page_end_t(page);
+        h->page_update_every = page->update_every;
+        ret = 0;
+    }
+
+    hibenchmarks_mutex_unlock(&ctx->mutex);
+    return ret;
+}
+
+storage_number rrdeng_query_value(RRDENG_QUERY_HANDLE *h, time_t t) {
+    RRDDIM *rd = h->rd;
+
+    if(t > h->ring_first_t)
+        return rrddim_page_iterator_get(&h->ring, (long)rrdset_time2slot(rd->rrdset, t));
+
+    if(unlikely(!rd->rrdeng_metric))
+        return SN_EMPTY_SLOT;
+
+    if(unlikely(t < h->page_start_t || t > h->page_end_t)) {
+        if(rrdeng_query_load_page(h, t))
+            return SN_EMPTY_SLOT;
+    }
+
+    time_t offset = t - h->page_start_t;
+    if(unlikely(offset % h->page_update_every))
+        return SN_EMPTY_SLOT;
+
+    return h->values[offset / h->page_update_every];
+}
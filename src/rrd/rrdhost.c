@@ -128,6 +128,7 @@ RRDHOST *rrdhost_create(const char *hostname,
     rrd_check_wrlock();
 
     RRDHOST *host = callocz(1, sizeof(RRDHOST));
+    slab_set_init(&host->slabs);
 
     host->rrd_update_every    = (update_every > 0)?update_every:1;
     host->rrd_history_entries = align_entries_to_pagesize(memory_mode, entries);
@@ -154,8 +155,8 @@ RRDHOST *rrdhost_create(const char *hostname,
     host->program_version = strdupz((program_version && *program_version)?program_version:"unknown");
     host->registry_hostname = strdupz((registry_hostname && *registry_hostname)?registry_hostname:hostname);
 
-    avl_init_lock(&(host->rrdset_root_index),      rrdset_compare);
-    avl_init_lock(&(host->rrdset_root_index_name), rrdset_compare_name);
+    hash_index_init(&(host->rrdset_root_index),      offsetof(RRDSET, id));
+    hash_index_init(&(host->rrdset_root_index_name), offsetof(RRDSET, name));
     avl_init_lock(&(host->rrdfamily_root_index),   rrdfamily_compare);
     avl_init_lock(&(host->rrdvar_root_index),   rrdvar_compare);
 
@@ -199,7 +200,7 @@ RRDHOST *rrdhost_create(const char *hostname,
         snprintfz(filename, FILENAME_MAX, "%s/%s", hibenchmarks_configured_cache_dir, host->machine_guid);
         host->cache_dir = strdupz(filename);
 
-        if(host->rrd_memory_mode == RRD_MEMORY_MODE_MAP || host->rrd_memory_mode == RRD_MEMORY_MODE_SAVE) {
+        if(host->rrd_memory_mode == RRD_MEMORY_MODE_MAP || host->rrd_memory_mode == RRD_MEMORY_MODE_SAVE || host->rrd_memory_mode == RRD_MEMORY_MODE_DBENGINE) {
             int r = mkdir(host->cache_dir, 0775);
             if(r != 0 && errno != EEXIST)
                 error("Host '%s': cannot create directory '%s'", host->hostname, host->cache_dir);
@@ -216,6 +217,9 @@ RRDHOST *rrdhost_create(const char *hostname,
 
     }
 
+    if(host->rrd_memory_mode == RRD_MEMORY_MODE_DBENGINE)
+        host->rrdeng = rrdeng_init(host->cache_dir, default_rrdeng_disk_space_mb);
+
     if(host->health_enabled) {
         snprintfz(filename, FILENAME_MAX, "%s/health", host->varlib_dir);
         int r = mkdir(filename, 0775);
@@ -521,9 +525,27 @@ void rrdhost_free(RRDHOST *host) {
     // ------------------------------------------------------------------------
     // release its children resources
 
+    // the charts, the dimensions and their variables are not returned
+    // to the slabs one by one - all the slab pages are released together
+    slab_set_destroy_begin(&host->slabs);
+
     while(host->rrdset_root)
         rrdset_free(host->rrdset_root);
 
+    // the queries still reading charts of the host free them when they finish
+    // they do not need the host lock for this
+    while(unlikely(__sync_add_and_fetch(&host->rrdset_deferred, 0)))
+        sleep_usec(1000);
+
+    hash_index_destroy(&host->rrdset_root_index);
+    hash_index_destroy(&host->rrdset_root_index_name);
+
+    debug(D_RRD_CALLS, "RRDHOST: releasing %zu bytes of chart and dimension slabs of host '%s'", slab_set_allocated_memory(&host->slabs), host->hostname);
+    slab_set_destroy(&host->slabs);
+
+    rrdeng_exit(host->rrdeng);
+    host->rrdeng = NULL;
+
     while(host->alarms)
         rrdcalc_unlink_and_free(host, host->alarms);
 
@@ -609,6 +631,8 @@ void rrdhost_save_charts(RRDHOST *host) {
         rrdset_unlock(st);
     }
 
+    rrdeng_sync(host->rrdeng);
+
     rrdhost_unlock(host);
 }
 
@@ -663,6 +687,8 @@ void rrdhost_cleanup_charts(RRDHOST *host) {
         rrdset_unlock(st);
     }
 
+    rrdeng_sync(host->rrdeng);
+
     rrdhost_unlock(host);
 }
 
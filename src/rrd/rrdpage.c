@@ -0,0 +1,337 @@
+// SPDX-License-Identifier: GPL-3.0+
+#define HIBENCHMARKS_RRD_INTERNALS 1
+#include "include/common.h"
+
+// ----------------------------------------------------------------------------
+// RRD COMPRESSED PAGES
+//
+// with memory modes compressed and dbengine, the round robin database of every dimension
+// is split in pages of RRDDIM_PAGE_ENTRIES slots. The page being written is
+// kept uncompressed in rd->values. When data collection moves to another page,
+// the page is compressed and the next one is decompressed into rd->values.
+//
+// The pages are compressed with the XOR encoding of the Gorilla paper,
+// applied to the 32-bit storage numbers: a constant dimension needs 1 bit
+// per slot, a slow moving one only the few low bits that changed.
+// The timestamps of the slots are implied by their position in the
+// round robin database, so they do not need to be encoded.
+
+// ----------------------------------------------------------------------------
+// bit streams
+
+struct bit_writer {
+    uint8_t *data;
+    size_t bytes;
+    uint64_t acc;
+    int used;
+};
+
+static inline void bit_writer_write(struct bit_writer *bw, uint32_t value, int bits) {
+    bw->acc = (bw->acc << bits) | ((bits == 32) ? value : (value & ((1U << bits) - 1)));
+    bw->used += bits;
+
+    while(bw->used >= 8) {
+        bw->used -= 8;
+        bw->data[bw->bytes++] = (uint8_t)(bw->acc >> bw->used);
+    }
+}
+
+static inline void bit_writer_flush(struct bit_writer *bw) {
+    if(bw->used) {
+        bw->data[bw->bytes++] = (uint8_t)(bw->acc << (8 - bw->used));
+        bw->used = 0;
+    }
+}
+
+struct bit_reader {
+    const uint8_t *data;
+    size_t bytes;
+    size_t pos;
+    uint64_t acc;
+    int used;
+};
+
+static inline uint32_t bit_reader_read(struct bit_reader *br, int bits) {
+    while(br->used < bits) {
+        br->acc = (br->acc << 8) | ((likely(br->pos < br->bytes)) ? br->data[br->pos++] : 0);
+        br->used += 8;
+    }
+
+    br->used -= bits;
+    uint64_t value = br->acc >> br->used;
+    return (bits == 32) ? (uint32_t)value : (uint32_t)(value & ((1U << bits) - 1));
+}
+
+// ----------------------------------------------------------------------------
+// XOR encoding of storage numbers
+//
+// the first value is stored as-is (32 bits), every next one is XORed with
+// the previous one:
+//
+//  '0'                     the same value
+//  '10' + bits             the XOR fits in the window of the previous XOR
+//  '11' + 5 bits leading zeros + 5 bits length - 1 + bits
+//                          a new window
+
+size_t storage_number_page_compress(const storage_number *values, long entries, uint8_t *data) {
+    struct bit_writer bw = { .data = data, .bytes = 0, .acc = 0, .used = 0 };
+
+    if(unlikely(entries <= 0))
+        return 0;
+
+    storage_number last = values[0];
+    bit_writer_write(&bw, last, 32);
+
+    int window_leading = -1, window_trailing = 0;
+
+    long i;
+    for(i = 1; i < entries ; i++) {
+        uint32_t x = values[i] ^ last;
+        last = values[i];
+
+        if(likely(!x)) {
+            bit_writer_write(&bw, 0, 1);
+            continue;
+        }
+
+        int leading  = __builtin_clz(x);
+        int trailing = __builtin_ctz(x);
+
+        if(window_leading != -1 && leading >= window_leading && trailing >= window_trailing) {
+            bit_writer_write(&bw, 2, 2);
+            bit_writer_write(&bw, x >> window_trailing, 32 - window_leading - window_trailing);
+        }
+        else {
+            int length = 32 - leading - trailing;
+
+            bit_writer_write(&bw, 3, 2);
+            bit_writer_write(&bw, (uint32_t)leading, 5);
+            bit_writer_write(&bw, (uint32_t)(length - 1), 5);
+            bit_writer_write(&bw, x >> trailing, length);
+
+            window_leading = leading;
+            window_trailing = trailing;
+        }
+    }
+
+    bit_writer_flush(&bw);
+    return bw.bytes;
+}
+
+void storage_number_page_decompress(const uint8_t *data, size_t bytes, storage_number *values, long entries) {
+    struct bit_reader br = { .data = data, .bytes = bytes, .pos = 0, .acc = 0, .used = 0 };
+
+    if(unlikely(entries <= 0))
+        return;
+
+    storage_number last = bit_reader_read(&br, 32);
+    values[0] = last;
+
+    int window_leading = 0, window_trailing = 0;
+
+    long i;
+    for(i = 1; i < entries ; i++) {
+        if(likely(!bit_reader_read(&br, 1))) {
+            values[i] = last;
+            continue;
+        }
+
+        if(bit_reader_read(&br, 1)) {
+            window_leading = (int)bit_reader_read(&br, 5);
+            window_trailing = 32 - window_leading - ((int)bit_reader_read(&br, 5) + 1);
+        }
+
+        last ^= bit_reader_read(&br, 32 - window_leading - window_trailing) << window_trailing;
+        values[i] = last;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// RRDDIM compressed pages
+
+static inline long rrddim_page_entries(RRDDIM *rd, long page) {
+    long first = page * RRDDIM_PAGE_ENTRIES;
+    long entries = rd->entries - first;
+    return (entries > RRDDIM_PAGE_ENTRIES) ? RRDDIM_PAGE_ENTRIES : entries;
+}
+
+// decompress a page - the caller has to hold the mutex
+static inline void rrddim_page_decompress_unsafe(RRDDIM *rd, long page, storage_number *values) {
+    struct rrddim_page *p = rd->pages->page[page];
+    long entries = rrddim_page_entries(rd, page);
+
+    if(unlikely(!p))
+        memset(values, 0, entries * sizeof(storage_number));
+    else
+        storage_number_page_decompress(p->data, p->bytes, values, entries);
+}
+
+void rrddim_pages_init(RRDSET *st, RRDDIM *rd) {
+    rd->pages = NULL;
+
+    if(!rrd_memory_mode_has_pages(rd->rrd_memory_mode))
+        return;
+
+    struct rrddim_pages *pages = callocz(1, sizeof(struct rrddim_pages));
+    hibenchmarks_mutex_init(&pages->mutex);
+
+    pages->pages = (rd->entries + RRDDIM_PAGE_ENTRIES - 1) / RRDDIM_PAGE_ENTRIES;
+    pages->current_page = rrddim_page_of_slot(st->current_entry);
+    pages->page = callocz((size_t)pages->pages, sizeof(struct rrddim_page *));
+    pages->last_slot = -1;
+
+    rd->pages = pages;
+}
+
+void rrddim_pages_free(RRDDIM *rd) {
+    struct rrddim_pages *pages = rd->pages;
+    if(!pages)
+        return;
+
+    long p;
+    for(p = 0; p < pages->pages ; p++)
+        freez(pages->page[p]);
+
+    freez(pages->page);
+    freez(pages);
+    rd->pages = NULL;
+}
+
+// save the slots of the current page written since the last save, to the dbengine
+// the caller has to hold the mutex
+static void rrddim_page_flush_unsafe(RRDDIM *rd) {
+    struct rrddim_pages *pages = rd->pages;
+
+    if(!rd->rrdeng_metric || pages->last_slot < pages->flushed_slots)
+        return;
+
+    long entries = pages->last_slot - pages->flushed_slots + 1;
+    time_t start_t = pages->last_slot_t - (time_t)(entries - 1) * rd->update_every;
+
+    rrdeng_store_page(rd->rrdset->rrdhost->rrdeng, rd->rrdeng_metric, start_t, rd->update_every, &rd->values[pages->flushed_slots], entries);
+    pages->flushed_slots = pages->last_slot + 1;
+}
+
+void rrddim_pages_flush(RRDDIM *rd) {
+    struct rrddim_pages *pages = rd->pages;
+    if(!pages || !rd->rrdeng_metric)
+        return;
+
+    hibenchmarks_mutex_lock(&pages->mutex);
+    rrddim_page_flush_unsafe(rd);
+    hibenchmarks_mutex_unlock(&pages->mutex);
+}
+
+// compress the current page and decompress the new one in rd->values
+// called by the data collection thread
+static void rrddim_page_switch(RRDDIM *rd, long page) {
+    struct rrddim_pages *pages = rd->pages;
+    uint8_t buffer[RRDDIM_PAGE_MAX_BYTES(RRDDIM_PAGE_ENTRIES)];
+
+    long current = pages->current_page;
+    size_t bytes = storage_number_page_compress(rd->values, rrddim_page_entries(rd, current), buffer);
+
+    struct rrddim_page *p = mallocz(sizeof(struct rrddim_page) + bytes);
+    p->bytes = (uint32_t)bytes;
+    memcpy(p->data, buffer, bytes);
+
+    hibenchmarks_mutex_lock(&pages->mutex);
+
+    rrddim_page_flush_unsafe(rd);
+    pages->last_slot = -1;
+    pages->flushed_slots = 0;
+
+    if(unlikely(pages->page[current])) {
+        pages->compressed_bytes -= pages->page[current]->bytes;
+        freez(pages->page[current]);
+    }
+    pages->page[current] = p;
+    pages->compressed_bytes += bytes;
+
+    // the new page keeps the old values of the round robin database,
+    // until they are overwritten
+    rrddim_page_decompress_unsafe(rd, page, rd->values);
+    if(likely(pages->page[page])) {
+        pages->compressed_bytes -= pages->page[page]->bytes;
+        freez(pages->page[page]);
+        pages->page[page] = NULL;
+    }
+    pages->current_page = page;
+
+    hibenchmarks_mutex_unlock(&pages->mutex);
+}
+
+void rrddim_page_store(RRDDIM *rd, long slot, time_t t, storage_number n) {
+    struct rrddim_pages *pages = rd->pages;
+    long page = rrddim_page_of_slot(slot);
+
+    if(unlikely(page != pages->current_page))
+        rrddim_page_switch(rd, page);
+
+    slot -= page * RRDDIM_PAGE_ENTRIES;
+
+    // rrddim_pages_flush() saves the same slots from other threads
+    hibenchmarks_mutex_lock(&pages->mutex);
+
+    rd->values[slot] = n;
+    pages->last_slot_t = t;
+    pages->last_slot = slot;
+    if(unlikely(slot < pages->flushed_slots))
+        pages->flushed_slots = slot;
+
+    hibenchmarks_mutex_unlock(&pages->mutex);
+}
+
+storage_number rrddim_page_value(RRDDIM *rd, long slot) {
+    struct rrddim_pages *pages = rd->pages;
+    long page = rrddim_page_of_slot(slot);
+    storage_number values[RRDDIM_PAGE_ENTRIES];
+    storage_number n;
+
+    hibenchmarks_mutex_lock(&pages->mutex);
+
+    if(likely(page == pages->current_page))
+        n = rd->values[slot - page * RRDDIM_PAGE_ENTRIES];
+    else {
+        rrddim_page_decompress_unsafe(rd, page, values);
+        n = values[slot - page * RRDDIM_PAGE_ENTRIES];
+    }
+
+    hibenchmarks_mutex_unlock(&pages->mutex);
+
+    return n;
+}
+
+// ----------------------------------------------------------------------------
+// RRDDIM page iterator
+
+void rrddim_page_iterator_init(RRDDIM_PAGE_ITERATOR *it, RRDDIM *rd) {
+    it->rd = rd;
+    it->page = -1;
+}
+
+void rrddim_page_iterator_load(RRDDIM_PAGE_ITERATOR *it, long page) {
+    RRDDIM *rd = it->rd;
+
+    if(unlikely(!rd->pages)) {
+        long entries = rd->entries - page * RRDDIM_PAGE_ENTRIES;
+        if(entries > RRDDIM_PAGE_ENTRIES) entries = RRDDIM_PAGE_ENTRIES;
+
+        memcpy(it->values, &rd->values[page * RRDDIM_PAGE_ENTRIES], entries * sizeof(storage_number));
+        it->page = page;
+        return;
+    }
+
+    struct rrddim_pages *pages = rd->pages;
+
+    hibenchmarks_mutex_lock(&pages->mutex);
+
+    if(page == pages->current_page)
+        memcpy(it->values, rd->values, rrddim_page_entries(rd, page) * sizeof(storage_number));
+    else
+        rrddim_page_decompress_unsafe(rd, page, it->values);
+
+    hibenchmarks_mutex_unlock(&pages->mutex);
+
+    it->page = page;
+}
@@ -92,7 +92,7 @@ static inline void rrdpush_send_chart_definition_nolock(RRDSET *st) {
     // send the chart
     buffer_sprintf(
             host->rrdpush_sender_buffer
-            , "CHART \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" %ld %d \"%s %s %s %s\" \"%s\" \"%s\"\n"
+            , "CHART \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" %ld %d \"%s %s %s %s %s\" \"%s\" \"%s\"\n"
             , st->id
             , st->name
             , st->title
@@ -106,6 +106,7 @@ static inline void rrdpush_send_chart_definition_nolock(RRDSET *st) {
             , rrdset_flag_check(st, RRDSET_FLAG_DETAIL)?"detail":""
             , rrdset_flag_check(st, RRDSET_FLAG_STORE_FIRST)?"store_first":""
             , rrdset_flag_check(st, RRDSET_FLAG_HIDDEN)?"hidden":""
+            , (st->storage_format == RRD_STORAGE_FORMAT_64BIT)?RRD_STORAGE_FORMAT_64BIT_NAME:""
             , (st->plugin_name)?st->plugin_name:""
             , (st->module_name)?st->module_name:""
     );
@@ -152,11 +153,11 @@ static inline void rrdpush_send_chart_metrics_nolock(RRDSET *st) {
 
     RRDDIM *rd;
     rrddim_foreach_read(rd, st) {
-        if(rd->updated && rd->exposed)
+        if(rrddim_collection(rd, updated) && rd->exposed)
             buffer_sprintf(host->rrdpush_sender_buffer
                            , "SET \"%s\" = " COLLECTED_NUMBER_FORMAT "\n"
                            , rd->id
-                           , rd->collected_value
+                           , rrddim_collection(rd, collected_value)
         );
     }
 
@@ -0,0 +1,304 @@
+// SPDX-License-Identifier: GPL-3.0+
+#include "include/common.h"
+
+// ----------------------------------------------------------------------------
+// the grouping kernels of rrd2rrdr()
+//
+// rrd2rrdr() unpacks the slots of each dimension in a contiguous array, oldest
+// first, with NAN for the slots that do not exist. The kernels reduce the
+// values of the slots of a row, without branches per value.
+//
+// The x87 long double of calculated_number has no vector instructions, so the
+// portable loops are used. When hibenchmarks is compiled with
+// HIBENCHMARKS_WITHOUT_LONG_DOUBLE on x86_64, AVX2 versions are selected at
+// runtime, if the CPU supports them. They add the values in a different
+// order, so sums may differ from the portable ones in their last digits.
+
+static long rrdr_grouping_sum_portable(const calculated_number *values, long entries, calculated_number *sum, int *nonzero) {
+    calculated_number s0 = 0, s1 = 0;
+    long count = 0, nz = 0, i = 0;
+
+    for(; i + 2 <= entries ; i += 2) {
+        calculated_number a = values[i], b = values[i + 1];
+        int ea = (a == a), eb = (b == b);
+
+        s0 += (ea) ? a : 0;
+        s1 += (eb) ? b : 0;
+        count += ea + eb;
+        nz |= (ea & (a != 0)) | (eb & (b != 0));
+    }
+
+    for(; i < entries ; i++) {
+        calculated_number a = values[i];
+        int ea = (a == a);
+
+        s0 += (ea) ? a : 0;
+        count += ea;
+        nz |= ea & (a != 0);
+    }
+
+    *sum = s0 + s1;
+    *nonzero = (int)nz;
+    return count;
+}
+
+// min and max are by absolute value - on ties, the newest value is kept
+static long rrdr_grouping_min_max_portable(const calculated_number *values, long entries, calculated_number *result, int *nonzero, int max) {
+    calculated_number best = NAN, best_abs = (max) ? -1 : INFINITY;
+    long count = 0, nz = 0, i;
+
+    for(i = 0; i < entries ; i++) {
+        calculated_number a = values[i], abs_a = calculated_number_fabs(a);
+        int ea = (a == a);
+        int take = ea & ((max) ? (abs_a >= best_abs) : (abs_a <= best_abs));
+
+        best = (take) ? a : best;
+        best_abs = (take) ? abs_a : best_abs;
+        count += ea;
+        nz |= ea & (a != 0);
+    }
+
+    *result = best;
+    *nonzero = (int)nz;
+    return count;
+}
+
+#if defined(HIBENCHMARKS_WITHOUT_LONG_DOUBLE) && defined(__x86_64__) && defined(__GNUC__)
+#define RRDR_GROUPING_AVX2 1
+#include <immintrin.h>
+
+__attribute__((target("avx2")))
+static long rrdr_grouping_sum_avx2(const calculated_number *values, long entries, calculated_number *sum, int *nonzero) {
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d acc = zero, nz = zero;
+    __m256i count = _mm256_setzero_si256();
+    long i = 0;
+
+    for(; i + 4 <= entries ; i += 4) {
+        __m256d v = _mm256_loadu_pd(&values[i]);
+        __m256d exists = _mm256_cmp_pd(v, v, _CMP_ORD_Q);
+
+        acc = _mm256_add_pd(acc, _mm256_and_pd(v, exists));
+        nz = _mm256_or_pd(nz, _mm256_and_pd(exists, _mm256_cmp_pd(v, zero, _CMP_NEQ_UQ)));
+
+        // compare masks are -1, so subtracting them counts them
+        count = _mm256_sub_epi64(count, _mm256_castpd_si256(exists));
+    }
+
+    double a[4];
+    long long c[4];
+    _mm256_storeu_pd(a, acc);
+    _mm256_storeu_si256((__m256i *)c, count);
+
+    calculated_number tail_sum;
+    int tail_nonzero;
+    long tail_count = rrdr_grouping_sum_portable(&values[i], entries - i, &tail_sum, &tail_nonzero);
+
+    *sum = ((a[0] + a[1]) + (a[2] + a[3])) + tail_sum;
+    *nonzero = (_mm256_movemask_pd(nz) != 0) | tail_nonzero;
+    return (long)(c[0] + c[1] + c[2] + c[3]) + tail_count;
+}
+
+__attribute__((target("avx2")))
+static long rrdr_grouping_min_max_avx2(const calculated_number *values, long entries, calculated_number *result, int *nonzero, int max) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d sign_bit = _mm256_set1_pd(-0.0);
+    const __m256d four = _mm256_set1_pd(4.0);
+
+    // every lane keeps its best value, and the index it was found at, for the ties
+    __m256d best = _mm256_set1_pd(NAN), best_abs = _mm256_set1_pd((max) ? -1.0 : INFINITY);
+    __m256d best_index = _mm256_set1_pd(-1.0), index = _mm256_setr_pd(0.0, 1.0, 2.0, 3.0);
+    __m256d nz = zero;
+    __m256i count = _mm256_setzero_si256();
+    long i = 0;
+
+    for(; i + 4 <= entries ; i += 4, index = _mm256_add_pd(index, four)) {
+        __m256d v = _mm256_loadu_pd(&values[i]);
+        __m256d abs_v = _mm256_andnot_pd(sign_bit, v);
+        __m256d exists = _mm256_cmp_pd(v, v, _CMP_ORD_Q);
+
+        // NAN compares false, so the slots that do not exist are never taken
+        __m256d take = (max) ? _mm256_cmp_pd(abs_v, best_abs, _CMP_GE_OQ) : _mm256_cmp_pd(abs_v, best_abs, _CMP_LE_OQ);
+
+        best = _mm256_blendv_pd(best, v, take);
+        best_abs = _mm256_blendv_pd(best_abs, abs_v, take);
+        best_index = _mm256_blendv_pd(best_index, index, take);
+
+        nz = _mm256_or_pd(nz, _mm256_and_pd(exists, _mm256_cmp_pd(v, zero, _CMP_NEQ_UQ)));
+        count = _mm256_sub_epi64(count, _mm256_castpd_si256(exists));
+    }
+
+    double b[4], ba[4], bi[4];
+    long long c[4];
+    _mm256_storeu_pd(b, best);
+    _mm256_storeu_pd(ba, best_abs);
+    _mm256_storeu_pd(bi, best_index);
+    _mm256_storeu_si256((__m256i *)c, count);
+
+    // the best of the lanes - on ties, the one found last
+    int k, w = 0;
+    for(k = 1; k < 4 ; k++) {
+        int better = (max) ? (ba[k] > ba[w]) : (ba[k] < ba[w]);
+        if(better || (ba[k] == ba[w] && bi[k] > bi[w])) w = k;
+    }
+
+    calculated_number tail_result;
+    int tail_nonzero;
+    long tail_count = rrdr_grouping_min_max_portable(&values[i], entries - i, &tail_result, &tail_nonzero, max);
+
+    *result = b[w];
+    if(tail_count && (bi[w] < 0 || ((max) ? (calculated_number_fabs(tail_result) >= ba[w]) : (calculated_number_fabs(tail_result) <= ba[w]))))
+        *result = tail_result;
+
+    *nonzero = (_mm256_movemask_pd(nz) != 0) | tail_nonzero;
+    return (long)(c[0] + c[1] + c[2] + c[3]) + tail_count;
+}
+
+static int rrdr_grouping_avx2 = -1;
+
+static inline int rrdr_grouping_has_avx2(void) {
+    if(unlikely(rrdr_grouping_avx2 == -1))
+        rrdr_grouping_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+
+    return rrdr_grouping_avx2;
+}
+#endif
+
+long rrdr_grouping_sum(const calculated_number *values, long entries, calculated_number *sum, int *nonzero) {
+#ifdef RRDR_GROUPING_AVX2
+    if(likely(rrdr_grouping_has_avx2()))
+        return rrdr_grouping_sum_avx2(values, entries, sum, nonzero);
+#endif
+
+    return rrdr_grouping_sum_portable(values, entries, sum, nonzero);
+}
+
+long rrdr_grouping_min(const calculated_number *values, long entries, calculated_number *min, int *nonzero) {
+#ifdef RRDR_GROUPING_AVX2
+    if(likely(rrdr_grouping_has_avx2()))
+        return rrdr_grouping_min_max_avx2(values, entries, min, nonzero, 0);
+#endif
+
+    return rrdr_grouping_min_max_portable(values, entries, min, nonzero, 0);
+}
+
+long rrdr_grouping_max(const calculated_number *values, long entries, calculated_number *max, int *nonzero) {
+#ifdef RRDR_GROUPING_AVX2
+    if(likely(rrdr_grouping_has_avx2()))
+        return rrdr_grouping_min_max_avx2(values, entries, max, nonzero, 1);
+#endif
+
+    return rrdr_grouping_min_max_portable(values, entries, max, nonzero, 1);
+}
+
+// for the incremental sum and the rate - the positions of the oldest and the
+// newest values that exist
+long rrdr_grouping_oldest_newest(const calculated_number *values, long entries, long *oldest, long *newest, int *nonzero) {
+    calculated_number sum;
+    long count = rrdr_grouping_sum(values, entries, &sum, nonzero);
+
+    if(likely(count)) {
+        long i;
+        for(i = 0; isnan(values[i]) ; i++) ;
+        *oldest = i;
+
+        for(i = entries - 1; isnan(values[i]) ; i--) ;
+        *newest = i;
+    }
+
+    return count;
+}
+
+// ----------------------------------------------------------------------------
+// the kernels of the statistical grouping methods
+//
+// They reduce the values in place, so that rrd2rrdr() can group long windows
+// without sorting or allocating per row.
+
+// quickselect - puts the k-th smallest value at a[k], the smaller ones before
+// it and the bigger ones after it
+static void rrdr_grouping_select(calculated_number *a, long entries, long k) {
+    long lo = 0, hi = entries - 1;
+
+    while(lo < hi) {
+        calculated_number pivot = a[lo + (hi - lo) / 2], t;
+        long i = lo, j = hi;
+
+        while(i <= j) {
+            while(a[i] < pivot) i++;
+            while(a[j] > pivot) j--;
+
+            if(i <= j) {
+                t = a[i]; a[i] = a[j]; a[j] = t;
+                i++;
+                j--;
+            }
+        }
+
+        if(k <= j) hi = j;
+        else if(k >= i) lo = i;
+        else break;
+    }
+}
+
+// the percentile of the values that exist, interpolated between the two
+// closest ranks - scratch has to fit all the entries
+long rrdr_grouping_percentile(const calculated_number *values, long entries, calculated_number percentile, calculated_number *scratch, calculated_number *result, int *nonzero) {
+    long count = 0, nz = 0, i;
+
+    // keep only the values that exist, without branches
+    for(i = 0; i < entries ; i++) {
+        calculated_number a = values[i];
+        int ea = (a == a);
+
+        scratch[count] = a;
+        count += ea;
+        nz |= ea & (a != 0);
+    }
+
+    *nonzero = (int)nz;
+    if(unlikely(!count)) return 0;
+
+    calculated_number rank = percentile * (calculated_number)(count - 1) / 100;
+    long k = (long)rank;
+    calculated_number fraction = rank - (calculated_number)k;
+
+    rrdr_grouping_select(scratch, count, k);
+    calculated_number value = scratch[k];
+
+    if(fraction > 0 && k + 1 < count) {
+        // the next rank is the smallest of the bigger values
+        calculated_number next = scratch[k + 1];
+        for(i = k + 2; i < count ; i++)
+            if(scratch[i] < next) next = scratch[i];
+
+        value += fraction * (next - value);
+    }
+
+    *result = value;
+    return count;
+}
+
+// the average and the sample standard deviation, in one pass (Welford)
+long rrdr_grouping_stddev(const calculated_number *values, long entries, calculated_number *average, calculated_number *stddev, int *nonzero) {
+    calculated_number mean = 0, m2 = 0;
+    long count = 0, nz = 0, i;
+
+    for(i = 0; i < entries ; i++) {
+        calculated_number a = values[i];
+        if(unlikely(a != a)) continue;
+
+        count++;
+        calculated_number delta = a - mean;
+        mean += delta / (calculated_number)count;
+        m2 += delta * (a - mean);
+        nz |= (a != 0);
+    }
+
+    *nonzero = (int)nz;
+    if(unlikely(!count)) return 0;
+
+    *average = mean;
+    *stddev = (count > 1) ? calculated_number_sqrt(m2 / (calculated_number)(count - 1)) : 0;
+    return count;
+}
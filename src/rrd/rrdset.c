@@ -22,50 +22,21 @@ void __rrdset_check_wrlock(RRDSET *st, const char *file, const char *function, c
 // ----------------------------------------------------------------------------
 // RRDSET index
 
-int rrdset_compare(void* a, void* b) {
-    if(((RRDSET *)a)->hash < ((RRDSET *)b)->hash) return -1;
-    else if(((RRDSET *)a)->hash > ((RRDSET *)b)->hash) return 1;
-    else return strcmp(((RRDSET *)a)->id, ((RRDSET *)b)->id);
-}
-
-static RRDSET *rrdset_index_find(RRDHOST *host, const char *id, uint32_t hash) {
-    RRDSET tmp;
-    strncpyz(tmp.id, id, RRD_ID_LENGTH_MAX);
-    tmp.hash = (hash)?hash:simple_hash(tmp.id);
-
-    return (RRDSET *)avl_search_lock(&(host->rrdset_root_index), (avl *) &tmp);
+static inline RRDSET *rrdset_index_find(RRDHOST *host, const char *id, uint32_t hash) {
+    return (RRDSET *)hash_index_search(&host->rrdset_root_index, id, (hash)?hash:simple_hash(id));
 }
 
 // ----------------------------------------------------------------------------
 // RRDSET name index
 
-#define rrdset_from_avlname(avlname_ptr) ((RRDSET *)((avlname_ptr) - offsetof(RRDSET, avlname)))
-
-int rrdset_compare_name(void* a, void* b) {
-    RRDSET *A = rrdset_from_avlname(a);
-    RRDSET *B = rrdset_from_avlname(b);
-
-    // fprintf(stderr, "COMPARING: %s with %s\n", A->name, B->name);
-
-    if(A->hash_name < B->hash_name) return -1;
-    else if(A->hash_name > B->hash_name) return 1;
-    else return strcmp(A->name, B->name);
-}
-
 RRDSET *rrdset_index_add_name(RRDHOST *host, RRDSET *st) {
-    void *result;
     // fprintf(stderr, "ADDING: %s (name: %s)\n", st->id, st->name);
-    result = avl_insert_lock(&host->rrdset_root_index_name, (avl *) (&st->avlname));
-    if(result) return rrdset_from_avlname(result);
-    return NULL;
+    return (RRDSET *)hash_index_insert(&host->rrdset_root_index_name, st, st->hash_name);
 }
 
 RRDSET *rrdset_index_del_name(RRDHOST *host, RRDSET *st) {
-    void *result;
     // fprintf(stderr, "DELETING: %s (name: %s)\n", st->id, st->name);
-    result = (RRDSET *)avl_remove_lock(&((host)->rrdset_root_index_name), (avl *)(&st->avlname));
-    if(result) return rrdset_from_avlname(result);
-    return NULL;
+    return (RRDSET *)hash_index_remove(&host->rrdset_root_index_name, st, st->hash_name);
 }
 
 
@@ -73,23 +44,12 @@ RRDSET *rrdset_index_del_name(RRDHOST *host, RRDSET *st) {
 // RRDSET - find charts
 
 static inline RRDSET *rrdset_index_find_name(RRDHOST *host, const char *name, uint32_t hash) {
-    void *result = NULL;
-    RRDSET tmp;
-    tmp.name = name;
-    tmp.hash_name = (hash)?hash:simple_hash(tmp.name);
-
     // fprintf(stderr, "SEARCHING: %s\n", name);
-    result = avl_search_lock(&host->rrdset_root_index_name, (avl *) (&(tmp.avlname)));
-    if(result) {
-        RRDSET *st = rrdset_from_avlname(result);
-        if(strcmp(st->magic, RRDSET_MAGIC) != 0)
-            error("Search for RRDSET %s returned an invalid RRDSET %s (name %s)", name, st->id, st->name);
-
-        // fprintf(stderr, "FOUND: %s\n", name);
-        return rrdset_from_avlname(result);
-    }
-    // fprintf(stderr, "NOT FOUND: %s\n", name);
-    return NULL;
+    RRDSET *st = (RRDSET *)hash_index_search(&host->rrdset_root_index_name, name, (hash)?hash:simple_hash(name));
+    if(st && strcmp(st->magic, RRDSET_MAGIC) != 0)
+        error("Search for RRDSET %s returned an invalid RRDSET %s (name %s)", name, st->id, st->name);
+
+    return st;
 }
 
 inline RRDSET *rrdset_find(RRDHOST *host, const char *id) {
@@ -155,12 +115,13 @@ int rrdset_set_name(RRDSET *st, const char *name) {
 
     if(st->name) {
         rrdset_index_del_name(host, st);
-        st->name = config_set_default(st->config_section, "name", b);
+        string_intern_release(st->name);
+        st->name = string_intern(config_set_default(st->config_section, "name", b));
         st->hash_name = simple_hash(st->name);
         rrdsetvar_rename_all(st);
     }
     else {
-        st->name = config_get(st->config_section, "name", b);
+        st->name = string_intern(config_get(st->config_section, "name", b));
         st->hash_name = simple_hash(st->name);
     }
 
@@ -238,6 +199,10 @@ inline void rrdset_update_heterogeneous_flag(RRDSET *st) {
 void rrdset_reset(RRDSET *st) {
     debug(D_RRD_CALLS, "rrdset_reset() %s", st->name);
 
+    // the slots will be written again from the first one
+    // so the readers should consider all of them overwritten
+    rrdset_ring_write_begin(st);
+
     st->last_collected_time.tv_sec = 0;
     st->last_collected_time.tv_usec = 0;
     st->last_updated.tv_sec = 0;
@@ -250,9 +215,140 @@ void rrdset_reset(RRDSET *st) {
     rrddim_foreach_read(rd, st) {
         rd->last_collected_time.tv_sec = 0;
         rd->last_collected_time.tv_usec = 0;
-        rd->collections_counter = 0;
+        rrddim_collection(rd, collections_counter) = 0;
         // memset(rd->values, 0, rd->entries * sizeof(storage_number));
     }
+
+    rrdset_ring_write_end(st, (size_t)st->entries);
+}
+
+// ----------------------------------------------------------------------------
+// RRDSET - lock-free readers
+
+// copy the state of the round robin database of the chart
+// returns the seq to give to rrdset_ring_overwritten()
+size_t rrdset_ring_snapshot(RRDSET *st, struct rrdset_tier *ring) {
+    size_t seq;
+
+    for(;;) {
+        seq = rrdset_seq_load(st);
+
+        if(likely(!(seq & 1))) {
+            ring->update_every  = st->update_every;
+            ring->entries       = st->entries;
+            ring->current_entry = st->current_entry;
+            ring->counter       = st->counter;
+            ring->last_updated  = st->last_updated;
+
+            rrdset_seq_fence();
+            if(likely(rrdset_seq_load(st) == seq))
+                return seq;
+        }
+
+        // the data collection thread is storing a slot
+        sched_yield();
+    }
+}
+
+// check if the slots read since the snapshot, down to oldest_slot, have been overwritten
+int rrdset_ring_overwritten(RRDSET *st, struct rrdset_tier *ring, size_t seq, long oldest_slot) {
+    rrdset_seq_fence();
+    size_t now = rrdset_seq_load(st);
+
+    if(likely(now == seq))
+        return 0;
+
+    // a slot is being stored now - count it
+    size_t stored = (now + 1) / 2 - seq / 2;
+
+    // the slots are stored starting from ring->current_entry
+    // the oldest slot read is the last one to be overwritten
+    long distance = oldest_slot - ring->current_entry;
+    if(distance < 0) distance += ring->entries;
+
+    return (stored > (size_t)distance) ? 1 : 0;
+}
+
+// ----------------------------------------------------------------------------
+// RRDSET - the collection state of the dimensions
+// the caller has to write lock the chart
+
+void rrdset_collection_add(RRDSET *st, RRDDIM *rd) {
+    struct rrdset_collection *c = &st->collection;
+
+    if(unlikely(c->used == c->size)) {
+        c->size = (c->size) ? c->size * 2 : 8;
+
+        c->rd                    = reallocz(c->rd,                    c->size * sizeof(RRDDIM *));
+        c->updated               = reallocz(c->updated,               c->size * sizeof(uint8_t));
+        c->collections_counter   = reallocz(c->collections_counter,   c->size * sizeof(size_t));
+        c->algorithm             = reallocz(c->algorithm,             c->size * sizeof(RRD_ALGORITHM));
+        c->multiplier            = reallocz(c->multiplier,            c->size * sizeof(calculated_number));
+        c->divisor               = reallocz(c->divisor,               c->size * sizeof(calculated_number));
+        c->collected_value       = reallocz(c->collected_value,       c->size * sizeof(collected_number));
+        c->last_collected_value  = reallocz(c->last_collected_value,  c->size * sizeof(collected_number));
+        c->calculated_value      = reallocz(c->calculated_value,      c->size * sizeof(calculated_number));
+        c->last_calculated_value = reallocz(c->last_calculated_value, c->size * sizeof(calculated_number));
+    }
+
+    size_t i = c->used++;
+    rd->collection_slot = i;
+
+    c->rd[i] = rd;
+    c->updated[i] = 0;
+    c->collections_counter[i] = (rrdset_flag_check(st, RRDSET_FLAG_STORE_FIRST)) ? 1 : 0;
+    c->algorithm[i] = rd->algorithm;
+    c->multiplier[i] = (calculated_number)rd->multiplier;
+    c->divisor[i] = (calculated_number)rd->divisor;
+    c->collected_value[i] = 0;
+    c->last_collected_value[i] = 0;
+    c->calculated_value[i] = 0;
+    c->last_calculated_value[i] = 0;
+}
+
+// the last slot is moved to the place of the removed one, to keep the arrays dense
+void rrdset_collection_del(RRDSET *st, RRDDIM *rd) {
+    struct rrdset_collection *c = &st->collection;
+    size_t i = rd->collection_slot, last = c->used - 1;
+
+    if(unlikely(i >= c->used || c->rd[i] != rd)) {
+        error("Request to remove dimension '%s.%s' from the collection state, but it is not there.", st->id, rd->name);
+        return;
+    }
+
+    if(i != last) {
+        c->rd[i]                    = c->rd[last];
+        c->updated[i]               = c->updated[last];
+        c->collections_counter[i]   = c->collections_counter[last];
+        c->algorithm[i]             = c->algorithm[last];
+        c->multiplier[i]            = c->multiplier[last];
+        c->divisor[i]               = c->divisor[last];
+        c->collected_value[i]       = c->collected_value[last];
+        c->last_collected_value[i]  = c->last_collected_value[last];
+        c->calculated_value[i]      = c->calculated_value[last];
+        c->last_calculated_value[i] = c->last_calculated_value[last];
+
+        c->rd[i]->collection_slot = i;
+    }
+
+    c->used--;
+}
+
+void rrdset_collection_free(RRDSET *st) {
+    struct rrdset_collection *c = &st->collection;
+
+    freez(c->rd);
+    freez(c->updated);
+    freez(c->collections_counter);
+    freez(c->algorithm);
+    freez(c->multiplier);
+    freez(c->divisor);
+    freez(c->collected_value);
+    freez(c->last_collected_value);
+    freez(c->calculated_value);
+    freez(c->last_calculated_value);
+
+    memset(c, 0, sizeof(struct rrdset_collection));
 }
 
 // ----------------------------------------------------------------------------
@@ -262,7 +358,7 @@ inline long align_entries_to_pagesize(RRD_MEMORY_MODE mode, long entries) {
     if(unlikely(entries < 5)) entries = 5;
     if(unlikely(entries > RRD_HISTORY_ENTRIES_MAX)) entries = RRD_HISTORY_ENTRIES_MAX;
 
-    if(unlikely(mode == RRD_MEMORY_MODE_NONE || mode == RRD_MEMORY_MODE_ALLOC))
+    if(unlikely(mode == RRD_MEMORY_MODE_NONE || mode == RRD_MEMORY_MODE_ALLOC || mode == RRD_MEMORY_MODE_TIERED || rrd_memory_mode_has_pages(mode)))
         return entries;
 
     long page = (size_t)sysconf(_SC_PAGESIZE);
@@ -295,6 +391,52 @@ static inline void last_updated_time_align(RRDSET *st) {
 // ----------------------------------------------------------------------------
 // RRDSET - free a chart
 
+// free the memory of a chart that has been removed from its host
+// called by rrdset_free(), or by the last query reading the chart
+void rrdset_free_deferred(RRDSET *st) {
+    RRDHOST *host = st->rrdhost;
+
+    debug(D_RRD_CALLS, "RRDSET: freeing the memory of chart '%s' of host '%s'", st->id, host->hostname);
+
+    rrdr_cache_free_chart(st);
+
+    while(st->dimensions) rrddim_free(st, st->dimensions);
+    rrdset_collection_free(st);
+    hash_index_destroy(&st->dimensions_index);
+
+    hibenchmarks_rwlock_destroy(&st->rrdset_rwlock);
+
+    // free directly allocated members
+    slab_set_freez_string(&host->slabs, st->config_section);
+
+    string_intern_release(st->id);
+    string_intern_release(st->name);
+    string_intern_release(st->family);
+    string_intern_release(st->units);
+    string_intern_release(st->context);
+    string_intern_release(st->plugin_name);
+    string_intern_release(st->module_name);
+
+    switch(st->rrd_memory_mode) {
+        case RRD_MEMORY_MODE_SAVE:
+        case RRD_MEMORY_MODE_MAP:
+        case RRD_MEMORY_MODE_RAM:
+            debug(D_RRD_CALLS, "Unmapping stats '%s'.", st->name);
+            munmap(st, st->memsize);
+            break;
+
+        case RRD_MEMORY_MODE_ALLOC:
+        case RRD_MEMORY_MODE_NONE:
+        case RRD_MEMORY_MODE_TIERED:
+        case RRD_MEMORY_MODE_COMPRESSED:
+        case RRD_MEMORY_MODE_DBENGINE:
+            slab_set_freez(&host->slabs, st, st->memsize);
+            break;
+    }
+
+    __sync_sub_and_fetch(&host->rrdset_deferred, 1);
+}
+
 void rrdset_free(RRDSET *st) {
     if(unlikely(!st)) return;
 
@@ -314,11 +456,14 @@ void rrdset_free(RRDSET *st) {
     rrdset_index_del_name(host, st);
 
     // ------------------------------------------------------------------------
-    // free its children structures
+    // free the structures it has linked to the host
 
     while(st->variables)  rrdsetvar_free(st->variables);
     while(st->alarms)     rrdsetcalc_unlink(st->alarms);
-    while(st->dimensions) rrddim_free(st, st->dimensions);
+
+    RRDDIM *rd;
+    for(rd = st->dimensions; rd ; rd = rd->next)
+        while(rd->variables) rrddimvar_free(rd->variables);
 
     rrdfamily_free(host, st->rrdfamily);
 
@@ -344,28 +489,12 @@ void rrdset_free(RRDSET *st) {
     rrdset_unlock(st);
 
     // ------------------------------------------------------------------------
-    // free it
+    // free it, now or when the last query reading it finishes
 
-    hibenchmarks_rwlock_destroy(&st->rrdset_rwlock);
-
-    // free directly allocated members
-    freez(st->config_section);
-    freez(st->plugin_name);
-    freez(st->module_name);
-
-    switch(st->rrd_memory_mode) {
-        case RRD_MEMORY_MODE_SAVE:
-        case RRD_MEMORY_MODE_MAP:
-        case RRD_MEMORY_MODE_RAM:
-            debug(D_RRD_CALLS, "Unmapping stats '%s'.", st->name);
-            munmap(st, st->memsize);
-            break;
+    __sync_add_and_fetch(&host->rrdset_deferred, 1);
 
-        case RRD_MEMORY_MODE_ALLOC:
-        case RRD_MEMORY_MODE_NONE:
-            freez(st);
-            break;
-    }
+    if(likely(rrdset_readers_add(st, RRDSET_READERS_FREED) == RRDSET_READERS_FREED))
+        rrdset_free_deferred(st);
 }
 
 void rrdset_save(RRDSET *st) {
@@ -384,6 +513,10 @@ void rrdset_save(RRDSET *st) {
             debug(D_RRD_STATS, "Saving dimension '%s' to '%s'.", rd->name, rd->cache_filename);
             memory_file_save(rd->cache_filename, rd, rd->memsize);
         }
+        else if(rd->rrdeng_metric) {
+            debug(D_RRD_STATS, "Saving dimension '%s' to the dbengine.", rd->name);
+            rrddim_pages_flush(rd);
+        }
     }
 }
 
@@ -441,6 +574,7 @@ RRDSET *rrdset_create_custom(
         , RRDSET_TYPE chart_type
         , RRD_MEMORY_MODE memory_mode
         , long history_entries
+        , RRD_STORAGE_FORMAT storage_format
 ) {
     if(!type || !type[0]) {
         fatal("Cannot create rrd stats without a type: id '%s', name '%s', family '%s', context '%s', title '%s', units '%s', plugin '%s', module '%s'."
@@ -511,6 +645,12 @@ RRDSET *rrdset_create_custom(
     int enabled = config_get_boolean(config_section, "enabled", 1);
     if(!enabled) entries = 5;
 
+    storage_format = rrd_storage_format_id(config_get(config_section, "storage format", rrd_storage_format_name(storage_format)));
+    if(storage_format == RRD_STORAGE_FORMAT_64BIT && rrd_memory_mode_has_pages(memory_mode)) {
+        info("Chart '%s' cannot use storage format %s with memory mode %s. Using %s.", fullid, RRD_STORAGE_FORMAT_64BIT_NAME, rrd_memory_mode_name(memory_mode), RRD_STORAGE_FORMAT_32BIT_NAME);
+        storage_format = RRD_STORAGE_FORMAT_32BIT;
+    }
+
     unsigned long size = sizeof(RRDSET);
     char *cache_dir = rrdset_cache_dir(host, fullid, config_section);
 
@@ -531,12 +671,12 @@ RRDSET *rrdset_create_custom(
         );
 
         if(st) {
-            memset(&st->avl, 0, sizeof(avl));
-            memset(&st->avlname, 0, sizeof(avl));
             memset(&st->rrdvar_root_index, 0, sizeof(avl_tree_lock));
-            memset(&st->dimensions_index, 0, sizeof(avl_tree_lock));
+            memset(&st->dimensions_index, 0, sizeof(HASH_INDEX));
+            memset(&st->collection, 0, sizeof(struct rrdset_collection));
             memset(&st->rrdset_rwlock, 0, sizeof(hibenchmarks_rwlock_t));
 
+            st->id = NULL;
             st->name = NULL;
             st->config_section = NULL;
             st->type = NULL;
@@ -563,7 +703,7 @@ RRDSET *rrdset_create_custom(
                     info("Initializing file %s.", fullfilename);
                     memset(st, 0, size);
                 }
-                else if(strcmp(st->id, fullid) != 0) {
+                else if(strncmp(st->cache_id, fullid, RRD_ID_LENGTH_MAX) != 0) {
                     error("File %s contents are not for chart %s. Clearing it.", fullfilename, fullid);
                     // munmap(st, size);
                     // st = NULL;
@@ -577,6 +717,10 @@ RRDSET *rrdset_create_custom(
                     error("File %s does not have the desired update frequency. Clearing it.", fullfilename);
                     memset(st, 0, size);
                 }
+                else if(st->storage_format != storage_format) {
+                    error("File %s does not have the desired storage format. Clearing it.", fullfilename);
+                    memset(st, 0, size);
+                }
                 else if((now - st->last_updated.tv_sec) > update_every * entries) {
                     error("File %s is too old. Clearing it.", fullfilename);
                     memset(st, 0, size);
@@ -600,25 +744,34 @@ RRDSET *rrdset_create_custom(
     }
 
     if(unlikely(!st)) {
-        st = callocz(1, size);
-        st->rrd_memory_mode = (memory_mode == RRD_MEMORY_MODE_NONE) ? RRD_MEMORY_MODE_NONE : RRD_MEMORY_MODE_ALLOC;
+        st = slab_set_callocz(&host->slabs, size);
+        st->rrd_memory_mode = (memory_mode == RRD_MEMORY_MODE_NONE || memory_mode == RRD_MEMORY_MODE_TIERED || rrd_memory_mode_has_pages(memory_mode)) ? memory_mode : RRD_MEMORY_MODE_ALLOC;
     }
 
-    st->plugin_name = plugin?strdup(plugin):NULL;
-    st->module_name = module?strdup(module):NULL;
+    st->plugin_name = string_intern(plugin);
+    st->module_name = string_intern(module);
 
-    st->config_section = strdup(config_section);
+    st->config_section = slab_set_strdupz(&host->slabs, config_section);
     st->rrdhost = host;
     st->memsize = size;
     st->entries = entries;
     st->update_every = update_every;
+    st->storage_format = storage_format;
+
+    // these may have been loaded from disk
+    st->seq = 0;
+    st->readers = 0;
 
     if(st->current_entry >= st->entries) st->current_entry = 0;
 
+    if(rrdset_has_tiers(st))
+        rrdset_tiers_init(st);
+
     strcpy(st->cache_filename, fullfilename);
     strcpy(st->magic, RRDSET_MAGIC);
+    strncpyz(st->cache_id, fullid, RRD_ID_LENGTH_MAX);
 
-    strcpy(st->id, fullid);
+    st->id = string_intern(fullid);
     st->hash = simple_hash(st->id);
 
     st->cache_dir = cache_dir;
@@ -626,14 +779,19 @@ RRDSET *rrdset_create_custom(
     st->chart_type = rrdset_type_id(config_get(st->config_section, "chart type", rrdset_type_name(chart_type)));
     st->type       = config_get(st->config_section, "type", type);
 
-    st->family     = config_get(st->config_section, "family", family?family:st->type);
-    json_fix_string(st->family);
+    char *s;
+
+    s = config_get(st->config_section, "family", family?family:st->type);
+    json_fix_string(s);
+    st->family = string_intern(s);
 
-    st->units      = config_get(st->config_section, "units", units?units:"");
-    json_fix_string(st->units);
+    s = config_get(st->config_section, "units", units?units:"");
+    json_fix_string(s);
+    st->units = string_intern(s);
 
-    st->context    = config_get(st->config_section, "context", context?context:st->id);
-    json_fix_string(st->context);
+    s = config_get(st->config_section, "context", context?context:st->id);
+    json_fix_string(s);
+    st->context = string_intern(s);
     st->hash_context = simple_hash(st->context);
 
     st->priority = config_get_number(st->config_section, "priority", priority);
@@ -665,7 +823,7 @@ RRDSET *rrdset_create_custom(
     st->last_accessed_time = 0;
     st->upstream_resync_time = 0;
 
-    avl_init_lock(&st->dimensions_index, rrddim_compare);
+    hash_index_init(&st->dimensions_index, offsetof(RRDDIM, id));
     avl_init_lock(&st->rrdvar_root_index, rrdvar_compare);
 
     hibenchmarks_rwlock_init(&st->rrdset_rwlock);
@@ -821,6 +979,8 @@ static inline usec_t rrdset_update_last_collected_time(RRDSET *st) {
 }
 
 static inline usec_t rrdset_init_last_updated_time(RRDSET *st) {
+    rrdset_ring_write_begin(st);
+
     // copy the last collected time to last updated time
     st->last_updated.tv_sec  = st->last_collected_time.tv_sec;
     st->last_updated.tv_usec = st->last_collected_time.tv_usec;
@@ -830,6 +990,9 @@ static inline usec_t rrdset_init_last_updated_time(RRDSET *st) {
 
     last_updated_time_align(st);
 
+    // the time of all the slots changed
+    rrdset_ring_write_end(st, (size_t)st->entries);
+
     usec_t last_updated_ut = st->last_updated.tv_sec * USEC_PER_SEC + st->last_updated.tv_usec;
 
     #ifdef HIBENCHMARKS_INTERNAL_CHECKS
@@ -877,7 +1040,8 @@ static inline size_t rrdset_done_interpolate(
         , char store_this_entry
         , uint32_t storage_flags
 ) {
-    RRDDIM *rd;
+    struct rrdset_collection *c = &st->collection;
+    size_t i, used = c->used;
 
     size_t stored_entries = 0;     // the number of entries we have stored in the db, during this call to rrdset_done()
 
@@ -898,13 +1062,16 @@ static inline size_t rrdset_done_interpolate(
 
         last_ut = next_store_ut;
 
-        rrddim_foreach_read(rd, st) {
+        rrdset_ring_write_begin(st);
+
+        for(i = 0; i < used ; i++) {
+            RRDDIM *rd = c->rd[i];
             calculated_number new_value;
 
-            switch(rd->algorithm) {
+            switch(c->algorithm[i]) {
                 case RRD_ALGORITHM_INCREMENTAL:
                     new_value = (calculated_number)
-                            (      rd->calculated_value
+                            (      c->calculated_value[i]
                                    * (calculated_number)(next_store_ut - last_collect_ut)
                                    / (calculated_number)(now_collect_ut - last_collect_ut)
                             );
@@ -917,15 +1084,15 @@ static inline size_t rrdset_done_interpolate(
                                 " / (%llu - %llu)"
                               , rd->name
                               , new_value
-                              , rd->calculated_value
+                              , c->calculated_value[i]
                               , next_store_ut, last_collect_ut
                               , now_collect_ut, last_collect_ut
                     );
                     #endif
 
-                    rd->calculated_value -= new_value;
-                    new_value += rd->last_calculated_value;
-                    rd->last_calculated_value = 0;
+                    c->calculated_value[i] -= new_value;
+                    new_value += c->last_calculated_value[i];
+                    c->last_calculated_value[i] = 0;
                     new_value /= (calculated_number)st->update_every;
 
                     if(unlikely(next_store_ut - last_stored_ut < update_every_ut)) {
@@ -950,18 +1117,18 @@ static inline size_t rrdset_done_interpolate(
                         // do not interpolate
                         // just show the calculated value
 
-                        new_value = rd->calculated_value;
+                        new_value = c->calculated_value[i];
                     }
                     else {
                         // we have missed an update
                         // interpolate in the middle values
 
                         new_value = (calculated_number)
-                                (   (     (rd->calculated_value - rd->last_calculated_value)
+                                (   (     (c->calculated_value[i] - c->last_calculated_value[i])
                                           * (calculated_number)(next_store_ut - last_collect_ut)
                                           / (calculated_number)(now_collect_ut - last_collect_ut)
                                     )
-                                    +  rd->last_calculated_value
+                                    +  c->last_calculated_value[i]
                                 );
 
                         #ifdef HIBENCHMARKS_INTERNAL_CHECKS
@@ -972,9 +1139,9 @@ static inline size_t rrdset_done_interpolate(
                                             " / %llu) + " CALCULATED_NUMBER_FORMAT
                                   , rd->name
                                   , new_value
-                                  , rd->calculated_value, rd->last_calculated_value
+                                  , c->calculated_value[i], c->last_calculated_value[i]
                                   , (next_store_ut - first_ut)
-                                  , (now_collect_ut - first_ut), rd->last_calculated_value
+                                  , (now_collect_ut - first_ut), c->last_calculated_value[i]
                         );
                         #endif
                     }
@@ -982,20 +1149,25 @@ static inline size_t rrdset_done_interpolate(
             }
 
             if(unlikely(!store_this_entry)) {
-                rd->values[current_entry] = SN_EMPTY_SLOT; //pack_storage_number(0, SN_NOT_EXISTS);
+                rrddim_store_value(rd, current_entry, (time_t)(next_store_ut / USEC_PER_SEC), 0, SN_NOT_EXISTS);
                 continue;
             }
 
-            if(likely(rd->updated && rd->collections_counter > 1 && iterations < st->gap_when_lost_iterations_above)) {
-                rd->values[current_entry] = pack_storage_number(new_value, storage_flags );
+            if(likely(c->updated[i] && c->collections_counter[i] > 1 && iterations < st->gap_when_lost_iterations_above)) {
+                rrddim_store_value(rd, current_entry, (time_t)(next_store_ut / USEC_PER_SEC), new_value, storage_flags);
                 rd->last_stored_value = new_value;
 
+                if(unlikely(rd->tiers))
+                    rrddim_tiers_add(rd, new_value);
+
                 #ifdef HIBENCHMARKS_INTERNAL_CHECKS
+                calculated_number stored_value;
+                rrddim_slot_get(rd, current_entry, &stored_value);
                 rrdset_debug(st, "%s: STORE[%ld] "
                             CALCULATED_NUMBER_FORMAT " = " CALCULATED_NUMBER_FORMAT
                           , rd->name
                           , current_entry
-                          , unpack_storage_number(rd->values[current_entry]), new_value
+                          , stored_value, new_value
                 );
                 #endif
 
@@ -1009,7 +1181,7 @@ static inline size_t rrdset_done_interpolate(
                 );
                 #endif
 
-                rd->values[current_entry] = SN_EMPTY_SLOT; // pack_storage_number(0, SN_NOT_EXISTS);
+                rrddim_store_value(rd, current_entry, (time_t)(next_store_ut / USEC_PER_SEC), 0, SN_NOT_EXISTS);
                 rd->last_stored_value = NAN;
             }
 
@@ -1017,15 +1189,16 @@ static inline size_t rrdset_done_interpolate(
 
             #ifdef HIBENCHMARKS_INTERNAL_CHECKS
             if(unlikely(rrdset_flag_check(st, RRDSET_FLAG_DEBUG))) {
-                calculated_number t1 = new_value * (calculated_number)rd->multiplier / (calculated_number)rd->divisor;
-                calculated_number t2 = unpack_storage_number(rd->values[current_entry]);
+                calculated_number t1 = new_value * c->multiplier[i] / c->divisor[i];
+                calculated_number t2;
+                uint32_t t2_flags = rrddim_slot_get(rd, current_entry, &t2);
 
                 calculated_number accuracy = accuracy_loss(t1, t2);
                 debug(D_RRD_STATS, "%s/%s: UNPACK[%ld] = " CALCULATED_NUMBER_FORMAT " FLAGS=0x%08x (original = " CALCULATED_NUMBER_FORMAT ", accuracy loss = " CALCULATED_NUMBER_FORMAT "%%%s)"
                       , st->id, rd->name
                       , current_entry
                       , t2
-                      , get_storage_number_flags(rd->values[current_entry])
+                      , t2_flags
                       , t1
                       , accuracy
                       , (accuracy > ACCURACY_LOSS) ? " **TOO BIG** " : ""
@@ -1049,17 +1222,21 @@ static inline size_t rrdset_done_interpolate(
         // reset the storage flags for the next point, if any;
         storage_flags = SN_EXISTS;
 
+        // roll up the slot we just stored, into the tiers
+        if(unlikely(rrdset_has_tiers(st)))
+            rrdset_tiers_store(st, (time_t)(next_store_ut / USEC_PER_SEC));
+
         counter++;
         current_entry = ((current_entry + 1) >= st->entries) ? 0 : current_entry + 1;
         last_stored_ut = next_store_ut;
-    }
 
-    st->counter = counter;
-    st->current_entry = current_entry;
-
-    if(likely(last_ut)) {
+        // publish the slot to the readers
+        st->counter = counter;
+        st->current_entry = current_entry;
         st->last_updated.tv_sec = (time_t) (last_ut / USEC_PER_SEC);
         st->last_updated.tv_usec = 0;
+
+        rrdset_ring_write_end(st, 1);
     }
 
     return stored_entries;
@@ -1070,13 +1247,16 @@ static inline void rrdset_done_fill_the_gap(RRDSET *st) {
     usec_t now_collect_ut  = st->last_collected_time.tv_sec * USEC_PER_SEC + st->last_collected_time.tv_usec;
 
     long c = 0, entries = st->entries;
+
+    rrdset_ring_write_begin(st);
+
     RRDDIM *rd;
     rrddim_foreach_read(rd, st) {
         usec_t next_store_ut = (st->last_updated.tv_sec + st->update_every) * USEC_PER_SEC;
         long current_entry = st->current_entry;
 
         for(c = 0; c < entries && next_store_ut <= now_collect_ut ; next_store_ut += update_every_ut, c++) {
-            rd->values[current_entry] = SN_EMPTY_SLOT;
+            rrddim_store_value(rd, current_entry, (time_t)(next_store_ut / USEC_PER_SEC), 0, SN_NOT_EXISTS);
             current_entry = ((current_entry + 1) >= entries) ? 0 : current_entry + 1;
 
             #ifdef HIBENCHMARKS_INTERNAL_CHECKS
@@ -1093,6 +1273,8 @@ static inline void rrdset_done_fill_the_gap(RRDSET *st) {
         if(st->current_entry >= st->entries)
             st->current_entry -= st->entries;
     }
+
+    rrdset_ring_write_end(st, (c > 0) ? (size_t)c : 1);
 }
 
 void rrdset_done(RRDSET *st) {
@@ -1107,8 +1289,6 @@ void rrdset_done(RRDSET *st) {
 
     debug(D_RRD_CALLS, "rrdset_done() for chart %s", st->name);
 
-    RRDDIM *rd;
-
     char
             store_this_entry = 1,   // boolean: 1 = store this entry, 0 = don't store this entry
             first_entry = 0;        // boolean: 1 = this is the first entry seen for this chart, 0 = all other entries
@@ -1230,13 +1410,16 @@ void rrdset_done(RRDSET *st) {
     rrdset_debug(st, "next_store_ut   = %0.3" LONG_DOUBLE_MODIFIER " (next interpolation point)", (LONG_DOUBLE)next_store_ut/USEC_PER_SEC);
     #endif
 
-    // calculate totals and count the dimensions
-    int dimensions = 0;
+    // the dimensions are processed in the order of their collection slots
+    rrdset_check_rdlock(st);
+    struct rrdset_collection *c = &st->collection;
+    size_t i, used = c->used;
+
+    // calculate totals
     st->collected_total = 0;
-    rrddim_foreach_read(rd, st) {
-        dimensions++;
-        if(likely(rd->updated))
-            st->collected_total += rd->collected_value;
+    for(i = 0; i < used ; i++) {
+        if(likely(c->updated[i]))
+            st->collected_total += c->collected_value[i];
     }
 
     uint32_t storage_flags = SN_EXISTS;
@@ -1244,10 +1427,11 @@ void rrdset_done(RRDSET *st) {
     // process all dimensions to calculate their values
     // based on the collected figures only
     // at this stage we do not interpolate anything
-    rrddim_foreach_read(rd, st) {
+    for(i = 0; i < used ; i++) {
+        RRDDIM *rd = c->rd[i];
 
-        if(unlikely(!rd->updated)) {
-            rd->calculated_value = 0;
+        if(unlikely(!c->updated[i])) {
+            c->calculated_value[i] = 0;
             continue;
         }
 
@@ -1258,18 +1442,18 @@ void rrdset_done(RRDSET *st) {
                 " last_calculated_value = " CALCULATED_NUMBER_FORMAT
                 " calculated_value = " CALCULATED_NUMBER_FORMAT
                                       , rd->name
-                                      , rd->last_collected_value
-                                      , rd->collected_value
-                                      , rd->last_calculated_value
-                                      , rd->calculated_value
+                                      , c->last_collected_value[i]
+                                      , c->collected_value[i]
+                                      , c->last_calculated_value[i]
+                                      , c->calculated_value[i]
         );
         #endif
 
-        switch(rd->algorithm) {
+        switch(c->algorithm[i]) {
             case RRD_ALGORITHM_ABSOLUTE:
-                rd->calculated_value = (calculated_number)rd->collected_value
-                                       * (calculated_number)rd->multiplier
-                                       / (calculated_number)rd->divisor;
+                c->calculated_value[i] = (calculated_number)c->collected_value[i]
+                                       * c->multiplier[i]
+                                       / c->divisor[i];
 
                 #ifdef HIBENCHMARKS_INTERNAL_CHECKS
                 rrdset_debug(st, "%s: CALC ABS/ABS-NO-IN "
@@ -1278,10 +1462,10 @@ void rrdset_done(RRDSET *st) {
                             " * " CALCULATED_NUMBER_FORMAT
                             " / " CALCULATED_NUMBER_FORMAT
                           , rd->name
-                          , rd->calculated_value
-                          , rd->collected_value
-                          , (calculated_number)rd->multiplier
-                          , (calculated_number)rd->divisor
+                          , c->calculated_value[i]
+                          , c->collected_value[i]
+                          , c->multiplier[i]
+                          , c->divisor[i]
                 );
                 #endif
 
@@ -1289,13 +1473,13 @@ void rrdset_done(RRDSET *st) {
 
             case RRD_ALGORITHM_PCENT_OVER_ROW_TOTAL:
                 if(unlikely(!st->collected_total))
-                    rd->calculated_value = 0;
+                    c->calculated_value[i] = 0;
                 else
                     // the percentage of the current value
                     // over the total of all dimensions
-                    rd->calculated_value =
+                    c->calculated_value[i] =
                             (calculated_number)100
-                            * (calculated_number)rd->collected_value
+                            * (calculated_number)c->collected_value[i]
                             / (calculated_number)st->collected_total;
 
                 #ifdef HIBENCHMARKS_INTERNAL_CHECKS
@@ -1304,8 +1488,8 @@ void rrdset_done(RRDSET *st) {
                             " * " COLLECTED_NUMBER_FORMAT
                             " / " COLLECTED_NUMBER_FORMAT
                           , rd->name
-                          , rd->calculated_value
-                          , rd->collected_value
+                          , c->calculated_value[i]
+                          , c->collected_value[i]
                           , st->collected_total
                 );
                 #endif
@@ -1313,29 +1497,29 @@ void rrdset_done(RRDSET *st) {
                 break;
 
             case RRD_ALGORITHM_INCREMENTAL:
-                if(unlikely(rd->collections_counter <= 1)) {
-                    rd->calculated_value = 0;
+                if(unlikely(c->collections_counter[i] <= 1)) {
+                    c->calculated_value[i] = 0;
                     continue;
                 }
 
                 // if the new is smaller than the old (an overflow, or reset), set the old equal to the new
                 // to reset the calculation (it will give zero as the calculation for this second)
-                if(unlikely(rd->last_collected_value > rd->collected_value)) {
+                if(unlikely(c->last_collected_value[i] > c->collected_value[i])) {
                     debug(D_RRD_STATS, "%s.%s: RESET or OVERFLOW. Last collected value = " COLLECTED_NUMBER_FORMAT ", current = " COLLECTED_NUMBER_FORMAT
                           , st->name, rd->name
-                          , rd->last_collected_value
-                          , rd->collected_value);
+                          , c->last_collected_value[i]
+                          , c->collected_value[i]);
 
                     if(!(rrddim_flag_check(rd, RRDDIM_FLAG_DONT_DETECT_RESETS_OR_OVERFLOWS)))
                         storage_flags = SN_EXISTS_RESET;
 
-                    rd->last_collected_value = rd->collected_value;
+                    c->last_collected_value[i] = c->collected_value[i];
                 }
 
-                rd->calculated_value +=
-                        (calculated_number)(rd->collected_value - rd->last_collected_value)
-                        * (calculated_number)rd->multiplier
-                        / (calculated_number)rd->divisor;
+                c->calculated_value[i] +=
+                        (calculated_number)(c->collected_value[i] - c->last_collected_value[i])
+                        * c->multiplier[i]
+                        / c->divisor[i];
 
                 #ifdef HIBENCHMARKS_INTERNAL_CHECKS
                 rrdset_debug(st, "%s: CALC INC PRE "
@@ -1345,44 +1529,44 @@ void rrdset_done(RRDSET *st) {
                                     " * " CALCULATED_NUMBER_FORMAT
                             " / " CALCULATED_NUMBER_FORMAT
                           , rd->name
-                          , rd->calculated_value
-                          , rd->collected_value, rd->last_collected_value
-                          , (calculated_number)rd->multiplier
-                          , (calculated_number)rd->divisor
+                          , c->calculated_value[i]
+                          , c->collected_value[i], c->last_collected_value[i]
+                          , c->multiplier[i]
+                          , c->divisor[i]
                 );
                 #endif
 
                 break;
 
             case RRD_ALGORITHM_PCENT_OVER_DIFF_TOTAL:
-                if(unlikely(rd->collections_counter <= 1)) {
-                    rd->calculated_value = 0;
+                if(unlikely(c->collections_counter[i] <= 1)) {
+                    c->calculated_value[i] = 0;
                     continue;
                 }
 
                 // if the new is smaller than the old (an overflow, or reset), set the old equal to the new
                 // to reset the calculation (it will give zero as the calculation for this second)
-                if(unlikely(rd->last_collected_value > rd->collected_value)) {
+                if(unlikely(c->last_collected_value[i] > c->collected_value[i])) {
                     debug(D_RRD_STATS, "%s.%s: RESET or OVERFLOW. Last collected value = " COLLECTED_NUMBER_FORMAT ", current = " COLLECTED_NUMBER_FORMAT
                           , st->name, rd->name
-                          , rd->last_collected_value
-                          , rd->collected_value
+                          , c->last_collected_value[i]
+                          , c->collected_value[i]
                     );
 
                     if(!(rrddim_flag_check(rd, RRDDIM_FLAG_DONT_DETECT_RESETS_OR_OVERFLOWS)))
                         storage_flags = SN_EXISTS_RESET;
 
-                    rd->last_collected_value = rd->collected_value;
+                    c->last_collected_value[i] = c->collected_value[i];
                 }
 
                 // the percentage of the current increment
                 // over the increment of all dimensions together
                 if(unlikely(st->collected_total == st->last_collected_total))
-                    rd->calculated_value = 0;
+                    c->calculated_value[i] = 0;
                 else
-                    rd->calculated_value =
+                    c->calculated_value[i] =
                             (calculated_number)100
-                            * (calculated_number)(rd->collected_value - rd->last_collected_value)
+                            * (calculated_number)(c->collected_value[i] - c->last_collected_value[i])
                             / (calculated_number)(st->collected_total - st->last_collected_total);
 
                 #ifdef HIBENCHMARKS_INTERNAL_CHECKS
@@ -1391,8 +1575,8 @@ void rrdset_done(RRDSET *st) {
                             " * (" COLLECTED_NUMBER_FORMAT " - " COLLECTED_NUMBER_FORMAT ")"
                             " / (" COLLECTED_NUMBER_FORMAT " - " COLLECTED_NUMBER_FORMAT ")"
                           , rd->name
-                          , rd->calculated_value
-                          , rd->collected_value, rd->last_collected_value
+                          , c->calculated_value[i]
+                          , c->collected_value[i], c->last_collected_value[i]
                           , st->collected_total, st->last_collected_total
                 );
                 #endif
@@ -1402,13 +1586,13 @@ void rrdset_done(RRDSET *st) {
             default:
                 // make the default zero, to make sure
                 // it gets noticed when we add new types
-                rd->calculated_value = 0;
+                c->calculated_value[i] = 0;
 
                 #ifdef HIBENCHMARKS_INTERNAL_CHECKS
                 rrdset_debug(st, "%s: CALC "
                             CALCULATED_NUMBER_FORMAT " = 0"
                           , rd->name
-                          , rd->calculated_value
+                          , c->calculated_value[i]
                 );
                 #endif
 
@@ -1422,10 +1606,10 @@ void rrdset_done(RRDSET *st) {
                     " last_calculated_value = " CALCULATED_NUMBER_FORMAT
                     " calculated_value = " CALCULATED_NUMBER_FORMAT
                                       , rd->name
-                                      , rd->last_collected_value
-                                      , rd->collected_value
-                                      , rd->last_calculated_value
-                                      , rd->calculated_value
+                                      , c->last_collected_value[i]
+                                      , c->collected_value[i]
+                                      , c->last_calculated_value[i]
+                                      , c->calculated_value[i]
         );
         #endif
 
@@ -1454,24 +1638,26 @@ void rrdset_done(RRDSET *st) {
 
     st->last_collected_total  = st->collected_total;
 
-    rrddim_foreach_read(rd, st) {
-        if(unlikely(!rd->updated))
+    for(i = 0; i < used ; i++) {
+        RRDDIM *rd = c->rd[i];
+        if(unlikely(!c->updated[i]))
             continue;
 
         #ifdef HIBENCHMARKS_INTERNAL_CHECKS
-        rrdset_debug(st, "%s: setting last_collected_value (old: " COLLECTED_NUMBER_FORMAT ") to last_collected_value (new: " COLLECTED_NUMBER_FORMAT ")", rd->name, rd->last_collected_value, rd->collected_value);
+        rrdset_debug(st, "%s: setting last_collected_value (old: " COLLECTED_NUMBER_FORMAT ") to last_collected_value (new: " COLLECTED_NUMBER_FORMAT ")", rd->name, c->last_collected_value[i], c->collected_value[i]);
         #endif
 
-        rd->last_collected_value = rd->collected_value;
+        c->last_collected_value[i] = c->collected_value[i];
+        rd->last_collected_value = c->collected_value[i];
 
-        switch(rd->algorithm) {
+        switch(c->algorithm[i]) {
             case RRD_ALGORITHM_INCREMENTAL:
                 if(unlikely(!first_entry)) {
                     #ifdef HIBENCHMARKS_INTERNAL_CHECKS
-                    rrdset_debug(st, "%s: setting last_calculated_value (old: " CALCULATED_NUMBER_FORMAT ") to last_calculated_value (new: " CALCULATED_NUMBER_FORMAT ")", rd->name, rd->last_calculated_value + rd->calculated_value, rd->calculated_value);
+                    rrdset_debug(st, "%s: setting last_calculated_value (old: " CALCULATED_NUMBER_FORMAT ") to last_calculated_value (new: " CALCULATED_NUMBER_FORMAT ")", rd->name, c->last_calculated_value[i] + c->calculated_value[i], c->calculated_value[i]);
                     #endif
 
-                    rd->last_calculated_value += rd->calculated_value;
+                    c->last_calculated_value[i] += c->calculated_value[i];
                 }
                 else {
                     #ifdef HIBENCHMARKS_INTERNAL_CHECKS
@@ -1484,16 +1670,16 @@ void rrdset_done(RRDSET *st) {
             case RRD_ALGORITHM_PCENT_OVER_ROW_TOTAL:
             case RRD_ALGORITHM_PCENT_OVER_DIFF_TOTAL:
                 #ifdef HIBENCHMARKS_INTERNAL_CHECKS
-                rrdset_debug(st, "%s: setting last_calculated_value (old: " CALCULATED_NUMBER_FORMAT ") to last_calculated_value (new: " CALCULATED_NUMBER_FORMAT ")", rd->name, rd->last_calculated_value, rd->calculated_value);
+                rrdset_debug(st, "%s: setting last_calculated_value (old: " CALCULATED_NUMBER_FORMAT ") to last_calculated_value (new: " CALCULATED_NUMBER_FORMAT ")", rd->name, c->last_calculated_value[i], c->calculated_value[i]);
                 #endif
 
-                rd->last_calculated_value = rd->calculated_value;
+                c->last_calculated_value[i] = c->calculated_value[i];
                 break;
         }
 
-        rd->calculated_value = 0;
-        rd->collected_value = 0;
-        rd->updated = 0;
+        c->calculated_value[i] = 0;
+        c->collected_value[i] = 0;
+        c->updated[i] = 0;
 
         #ifdef HIBENCHMARKS_INTERNAL_CHECKS
         rrdset_debug(st, "%s: END "
@@ -1502,10 +1688,10 @@ void rrdset_done(RRDSET *st) {
                     " last_calculated_value = " CALCULATED_NUMBER_FORMAT
                     " calculated_value = " CALCULATED_NUMBER_FORMAT
                                       , rd->name
-                                      , rd->last_collected_value
-                                      , rd->collected_value
-                                      , rd->last_calculated_value
-                                      , rd->calculated_value
+                                      , c->last_collected_value[i]
+                                      , c->collected_value[i]
+                                      , c->last_calculated_value[i]
+                                      , c->calculated_value[i]
         );
         #endif
 
@@ -76,9 +76,9 @@ static inline void rrdsetvar_create_variables(RRDSETVAR *rs) {
 
 RRDSETVAR *rrdsetvar_create(RRDSET *st, const char *variable, RRDVAR_TYPE type, void *value, RRDVAR_OPTIONS options) {
     debug(D_VARIABLES, "RRDVARSET create for chart id '%s' name '%s' with variable name '%s'", st->id, st->name, variable);
-    RRDSETVAR *rs = (RRDSETVAR *)callocz(1, sizeof(RRDSETVAR));
+    RRDSETVAR *rs = (RRDSETVAR *)slab_set_callocz(&st->rrdhost->slabs, sizeof(RRDSETVAR));
 
-    rs->variable = strdupz(variable);
+    rs->variable = slab_set_strdupz(&st->rrdhost->slabs, variable);
     rs->hash = simple_hash(rs->variable);
     rs->type = type;
     rs->value = value;
@@ -119,12 +119,12 @@ void rrdsetvar_free(RRDSETVAR *rs) {
 
     rrdsetvar_free_variables(rs);
 
-    freez(rs->variable);
+    slab_set_freez_string(&st->rrdhost->slabs, rs->variable);
 
     if(rs->options & RRDVAR_OPTION_ALLOCATED)
         freez(rs->value);
 
-    freez(rs);
+    slab_set_freez(&st->rrdhost->slabs, rs, sizeof(RRDSETVAR));
 }
 
 // --------------------------------------------------------------------------------------------------------------------
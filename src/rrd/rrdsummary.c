@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: GPL-3.0+
+#define HIBENCHMARKS_RRD_INTERNALS 1
+#include "include/common.h"
+
+// ----------------------------------------------------------------------------
+// RRD DIMENSION summaries
+//
+// every block of RRDDIM_SUMMARY_SLOTS slots of the round robin database of a
+// dimension (the last one may be shorter) has a summary of its values. The
+// summary of a block is aggregated while its slots are stored, and published
+// when its last slot is stored, with the time of that slot.
+//
+// Queries use the summary of a block only when its time is the time they
+// expect for its last slot, so the summaries of the blocks being overwritten,
+// or the ones of the blocks that missed a slot, are never used. Since the
+// summary is published with the last slot of the block, the lock-free readers
+// notice that it changed while they read it, the same way they notice that
+// the slot changed (rrdset_ring_overwritten()).
+
+int rrddim_summaries_enabled = 1;
+
+#define rrddim_summary_blocks(entries) (((entries) + RRDDIM_SUMMARY_SLOTS - 1) / RRDDIM_SUMMARY_SLOTS)
+
+void rrddim_summaries_init(RRDSET *st, RRDDIM *rd) {
+    rd->summaries = NULL;
+
+    if(!rrddim_summaries_enabled || st->rrd_memory_mode == RRD_MEMORY_MODE_NONE || st->entries < RRDDIM_SUMMARY_SLOTS)
+        return;
+
+    struct rrddim_summaries *s = callocz(1, sizeof(struct rrddim_summaries));
+    s->blocks = callocz((size_t)rrddim_summary_blocks(st->entries), sizeof(RRDDIM_SUMMARY));
+    s->next_slot = -1;
+    rd->summaries = s;
+
+    // the values loaded from disk (memory modes save and map) are summarized
+    // the way they were stored, from the oldest to the newest
+    if(st->counter && !rd->pages && (rd->rrd_memory_mode == RRD_MEMORY_MODE_SAVE || rd->rrd_memory_mode == RRD_MEMORY_MODE_MAP)) {
+        long c, slot = (long)rrdset_first_slot(st), last_slot = (long)rrdset_last_slot(st);
+        for(c = 0; c < st->entries ; c++) {
+            calculated_number value;
+            uint32_t flags = rrddim_slot_get(rd, slot, &value);
+
+            rrddim_summary_add(rd, slot, rrdset_slot2time(st, slot), (flags) ? value : NAN, (flags == SN_EXISTS_RESET));
+
+            if(slot == last_slot) break;
+            if(++slot >= st->entries) slot = 0;
+        }
+    }
+}
+
+void rrddim_summaries_free(RRDDIM *rd) {
+    if(!rd->summaries)
+        return;
+
+    freez(rd->summaries->blocks);
+    freez(rd->summaries);
+    rd->summaries = NULL;
+}
+
+// ----------------------------------------------------------------------------
+// RRD DIMENSION summaries - data collection
+
+// called by rrddim_store_value() for every slot stored
+// value is NAN when the slot does not exist
+void rrddim_summary_add(RRDDIM *rd, long slot, time_t t, calculated_number value, int reset) {
+    struct rrddim_summaries *s = rd->summaries;
+    RRDDIM_SUMMARY *open = &s->open;
+
+    if(unlikely(!(slot % RRDDIM_SUMMARY_SLOTS))) {
+        // a new block starts - its old summary is not valid any more
+        s->blocks[slot / RRDDIM_SUMMARY_SLOTS].last_t = 0;
+
+        memset(open, 0, sizeof(RRDDIM_SUMMARY));
+        s->open_valid = 1;
+    }
+    else if(unlikely(slot != s->next_slot || t != s->next_t))
+        s->open_valid = 0;
+
+    s->next_slot = slot + 1;
+    s->next_t = t + rd->update_every;
+
+    RRDDIM_SUMMARY v = {
+            .min = value,
+            .max = value,
+            .sum = value,
+            .count = (value == value) ? 1 : 0,
+            .reset = (uint32_t)reset
+    };
+    rrddim_summary_merge(open, &v);
+
+    // the last slot of the block
+    if(unlikely(!((slot + 1) % RRDDIM_SUMMARY_SLOTS) || slot + 1 == rd->entries)) {
+        RRDDIM_SUMMARY *b = &s->blocks[slot / RRDDIM_SUMMARY_SLOTS];
+
+        if(likely(s->open_valid)) {
+            *b = *open;
+            b->last_t = t;
+        }
+        else
+            b->last_t = 0;
+    }
+}
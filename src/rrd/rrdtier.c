@@ -0,0 +1,233 @@
+// SPDX-License-Identifier: GPL-3.0+
+#define HIBENCHMARKS_RRD_INTERNALS 1
+#include "include/common.h"
+
+// ----------------------------------------------------------------------------
+// RRD TIERS
+//
+// with memory mode tiered, every chart keeps its per-second round robin
+// database in RAM (like memory mode ram), and rolls the stored values up
+// into RRD_STORAGE_TIERS downsampled round robin databases, keeping
+// min, max, sum and count for every slot.
+//
+// tier 0 groups RRD_TIER_GROUPING slots of the chart,
+// tier 1 groups RRD_TIER_GROUPING slots of tier 0, etc.
+
+long default_rrd_tier_history_entries[RRD_STORAGE_TIERS] = {
+        RRD_TIER0_DEFAULT_HISTORY_ENTRIES,
+        RRD_TIER1_DEFAULT_HISTORY_ENTRIES
+};
+
+void rrdset_tiers_init(RRDSET *st) {
+    int t, update_every = st->update_every;
+
+    for(t = 0; t < RRD_STORAGE_TIERS ; t++) {
+        struct rrdset_tier *tier = &st->tiers[t];
+
+        update_every *= RRD_TIER_GROUPING;
+
+        tier->update_every = update_every;
+        tier->entries = default_rrd_tier_history_entries[t];
+        if(unlikely(tier->entries < 5)) tier->entries = 5;
+        tier->current_entry = 0;
+        tier->counter = 0;
+        tier->last_updated.tv_sec = 0;
+        tier->last_updated.tv_usec = 0;
+    }
+}
+
+void rrddim_tiers_init(RRDSET *st, RRDDIM *rd) {
+    rd->tiers = NULL;
+
+    if(!rrdset_has_tiers(st))
+        return;
+
+    rd->tiers = callocz(RRD_STORAGE_TIERS, sizeof(struct rrddim_tier));
+
+    int t;
+    for(t = 0; t < RRD_STORAGE_TIERS ; t++)
+        rd->tiers[t].slots = callocz((size_t)st->tiers[t].entries, sizeof(RRD_TIER_SLOT));
+}
+
+void rrddim_tiers_free(RRDDIM *rd) {
+    if(!rd->tiers)
+        return;
+
+    int t;
+    for(t = 0; t < RRD_STORAGE_TIERS ; t++)
+        freez(rd->tiers[t].slots);
+
+    freez(rd->tiers);
+    rd->tiers = NULL;
+}
+
+// ----------------------------------------------------------------------------
+// RRD TIERS - data collection
+
+static inline void rrddim_tier_aggregate(struct rrddim_tier *dt, calculated_number min, calculated_number max, calculated_number sum, uint32_t count) {
+    if(unlikely(!dt->count)) {
+        dt->min = min;
+        dt->max = max;
+        dt->sum = sum;
+        dt->count = count;
+        return;
+    }
+
+    if(min < dt->min) dt->min = min;
+    if(max > dt->max) dt->max = max;
+    dt->sum += sum;
+    dt->count += count;
+}
+
+// called by rrdset_done() for every value stored in the chart round robin database
+inline void rrddim_tiers_add(RRDDIM *rd, calculated_number value) {
+    if(unlikely(isnan(value)))
+        return;
+
+    rrddim_tier_aggregate(&rd->tiers[0], value, value, value, 1);
+}
+
+static inline void rrdset_tier_next_slot(struct rrdset_tier *tier) {
+    tier->counter++;
+    tier->current_entry = ((tier->current_entry + 1) >= tier->entries) ? 0 : tier->current_entry + 1;
+}
+
+static void rrdset_tier_store_slot(RRDSET *st, int t, time_t now) {
+    struct rrdset_tier *tier = &st->tiers[t];
+    RRDDIM *rd;
+
+    // the clock went backwards - keep aggregating in the open slot
+    if(unlikely(now <= tier->last_updated.tv_sec))
+        return;
+
+    // fill the gap, if we missed any slots
+    if(likely(tier->last_updated.tv_sec)) {
+        long c, missing = (long)((now - tier->last_updated.tv_sec) / tier->update_every) - 1;
+        if(unlikely(missing > tier->entries)) missing = tier->entries;
+
+        for(c = 0; c < missing ; c++) {
+            rrddim_foreach_read(rd, st)
+                memset(&rd->tiers[t].slots[tier->current_entry], 0, sizeof(RRD_TIER_SLOT));
+
+            rrdset_tier_next_slot(tier);
+        }
+    }
+
+    rrddim_foreach_read(rd, st) {
+        struct rrddim_tier *dt = &rd->tiers[t];
+        RRD_TIER_SLOT *slot = &dt->slots[tier->current_entry];
+
+        if(likely(dt->count)) {
+            slot->min   = pack_storage_number(dt->min, SN_EXISTS);
+            slot->max   = pack_storage_number(dt->max, SN_EXISTS);
+            slot->sum   = pack_storage_number(dt->sum, SN_EXISTS);
+            slot->count = dt->count;
+
+            // cascade it to the next tier
+            if(t + 1 < RRD_STORAGE_TIERS)
+                rrddim_tier_aggregate(&rd->tiers[t + 1], dt->min, dt->max, dt->sum, dt->count);
+        }
+        else
+            memset(slot, 0, sizeof(RRD_TIER_SLOT));
+
+        dt->min = dt->max = dt->sum = 0;
+        dt->count = 0;
+    }
+
+    rrdset_tier_next_slot(tier);
+    tier->last_updated.tv_sec = now;
+    tier->last_updated.tv_usec = 0;
+}
+
+// called by rrdset_done() after every slot stored in the chart round robin database
+// now is the timestamp of the slot just stored
+void rrdset_tiers_store(RRDSET *st, time_t now) {
+    int t;
+    for(t = 0; t < RRD_STORAGE_TIERS ; t++) {
+        // the slots of the higher tiers are multiples of this one
+        // so if this is not complete, neither are they
+        if(now % st->tiers[t].update_every)
+            break;
+
+        rrdset_tier_store_slot(st, t, now);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// RRD TIERS - queries
+
+time_t rrdset_tiers_first_entry_t(RRDSET *st) {
+    time_t first_entry_t = rrdset_first_entry_t(st);
+
+    // the dbengine keeps on disk the pages rotated out of the round robin database
+    if(rrdset_has_dbengine(st)) {
+        time_t disk_first_t = rrdeng_first_entry_t(st);
+        if(disk_first_t && disk_first_t - st->update_every < first_entry_t)
+            first_entry_t = disk_first_t - st->update_every;
+    }
+
+    if(!rrdset_has_tiers(st))
+        return first_entry_t;
+
+    int t;
+    for(t = 0; t < RRD_STORAGE_TIERS ; t++) {
+        struct rrdset_tier *tier = &st->tiers[t];
+        if(unlikely(!tier->counter)) continue;
+
+        time_t tier_first_t = rrdset_first_entry_t(tier);
+        if(tier_first_t < first_entry_t) first_entry_t = tier_first_t;
+    }
+
+    return first_entry_t;
+}
+
+// find the tier that should answer a query
+// returns NULL when the chart round robin database should be used
+//
+// the chart round robin database is preferred when it has all the data
+// requested (so that alarms and short dashboard queries get the exact data).
+// otherwise the coarsest tier that can still provide the points requested is used.
+struct rrdset_tier *rrdset_tier_for_query(RRDSET *st, time_t after, time_t before, long points, int *tier_id) {
+    if(!rrdset_has_tiers(st) || after >= rrdset_first_entry_t(st))
+        return NULL;
+
+    // when all the points are requested, only the finest tier can satisfy them
+    if(points < 0) points = -points;
+    time_t group_duration = (points) ? (before - after) / points : 0;
+
+    int t;
+    struct rrdset_tier *tier;
+
+    // the coarsest tier that has the data and satisfies the points
+    for(t = RRD_STORAGE_TIERS - 1; t >= 0 ; t--) {
+        tier = &st->tiers[t];
+        if(unlikely(!tier->counter)) continue;
+
+        if(tier->update_every <= group_duration && rrdset_first_entry_t(tier) <= after) {
+            *tier_id = t;
+            return tier;
+        }
+    }
+
+    // the finest tier that has the data
+    for(t = 0; t < RRD_STORAGE_TIERS ; t++) {
+        tier = &st->tiers[t];
+        if(unlikely(!tier->counter)) continue;
+
+        if(rrdset_first_entry_t(tier) <= after) {
+            *tier_id = t;
+            return tier;
+        }
+    }
+
+    // the tier that goes back the most
+    for(t = RRD_STORAGE_TIERS - 1; t >= 0 ; t--) {
+        tier = &st->tiers[t];
+        if(likely(tier->counter)) {
+            *tier_id = t;
+            return tier;
+        }
+    }
+
+    return NULL;
+}
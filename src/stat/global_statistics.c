@@ -14,6 +14,21 @@ volatile struct global_statistics global_statistics = {
 
 hibenchmarks_mutex_t global_statistics_mutex = HIBENCHMARKS_MUTEX_INITIALIZER;
 
+static struct web_worker_statistics *web_workers_statistics = NULL;
+static volatile size_t web_workers_statistics_count = 0;
+
+// the id of the web server worker of the running thread, -1 when it is not one
+__thread int web_worker_statistics_id = -1;
+
+// called once, before the workers are started
+void web_workers_statistics_init(size_t workers) {
+    if(web_workers_statistics_count || !workers) return;
+
+    web_workers_statistics = callocz(workers, sizeof(struct web_worker_statistics));
+    __sync_synchronize();
+    web_workers_statistics_count = workers;
+}
+
 inline void global_statistics_lock(void) {
     hibenchmarks_mutex_lock(&global_statistics_mutex);
 }
@@ -56,6 +71,9 @@ void finished_web_request_statistics(uint64_t dt,
     if (web_server_is_multithreaded)
         global_statistics_unlock();
 #endif
+
+    if(web_worker_statistics_id >= 0)
+        web_workers_statistics[web_worker_statistics_id].requests++;
 }
 
 uint64_t web_client_connected(void) {
@@ -73,6 +91,9 @@ uint64_t web_client_connected(void) {
         global_statistics_unlock();
 #endif
 
+    if(web_worker_statistics_id >= 0)
+        web_workers_statistics[web_worker_statistics_id].connections++;
+
     return id;
 }
 
@@ -284,6 +305,69 @@ void global_statistics_charts(void) {
 
     // ----------------------------------------------------------------
 
+    if(web_workers_statistics_count) {
+        static RRDSET *st_workers_connections = NULL, *st_workers_requests = NULL;
+        static RRDDIM **rd_workers_connections = NULL, **rd_workers_requests = NULL;
+        size_t i, workers = web_workers_statistics_count;
+
+        if (unlikely(!st_workers_connections)) {
+            st_workers_connections = rrdset_create_localhost(
+                    "hibenchmarks"
+                    , "web_workers_connections"
+                    , NULL
+                    , "hibenchmarks"
+                    , NULL
+                    , "HiBenchmarks Web Server Connections per Worker"
+                    , "connections/s"
+                    , "hibenchmarks"
+                    , "stats"
+                    , 130310
+                    , localhost->rrd_update_every
+                    , RRDSET_TYPE_STACKED
+            );
+
+            st_workers_requests = rrdset_create_localhost(
+                    "hibenchmarks"
+                    , "web_workers_requests"
+                    , NULL
+                    , "hibenchmarks"
+                    , NULL
+                    , "HiBenchmarks Web Server Requests per Worker"
+                    , "requests/s"
+                    , "hibenchmarks"
+                    , "stats"
+                    , 130320
+                    , localhost->rrd_update_every
+                    , RRDSET_TYPE_STACKED
+            );
+
+            rd_workers_connections = callocz(workers, sizeof(RRDDIM *));
+            rd_workers_requests = callocz(workers, sizeof(RRDDIM *));
+
+            for(i = 0; i < workers ; i++) {
+                char id[50 + 1];
+                snprintfz(id, 50, "worker%zu", i + 1);
+
+                rd_workers_connections[i] = rrddim_add(st_workers_connections, id, NULL, 1, 1, RRD_ALGORITHM_INCREMENTAL);
+                rd_workers_requests[i] = rrddim_add(st_workers_requests, id, NULL, 1, 1, RRD_ALGORITHM_INCREMENTAL);
+            }
+        }
+        else {
+            rrdset_next(st_workers_connections);
+            rrdset_next(st_workers_requests);
+        }
+
+        for(i = 0; i < workers ; i++) {
+            rrddim_set_by_pointer(st_workers_connections, rd_workers_connections[i], (collected_number)web_workers_statistics[i].connections);
+            rrddim_set_by_pointer(st_workers_requests, rd_workers_requests[i], (collected_number)web_workers_statistics[i].requests);
+        }
+
+        rrdset_done(st_workers_connections);
+        rrdset_done(st_workers_requests);
+    }
+
+    // ----------------------------------------------------------------
+
     {
         static RRDSET *st_bytes = NULL;
         static RRDDIM *rd_in = NULL,
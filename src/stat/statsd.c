@@ -1477,6 +1477,7 @@ static inline RRDSET *statsd_private_rrdset_create(
             , chart_type      // chart type
             , memory_mode     // memory mode
             , history         // history
+            , RRD_STORAGE_FORMAT_32BIT // storage format
     );
     rrdset_flag_set(st, RRDSET_FLAG_STORE_FIRST);
 
@@ -2015,6 +2016,7 @@ static inline void statsd_update_app_chart(STATSD_APP *app, STATSD_APP_CHART *ch
                 , chart->chart_type         // chart type
                 , app->rrd_memory_mode      // memory mode
                 , app->rrd_history_entries  // history
+                , RRD_STORAGE_FORMAT_32BIT  // storage format
         );
 
         rrdset_flag_set(chart->st, RRDSET_FLAG_STORE_FIRST);
@@ -1,7 +1,7 @@
 // SPDX-License-Identifier: GPL-3.0+
 #include "include/common.h"
 
-storage_number pack_storage_number(calculated_number value, uint32_t flags)
+static inline storage_number pack_storage_number_one(calculated_number value, uint32_t flags)
 {
     // bit 32 = sign 0:positive, 1:negative
     // bit 31 = 0:divide, 1:multiply
@@ -70,7 +70,7 @@ storage_number pack_storage_number(calculated_number value, uint32_t flags)
     return r;
 }
 
-calculated_number unpack_storage_number(storage_number value)
+static inline calculated_number unpack_storage_number_one(storage_number value)
 {
     if(!value) return 0;
 
@@ -105,6 +105,191 @@ calculated_number unpack_storage_number(storage_number value)
     return n;
 }
 
+storage_number pack_storage_number(calculated_number value, uint32_t flags)
+{
+    return pack_storage_number_one(value, flags);
+}
+
+calculated_number unpack_storage_number(storage_number value)
+{
+    return unpack_storage_number_one(value);
+}
+
+// ----------------------------------------------------------------------------
+// batch pack / unpack
+//
+// the x87 long double of calculated_number has no vector instructions, so the
+// default build uses the portable loops. When hibenchmarks is compiled with
+// HIBENCHMARKS_WITHOUT_LONG_DOUBLE on x86_64, AVX2 versions are selected at
+// runtime, if the CPU supports them. Both give the same results as
+// pack_storage_number() and unpack_storage_number().
+
+static void pack_storage_number_batch_portable(const calculated_number *values, storage_number *out, size_t entries, uint32_t flags) {
+    size_t i;
+    for(i = 0; i < entries ; i++)
+        out[i] = pack_storage_number_one(values[i], flags);
+}
+
+static void unpack_storage_number_batch_portable(const storage_number *values, calculated_number *out, size_t entries) {
+    size_t i;
+    for(i = 0; i < entries ; i++)
+        out[i] = (likely(does_storage_number_exist(values[i]))) ? unpack_storage_number_one(values[i]) : NAN;
+}
+
+#if defined(HIBENCHMARKS_WITHOUT_LONG_DOUBLE) && defined(__x86_64__) && defined(__GNUC__)
+#define STORAGE_NUMBER_AVX2 1
+#include <immintrin.h>
+
+// the 32-bit low halves of 4 64-bit lanes
+__attribute__((target("avx2")))
+static inline __m128i avx2_epi64_to_epi32(__m256i x) {
+    return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(x, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)));
+}
+
+// the lanes step by 10 like the loops of pack_storage_number() and
+// unpack_storage_number(), so that they round the same way
+__attribute__((target("avx2")))
+static void pack_storage_number_batch_avx2(const calculated_number *values, storage_number *out, size_t entries, uint32_t flags) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d ten = _mm256_set1_pd(10.0);
+    const __m256d sign_bit = _mm256_set1_pd(-0.0);
+    const __m256d max = _mm256_set1_pd((double)0x00ffffff);
+    const __m256d small = _mm256_set1_pd((double)0x0019999e);
+    const __m128i r_flags = _mm_set1_epi32((int)get_storage_number_flags(flags));
+    size_t i = 0;
+    int k;
+
+    for(; i + 4 <= entries ; i += 4) {
+        __m256d v = _mm256_loadu_pd(&values[i]);
+        __m256d n = _mm256_andnot_pd(sign_bit, v);
+
+        // divide the big ones by 10 up to 7 times, multiply the small ones
+        __m256d is_big = _mm256_cmp_pd(n, max, _CMP_GT_OQ);
+        __m256i m = _mm256_setzero_si256();
+
+        for(k = 0; k < 7 ; k++) {
+            __m256d divide   = _mm256_and_pd(is_big, _mm256_cmp_pd(n, max, _CMP_GT_OQ));
+            __m256d multiply = _mm256_andnot_pd(is_big, _mm256_cmp_pd(n, small, _CMP_LT_OQ));
+
+            n = _mm256_blendv_pd(n, _mm256_div_pd(n, ten), divide);
+            n = _mm256_blendv_pd(n, _mm256_mul_pd(n, ten), multiply);
+
+            // compare masks are -1, so subtracting them counts them
+            m = _mm256_sub_epi64(m, _mm256_castpd_si256(_mm256_or_pd(divide, multiply)));
+        }
+
+        // the numbers that are too big are stored as 0x00ffffff
+        n = _mm256_blendv_pd(n, _mm256_min_pd(n, max), is_big);
+
+#ifdef STORAGE_WITH_MATH
+        __m128i mantissa = _mm256_cvtpd_epi32(n);
+#else
+        __m128i mantissa = _mm256_cvttpd_epi32(n);
+#endif
+
+        __m128i sign = _mm_slli_epi32(avx2_epi64_to_epi32(_mm256_srli_epi64(_mm256_castpd_si256(v), 63)), 31);
+        __m128i big  = _mm_slli_epi32(_mm_srli_epi32(avx2_epi64_to_epi32(_mm256_castpd_si256(is_big)), 31), 30);
+
+        __m128i r = _mm_or_si128(r_flags, _mm_or_si128(sign, big));
+        r = _mm_or_si128(r, _mm_slli_epi32(avx2_epi64_to_epi32(m), 27));
+        r = _mm_add_epi32(r, mantissa);
+
+        // zero is stored with the flags only
+        __m128i is_zero = avx2_epi64_to_epi32(_mm256_castpd_si256(_mm256_cmp_pd(v, zero, _CMP_EQ_OQ)));
+        r = _mm_blendv_epi8(r, r_flags, is_zero);
+
+        _mm_storeu_si128((__m128i *)&out[i], r);
+    }
+
+    pack_storage_number_batch_portable(&values[i], &out[i], entries - i, flags);
+}
+
+__attribute__((target("avx2")))
+static void unpack_storage_number_batch_avx2(const storage_number *values, calculated_number *out, size_t entries) {
+    const __m128i mantissa_mask = _mm_set1_epi32(0x00ffffff);
+    const __m128i flags_mask = _mm_set1_epi32(7 << 24);
+    const __m256d ten = _mm256_set1_pd(10.0);
+    const __m256d nan = _mm256_set1_pd(NAN);
+    size_t i = 0;
+    int k;
+
+    for(; i + 4 <= entries ; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)&values[i]);
+
+        __m256d n = _mm256_cvtepi32_pd(_mm_and_si128(v, mantissa_mask));
+        __m256i mul = _mm256_cvtepu32_epi64(_mm_and_si128(_mm_srli_epi32(v, 27), _mm_set1_epi32(7)));
+
+        // the multiply bit, and the sign bit, as 64-bit lane masks
+        __m256d is_mul  = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_srai_epi32(_mm_slli_epi32(v, 1), 31)));
+        __m256d is_sign = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_srai_epi32(v, 31)));
+
+        for(k = 0; k < 7 ; k++) {
+            __m256d step = _mm256_castsi256_pd(_mm256_cmpgt_epi64(mul, _mm256_set1_epi64x(k)));
+            n = _mm256_blendv_pd(n, _mm256_blendv_pd(_mm256_div_pd(n, ten), _mm256_mul_pd(n, ten), is_mul), step);
+        }
+
+        n = _mm256_xor_pd(n, _mm256_and_pd(is_sign, _mm256_set1_pd(-0.0)));
+
+        // the slots that do not exist are NAN
+        __m256d missing = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmpeq_epi32(_mm_and_si128(v, flags_mask), _mm_setzero_si128())));
+        n = _mm256_blendv_pd(n, nan, missing);
+
+        _mm256_storeu_pd(&out[i], n);
+    }
+
+    unpack_storage_number_batch_portable(&values[i], &out[i], entries - i);
+}
+
+static int storage_number_avx2 = -1;
+
+static inline int storage_number_has_avx2(void) {
+    if(unlikely(storage_number_avx2 == -1))
+        storage_number_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+
+    return storage_number_avx2;
+}
+#endif
+
+void pack_storage_number_batch(const calculated_number *values, storage_number *out, size_t entries, uint32_t flags) {
+#ifdef STORAGE_NUMBER_AVX2
+    if(likely(storage_number_has_avx2())) {
+        pack_storage_number_batch_avx2(values, out, entries, flags);
+        return;
+    }
+#endif
+
+    pack_storage_number_batch_portable(values, out, entries, flags);
+}
+
+void unpack_storage_number_batch(const storage_number *values, calculated_number *out, size_t entries) {
+#ifdef STORAGE_NUMBER_AVX2
+    if(likely(storage_number_has_avx2())) {
+        unpack_storage_number_batch_avx2(values, out, entries);
+        return;
+    }
+#endif
+
+    unpack_storage_number_batch_portable(values, out, entries);
+}
+
+// ----------------------------------------------------------------------------
+// 64-bit storage numbers
+
+storage_number64 pack_storage_number64(calculated_number value, uint32_t flags)
+{
+    union { double d; uint64_t u; } n = { .d = (double)value };
+
+    // the flags replace the 3 lowest bits of the mantissa
+    // zero is stored with the flags only
+    return (n.u & ~0x7ULL) | ((flags >> 24) & 0x7);
+}
+
+calculated_number unpack_storage_number64(storage_number64 value)
+{
+    union { uint64_t u; double d; } n = { .u = value & ~0x7ULL };
+    return (calculated_number)n.d;
+}
+
 /*
 int print_calculated_number(char *str, calculated_number value)
 {
@@ -162,71 +347,121 @@ int print_calculated_number(char *str, calculated_number value)
 }
 */
 
-int print_calculated_number(char *str, calculated_number value) {
-    // info("printing number " CALCULATED_NUMBER_FORMAT, value);
-    char integral_str[50], fractional_str[50];
+// ----------------------------------------------------------------------------
+// printing calculated numbers
+//
+// Up to 7 fractional digits, without trailing zeros. The digits are written
+// forward, two at a time, so that the queries do not spend their time in
+// divisions and in reversing strings. Integral values, like timestamps and
+// most of the collected values, skip the fractional part completely.
+
+static const char print_number_digits[201] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+static inline int print_number_digits_count(unsigned long long n) {
+    int count = 1;
+
+    for(;;) {
+        if(n < 10ULL) return count;
+        if(n < 100ULL) return count + 1;
+        if(n < 1000ULL) return count + 2;
+        if(n < 10000ULL) return count + 3;
+        n /= 10000ULL;
+        count += 4;
+    }
+}
+
+// writes the last 'len' digits of n at str, zero padded
+static inline char *print_number_digits_forward(char *str, unsigned long long n, int len) {
+    char *wstr = str + len;
 
+    while(len >= 2) {
+        const char *d = &print_number_digits[(n % 100) * 2];
+        n /= 100;
+        *--wstr = d[1];
+        *--wstr = d[0];
+        len -= 2;
+    }
+
+    if(len)
+        *--wstr = (char)('0' + (n % 10));
+
+    return str;
+}
+
+// the integral values that can be printed without the fractional part
+#define PRINT_NUMBER_INTEGRAL_MAX 1000000000000000000.0
+
+int print_calculated_number(char *str, calculated_number value) {
     char *wstr = str;
+    int len;
 
     if(unlikely(value < 0)) {
         *wstr++ = '-';
         value = -value;
     }
 
-    calculated_number integral, fractional;
+    unsigned long long integral_int, fractional_int;
+
+    if(likely(value < PRINT_NUMBER_INTEGRAL_MAX)) {
+        integral_int = (unsigned long long)value;
+        calculated_number integral = (calculated_number)integral_int;
+
+        if(likely(integral == value)) {
+            len = print_number_digits_count(integral_int);
+            print_number_digits_forward(wstr, integral_int, len);
+            wstr += len;
+            *wstr = '\0';
+            return (int)(wstr - str);
+        }
+
+        // the same as modf(), without the function call - the subtraction is exact
+        fractional_int = (unsigned long long)calculated_number_llrint((value - integral) * 10000000.0);
+    }
+    else {
+        calculated_number integral, fractional;
 
 #ifdef STORAGE_WITH_MATH
-    fractional = calculated_number_modf(value, &integral) * 10000000.0;
+        fractional = calculated_number_modf(value, &integral) * 10000000.0;
 #else
-    fractional = ((unsigned long long)(value * 10000000ULL) % 10000000ULL);
+        fractional = ((unsigned long long)(value * 10000000ULL) % 10000000ULL);
 #endif
 
-    unsigned long long integral_int = (unsigned long long)integral;
-    unsigned long long fractional_int = (unsigned long long)calculated_number_llrint(fractional);
+        integral_int = (unsigned long long)integral;
+        fractional_int = (unsigned long long)calculated_number_llrint(fractional);
+    }
+
     if(unlikely(fractional_int >= 10000000)) {
         integral_int += 1;
         fractional_int -= 10000000;
     }
 
-    // info("integral " CALCULATED_NUMBER_FORMAT " (%llu), fractional " CALCULATED_NUMBER_FORMAT " (%llu)", integral, integral_int, fractional, fractional_int);
-
-    char *istre;
-    if(unlikely(integral_int == 0)) {
-        integral_str[0] = '0';
-        istre = &integral_str[1];
-    }
-    else
-        // convert the integral part to string (reversed)
-        istre = print_number_llu_r_smart(integral_str, integral_int);
-
-    // copy reversed the integral string
-    istre--;
-    while( istre >= integral_str ) *wstr++ = *istre--;
+    len = print_number_digits_count(integral_int);
+    print_number_digits_forward(wstr, integral_int, len);
+    wstr += len;
 
     if(likely(fractional_int != 0)) {
-        // add a dot
-        *wstr++ = '.';
-
-        // convert the fractional part to string (reversed)
-        char *fstre = print_number_llu_r_smart(fractional_str, fractional_int);
-
-        // prepend zeros to reach 7 digits length
-        int decimal = 7;
-        int len = (int)(fstre - fractional_str);
-        while(len < decimal) {
-            *wstr++ = '0';
-            len++;
+        // the trailing zeros are not printed
+        len = 7;
+        while(fractional_int % 10 == 0) {
+            fractional_int /= 10;
+            len--;
         }
 
-        char *begin = fractional_str;
-        while(begin < fstre && *begin == '0') begin++;
-
-        // copy reversed the fractional string
-        fstre--;
-        while( fstre >= begin ) *wstr++ = *fstre--;
+        *wstr++ = '.';
+        print_number_digits_forward(wstr, fractional_int, len);
+        wstr += len;
     }
 
     *wstr = '\0';
-    // info("printed number '%s'", str);
     return (int)(wstr - str);
 }
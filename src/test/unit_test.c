@@ -15,6 +15,12 @@ static int check_number_printing(void) {
             { .n = 123.4567890123456789, .correct = "123.456789" },
             { .n = 9999.9999999, .correct = "9999.9999999" },
             { .n = -9999.9999999, .correct = "-9999.9999999" },
+            { .n = 1.05, .correct = "1.05" },
+            { .n = -0.5, .correct = "-0.5" },
+            { .n = 0.9999999999, .correct = "1" },
+            { .n = 1524835127, .correct = "1524835127" },
+            { .n = -100, .correct = "-100" },
+            { .n = 1234567890123.25, .correct = "1234567890123.25" },
             { .n = 0, .correct = NULL },
     };
 
@@ -37,6 +43,45 @@ static int check_number_printing(void) {
     return 0;
 }
 
+// the numbers of a query - timestamps, integers and values with decimals
+static void benchmark_number_printing(int loop) {
+    #define BENCHMARK_PRINTING_VALUES 1024
+    calculated_number values[BENCHMARK_PRINTING_VALUES];
+    char buffer[100];
+    struct rusage now, last;
+    unsigned long long mine, their;
+    size_t bytes = 0;
+    int i, j;
+
+    for(i = 0; i < BENCHMARK_PRINTING_VALUES ;i++) {
+        switch(i % 4) {
+            case 0: values[i] = 1524835127 + i; break;
+            case 1: values[i] = i * 37; break;
+            case 2: values[i] = (calculated_number)i / 7.0; break;
+            default: values[i] = -(calculated_number)i * 1000.0 / 3.0; break;
+        }
+    }
+
+    fprintf(stderr, "\nBenchmarking printing %d numbers of a query\n", loop);
+
+    getrusage(RUSAGE_SELF, &last);
+    for(j = 0; j < loop / BENCHMARK_PRINTING_VALUES ;j++)
+        for(i = 0; i < BENCHMARK_PRINTING_VALUES ;i++)
+            bytes += (size_t)print_calculated_number(buffer, values[i]);
+    getrusage(RUSAGE_SELF, &now);
+    mine = now.ru_utime.tv_sec * 1000000ULL + now.ru_utime.tv_usec - last.ru_utime.tv_sec * 1000000ULL - last.ru_utime.tv_usec;
+
+    getrusage(RUSAGE_SELF, &last);
+    for(j = 0; j < loop / BENCHMARK_PRINTING_VALUES ;j++)
+        for(i = 0; i < BENCHMARK_PRINTING_VALUES ;i++)
+            bytes += (size_t)snprintfz(buffer, 100, CALCULATED_NUMBER_FORMAT, values[i]);
+    getrusage(RUSAGE_SELF, &now);
+    their = now.ru_utime.tv_sec * 1000000ULL + now.ru_utime.tv_usec - last.ru_utime.tv_sec * 1000000ULL - last.ru_utime.tv_usec;
+
+    fprintf(stderr, "    print_calculated_number(): %0.5" LONG_DOUBLE_MODIFIER " sec, snprintf(): %0.5" LONG_DOUBLE_MODIFIER " sec, %0.2" LONG_DOUBLE_MODIFIER " times faster (%zu bytes)\n"
+            , (LONG_DOUBLE)(mine / 1000000.0), (LONG_DOUBLE)(their / 1000000.0), (LONG_DOUBLE)((mine) ? (LONG_DOUBLE)their / (LONG_DOUBLE)mine : 0), bytes);
+}
+
 static int check_rrdcalc_comparisons(void) {
     RRDCALC_STATUS a, b;
 
@@ -204,8 +249,8 @@ void benchmark_storage_number(int loop, int multiplier) {
     }
 
     getrusage(RUSAGE_SELF, &now);
-    user   = now.ru_utime.tv_sec * 1000000ULL + now.ru_utime.tv_usec - last.ru_utime.tv_sec * 1000000ULL + last.ru_utime.tv_usec;
-    system = now.ru_stime.tv_sec * 1000000ULL + now.ru_stime.tv_usec - last.ru_stime.tv_sec * 1000000ULL + last.ru_stime.tv_usec;
+    user   = now.ru_utime.tv_sec * 1000000ULL + now.ru_utime.tv_usec - last.ru_utime.tv_sec * 1000000ULL - last.ru_utime.tv_usec;
+    system = now.ru_stime.tv_sec * 1000000ULL + now.ru_stime.tv_usec - last.ru_stime.tv_sec * 1000000ULL - last.ru_stime.tv_usec;
     total  = user + system;
     mine = total;
 
@@ -228,8 +273,8 @@ void benchmark_storage_number(int loop, int multiplier) {
     }
 
     getrusage(RUSAGE_SELF, &now);
-    user   = now.ru_utime.tv_sec * 1000000ULL + now.ru_utime.tv_usec - last.ru_utime.tv_sec * 1000000ULL + last.ru_utime.tv_usec;
-    system = now.ru_stime.tv_sec * 1000000ULL + now.ru_stime.tv_usec - last.ru_stime.tv_sec * 1000000ULL + last.ru_stime.tv_usec;
+    user   = now.ru_utime.tv_sec * 1000000ULL + now.ru_utime.tv_usec - last.ru_utime.tv_sec * 1000000ULL - last.ru_utime.tv_usec;
+    system = now.ru_stime.tv_sec * 1000000ULL + now.ru_stime.tv_usec - last.ru_stime.tv_sec * 1000000ULL - last.ru_stime.tv_usec;
     total  = user + system;
     their = total;
 
@@ -262,8 +307,8 @@ void benchmark_storage_number(int loop, int multiplier) {
     }
 
     getrusage(RUSAGE_SELF, &now);
-    user   = now.ru_utime.tv_sec * 1000000ULL + now.ru_utime.tv_usec - last.ru_utime.tv_sec * 1000000ULL + last.ru_utime.tv_usec;
-    system = now.ru_stime.tv_sec * 1000000ULL + now.ru_stime.tv_usec - last.ru_stime.tv_sec * 1000000ULL + last.ru_stime.tv_usec;
+    user   = now.ru_utime.tv_sec * 1000000ULL + now.ru_utime.tv_usec - last.ru_utime.tv_sec * 1000000ULL - last.ru_utime.tv_usec;
+    system = now.ru_stime.tv_sec * 1000000ULL + now.ru_stime.tv_usec - last.ru_stime.tv_sec * 1000000ULL - last.ru_stime.tv_usec;
     total  = user + system;
     mine = total;
 
@@ -278,6 +323,69 @@ void benchmark_storage_number(int loop, int multiplier) {
 
     // ------------------------------------------------------------------------
 
+    #define BENCHMARK_BATCH 256
+    calculated_number batch_values[BENCHMARK_BATCH], batch_unpacked[BENCHMARK_BATCH];
+    storage_number batch_packed[BENCHMARK_BATCH];
+
+    n = STORAGE_NUMBER_POSITIVE_MIN;
+    for(i = 0; i < BENCHMARK_BATCH ;i++) {
+        n *= multiplier;
+        if(n > STORAGE_NUMBER_POSITIVE_MAX) n = STORAGE_NUMBER_POSITIVE_MIN;
+        batch_values[i] = (i % 2) ? -n : n;
+    }
+
+    fprintf(stderr, "\nPACK / UNPACK ONE BY ONE: ");
+    getrusage(RUSAGE_SELF, &last);
+
+    d = 0;
+    for(j = 0; j < loop / BENCHMARK_BATCH * 10 ;j++) {
+        for(i = 0; i < BENCHMARK_BATCH ;i++)
+            batch_packed[i] = pack_storage_number(batch_values[i], SN_EXISTS);
+
+        for(i = 0; i < BENCHMARK_BATCH ;i++)
+            batch_unpacked[i] = unpack_storage_number(batch_packed[i]);
+
+        d += batch_unpacked[j % BENCHMARK_BATCH];
+        batch_values[j % BENCHMARK_BATCH] += 1;
+    }
+
+    getrusage(RUSAGE_SELF, &now);
+    user   = now.ru_utime.tv_sec * 1000000ULL + now.ru_utime.tv_usec - last.ru_utime.tv_sec * 1000000ULL - last.ru_utime.tv_usec;
+    system = now.ru_stime.tv_sec * 1000000ULL + now.ru_stime.tv_usec - last.ru_stime.tv_sec * 1000000ULL - last.ru_stime.tv_usec;
+    total  = user + system;
+    their = total;
+
+    fprintf(stderr, "user %0.5" LONG_DOUBLE_MODIFIER ", system %0.5" LONG_DOUBLE_MODIFIER ", total %0.5" LONG_DOUBLE_MODIFIER " (" CALCULATED_NUMBER_FORMAT ")\n", (LONG_DOUBLE)(user / 1000000.0), (LONG_DOUBLE)(system / 1000000.0), (LONG_DOUBLE)(total / 1000000.0), d);
+
+    fprintf(stderr, "PACK / UNPACK IN BATCHES OF %d: ", BENCHMARK_BATCH);
+    getrusage(RUSAGE_SELF, &last);
+
+    d = 0;
+    for(j = 0; j < loop / BENCHMARK_BATCH * 10 ;j++) {
+        pack_storage_number_batch(batch_values, batch_packed, BENCHMARK_BATCH, SN_EXISTS);
+        unpack_storage_number_batch(batch_packed, batch_unpacked, BENCHMARK_BATCH);
+
+        d += batch_unpacked[j % BENCHMARK_BATCH];
+        batch_values[j % BENCHMARK_BATCH] += 1;
+    }
+
+    getrusage(RUSAGE_SELF, &now);
+    user   = now.ru_utime.tv_sec * 1000000ULL + now.ru_utime.tv_usec - last.ru_utime.tv_sec * 1000000ULL - last.ru_utime.tv_usec;
+    system = now.ru_stime.tv_sec * 1000000ULL + now.ru_stime.tv_usec - last.ru_stime.tv_sec * 1000000ULL - last.ru_stime.tv_usec;
+    total  = user + system;
+    mine = total;
+
+    fprintf(stderr, "user %0.5" LONG_DOUBLE_MODIFIER ", system %0.5" LONG_DOUBLE_MODIFIER ", total %0.5" LONG_DOUBLE_MODIFIER " (" CALCULATED_NUMBER_FORMAT ")\n", (LONG_DOUBLE)(user / 1000000.0), (LONG_DOUBLE)(system / 1000000.0), (LONG_DOUBLE)(total / 1000000.0), d);
+
+    if(mine > their) {
+        fprintf(stderr, "BATCH PACKING AND UNPACKING IS SLOWER %0.2" LONG_DOUBLE_MODIFIER " %%\n", (LONG_DOUBLE)(mine * 100.0 / their - 100.0));
+    }
+    else {
+        fprintf(stderr, "BATCH PACKING AND UNPACKING IS  F A S T E R  %0.2" LONG_DOUBLE_MODIFIER " %%\n", (LONG_DOUBLE)(their * 100.0 / mine - 100.0));
+    }
+
+    // ------------------------------------------------------------------------
+
 }
 
 static int check_storage_number_exists() {
@@ -308,9 +416,97 @@ static int check_storage_number_exists() {
     return 0;
 }
 
+static int check_storage_number_pages(void) {
+    const char *patterns[] = { "constant", "slow moving", "with gaps", "random", NULL };
+    storage_number values[RRDDIM_PAGE_ENTRIES], decoded[RRDDIM_PAGE_ENTRIES];
+    uint8_t data[RRDDIM_PAGE_MAX_BYTES(RRDDIM_PAGE_ENTRIES)];
+    int p;
+    long i;
+
+    for(p = 0; patterns[p] ; p++) {
+        for(i = 0; i < RRDDIM_PAGE_ENTRIES ; i++) {
+            switch(p) {
+                case 0: values[i] = pack_storage_number(100, SN_EXISTS); break;
+                case 1: values[i] = pack_storage_number(1000 + i / 10, SN_EXISTS); break;
+                case 2: values[i] = (i % 7) ? pack_storage_number(i * 3, SN_EXISTS) : SN_EMPTY_SLOT; break;
+                default: values[i] = pack_storage_number((calculated_number)random() / 1000.0, SN_EXISTS); break;
+            }
+        }
+
+        size_t bytes = storage_number_page_compress(values, RRDDIM_PAGE_ENTRIES, data);
+        if(bytes > sizeof(data)) {
+            fprintf(stderr, "Compressed page '%s' overflowed: %zu bytes\n", patterns[p], bytes);
+            return 1;
+        }
+
+        storage_number_page_decompress(data, bytes, decoded, RRDDIM_PAGE_ENTRIES);
+        for(i = 0; i < RRDDIM_PAGE_ENTRIES ; i++) {
+            if(decoded[i] != values[i]) {
+                fprintf(stderr, "Compressed page '%s' slot %ld: expected 0x%08x, got 0x%08x\n", patterns[p], i, values[i], decoded[i]);
+                return 1;
+            }
+        }
+
+        fprintf(stderr, "Compressed page '%s': %zu bytes instead of %zu (%0.2fx)\n"
+                , patterns[p], bytes, sizeof(values), (double)sizeof(values) / (double)bytes);
+    }
+
+    return 0;
+}
+
+// the batch versions should give the same results as the single value ones
+static int check_storage_number_batch(void) {
+    fprintf(stderr, "\nChecking batch pack / unpack of storage numbers\n");
+
+    size_t i, entries = 0, errors = 0;
+    calculated_number values[1000], unpacked[1000];
+    storage_number packed[1000];
+
+    calculated_number n;
+    for(n = STORAGE_NUMBER_POSITIVE_MIN; n < STORAGE_NUMBER_POSITIVE_MAX && entries < 990 ; n *= 1.37) {
+        values[entries++] = n;
+        values[entries++] = -n;
+    }
+
+    // the edges of the multiplier and the divider
+    values[entries++] = 0.9;
+    values[entries++] = 1677723.7;
+    values[entries++] = 16777215.4;
+    values[entries++] = 16777216.6;
+    values[entries++] = 0;
+    values[entries++] = STORAGE_NUMBER_POSITIVE_MAX * 10;
+
+    pack_storage_number_batch(values, packed, entries, SN_EXISTS);
+
+    for(i = 0; i < entries ; i++) {
+        storage_number expected = pack_storage_number(values[i], SN_EXISTS);
+        if(packed[i] != expected) {
+            fprintf(stderr, "    pack " CALCULATED_NUMBER_FORMAT ": expected 0x%08x, found 0x%08x ### E R R O R ###\n", values[i], expected, packed[i]);
+            errors++;
+        }
+    }
+
+    // the last one is an empty slot
+    packed[entries - 1] = SN_EMPTY_SLOT;
+    unpack_storage_number_batch(packed, unpacked, entries);
+
+    for(i = 0; i < entries ; i++) {
+        calculated_number expected = (does_storage_number_exist(packed[i])) ? unpack_storage_number(packed[i]) : NAN;
+        if(isnan(expected) ? !isnan(unpacked[i]) : unpacked[i] != expected) {
+            fprintf(stderr, "    unpack 0x%08x: expected " CALCULATED_NUMBER_FORMAT ", found " CALCULATED_NUMBER_FORMAT " ### E R R O R ###\n", packed[i], expected, unpacked[i]);
+            errors++;
+        }
+    }
+
+    fprintf(stderr, "    checked %zu values, %zu errors\n", entries, errors);
+    return (errors) ? 1 : 0;
+}
+
 int unit_test_storage()
 {
     if(check_storage_number_exists()) return 0;
+    if(check_storage_number_pages()) return 1;
+    if(check_storage_number_batch()) return 1;
 
     calculated_number c, a = 0;
     int i, j, g, r = 0;
@@ -333,6 +529,7 @@ int unit_test_storage()
     }
 
     benchmark_storage_number(1000000, 2);
+    benchmark_number_printing(5000000);
     return r;
 }
 
@@ -1198,67 +1395,2137 @@ static int test_variable_renames(void) {
     return 1;
 }
 
-int run_all_mockup_tests(void)
-{
-    if(check_number_printing())
-        return 1;
+static int test_compressed_memory_mode(void) {
+    fprintf(stderr, "\nTesting memory mode compressed against memory mode alloc\n");
 
-    if(check_rrdcalc_comparisons())
-        return 1;
+    RRDSET *st[2];
+    RRDDIM *rd[2][2];
+    RRD_MEMORY_MODE modes[2] = { RRD_MEMORY_MODE_ALLOC, RRD_MEMORY_MODE_COMPRESSED };
+    struct timeval now;
+    int m, errors = 0;
+    long c;
 
-    if(!test_variable_renames())
-        return 1;
+    now_realtime_timeval(&now);
 
-    if(run_test(&test1))
-        return 1;
+    for(m = 0; m < 2 ; m++) {
+        char id[101];
+        snprintfz(id, 100, "unittest-pages-%s", rrd_memory_mode_name(modes[m]));
 
-    if(run_test(&test2))
-        return 1;
+        st[m] = rrdset_create_custom(localhost, "hibenchmarks", id, NULL, "hibenchmarks", NULL, "Unit Testing", "a value", "unittest", NULL, 1, 1
+                                     , RRDSET_TYPE_LINE, modes[m], 600, RRD_STORAGE_FORMAT_32BIT);
+        rd[m][0] = rrddim_add(st[m], "slow", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+        rd[m][1] = rrddim_add(st[m], "noisy", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+    }
 
-    if(run_test(&test3))
-        return 1;
+    // fill the round robin database more than twice, to rotate all pages
+    for(c = 0; c < st[0]->entries * 2 + 100 ; c++) {
+        for(m = 0; m < 2 ; m++) {
+            if(c) st[m]->usec_since_last_update = USEC_PER_SEC;
+            else st[m]->last_collected_time = now;
 
-    if(run_test(&test4))
-        return 1;
+            rrddim_set_by_pointer(st[m], rd[m][0], 1000 + c / 60);
+            rrddim_set_by_pointer(st[m], rd[m][1], (c % 13) ? c * 7 % 1009 : 0);
+            rd[m][0]->last_collected_time.tv_sec = rd[m][1]->last_collected_time.tv_sec = st[m]->last_collected_time.tv_sec;
+            rrdset_done(st[m]);
+        }
+    }
 
-    if(run_test(&test5))
-        return 1;
+    for(m = 0; m < 2 ; m++) {
+        for(c = 0; c < st[0]->entries ; c++) {
+            storage_number expected = rd[0][m]->values[c], found = rrddim_slot_value(rd[1][m], c);
+            if(expected != found) {
+                fprintf(stderr, "    %s slot %ld: expected 0x%08x, found 0x%08x ### E R R O R ###\n", rd[1][m]->name, c, expected, found);
+                errors++;
+            }
+        }
+    }
 
-    if(run_test(&test6))
-        return 1;
+    long w, windows = 0;
+    for(w = 0; w < 10 ; w++, windows++) {
+        calculated_number n[2];
+        for(m = 0; m < 2 ; m++) {
+            rrdset_rdlock(st[m]);
+            rrdset2value_api_v1(st[m], NULL, &n[m], NULL, 1, -(w + 1) * 59, -w * 59, GROUP_AVERAGE, 0, 0, NULL, NULL, NULL);
+            rrdset_unlock(st[m]);
+        }
 
-    if(run_test(&test7))
-        return 1;
+        if(n[0] != n[1]) {
+            fprintf(stderr, "    window %ld: expected " CALCULATED_NUMBER_FORMAT ", found " CALCULATED_NUMBER_FORMAT " ### E R R O R ###\n", w, n[0], n[1]);
+            errors++;
+        }
+    }
 
-    if(run_test(&test8))
-        return 1;
+    fprintf(stderr, "    compared %ld slots and %ld query windows, memory mode compressed uses %zu + %zu bytes instead of %zu\n"
+            , st[0]->entries, windows
+            , rd[1][0]->memsize, rd[1][0]->pages->compressed_bytes, rd[0][0]->memsize);
 
-    if(run_test(&test9))
-        return 1;
+    return errors;
+}
 
-    if(run_test(&test10))
-        return 1;
+static int test_storage_format_64bit(void) {
+    fprintf(stderr, "\nTesting storage format 64bit against storage format 32bit\n");
 
-    if(run_test(&test11))
-        return 1;
+    RRDSET *st[2];
+    RRDDIM *rd[2];
+    RRD_STORAGE_FORMAT formats[2] = { RRD_STORAGE_FORMAT_32BIT, RRD_STORAGE_FORMAT_64BIT };
+    struct timeval now;
+    int f, errors = 0;
+    long c, checked = 0;
 
-    if(run_test(&test12))
-        return 1;
+    // a byte counter that needs more than the 24 bits of storage_number
+    collected_number base = 1000000000LL;
 
-    if(run_test(&test13))
-        return 1;
+    now_realtime_timeval(&now);
 
-    if(run_test(&test14))
-        return 1;
+    for(f = 0; f < 2 ; f++) {
+        char id[101];
+        snprintfz(id, 100, "unittest-storage-format-%s", rrd_storage_format_name(formats[f]));
 
-    if(run_test(&test14b))
-        return 1;
+        st[f] = rrdset_create_custom(localhost, "hibenchmarks", id, NULL, "hibenchmarks", NULL, "Unit Testing", "a value", "unittest", NULL, 1, 1
+                                     , RRDSET_TYPE_LINE, RRD_MEMORY_MODE_ALLOC, 300, formats[f]);
+        rd[f] = rrddim_add(st[f], "bytes", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+    }
 
-    if(run_test(&test14c))
+    if(st[1]->storage_format != RRD_STORAGE_FORMAT_64BIT || rd[1]->memsize != rd[0]->memsize + st[0]->entries * sizeof(storage_number)) {
+        fprintf(stderr, "    the chart does not have storage format 64bit ### E R R O R ###\n");
         return 1;
+    }
 
-    if(run_test(&test15))
+    for(c = 0; c < st[0]->entries + 100 ; c++) {
+        for(f = 0; f < 2 ; f++) {
+            if(c) st[f]->usec_since_last_update = USEC_PER_SEC;
+            else st[f]->last_collected_time = now;
+
+            rrddim_set_by_pointer(st[f], rd[f], base + c);
+            rd[f]->last_collected_time.tv_sec = st[f]->last_collected_time.tv_sec;
+            rrdset_done(st[f]);
+        }
+    }
+
+    // every slot has the exact value collected
+    for(c = 0; c < st[1]->entries ; c++) {
+        calculated_number value;
+        if(!rrddim_slot_get(rd[1], c, &value)) continue;
+
+        if(value != (calculated_number)(base + (value - base)) || value < base || value >= base + st[0]->entries + 100) {
+            fprintf(stderr, "    slot %ld: found " CALCULATED_NUMBER_FORMAT " ### E R R O R ###\n", c, value);
+            errors++;
+        }
+
+        long next = (c + 1 < st[1]->entries) ? c + 1 : 0;
+        calculated_number next_value;
+        if(next != st[1]->current_entry && rrddim_slot_get(rd[1], next, &next_value) && next_value != value + 1) {
+            fprintf(stderr, "    slot %ld: expected " CALCULATED_NUMBER_FORMAT ", found " CALCULATED_NUMBER_FORMAT " ### E R R O R ###\n", next, value + 1, next_value);
+            errors++;
+        }
+
+        checked++;
+    }
+
+    // the queries return the exact values - the 32bit ones are rounded to 8 digits
+    calculated_number n[2];
+    for(f = 0; f < 2 ; f++) {
+        rrdset_rdlock(st[f]);
+        rrdset2value_api_v1(st[f], NULL, &n[f], NULL, 1, -60, 0, GROUP_MAX, 0, 0, NULL, NULL, NULL);
+        rrdset_unlock(st[f]);
+    }
+
+    if(n[1] != calculated_number_round(n[1]) || n[1] < base || calculated_number_fabs(n[1] - n[0]) > 100) {
+        fprintf(stderr, "    query: found " CALCULATED_NUMBER_FORMAT " with storage format 64bit and " CALCULATED_NUMBER_FORMAT " with 32bit ### E R R O R ###\n", n[1], n[0]);
+        errors++;
+    }
+
+    fprintf(stderr, "    checked %ld slots, the last value is " CALCULATED_NUMBER_FORMAT " with storage format 64bit and " CALCULATED_NUMBER_FORMAT " with storage format 32bit\n"
+            , checked, n[1], n[0]);
+
+    return errors;
+}
+
+static int test_rrdset_ring_readers(void) {
+    fprintf(stderr, "\nTesting the lock-free readers of the round robin database\n");
+
+    struct timeval now;
+    int errors = 0;
+    long c;
+
+    now_realtime_timeval(&now);
+
+    RRDSET *st = rrdset_create_localhost("hibenchmarks", "unittest-ring-readers", NULL, "hibenchmarks", NULL, "Unit Testing", "a value", "unittest", NULL, 1, 1, RRDSET_TYPE_LINE);
+    RRDDIM *rd = rrddim_add(st, "value", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+
+    for(c = 0; c < st->entries + 10 ; c++) {
+        if(c) st->usec_since_last_update = USEC_PER_SEC;
+        else st->last_collected_time = now;
+
+        rrddim_set_by_pointer(st, rd, c);
+        rd->last_collected_time.tv_sec = st->last_collected_time.tv_sec;
+        rrdset_done(st);
+    }
+
+    struct rrdset_tier ring;
+    size_t seq = rrdset_ring_snapshot(st, &ring);
+
+    if(seq & 1 || ring.current_entry != st->current_entry || ring.last_updated.tv_sec != st->last_updated.tv_sec) {
+        fprintf(stderr, "    the snapshot does not match the chart (seq %zu) ### E R R O R ###\n", seq);
+        errors++;
+    }
+
+    if(rrdset_ring_overwritten(st, &ring, seq, ring.current_entry)) {
+        fprintf(stderr, "    nothing has been stored, but the oldest slot is reported overwritten ### E R R O R ###\n");
+        errors++;
+    }
+
+    // store one more slot - it goes over the oldest one
+    st->usec_since_last_update = USEC_PER_SEC;
+    rrddim_set_by_pointer(st, rd, c);
+    rrdset_done(st);
+
+    if(rrdset_seq_load(st) != seq + 2) {
+        fprintf(stderr, "    storing a slot moved seq from %zu to %zu, expected %zu ### E R R O R ###\n", seq, rrdset_seq_load(st), seq + 2);
+        errors++;
+    }
+
+    if(!rrdset_ring_overwritten(st, &ring, seq, ring.current_entry)) {
+        fprintf(stderr, "    the oldest slot has been stored again, but it is not reported overwritten ### E R R O R ###\n");
+        errors++;
+    }
+
+    long newest = (ring.current_entry == 0) ? ring.entries - 1 : ring.current_entry - 1;
+    if(rrdset_ring_overwritten(st, &ring, seq, newest)) {
+        fprintf(stderr, "    the newest slot is reported overwritten ### E R R O R ###\n");
+        errors++;
+    }
+
+    fprintf(stderr, "    seq is %zu after %ld slots stored\n", rrdset_seq_load(st), c + 1);
+
+    // a chart freed while it is read is freed by its last reader
+    RRDHOST *host = st->rrdhost;
+    size_t deferred = host->rrdset_deferred;
+
+    rrdset_read_begin(st);
+    rrdset_read_begin(st);
+
+    rrdhost_wrlock(host);
+    rrdset_free(st);
+    rrdhost_unlock(host);
+
+    if(rrdset_find(host, "hibenchmarks.unittest-ring-readers") || host->rrdset_deferred != deferred + 1 || rrdset_readers(st) != 2) {
+        fprintf(stderr, "    the chart freed while it is read is not waiting for its readers ### E R R O R ###\n");
+        errors++;
+    }
+
+    rrdset_read_end(st);
+    if(host->rrdset_deferred != deferred + 1) {
+        fprintf(stderr, "    the chart has been freed while it is still read ### E R R O R ###\n");
+        errors++;
+    }
+
+    rrdset_read_end(st);
+    if(host->rrdset_deferred != deferred) {
+        fprintf(stderr, "    the last reader did not free the chart ### E R R O R ###\n");
+        errors++;
+    }
+
+    return errors;
+}
+
+static int test_slab_set(void) {
+    fprintf(stderr, "\nTesting the slab allocator\n");
+
+    SLAB_SET set;
+    slab_set_init(&set);
+
+    int errors = 0;
+    size_t i, entries = 1000, size = sizeof(RRDDIM);
+    void *objects[entries];
+
+    // a few objects get a small page
+    void *first = slab_set_callocz(&set, size);
+    if(slab_set_allocated_memory(&set) > SLAB_FIRST_PAGE_SIZE + SLAB_MIN_OBJECTS_PER_PAGE * size + 256) {
+        fprintf(stderr, "    one object allocated %zu bytes of slabs ### E R R O R ###\n", slab_set_allocated_memory(&set));
+        errors++;
+    }
+
+    for(i = 0; i < entries ; i++) {
+        objects[i] = slab_set_callocz(&set, size);
+        memset(objects[i], 0xff, size);
+    }
+
+    size_t memory = slab_set_allocated_memory(&set);
+
+    // freeing and allocating again reuses the same memory
+    for(i = 0; i < entries ; i += 2)
+        slab_set_freez(&set, objects[i], size);
+
+    for(i = 0; i < entries ; i += 2) {
+        char *o = slab_set_callocz(&set, size);
+        if(o[0] != 0 || o[size - 1] != 0) {
+            fprintf(stderr, "    object %zu is not zeroed ### E R R O R ###\n", i);
+            errors++;
+        }
+        objects[i] = o;
+    }
+
+    if(slab_set_allocated_memory(&set) != memory) {
+        fprintf(stderr, "    the memory grew from %zu to %zu bytes, while reusing the freed objects ### E R R O R ###\n", memory, slab_set_allocated_memory(&set));
+        errors++;
+    }
+
+    char *s = slab_set_strdupz(&set, "unittest.slab");
+    if(strcmp(s, "unittest.slab") != 0) {
+        fprintf(stderr, "    string copied as '%s' ### E R R O R ###\n", s);
+        errors++;
+    }
+    slab_set_freez_string(&set, s);
+
+    for(i = 0; i < entries ; i++)
+        slab_set_freez(&set, objects[i], size);
+
+    // the empty pages are released, except one of each slab
+    size_t released = slab_set_allocated_memory(&set);
+    if(released > SLAB_PAGE_SIZE + SLAB_FIRST_PAGE_SIZE + 256) {
+        fprintf(stderr, "    %zu bytes of slabs are kept, after freeing the objects ### E R R O R ###\n", released);
+        errors++;
+    }
+
+    slab_set_freez(&set, first, size);
+
+    fprintf(stderr, "    %zu objects of %zu bytes in %zu bytes of slabs, %zu bytes kept when freed\n", entries + 1, size, memory, released);
+
+    // when the set is destroyed, the objects are not returned to their pages
+    for(i = 0; i < entries ; i++)
+        objects[i] = slab_set_callocz(&set, size);
+
+    memory = slab_set_allocated_memory(&set);
+    slab_set_destroy_begin(&set);
+
+    for(i = 0; i < entries ; i++)
+        slab_set_freez(&set, objects[i], size);
+
+    if(slab_set_allocated_memory(&set) != memory) {
+        fprintf(stderr, "    the objects of a set being destroyed were freed one by one ### E R R O R ###\n");
+        errors++;
+    }
+
+    slab_set_destroy(&set);
+
+    if(slab_set_allocated_memory(&set) != 0) {
+        fprintf(stderr, "    %zu bytes of slabs are kept, after the set is destroyed ### E R R O R ###\n", slab_set_allocated_memory(&set));
+        errors++;
+    }
+
+    return errors;
+}
+
+static int test_string_intern(void) {
+    fprintf(stderr, "\nTesting the interned strings\n");
+
+    int errors = 0;
+    char buf[100];
+
+    struct string_intern_stats before;
+    string_intern_get_stats(&before);
+
+    strcpy(buf, "unittest.interned");
+    const char *s1 = string_intern(buf);
+    const char *s2 = string_intern("unittest.interned");
+
+    if(s1 != s2 || s1 == buf || strcmp(s1, buf) != 0) {
+        fprintf(stderr, "    the same string was interned twice ### E R R O R ###\n");
+        errors++;
+    }
+
+    if(string_intern_find("unittest.interned", 0) != s1 || string_intern_find("unittest.not.interned", 0)) {
+        fprintf(stderr, "    string_intern_find() does not find the interned strings ### E R R O R ###\n");
+        errors++;
+    }
+
+    const char *s3 = string_intern_dup(s1);
+    string_intern_release(s1);
+    string_intern_release(s2);
+
+    if(string_intern_find("unittest.interned", 0) != s3) {
+        fprintf(stderr, "    the string was freed while it is still referenced ### E R R O R ###\n");
+        errors++;
+    }
+
+    string_intern_release(s3);
+
+    if(string_intern_find("unittest.interned", 0)) {
+        fprintf(stderr, "    the string was not freed after its last reference ### E R R O R ###\n");
+        errors++;
+    }
+
+    // the charts of the unit tests share their units and families
+    RRDSET *st1 = rrdset_find_localhost("hibenchmarks.unittest-storage-format-32bit");
+    RRDSET *st2 = rrdset_find_localhost("hibenchmarks.unittest-storage-format-64bit");
+    if(st1 && st2 && (st1->units != st2->units || st1->family != st2->family)) {
+        fprintf(stderr, "    charts with the same units do not share them ### E R R O R ###\n");
+        errors++;
+    }
+
+    struct string_intern_stats after;
+    string_intern_get_stats(&after);
+
+    if(after.entries != before.entries || after.references != before.references) {
+        fprintf(stderr, "    the table has %zu strings with %zu references, expected %zu with %zu ### E R R O R ###\n", after.entries, after.references, before.entries, before.references);
+        errors++;
+    }
+
+    fprintf(stderr, "    %zu strings interned, with %zu references, in %zu bytes\n", after.entries, after.references, after.memory);
+    return errors;
+}
+
+static int test_tiered_memory_mode(void) {
+    fprintf(stderr, "\nTesting the sums of memory mode tiered against memory mode ram\n");
+
+    RRDSET *st[2];
+    RRDDIM *rd[2];
+    RRD_MEMORY_MODE modes[2] = { RRD_MEMORY_MODE_RAM, RRD_MEMORY_MODE_TIERED };
+    long history[2] = { 7200, 600 };
+    struct timeval now;
+    int m, errors = 0;
+    long c, w;
+
+    // the slots of the tiers start at whole minutes
+    now_realtime_timeval(&now);
+    now.tv_sec -= now.tv_sec % 60;
+    now.tv_usec = 0;
+
+    for(m = 0; m < 2 ; m++) {
+        char id[101];
+        snprintfz(id, 100, "unittest-tiers-%s", rrd_memory_mode_name(modes[m]));
+
+        st[m] = rrdset_create_custom(localhost, "hibenchmarks", id, NULL, "hibenchmarks", NULL, "Unit Testing", "a value", "unittest", NULL, 1, 1
+                                     , RRDSET_TYPE_LINE, modes[m], history[m], RRD_STORAGE_FORMAT_32BIT);
+        rd[m] = rrddim_add(st[m], "value", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+    }
+
+    // the tiered chart keeps only the last 600 seconds per second
+    for(c = 0; c < 7200 ; c++) {
+        for(m = 0; m < 2 ; m++) {
+            if(c) st[m]->usec_since_last_update = USEC_PER_SEC;
+            else st[m]->last_collected_time = now;
+
+            rrddim_set_by_pointer(st[m], rd[m], 1 + c * 7 % 101);
+            rd[m]->last_collected_time.tv_sec = st[m]->last_collected_time.tv_sec;
+            rrdset_done(st[m]);
+        }
+    }
+
+    // the sum of the per minute slots is the sum of the seconds they downsampled
+    for(w = 1; w < 10 ; w++) {
+        calculated_number n[2] = { 0, 0 };
+        int is_null[2] = { 0, 0 };
+        for(m = 0; m < 2 ; m++) {
+            rrdset_rdlock(st[m]);
+            rrdset2value_api_v1(st[m], NULL, &n[m], NULL, 1, -600, -w * 600, GROUP_SUM, 0, 0, NULL, NULL, &is_null[m]);
+            rrdset_unlock(st[m]);
+        }
+
+        if(is_null[0] || is_null[1] || calculated_number_fabs(n[0] - n[1]) > 0.0001) {
+            fprintf(stderr, "    sum of window %ld: expected " CALCULATED_NUMBER_FORMAT "%s, found " CALCULATED_NUMBER_FORMAT "%s ### E R R O R ###\n"
+                    , w, n[0], (is_null[0]) ? " (null)" : "", n[1], (is_null[1]) ? " (null)" : "");
+            errors++;
+        }
+    }
+
+    // the incremental sum is calculated on the per second slots, for the time they have
+    calculated_number n[2] = { 0, 0 };
+    int is_null[2] = { 0, 0 };
+    time_t after = 0, before = 0;
+
+    rrdset_rdlock(st[1]);
+    rrdset2value_api_v1(st[1], NULL, &n[1], NULL, 1, -3600, 0, GROUP_INCREMENTAL_SUM, 0, RRDR_OPTION_NOT_ALIGNED, &after, &before, &is_null[1]);
+    rrdset_unlock(st[1]);
+
+    rrdset_rdlock(st[0]);
+    rrdset2value_api_v1(st[0], NULL, &n[0], NULL, 1, rrdset_first_entry_t(st[1]), rrdset_last_entry_t(st[1]), GROUP_INCREMENTAL_SUM, 0, RRDR_OPTION_NOT_ALIGNED, NULL, NULL, &is_null[0]);
+    rrdset_unlock(st[0]);
+
+    if(is_null[0] || is_null[1] || after < rrdset_first_entry_t(st[1]) || calculated_number_fabs(n[0] - n[1]) > 0.0001) {
+        fprintf(stderr, "    incremental sum from %ld to %ld: expected " CALCULATED_NUMBER_FORMAT "%s, found " CALCULATED_NUMBER_FORMAT "%s ### E R R O R ###\n"
+                , (long)after, (long)before, n[0], (is_null[0]) ? " (null)" : "", n[1], (is_null[1]) ? " (null)" : "");
+        errors++;
+    }
+    else
+        fprintf(stderr, "    the sums of 9 windows from the per minute slots and the incremental sum of the last %ld seconds OK\n", (long)(before - after));
+
+    return errors;
+}
+
+static int test_dbengine_memory_mode(void) {
+    fprintf(stderr, "\nTesting memory mode dbengine against memory mode alloc\n");
+
+    char path[FILENAME_MAX + 1];
+    snprintfz(path, FILENAME_MAX, "/tmp/hibenchmarks-unittest-XXXXXX");
+    if(!mkdtemp(path)) {
+        fprintf(stderr, "    cannot create a temporary directory ### E R R O R ###\n");
+        return 1;
+    }
+
+    struct rrdengine *saved_rrdeng = localhost->rrdeng;
+    localhost->rrdeng = rrdeng_init(path, 1);
+    if(!localhost->rrdeng) {
+        fprintf(stderr, "    cannot initialize the dbengine in '%s' ### E R R O R ###\n", path);
+        localhost->rrdeng = saved_rrdeng;
+        return 1;
+    }
+
+    RRDSET *st[2];
+    RRDDIM *rd[2][2];
+    RRD_MEMORY_MODE modes[2] = { RRD_MEMORY_MODE_ALLOC, RRD_MEMORY_MODE_DBENGINE };
+    long history[2] = { 1200, 300 };
+    struct timeval now;
+    int m, errors = 0;
+    long c, w, windows = 0;
+
+    now_realtime_timeval(&now);
+
+    for(m = 0; m < 2 ; m++) {
+        char id[101];
+        snprintfz(id, 100, "unittest-disk-%s", rrd_memory_mode_name(modes[m]));
+
+        st[m] = rrdset_create_custom(localhost, "hibenchmarks", id, NULL, "hibenchmarks", NULL, "Unit Testing", "a value", "unittest", NULL, 1, 1
+                                     , RRDSET_TYPE_LINE, modes[m], history[m], RRD_STORAGE_FORMAT_32BIT);
+        rd[m][0] = rrddim_add(st[m], "slow", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+        rd[m][1] = rrddim_add(st[m], "noisy", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+    }
+
+    // collect more than 3 times the round robin database of the dbengine chart
+    for(c = 0; c < 1100 ; c++) {
+        for(m = 0; m < 2 ; m++) {
+            if(c) st[m]->usec_since_last_update = USEC_PER_SEC;
+            else st[m]->last_collected_time = now;
+
+            rrddim_set_by_pointer(st[m], rd[m][0], 1000 + c / 60);
+            rrddim_set_by_pointer(st[m], rd[m][1], (c % 13) ? c * 7 % 1009 : 0);
+            rd[m][0]->last_collected_time.tv_sec = rd[m][1]->last_collected_time.tv_sec = st[m]->last_collected_time.tv_sec;
+            rrdset_done(st[m]);
+        }
+    }
+
+    // query it, then save it, re-open the datafiles and query it again
+    int pass;
+    for(pass = 0; pass < 2 ; pass++) {
+        // windows of 59 seconds, going back 944 seconds - most of them are on disk
+        for(w = 0; w < 16 ; w++, windows++) {
+            calculated_number n[2] = { 0, 0 };
+            int is_null[2] = { 0, 0 };
+            for(m = 0; m < 2 ; m++) {
+                rrdset_rdlock(st[m]);
+                rrdset2value_api_v1(st[m], NULL, &n[m], NULL, 1, -59, -w * 59, GROUP_AVERAGE, 0, 0, NULL, NULL, &is_null[m]);
+                rrdset_unlock(st[m]);
+            }
+
+            if(is_null[0] != is_null[1] || (!is_null[0] && n[0] != n[1])) {
+                fprintf(stderr, "    pass %d, window %ld: expected " CALCULATED_NUMBER_FORMAT "%s, found " CALCULATED_NUMBER_FORMAT "%s ### E R R O R ###\n"
+                        , pass, w, n[0], (is_null[0]) ? " (null)" : "", n[1], (is_null[1]) ? " (null)" : "");
+                errors++;
+            }
+        }
+
+        if(!pass) {
+            for(m = 0; m < 2 ; m++)
+                rrddim_pages_flush(rd[1][m]);
+
+            rrdeng_exit(localhost->rrdeng);
+            localhost->rrdeng = rrdeng_init(path, 1);
+            if(!localhost->rrdeng) {
+                fprintf(stderr, "    cannot re-open the dbengine in '%s' ### E R R O R ###\n", path);
+                errors++;
+                break;
+            }
+
+            for(m = 0; m < 2 ; m++)
+                rd[1][m]->rrdeng_metric = rrdeng_metric_get(localhost->rrdeng, st[1]->id, rd[1][m]->id);
+        }
+    }
+
+    fprintf(stderr, "    compared %ld query windows, the dbengine chart keeps %ld entries in memory and has data since %ld seconds ago\n"
+            , windows, st[1]->entries, (long)(rrdset_last_entry_t(st[1]) - rrdset_tiers_first_entry_t(st[1])));
+
+    // detach the chart from the dbengine, so that it stays in memory only
+    for(m = 0; m < 2 ; m++)
+        rd[1][m]->rrdeng_metric = NULL;
+
+    rrdeng_exit(localhost->rrdeng);
+    localhost->rrdeng = saved_rrdeng;
+    recursively_delete_dir(path, "unittest dbengine");
+
+    return errors;
+}
+
+// ----------------------------------------------------------------------------
+// benchmark of the collection layout of rrdset_done()
+
+// the collection state of a dimension, as it used to be kept in RRDDIM,
+// in a linked list of separately allocated dimensions
+struct benchmark_linked_dimension {
+    struct benchmark_linked_dimension *next;
+    RRD_ALGORITHM algorithm;
+    collected_number multiplier;
+    collected_number divisor;
+    uint8_t updated;
+    size_t collections_counter;
+    collected_number collected_value;
+    collected_number last_collected_value;
+    calculated_number calculated_value;
+    calculated_number last_calculated_value;
+};
+
+static calculated_number benchmark_linked_dimensions(struct benchmark_linked_dimension *root, int loop) {
+    calculated_number sum = 0;
+    int l;
+
+    for(l = 0; l < loop ; l++) {
+        struct benchmark_linked_dimension *d;
+        for(d = root; d ; d = d->next) {
+            d->collected_value += l;
+            d->updated = 1;
+            d->collections_counter++;
+        }
+
+        for(d = root; d ; d = d->next) {
+            if(unlikely(!d->updated)) continue;
+
+            if(d->algorithm == RRD_ALGORITHM_INCREMENTAL)
+                d->calculated_value += (calculated_number)(d->collected_value - d->last_collected_value) * (calculated_number)d->multiplier / (calculated_number)d->divisor;
+            else
+                d->calculated_value = (calculated_number)d->collected_value * (calculated_number)d->multiplier / (calculated_number)d->divisor;
+
+            sum += d->calculated_value;
+        }
+
+        for(d = root; d ; d = d->next) {
+            d->last_collected_value = d->collected_value;
+            d->last_calculated_value = d->calculated_value;
+            d->calculated_value = 0;
+            d->updated = 0;
+        }
+    }
+
+    return sum;
+}
+
+static calculated_number benchmark_collection_arrays(struct rrdset_collection *c, int loop) {
+    calculated_number sum = 0;
+    size_t i, used = c->used;
+    int l;
+
+    for(l = 0; l < loop ; l++) {
+        for(i = 0; i < used ; i++) {
+            c->collected_value[i] += l;
+            c->updated[i] = 1;
+            c->collections_counter[i]++;
+        }
+
+        for(i = 0; i < used ; i++) {
+            if(unlikely(!c->updated[i])) continue;
+
+            if(c->algorithm[i] == RRD_ALGORITHM_INCREMENTAL)
+                c->calculated_value[i] += (calculated_number)(c->collected_value[i] - c->last_collected_value[i]) * c->multiplier[i] / c->divisor[i];
+            else
+                c->calculated_value[i] = (calculated_number)c->collected_value[i] * c->multiplier[i] / c->divisor[i];
+
+            sum += c->calculated_value[i];
+        }
+
+        for(i = 0; i < used ; i++) {
+            c->last_collected_value[i] = c->collected_value[i];
+            c->last_calculated_value[i] = c->calculated_value[i];
+            c->calculated_value[i] = 0;
+            c->updated[i] = 0;
+        }
+    }
+
+    return sum;
+}
+
+static void benchmark_rrdset_done(size_t dimensions, int loop) {
+    fprintf(stderr, "\n\nBenchmarking the collection of %zu dimensions %d times, please wait...\n\n", dimensions, loop);
+
+    // ------------------------------------------------------------------------
+    // the collection state alone, in both layouts
+
+    // every linked dimension is allocated with the size of a real dimension
+    size_t linked_size = sizeof(RRDDIM) + 60 * sizeof(storage_number);
+    struct benchmark_linked_dimension *root = NULL, **last = &root;
+
+    struct rrdset_collection c = {
+            .size = dimensions,
+            .used = dimensions,
+            .rd = NULL,
+            .updated = callocz(dimensions, sizeof(uint8_t)),
+            .collections_counter = callocz(dimensions, sizeof(size_t)),
+            .algorithm = callocz(dimensions, sizeof(RRD_ALGORITHM)),
+            .multiplier = callocz(dimensions, sizeof(calculated_number)),
+            .divisor = callocz(dimensions, sizeof(calculated_number)),
+            .collected_value = callocz(dimensions, sizeof(collected_number)),
+            .last_collected_value = callocz(dimensions, sizeof(collected_number)),
+            .calculated_value = callocz(dimensions, sizeof(calculated_number)),
+            .last_calculated_value = callocz(dimensions, sizeof(calculated_number))
+    };
+
+    size_t d;
+    for(d = 0; d < dimensions ; d++) {
+        struct benchmark_linked_dimension *ld = callocz(1, linked_size);
+        ld->algorithm = (d % 2) ? RRD_ALGORITHM_INCREMENTAL : RRD_ALGORITHM_ABSOLUTE;
+        ld->multiplier = 1;
+        ld->divisor = 1;
+        ld->collected_value = (collected_number)d;
+        *last = ld;
+        last = &ld->next;
+
+        c.algorithm[d] = ld->algorithm;
+        c.multiplier[d] = 1;
+        c.divisor[d] = 1;
+        c.collected_value[d] = (collected_number)d;
+    }
+
+    usec_t started = now_monotonic_usec();
+    calculated_number linked_sum = benchmark_linked_dimensions(root, loop);
+    usec_t linked_ut = now_monotonic_usec() - started;
+
+    started = now_monotonic_usec();
+    calculated_number arrays_sum = benchmark_collection_arrays(&c, loop);
+    usec_t arrays_ut = now_monotonic_usec() - started;
+
+    fprintf(stderr, "LINKED LIST OF DIMENSIONS : %llu usec (sum " CALCULATED_NUMBER_FORMAT ")\n", linked_ut, linked_sum);
+    fprintf(stderr, "ARRAYS OF THE CHART       : %llu usec (sum " CALCULATED_NUMBER_FORMAT ")\n", arrays_ut, arrays_sum);
+    if(arrays_ut)
+        fprintf(stderr, "THE ARRAYS ARE %0.2f TIMES FASTER\n", (double)linked_ut / (double)arrays_ut);
+
+    while(root) {
+        struct benchmark_linked_dimension *next = root->next;
+        freez(root);
+        root = next;
+    }
+
+    freez(c.updated);
+    freez(c.collections_counter);
+    freez(c.algorithm);
+    freez(c.multiplier);
+    freez(c.divisor);
+    freez(c.collected_value);
+    freez(c.last_collected_value);
+    freez(c.calculated_value);
+    freez(c.last_calculated_value);
+
+    // ------------------------------------------------------------------------
+    // rrdset_done() on a real chart
+
+    RRDSET *st = rrdset_create_custom(localhost, "hibenchmarks", "unittest-benchmark-rrdset-done", NULL, "hibenchmarks", NULL, "Unit Testing", "a value", "unittest", NULL, 1, 1
+                              , RRDSET_TYPE_LINE, RRD_MEMORY_MODE_ALLOC, 60, RRD_STORAGE_FORMAT_32BIT);
+
+    RRDDIM **rds = callocz(dimensions, sizeof(RRDDIM *));
+    for(d = 0; d < dimensions ; d++) {
+        char id[101];
+        snprintfz(id, 100, "dim%zu", d);
+        rds[d] = rrddim_add(st, id, NULL, 1, 1, (d % 2) ? RRD_ALGORITHM_INCREMENTAL : RRD_ALGORITHM_ABSOLUTE);
+    }
+
+    struct timeval now;
+    now_realtime_timeval(&now);
+
+    started = now_monotonic_usec();
+
+    int l;
+    for(l = 0; l < loop ; l++) {
+        if(l) st->usec_since_last_update = USEC_PER_SEC;
+        else st->last_collected_time = now;
+
+        for(d = 0; d < dimensions ; d++)
+            rrddim_set_by_pointer(st, rds[d], (collected_number)(d * l));
+
+        rrdset_done(st);
+    }
+
+    usec_t done_ut = now_monotonic_usec() - started;
+    fprintf(stderr, "RRDSET_DONE()             : %llu usec, %0.2f usec per call\n", done_ut, (double)done_ut / (double)loop);
+
+    freez(rds);
+}
+
+// ----------------------------------------------------------------------------
+// benchmark of the chart and dimension indexes
+
+// a chart or a dimension, indexed both ways
+struct benchmark_index_item {
+    avl avl;                    // the binary index - this has to be first!
+    const char *id;
+    uint32_t hash;
+
+    // the dimensions of a chart
+    avl_tree_lock dimensions_avl;
+    HASH_INDEX dimensions_hash;
+};
+
+// the comparison of the binary indexes of charts and dimensions, as it used to be
+static int benchmark_index_compare(void *a, void *b) {
+    if(((struct benchmark_index_item *)a)->hash < ((struct benchmark_index_item *)b)->hash) return -1;
+    else if(((struct benchmark_index_item *)a)->hash > ((struct benchmark_index_item *)b)->hash) return 1;
+    else return strcmp(((struct benchmark_index_item *)a)->id, ((struct benchmark_index_item *)b)->id);
+}
+
+static inline struct benchmark_index_item *benchmark_index_avl_find(avl_tree_lock *index, const char *id) {
+    struct benchmark_index_item tmp = {
+            .id = id,
+            .hash = simple_hash(id)
+    };
+    return (struct benchmark_index_item *)avl_search_lock(index, (avl *)&tmp);
+}
+
+struct benchmark_index_command {
+    int begin;                  // 1 for BEGIN, 0 for SET
+    const char *id;
+};
+
+// replay the lookups of a plugins.d stream, returns the number of lookups that found their item
+static size_t benchmark_index_replay_avl(avl_tree_lock *charts, struct benchmark_index_command *commands, size_t count, int loop) {
+    size_t found = 0, c;
+    int l;
+
+    for(l = 0; l < loop ; l++) {
+        struct benchmark_index_item *st = NULL;
+
+        for(c = 0; c < count ; c++) {
+            if(commands[c].begin)
+                st = benchmark_index_avl_find(charts, commands[c].id);
+            else if(likely(st) && likely(benchmark_index_avl_find(&st->dimensions_avl, commands[c].id)))
+                found++;
+        }
+    }
+
+    return found;
+}
+
+static size_t benchmark_index_replay_hash(HASH_INDEX *charts, struct benchmark_index_command *commands, size_t count, int loop) {
+    size_t found = 0, c;
+    int l;
+
+    for(l = 0; l < loop ; l++) {
+        struct benchmark_index_item *st = NULL;
+
+        for(c = 0; c < count ; c++) {
+            if(commands[c].begin)
+                st = hash_index_search(charts, commands[c].id, simple_hash(commands[c].id));
+            else if(likely(st) && likely(hash_index_search(&st->dimensions_hash, commands[c].id, simple_hash(commands[c].id))))
+                found++;
+        }
+    }
+
+    return found;
+}
+
+static int benchmark_rrd_indexes(size_t charts, size_t dimensions, int loop) {
+    fprintf(stderr, "\n\nBenchmarking the lookups of a plugins.d stream of %zu charts with %zu dimensions each, %d times, please wait...\n\n", charts, dimensions, loop);
+
+    int errors = 0;
+
+    avl_tree_lock charts_avl;
+    avl_init_lock(&charts_avl, benchmark_index_compare);
+
+    HASH_INDEX charts_hash;
+    hash_index_init(&charts_hash, offsetof(struct benchmark_index_item, id));
+
+    // the stream a plugin sends for one iteration of all its charts
+    BUFFER *wb = buffer_create(charts * dimensions * 30);
+
+    struct benchmark_index_item *items = callocz(charts * (dimensions + 1), sizeof(struct benchmark_index_item));
+    size_t c, d, i = 0;
+    char id[RRD_ID_LENGTH_MAX + 1];
+
+    for(c = 0; c < charts ; c++) {
+        struct benchmark_index_item *st = &items[i++];
+        snprintfz(id, RRD_ID_LENGTH_MAX, "unittest_%zu.chart_%zu", c % 100, c);
+        st->id = string_intern(id);
+        st->hash = simple_hash(st->id);
+        avl_init_lock(&st->dimensions_avl, benchmark_index_compare);
+        hash_index_init(&st->dimensions_hash, offsetof(struct benchmark_index_item, id));
+        if(avl_insert_lock(&charts_avl, (avl *)st) != (avl *)st || hash_index_insert(&charts_hash, st, st->hash) != st) {
+            fprintf(stderr, "    cannot index chart '%s' ### E R R O R ###\n", st->id);
+            errors++;
+        }
+
+        buffer_sprintf(wb, "BEGIN %s\n", st->id);
+
+        for(d = 0; d < dimensions ; d++) {
+            struct benchmark_index_item *rd = &items[i++];
+            snprintfz(id, RRD_ID_LENGTH_MAX, "dimension_%zu", d);
+            rd->id = string_intern(id);
+            rd->hash = simple_hash(rd->id);
+            if(avl_insert_lock(&st->dimensions_avl, (avl *)rd) != (avl *)rd || hash_index_insert(&st->dimensions_hash, rd, rd->hash) != rd) {
+                fprintf(stderr, "    cannot index dimension '%s' of chart '%s' ### E R R O R ###\n", rd->id, st->id);
+                errors++;
+            }
+
+            buffer_sprintf(wb, "SET %s = %zu\n", rd->id, d);
+        }
+
+        buffer_strcat(wb, "END\n");
+    }
+
+    // parse the stream once - we measure only the lookups
+    size_t count = 0;
+    struct benchmark_index_command *commands = mallocz(charts * (dimensions + 1) * sizeof(struct benchmark_index_command));
+    char *line = (char *)buffer_tostring(wb), *next;
+    for(; line && *line ; line = next) {
+        next = strchr(line, '\n');
+        if(next) *next++ = '\0';
+
+        char *words[PLUGINSD_MAX_WORDS] = { NULL };
+        pluginsd_split_words(line, words, PLUGINSD_MAX_WORDS);
+        if(!words[0] || !words[1]) continue;
+
+        if(!strcmp(words[0], "BEGIN") || !strcmp(words[0], "SET")) {
+            commands[count].begin = (words[0][0] == 'B');
+            commands[count].id = words[1];
+            count++;
+        }
+    }
+
+    usec_t started = now_monotonic_usec();
+    size_t avl_found = benchmark_index_replay_avl(&charts_avl, commands, count, loop);
+    usec_t avl_ut = now_monotonic_usec() - started;
+
+    started = now_monotonic_usec();
+    size_t hash_found = benchmark_index_replay_hash(&charts_hash, commands, count, loop);
+    usec_t hash_ut = now_monotonic_usec() - started;
+
+    fprintf(stderr, "AVL INDEXES  : %llu usec, %zu dimensions found\n", avl_ut, avl_found);
+    fprintf(stderr, "HASH INDEXES : %llu usec, %zu dimensions found\n", hash_ut, hash_found);
+    if(hash_ut)
+        fprintf(stderr, "THE HASH INDEXES ARE %0.2f TIMES FASTER\n", (double)avl_ut / (double)hash_ut);
+
+    if(avl_found != hash_found || hash_found != charts * dimensions * loop) {
+        fprintf(stderr, "THE INDEXES FOUND %zu AND %zu DIMENSIONS, EXPECTED %zu ### E R R O R ###\n", avl_found, hash_found, charts * dimensions * loop);
+        errors++;
+    }
+
+    for(i = 0; i < charts * (dimensions + 1) ; i++) {
+        if(items[i].dimensions_hash.key_offset) // only the charts have dimensions
+            hash_index_destroy(&items[i].dimensions_hash);
+        string_intern_release(items[i].id);
+    }
+
+    hash_index_destroy(&charts_hash);
+    freez(commands);
+    freez(items);
+    buffer_free(wb);
+    return errors;
+}
+
+static int test_rrdr_cache(void) {
+    fprintf(stderr, "\nTesting the query cache against the queries\n");
+
+    struct timeval now;
+    int errors = 0, m;
+    long c, step;
+
+    now_realtime_timeval(&now);
+
+    RRDSET *st = rrdset_create_localhost("hibenchmarks", "unittest-query-cache", NULL, "hibenchmarks", NULL, "Unit Testing", "a value", "unittest", NULL, 1, 1, RRDSET_TYPE_LINE);
+    RRDDIM *rd1 = rrddim_add(st, "value1", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+    RRDDIM *rd2 = rrddim_add(st, "value2", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+
+    for(c = 0; c < st->entries + 10 ; c++) {
+        if(c) st->usec_since_last_update = USEC_PER_SEC;
+        else st->last_collected_time = now;
+
+        rrddim_set_by_pointer(st, rd1, c * c % 97);
+        rrddim_set_by_pointer(st, rd2, (c % 5) ? c : 0);
+        rrdset_done(st);
+    }
+
+    struct {
+        long points;
+        long long after;
+        int group_method;
+    } queries[] = {
+            { 60, -600, GROUP_AVERAGE },
+            { 600, -600, GROUP_MAX },
+            { 20, -3600, GROUP_SUM },
+            { 0, 0, 0 }
+    };
+
+    struct rrdr_cache_stats before, after;
+    rrdr_cache_get_stats(&before);
+
+    long entries = rrdr_cache_entries;
+    BUFFER *wb = buffer_create(1);
+    BUFFER *expected = buffer_create(1);
+
+    for(step = 0; step < 25 ; step++) {
+        for(m = 0; queries[m].points ; m++) {
+            rrdr_cache_entries = 0;
+            buffer_flush(expected);
+            rrdset2anything_api_v1(st, expected, NULL, DATASOURCE_CSV, queries[m].points, queries[m].after, 0, queries[m].group_method, 0, RRDR_OPTION_SECONDS, NULL, NULL);
+
+            // the first is queried or slid, the second is reused
+            int i;
+            for(i = 0; i < 2 ; i++) {
+                rrdr_cache_entries = entries;
+                buffer_flush(wb);
+                rrdset2anything_api_v1(st, wb, NULL, DATASOURCE_CSV, queries[m].points, queries[m].after, 0, queries[m].group_method, 0, RRDR_OPTION_SECONDS, NULL, NULL);
+
+                if(strcmp(buffer_tostring(wb), buffer_tostring(expected)) != 0) {
+                    fprintf(stderr, "    step %ld, query %d: the cached result differs from the query ### E R R O R ###\n", step, m);
+                    errors++;
+                }
+            }
+        }
+
+        st->usec_since_last_update = USEC_PER_SEC;
+        rrddim_set_by_pointer(st, rd1, c * c % 97);
+        rrddim_set_by_pointer(st, rd2, (c % 5) ? c : 0);
+        rrdset_done(st);
+        c++;
+    }
+
+    rrdr_cache_entries = entries;
+
+    // the JSON wrapper gives the cursor to resume the result with
+    char cursor[100] = "";
+    buffer_flush(wb);
+    rrdset2anything_api_v1(st, wb, NULL, DATASOURCE_JSON, 60, -600, 0, GROUP_AVERAGE, 0, RRDR_OPTION_JSON_WRAP, NULL, NULL);
+
+    char *s = strstr(buffer_tostring(wb), "\"cursor\": \"");
+    if(s) {
+        s += 11;
+        size_t len = strcspn(s, "\"");
+        if(len < sizeof(cursor)) {
+            strncpy(cursor, s, len);
+            cursor[len] = '\0';
+        }
+    }
+
+    if(!*cursor) {
+        fprintf(stderr, "    the JSON wrapper does not have a cursor ### E R R O R ###\n");
+        errors++;
+    }
+
+    rrdr_cache_get_stats(&after);
+    for(step = 0; step < 10 ; step++) {
+        st->usec_since_last_update = USEC_PER_SEC;
+        rrddim_set_by_pointer(st, rd1, c * c % 97);
+        rrddim_set_by_pointer(st, rd2, (c % 5) ? c : 0);
+        rrdset_done(st);
+        c++;
+    }
+
+    buffer_flush(wb);
+    rrdset2anything_api_v1(st, wb, NULL, DATASOURCE_CSV, 60, -600, 0, GROUP_AVERAGE, 0, RRDR_OPTION_SECONDS, cursor, NULL);
+
+    rrdr_cache_entries = 0;
+    buffer_flush(expected);
+    rrdset2anything_api_v1(st, expected, NULL, DATASOURCE_CSV, 60, -600, 0, GROUP_AVERAGE, 0, RRDR_OPTION_SECONDS, NULL, NULL);
+    rrdr_cache_entries = entries;
+
+    size_t updates = after.updates;
+    rrdr_cache_get_stats(&after);
+
+    if(after.updates != updates + 1 || strcmp(buffer_tostring(wb), buffer_tostring(expected)) != 0) {
+        fprintf(stderr, "    the result of cursor '%s' was not resumed ### E R R O R ###\n", cursor);
+        errors++;
+    }
+
+    if(after.hits - before.hits < 25 * 3 || after.updates == before.updates) {
+        fprintf(stderr, "    the cache was not used, %zu hits and %zu updates ### E R R O R ###\n", after.hits - before.hits, after.updates - before.updates);
+        errors++;
+    }
+
+    fprintf(stderr, "    %zu hits, %zu updates and %zu misses of the query cache\n"
+            , after.hits - before.hits, after.updates - before.updates, after.misses - before.misses);
+
+    buffer_free(wb);
+    buffer_free(expected);
+    return errors;
+}
+
+static int test_rrdr_grouping_methods(void) {
+    fprintf(stderr, "\nTesting the grouping methods of the queries\n");
+
+    struct timeval now;
+    int errors = 0, m;
+    long c;
+
+    now_realtime_timeval(&now);
+    now.tv_usec = 0; // collected on the second, so that the values are not interpolated
+
+    RRDSET *st = rrdset_create_localhost("hibenchmarks", "unittest-grouping-methods", NULL, "hibenchmarks", NULL, "Unit Testing", "a value", "unittest", NULL, 1, 1, RRDSET_TYPE_LINE);
+    RRDDIM *rd1 = rrddim_add(st, "cycle", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+    RRDDIM *rd2 = rrddim_add(st, "line", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+
+    for(c = 0; c < 1000 ; c++) {
+        if(c) st->usec_since_last_update = USEC_PER_SEC;
+        else st->last_collected_time = now;
+
+        rrddim_set_by_pointer(st, rd1, c % 100);
+        rrddim_set_by_pointer(st, rd2, c * 3);
+        rrdset_done(st);
+    }
+
+    // any 100 seconds of the cycle have all the values 0 ... 99
+    struct {
+        const char *dimension;
+        int group_method;
+        calculated_number expected;
+    } tests[] = {
+            { "cycle", GROUP_AVERAGE,      49.5 },
+            { "cycle", GROUP_MEDIAN,       49.5 },
+            { "cycle", GROUP_PERCENTILE95, 94.05 },
+            { "cycle", GROUP_PERCENTILE99, 98.01 },
+            { "cycle", GROUP_STDDEV,       29.011492 },
+            { "cycle", GROUP_CV,           58.609075 },
+            { "line",  GROUP_RATE,         3 },
+            { NULL, 0, 0 }
+    };
+
+    for(m = 0; tests[m].dimension ; m++) {
+        calculated_number n = NAN;
+        int value_is_null = 0;
+
+        rrdset_rdlock(st);
+        rrdset2value_api_v1(st, NULL, &n, tests[m].dimension, 1, -100, 0, tests[m].group_method, 0, RRDR_OPTION_NOT_ALIGNED, NULL, NULL, &value_is_null);
+        rrdset_unlock(st);
+
+        fprintf(stderr, "    %-13s of %-5s: expected " CALCULATED_NUMBER_FORMAT ", got " CALCULATED_NUMBER_FORMAT, group_method2string(tests[m].group_method), tests[m].dimension, tests[m].expected, n);
+        if(value_is_null || calculated_number_fabs(n - tests[m].expected) > 0.0001) {
+            fprintf(stderr, " ### E R R O R ###\n");
+            errors++;
+        }
+        else
+            fprintf(stderr, " OK\n");
+    }
+
+    return errors;
+}
+
+static int test_web_api_v1_batch(void) {
+    fprintf(stderr, "\nTesting the batch queries\n");
+
+    int errors = 0, i;
+    RRDSET *st = rrdset_find_localhost("hibenchmarks.unittest-grouping-methods");
+    if(!st) {
+        fprintf(stderr, "    the chart of the grouping methods is not found ### E R R O R ###\n");
+        return 1;
+    }
+
+    web_client_api_v1_init();
+
+    long threads = hibenchmarks_workers_threads;
+    hibenchmarks_workers_threads = 4;
+
+    struct web_client *w = callocz(1, sizeof(struct web_client));
+    w->response.data = buffer_create(1);
+
+    // many queries, so that the threads of the pool get some of them
+    BUFFER *url = buffer_create(1);
+    for(i = 0; i < 64 ; i++)
+        buffer_sprintf(url, "%squery=chart:%s;points:%d;group:max", (i) ? "&" : "", (i % 3) ? st->id : "not.there", i % 7 + 1);
+    buffer_strcat(url, "&after=-100&options=seconds");
+
+    char *s = strdupz(buffer_tostring(url));
+    int ret = web_client_api_request_v1_batch(localhost, w, s);
+    freez(s);
+
+    const char *response = buffer_tostring(w->response.data);
+    BUFFER *expected = buffer_create(1);
+    int found = 0, not_found = 0;
+
+    const char *p = response;
+    for(i = 0; i < 64 ; i++) {
+        p = strstr(p, "\"status\": ");
+        if(!p) break;
+        p += 10;
+
+        if(i % 3) {
+            buffer_flush(expected);
+            rrdset2anything_api_v1(st, expected, NULL, DATASOURCE_JSON, i % 7 + 1, -100, 0, GROUP_MAX, 0, RRDR_OPTION_SECONDS, NULL, NULL);
+
+            const char *result = strstr(p, "\"result\": ");
+            if(!strncmp(p, "200", 3) && result && !strncmp(result + 10, buffer_tostring(expected), buffer_strlen(expected)))
+                found++;
+        }
+        else if(!strncmp(p, "404", 3))
+            not_found++;
+    }
+
+    if(ret != 200 || found != 42 || not_found != 22) {
+        fprintf(stderr, "    the batch returned %d, with %d of 42 results and %d of 22 missing charts ### E R R O R ###\n", ret, found, not_found);
+        errors++;
+    }
+    else
+        fprintf(stderr, "    %d results and %d missing charts, in the order of the queries OK\n", found, not_found);
+
+    // the threads of the pool are joined, and started again by the next run
+    hibenchmarks_workers_stop();
+    hibenchmarks_workers_threads = threads;
+    buffer_free(expected);
+    buffer_free(url);
+    buffer_free(w->response.data);
+    freez(w);
+    return errors;
+}
+
+static int test_rrdcontext_queries(void) {
+    fprintf(stderr, "\nTesting the context queries\n");
+
+    struct timeval now;
+    int errors = 0, m;
+    long c, k;
+
+    now_realtime_timeval(&now);
+    now.tv_usec = 0;
+
+    // three charts of the same context - all have 'a', the first has 'b' too
+    RRDSET *st[3];
+    RRDDIM *rda[3], *rdb = NULL;
+    for(k = 0; k < 3 ; k++) {
+        char id[101];
+        snprintfz(id, 100, "unittest-context-%ld", k);
+        st[k] = rrdset_create_localhost("hibenchmarks", id, NULL, "hibenchmarks", "hibenchmarks.unittest_context", "Unit Testing", "a value", "unittest", NULL, 1, 1, RRDSET_TYPE_LINE);
+        rda[k] = rrddim_add(st[k], "a", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+        if(!k) rdb = rrddim_add(st[k], "b", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+    }
+
+    for(c = 0; c < 200 ; c++) {
+        for(k = 0; k < 3 ; k++) {
+            if(c) st[k]->usec_since_last_update = USEC_PER_SEC;
+            else st[k]->last_collected_time = now;
+
+            rrddim_set_by_pointer(st[k], rda[k], k + 1);
+            if(!k) rrddim_set_by_pointer(st[k], rdb, 10);
+            rrdset_done(st[k]);
+        }
+    }
+
+    struct {
+        const char *hosts;
+        const char *charts;
+        int aggregation;
+        const char *row;
+    } tests[] = {
+            { NULL, NULL,                      RRDR_AGGREGATION_SUM,     ",6,10" },
+            { "*",  NULL,                      RRDR_AGGREGATION_SUM,     ",6,10" },
+            { NULL, NULL,                      RRDR_AGGREGATION_AVERAGE, ",2,10" },
+            { NULL, NULL,                      RRDR_AGGREGATION_MAX,     ",3,10" },
+            { NULL, "*context-1 *context-2",   RRDR_AGGREGATION_MIN,     ",2" },
+            { NULL, NULL, 0, NULL }
+    };
+
+    BUFFER *wb = buffer_create(1);
+    for(m = 0; tests[m].row ; m++) {
+        buffer_flush(wb);
+        int ret = rrdcontext2anything_api_v1(localhost, "hibenchmarks.unittest_context", tests[m].hosts, tests[m].charts, tests[m].aggregation
+                                             , wb, NULL, DATASOURCE_CSV, 10, -100, 0, GROUP_AVERAGE, 0, RRDR_OPTION_SECONDS, NULL);
+
+        // every row, after the header, has the aggregated values
+        long rows = 0, wrong = 0;
+        char *s = strdupz(buffer_tostring(wb)), *line, *ptr = s;
+        while((line = mystrsep(&ptr, "\r\n")) && *line) {
+            if(!strncmp(line, "time", 4)) continue;
+
+            const char *values = strchr(line, ',');
+            if(!values || strcmp(values, tests[m].row) != 0) wrong++;
+            rows++;
+        }
+        freez(s);
+
+        if(ret != 200 || !rows || wrong) {
+            fprintf(stderr, "    query %d returned %d, %ld of %ld rows are not '%s' ### E R R O R ###\n", m, ret, wrong, rows, tests[m].row);
+            errors++;
+        }
+        else
+            fprintf(stderr, "    query %d: %ld rows of '%s' OK\n", m, rows, tests[m].row);
+    }
+
+    buffer_flush(wb);
+    if(rrdcontext2anything_api_v1(localhost, "hibenchmarks.unittest_no_context", NULL, NULL, RRDR_AGGREGATION_SUM
+                                  , wb, NULL, DATASOURCE_CSV, 10, -100, 0, GROUP_AVERAGE, 0, 0, NULL) != 404) {
+        fprintf(stderr, "    a context without charts is found ### E R R O R ###\n");
+        errors++;
+    }
+
+    buffer_free(wb);
+    return errors;
+}
+
+static int test_rrdr2binary(void) {
+    fprintf(stderr, "\nTesting the binary format against the csv one\n");
+
+    int errors = 0;
+    RRDSET *st = rrdset_find_localhost("hibenchmarks.unittest-grouping-methods");
+    if(!st) {
+        fprintf(stderr, "    the chart of the grouping methods is not found ### E R R O R ###\n");
+        return 1;
+    }
+
+    BUFFER *bin = buffer_create(1), *csv = buffer_create(1);
+    rrdset_rdlock(st);
+    rrdset2anything_api_v1(st, bin, NULL, DATASOURCE_BINARY, 20, -600, 0, GROUP_AVERAGE, 0, RRDR_OPTION_SECONDS, NULL, NULL);
+    rrdset2anything_api_v1(st, csv, NULL, DATASOURCE_CSV, 20, -600, 0, GROUP_AVERAGE, 0, RRDR_OPTION_SECONDS, NULL, NULL);
+    rrdset_unlock(st);
+
+    RRDR_BINARY_HEADER h;
+    memcpy(&h, bin->buffer, sizeof(h));
+
+    if(memcmp(h.magic, RRDR_BINARY_MAGIC, 4) != 0 || h.version != RRDR_BINARY_VERSION || h.dimensions != 2 || !h.rows
+       || (h.names_bytes % 8) || buffer_strlen(bin) != sizeof(h) + h.names_bytes + (h.dimensions + 1) * h.rows * sizeof(double)) {
+        fprintf(stderr, "    the header of the binary format is wrong ### E R R O R ###\n");
+        buffer_free(bin);
+        buffer_free(csv);
+        return 1;
+    }
+
+    const char *names = bin->buffer + sizeof(h);
+    if(strcmp(names, "cycle") != 0 || strcmp(names + 6, "cycle") != 0 || strcmp(names + 12, "line") != 0) {
+        fprintf(stderr, "    the names of the binary format are wrong ### E R R O R ###\n");
+        errors++;
+    }
+
+    // every line of the csv, after its header, is a row of the binary
+    const double *timestamps = (const double *)(bin->buffer + sizeof(h) + h.names_bytes);
+    const double *values = timestamps + h.rows;
+
+    char *ptr = csv->buffer, *line;
+    uint32_t row = 0;
+    mystrsep(&ptr, "\r\n");
+    while((line = mystrsep(&ptr, "\r\n")) && *line && row < h.rows) {
+        calculated_number t = str2ld(line, &line);
+        calculated_number v1 = str2ld(line + 1, &line);
+        calculated_number v2 = str2ld(line + 1, &line);
+
+        if(t != timestamps[row] || calculated_number_fabs(v1 - values[row]) > 0.0001 || calculated_number_fabs(v2 - values[h.rows + row]) > 0.0001) {
+            fprintf(stderr, "    row %u: csv has " CALCULATED_NUMBER_FORMAT " " CALCULATED_NUMBER_FORMAT " " CALCULATED_NUMBER_FORMAT
+                    ", binary has %f %f %f ### E R R O R ###\n", row, t, v1, v2, timestamps[row], values[row], values[h.rows + row]);
+            errors++;
+        }
+        row++;
+    }
+
+    if(row != h.rows) {
+        fprintf(stderr, "    the csv has %u rows, the binary %u ### E R R O R ###\n", row, h.rows);
+        errors++;
+    }
+
+    if(!errors)
+        fprintf(stderr, "    %u rows of %u dimensions, in %zu bytes, instead of %zu of csv OK\n", h.rows, h.dimensions, buffer_strlen(bin), buffer_strlen(csv));
+
+    buffer_free(bin);
+    buffer_free(csv);
+    return errors;
+}
+
+static int test_rrdr_stream(void) {
+    fprintf(stderr, "\nTesting the streamed results against the complete ones\n");
+
+    RRDSET *st = rrdset_find_localhost("hibenchmarks.unittest-grouping-methods");
+    if(!st) {
+        fprintf(stderr, "    the chart of the grouping methods is not found ### E R R O R ###\n");
+        return 1;
+    }
+
+    struct {
+        const char *name;
+        uint32_t format;
+        uint32_t options;
+    } tests[] = {
+        { "csv",               DATASOURCE_CSV,            RRDR_OPTION_SECONDS },
+        { "csv reversed",      DATASOURCE_CSV,            RRDR_OPTION_SECONDS | RRDR_OPTION_REVERSED },
+        { "json",              DATASOURCE_JSON,           RRDR_OPTION_SECONDS },
+        { "datatable",         DATASOURCE_DATATABLE_JSON, 0 },
+        { "html reversed",     DATASOURCE_HTML,           RRDR_OPTION_REVERSED },
+        { "array",             DATASOURCE_JS_ARRAY,       RRDR_OPTION_MILLISECONDS },
+        { NULL, 0, 0 }
+    };
+
+    // blocks of 1 row, of the 2 dimensions of the chart
+    long stream_values = rrdr_stream_values;
+    rrdr_stream_values = 1 * 2 * 16;
+
+    int errors = 0, i;
+    BUFFER *streamed = buffer_create(1), *complete = buffer_create(1);
+
+    for(i = 0; tests[i].name ; i++) {
+        buffer_flush(streamed);
+        buffer_flush(complete);
+
+        RRDR_STREAM *s = rrdset2anything_api_v1_stream(st, streamed, NULL, tests[i].format, 20, -600, 0, GROUP_AVERAGE, 0, tests[i].options);
+        if(!s) {
+            fprintf(stderr, "    %s: the result is not streamed ### E R R O R ###\n", tests[i].name);
+            errors++;
+            continue;
+        }
+
+        // the chart is read only while each block is queried
+        size_t parts = 1, readers = rrdset_readers(st);
+        while(rrdr_stream_next(s, streamed)) {
+            readers += rrdset_readers(st);
+            parts++;
+        }
+        rrdr_stream_free(s);
+        parts++;
+
+        if(readers) {
+            fprintf(stderr, "    %s: the chart is read between the blocks ### E R R O R ###\n", tests[i].name);
+            errors++;
+        }
+
+        rrdset2anything_api_v1(st, complete, NULL, tests[i].format, 20, -600, 0, GROUP_AVERAGE, 0, tests[i].options, NULL, NULL);
+
+        if(strcmp(buffer_tostring(streamed), buffer_tostring(complete)) != 0) {
+            fprintf(stderr, "    %s: the streamed result differs ### E R R O R ###\n--- streamed:\n%s\n--- complete:\n%s\n"
+                    , tests[i].name, buffer_tostring(streamed), buffer_tostring(complete));
+            errors++;
+        }
+        else
+            fprintf(stderr, "    %s: %zu bytes in %zu parts OK\n", tests[i].name, buffer_strlen(streamed), parts);
+    }
+
+    // a small result is not streamed
+    rrdr_stream_values = stream_values;
+    buffer_flush(streamed);
+    RRDR_STREAM *s = rrdset2anything_api_v1_stream(st, streamed, NULL, DATASOURCE_CSV, 20, -600, 0, GROUP_AVERAGE, 0, 0);
+    if(s || buffer_strlen(streamed)) {
+        fprintf(stderr, "    a small result is streamed ### E R R O R ###\n");
+        rrdr_stream_free(s);
+        errors++;
+    }
+
+    buffer_free(streamed);
+    buffer_free(complete);
+    return errors;
+}
+
+static void rrdset_summaries_detach(RRDSET *st, struct rrddim_summaries **saved) {
+    RRDDIM *rd;
+    int c;
+    for(rd = st->dimensions, c = 0; rd ; rd = rd->next, c++) {
+        saved[c] = rd->summaries;
+        rd->summaries = NULL;
+    }
+}
+
+static void rrdset_summaries_attach(RRDSET *st, struct rrddim_summaries **saved) {
+    RRDDIM *rd;
+    int c;
+    for(rd = st->dimensions, c = 0; rd ; rd = rd->next, c++)
+        rd->summaries = saved[c];
+}
+
+static int test_rrddim_summaries(void) {
+    fprintf(stderr, "\nTesting the queries answered from the summaries of the dimensions\n");
+
+    struct timeval now;
+    int errors = 0, m;
+    long c;
+
+    now_realtime_timeval(&now);
+    now.tv_usec = 0; // collected on the second, so that the values are not interpolated
+
+    RRDSET *st = rrdset_create_custom(localhost, "hibenchmarks", "unittest-summaries", NULL, "hibenchmarks", NULL, "Unit Testing", "a value", "unittest", NULL, 1, 1
+                                      , RRDSET_TYPE_LINE, RRD_MEMORY_MODE_ALLOC, 1000, RRD_STORAGE_FORMAT_32BIT);
+
+    // integers, so that the sums do not depend on the order they are added
+    RRDDIM *rd1 = rrddim_add(st, "signed", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+    RRDDIM *rd2 = rrddim_add(st, "gaps", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+
+    if(!rd1->summaries || !rd2->summaries) {
+        fprintf(stderr, "    the dimensions do not have summaries ### E R R O R ###\n");
+        return 1;
+    }
+
+    // more than the entries of the chart, so that the slots are overwritten
+    for(c = 0; c < 2500 ; c++) {
+        if(c) st->usec_since_last_update = USEC_PER_SEC;
+        else st->last_collected_time = now;
+
+        rrddim_set_by_pointer(st, rd1, (c % 13) - 6);
+        if(c % 7 && (c / 100) % 5) rrddim_set_by_pointer(st, rd2, c % 50);
+        rrdset_done(st);
+    }
+
+    time_t before = st->last_updated.tv_sec, after = before - 900;
+
+    struct {
+        long points;
+        long group_time;
+        uint32_t options;
+    } queries[] = {
+            { 1,  0,   RRDR_OPTION_NOT_ALIGNED },
+            { 7,  0,   0 },
+            { 7,  0,   RRDR_OPTION_NOT_ALIGNED },
+            { 15, 0,   0 },
+            { 9,  0,   RRDR_OPTION_NOT_ALIGNED },
+            { 3,  120, 0 },
+            { 0,  0,   0 }
+    };
+
+    int methods[] = { GROUP_AVERAGE, GROUP_MIN, GROUP_MAX, GROUP_SUM, 0 };
+    struct rrddim_summaries *saved[2];
+
+    BUFFER *summarized = buffer_create(1), *scanned = buffer_create(1);
+    int compared = 0;
+
+    for(m = 0; methods[m] ; m++) {
+        for(c = 0; queries[c].points ; c++) {
+            buffer_flush(summarized);
+            buffer_flush(scanned);
+
+            rrdset2anything_api_v1(st, summarized, NULL, DATASOURCE_CSV, queries[c].points, after, before, methods[m], queries[c].group_time, queries[c].options | RRDR_OPTION_SECONDS, NULL, NULL);
+
+            rrdset_summaries_detach(st, saved);
+            rrdset2anything_api_v1(st, scanned, NULL, DATASOURCE_CSV, queries[c].points, after, before, methods[m], queries[c].group_time, queries[c].options | RRDR_OPTION_SECONDS, NULL, NULL);
+            rrdset_summaries_attach(st, saved);
+
+            if(strcmp(buffer_tostring(summarized), buffer_tostring(scanned)) != 0) {
+                fprintf(stderr, "    %s of %ld points: the summaries give\n%s\n    the slots give\n%s ### E R R O R ###\n"
+                        , group_method2string(methods[m]), queries[c].points, buffer_tostring(summarized), buffer_tostring(scanned));
+                errors++;
+            }
+            else
+                compared++;
+        }
+    }
+
+    if(!errors)
+        fprintf(stderr, "    %d queries give the same results with and without the summaries OK\n", compared);
+
+    // the summaries are used - a changed summary changes the result
+    calculated_number n = NAN, original = NAN;
+    int value_is_null = 0;
+    rrdset2value_api_v1(st, NULL, &original, "gaps", 1, after, before, GROUP_SUM, 0, RRDR_OPTION_NOT_ALIGNED, NULL, NULL, &value_is_null);
+
+    long b;
+    for(b = 0; b < st->entries / RRDDIM_SUMMARY_SLOTS ; b++)
+        rd2->summaries->blocks[b].sum += 1000000;
+
+    rrdset2value_api_v1(st, NULL, &n, "gaps", 1, after, before, GROUP_SUM, 0, RRDR_OPTION_NOT_ALIGNED, NULL, NULL, &value_is_null);
+
+    for(b = 0; b < st->entries / RRDDIM_SUMMARY_SLOTS ; b++)
+        rd2->summaries->blocks[b].sum -= 1000000;
+
+    if(n - original < 1000000) {
+        fprintf(stderr, "    the sum did not change when the summaries did (" CALCULATED_NUMBER_FORMAT " and " CALCULATED_NUMBER_FORMAT ") ### E R R O R ###\n", original, n);
+        errors++;
+    }
+    else
+        fprintf(stderr, "    the queries use %0.0Lf summaries OK\n", (long double)((n - original) / 1000000));
+
+    // how much faster the badges and the alarms get their values
+    {
+        usec_t started = now_monotonic_usec();
+        for(c = 0; c < 10000 ; c++)
+            rrdset2value_api_v1(st, NULL, &n, NULL, 1, after, before, GROUP_AVERAGE, 0, RRDR_OPTION_NOT_ALIGNED, NULL, NULL, &value_is_null);
+        usec_t summarized_ut = now_monotonic_usec() - started;
+
+        rrdset_summaries_detach(st, saved);
+        started = now_monotonic_usec();
+        for(c = 0; c < 10000 ; c++)
+            rrdset2value_api_v1(st, NULL, &n, NULL, 1, after, before, GROUP_AVERAGE, 0, RRDR_OPTION_NOT_ALIGNED, NULL, NULL, &value_is_null);
+        usec_t scanned_ut = now_monotonic_usec() - started;
+        rrdset_summaries_attach(st, saved);
+
+        fprintf(stderr, "    10000 values of 900 seconds: %llu usec with the summaries, %llu usec without them\n", summarized_ut, scanned_ut);
+    }
+
+    // a slot stored twice, invalidates the summary of its block
+    long slot = st->current_entry;
+    rrddim_store_value(rd1, slot, before + 1, 1, SN_EXISTS);
+    rrddim_store_value(rd1, slot, before + 1, 1, SN_EXISTS);
+    if(rd1->summaries->open_valid) {
+        fprintf(stderr, "    a slot stored twice did not invalidate the block ### E R R O R ###\n");
+        errors++;
+    }
+
+    buffer_free(summarized);
+    buffer_free(scanned);
+    return errors;
+}
+
+// the /api/v1/data path, on a chart with all its history collected
+int benchmark_queries(size_t dimensions, long entries, int loop) {
+    fprintf(stderr, "\n\nBenchmarking the queries of %ld points of %zu dimensions, %d times, please wait...\n\n", entries, dimensions, loop);
+
+    RRDSET *st = rrdset_create_custom(localhost, "hibenchmarks", "benchmark-queries", NULL, "hibenchmarks", NULL, "Benchmarking", "a value", "unittest", NULL, 1, 1
+                                      , RRDSET_TYPE_LINE, RRD_MEMORY_MODE_ALLOC, entries, RRD_STORAGE_FORMAT_32BIT);
+
+    if(st->entries != entries) {
+        fprintf(stderr, "The chart has %ld entries, instead of %ld\n", st->entries, entries);
+        return 1;
+    }
+
+    size_t d;
+    for(d = 0; d < dimensions ; d++) {
+        char id[101];
+        snprintfz(id, 100, "dim%zu", d);
+        RRDDIM *rd = rrddim_add(st, id, NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+
+        // a value per slot, with a gap and a reset here and there
+        long slot;
+        for(slot = 0; slot < entries ; slot++) {
+            if(unlikely((slot + d) % 997 == 0))
+                rd->values[slot] = SN_EMPTY_SLOT;
+            else
+                rd->values[slot] = pack_storage_number((calculated_number)((slot * (d + 1)) % 1000) - 250, ((slot + d) % 1009 == 0) ? SN_EXISTS_RESET : SN_EXISTS);
+        }
+    }
+
+    // all the slots have been collected, the last one just now
+    now_realtime_timeval(&st->last_updated);
+    st->current_entry = 0;
+    st->counter = (size_t)entries;
+    st->counter_done = (size_t)entries;
+
+    struct {
+        const char *name;
+        int group_method;
+    } methods[] = {
+            { "average", GROUP_AVERAGE },
+            { "min", GROUP_MIN },
+            { "max", GROUP_MAX },
+            { "sum", GROUP_SUM },
+            { "incremental-sum", GROUP_INCREMENTAL_SUM },
+            { "median", GROUP_MEDIAN },
+            { "percentile95", GROUP_PERCENTILE95 },
+            { "stddev", GROUP_STDDEV },
+            { "rate", GROUP_RATE },
+            { NULL, 0 }
+    };
+
+    // every query is answered from the database
+    long cache_entries = rrdr_cache_entries;
+    rrdr_cache_entries = 0;
+
+    BUFFER *wb = buffer_create(1);
+    usec_t total_ut = 0;
+    int m, i;
+    for(m = 0; methods[m].name ; m++) {
+        usec_t started = now_monotonic_usec();
+
+        for(i = 0; i < loop ; i++) {
+            buffer_flush(wb);
+            rrdset2anything_api_v1(st, wb, NULL, DATASOURCE_JSON, 300, -entries, 0, methods[m].group_method, 0, RRDR_OPTION_JSON_WRAP, NULL, NULL);
+        }
+
+        usec_t ut = now_monotonic_usec() - started;
+        total_ut += ut;
+
+        fprintf(stderr, "GROUP %-16s: %llu usec per query, %0.1f million values per second (%zu bytes of JSON)\n"
+                , methods[m].name
+                , ut / loop
+                , (double)entries * dimensions * loop / (double)ut
+                , buffer_strlen(wb)
+        );
+    }
+
+    fprintf(stderr, "ALL GROUPING METHODS    : %llu usec per query\n", total_ut / (loop * m));
+
+    rrdr_cache_entries = cache_entries;
+    buffer_free(wb);
+    return 0;
+}
+
+#ifdef HIBENCHMARKS_WITH_ZLIB
+// returns 0 when gzip inflates to data
+static int test_gunzip(const char *gzip, size_t gzip_len, const char *data, size_t len) {
+    char *inflated = mallocz(len + 1);
+
+    z_stream z = { .zalloc = Z_NULL, .zfree = Z_NULL, .opaque = Z_NULL };
+    inflateInit2(&z, 15 + 16);
+    z.next_in = (Bytef *)gzip;
+    z.avail_in = (uInt)gzip_len;
+    z.next_out = (Bytef *)inflated;
+    z.avail_out = (uInt)len + 1;
+
+    int ret = (inflate(&z, Z_FINISH) != Z_STREAM_END || z.total_out != len || memcmp(inflated, data, len) != 0);
+
+    inflateEnd(&z);
+    freez(inflated);
+    return ret;
+}
+#endif
+
+static int test_web_files_cache_write(const char *filename, const char *data, size_t len, struct stat *st) {
+    FILE *fp = fopen(filename, "w");
+    if(!fp) return 1;
+
+    fwrite(data, 1, len, fp);
+    fclose(fp);
+
+    return lstat(filename, st);
+}
+
+static int test_web_files_cache(void) {
+    fprintf(stderr, "\nTesting the static web files cache\n");
+
+    char filename[FILENAME_MAX + 1];
+    snprintfz(filename, FILENAME_MAX, "/tmp/hibenchmarks-unittest-web-file-%d.html", getpid());
+
+    int errors = 0;
+    size_t i, len = 0;
+    char data[10000];
+    for(i = 0; i < 100 ; i++)
+        len += snprintfz(&data[len], sizeof(data) - len, "<div class=\"line\">line %zu</div>\n", i);
+
+    struct stat st;
+    if(test_web_files_cache_write(filename, data, len, &st)) {
+        fprintf(stderr, "    cannot write file '%s' ### E R R O R ###\n", filename);
+        return 1;
+    }
+
+    struct web_files_cache_stats before, after;
+    web_files_cache_get_stats(&before);
+
+    WEB_FILE *f1 = web_files_cache_get(filename, &st);
+    WEB_FILE *f2 = web_files_cache_get(filename, &st);
+    web_files_cache_get_stats(&after);
+
+    if(!f1 || f1->len != len || memcmp(f1->data, data, len) != 0) {
+        fprintf(stderr, "    the cached file does not have the contents of the file ### E R R O R ###\n");
+        errors++;
+    }
+    else if(f2 != f1 || after.hits != before.hits + 1 || after.misses != before.misses + 1) {
+        fprintf(stderr, "    the file was read again (hits %zu, misses %zu) ### E R R O R ###\n", after.hits - before.hits, after.misses - before.misses);
+        errors++;
+    }
+
+#ifdef HIBENCHMARKS_WITH_ZLIB
+    if(f1 && !errors) {
+        if(!f1->gzip || f1->gzip_len >= len) {
+            fprintf(stderr, "    the file was not compressed ### E R R O R ###\n");
+            errors++;
+        }
+        else if(test_gunzip(f1->gzip, f1->gzip_len, data, len)) {
+            fprintf(stderr, "    the compressed file does not inflate to the file ### E R R O R ###\n");
+            errors++;
+        }
+        else
+            fprintf(stderr, "    %zu bytes compressed to %zu bytes\n", len, f1->gzip_len);
+    }
+#endif
+
+    // a file that changed is read again
+    char etag[WEB_FILE_ETAG_SIZE + 1];
+    strncpyz(etag, (f1)?f1->etag:"", WEB_FILE_ETAG_SIZE);
+
+    if(f1) web_files_cache_release(f1);
+    if(f2) web_files_cache_release(f2);
+
+    memcpy(data, "<DIV", 4);
+    len -= 10;
+    test_web_files_cache_write(filename, data, len, &st);
+
+    f1 = web_files_cache_get(filename, &st);
+    if(!f1 || f1->len != len || memcmp(f1->data, data, len) != 0 || !strcmp(f1->etag, etag)) {
+        fprintf(stderr, "    the changed file was not read again ### E R R O R ###\n");
+        errors++;
+    }
+    if(f1) web_files_cache_release(f1);
+
+    unlink(filename);
+    return errors;
+}
+
+#ifdef HIBENCHMARKS_WITH_ZLIB
+static int test_web_gzip_shared(void) {
+    fprintf(stderr, "\nTesting the shared gzip responses\n");
+
+    int errors = 0, i;
+    time_t now = now_realtime_sec();
+    BUFFER *expected = buffer_create(1), *wb1 = buffer_create(1), *wb2 = buffer_create(1);
+
+    buffer_strcat(expected, "{\n\t\"charts\": {");
+    for(i = 0; i < 500 ; i++)
+        buffer_sprintf(expected, "%s\n\t\t\"unittest.chart%d\": { \"id\": \"unittest.chart%d\", \"update_every\": 1 }", (i) ? "," : "", i, i);
+    buffer_strcat(expected, "\n\t}\n}");
+
+    // the same request, in the same second, is compressed once
+    const char *key = "unittest-guid 10.0.0.1 /api/v1/charts";
+    buffer_strcat(wb1, buffer_tostring(expected));
+    wb1->contenttype = CT_APPLICATION_JSON;
+
+    int f1 = web_gzip_shared_find(key, now, wb2);
+    int r1 = web_gzip_shared_compress(key, now, wb1);
+    int f2 = web_gzip_shared_find(key, now, wb2);
+
+    if(f1 != 0 || r1 != 0 || f2 != 1 || wb1->len != wb2->len || memcmp(wb1->buffer, wb2->buffer, wb1->len) != 0 || wb2->contenttype != CT_APPLICATION_JSON) {
+        fprintf(stderr, "    the second request was not answered by the shared response (%d, %d, %d) ### E R R O R ###\n", f1, r1, f2);
+        errors++;
+    }
+    else if(test_gunzip(wb2->buffer, wb2->len, buffer_tostring(expected), buffer_strlen(expected))) {
+        fprintf(stderr, "    the shared response does not inflate to the response ### E R R O R ###\n");
+        errors++;
+    }
+    else
+        fprintf(stderr, "    %zu bytes compressed once to %zu bytes and shared OK\n", buffer_strlen(expected), wb2->len);
+
+    // another request, or the same one in the next second, are not found
+    f1 = web_gzip_shared_find("unittest-guid 10.0.0.2 /api/v1/charts", now, wb2);
+    f2 = web_gzip_shared_find(key, now + 1, wb2);
+    if(f1 != 0 || f2 != 0) {
+        fprintf(stderr, "    another request, or a request of the next second, was answered by the shared response (%d, %d) ### E R R O R ###\n", f1, f2);
+        errors++;
+    }
+
+    buffer_free(expected);
+    buffer_free(wb1);
+    buffer_free(wb2);
+    return errors;
+}
+#endif
+
+static int test_web_client_pipelining(void) {
+    fprintf(stderr, "\nTesting the pipelined HTTP requests\n");
+
+    int sv[2];
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1) {
+        fprintf(stderr, "    cannot create a socket pair ### E R R O R ###\n");
+        return 1;
+    }
+
+    struct web_client *w = callocz(1, sizeof(struct web_client));
+    w->response.data = buffer_create(1);
+    w->response.header = buffer_create(1);
+    w->response.header_output = buffer_create(1);
+    w->request = buffer_create(1);
+    w->ifd = w->ofd = sv[0];
+    w->acl = WEB_CLIENT_ACL_DASHBOARD;
+    strcpy(w->origin, "*");
+
+    // the second URL is encoded (it is not found, if it is not decoded), the third is not complete yet
+    buffer_strcat(w->request,
+                  "GET /api/v1/alarms HTTP/1.1\r\nConnection: keep-alive\r\n\r\n"
+                  "GET /api/v1/al%61rms?a%6cl HTTP/1.1\r\nConnection: keep-alive\r\n\r\n"
+                  "GET /api/v1/alarm_log HTTP/1.1\r\nConn");
+
+    int errors = 0, i;
+    web_client_process_request(w);
+    for(i = 0; i < 10 && web_client_has_wait_send(w) && !web_client_check_dead(w) ; i++)
+        web_client_send(w);
+
+    if(!web_client_has_wait_receive(w) || strncmp(buffer_tostring(w->request), "GET /api/v1/alarm_log", 21) != 0) {
+        fprintf(stderr, "    the third request was lost ### E R R O R ###\n");
+        errors++;
+    }
+
+    char response[65536 + 1];
+    ssize_t len = recv(sv[1], response, 65536, MSG_DONTWAIT);
+    response[(len > 0) ? len : 0] = '\0';
+
+    int responses = 0;
+    char *s = response;
+    while((s = strstr(s, "HTTP/1.1 200 OK\r\n"))) {
+        responses++;
+        s++;
+    }
+
+    if(responses != 2) {
+        fprintf(stderr, "    received %d responses, expected 2 ### E R R O R ###\n", responses);
+        errors++;
+    }
+    else
+        fprintf(stderr, "    2 pipelined requests answered in order, the third is waiting for the rest of it OK\n");
+
+    web_client_request_done(w);
+    buffer_free(w->response.data);
+    buffer_free(w->response.header);
+    buffer_free(w->response.header_output);
+    buffer_free(w->request);
+    freez(w);
+    close(sv[0]);
+    close(sv[1]);
+    return errors;
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+// the first two clients of the epoll() test, and the events their slots got
+static struct {
+    volatile size_t adds;
+    volatile size_t dels;
+    volatile size_t received;
+    volatile size_t spurious;           // the reads that found nothing to read
+    size_t slot[2];
+    int inherited[2];                   // the accepted sockets, as a forked plugin would have them
+} poll_test;
+
+static void *poll_test_add_callback(POLLINFO *pi, short int *events, void *data) {
+    (void)data;
+
+    if(poll_test.adds < 2) {
+        poll_test.slot[poll_test.adds] = pi->slot;
+        poll_test.inherited[poll_test.adds] = dup(pi->fd);
+    }
+    poll_test.adds++;
+
+    *events = POLLIN;
+    return NULL;
+}
+
+static void poll_test_del_callback(POLLINFO *pi) {
+    (void)pi;
+    poll_test.dels++;
+}
+
+static int poll_test_rcv_callback(POLLINFO *pi, short int *events) {
+    char buffer[100];
+    ssize_t bytes = recv(pi->fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+
+    *events = POLLIN;
+
+    if(bytes == 0)
+        return -1;
+
+    if(bytes == -1) {
+        if(errno == EAGAIN || errno == EWOULDBLOCK)
+            poll_test.spurious++;
+        return 0;
+    }
+
+    poll_test.received += bytes;
+    return 0;
+}
+
+static void *poll_test_thread(void *ptr) {
+    poll_events((LISTEN_SOCKETS *)ptr, poll_test_add_callback, poll_test_del_callback, poll_test_rcv_callback, NULL, NULL, NULL, NULL, 0, 0, 0, NULL, 0);
+    return NULL;
+}
+
+// wait up to 5 seconds for the counter to reach the value
+static int poll_test_wait(volatile size_t *counter, size_t value) {
+    int i;
+    for(i = 0; i < 500 && *counter < value ; i++)
+        sleep_usec(10 * USEC_PER_MS);
+
+    return *counter >= value;
+}
+
+static int poll_test_connect(struct sockaddr_in *sin) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(fd != -1 && connect(fd, (struct sockaddr *)sin, sizeof(*sin)) == -1) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+static int test_poll_events_epoll(void) {
+    fprintf(stderr, "\nTesting the epoll() backend of poll_events()\n");
+
+    struct sockaddr_in sin = { .sin_family = AF_INET, .sin_port = 0, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t sin_len = sizeof(sin);
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if(fd == -1 || bind(fd, (struct sockaddr *)&sin, sizeof(sin)) == -1 || listen(fd, 10) == -1 || getsockname(fd, (struct sockaddr *)&sin, &sin_len) == -1) {
+        fprintf(stderr, "    cannot listen on localhost ### E R R O R ###\n");
+        if(fd != -1) close(fd);
+        return 1;
+    }
+
+    LISTEN_SOCKETS sockets;
+    memset(&sockets, 0, sizeof(sockets));
+    sockets.opened = 1;
+    sockets.fds[0] = fd;
+    sockets.fds_names[0] = "unittest";
+    sockets.fds_types[0] = SOCK_STREAM;
+    sockets.fds_families[0] = AF_INET;
+
+    memset(&poll_test, 0, sizeof(poll_test));
+    poll_test.inherited[0] = poll_test.inherited[1] = -1;
+
+    POLL_EVENTS_BACKEND saved_backend = poll_events_backend;
+    poll_events_backend = POLL_EVENTS_BACKEND_EPOLL;
+
+    pthread_t thread;
+    if(pthread_create(&thread, NULL, poll_test_thread, &sockets) != 0) {
+        fprintf(stderr, "    cannot start the poll_events() thread ### E R R O R ###\n");
+        poll_events_backend = saved_backend;
+        close(fd);
+        return 1;
+    }
+
+    int errors = 0;
+
+    // the first client sends data and disconnects
+    // its socket stays open in the copy of the forked plugin
+    int a = poll_test_connect(&sin);
+    if(a == -1 || send(a, "a", 1, 0) != 1 || !poll_test_wait(&poll_test.received, 1)) {
+        fprintf(stderr, "    the data of the first client were not received ### E R R O R ###\n");
+        errors++;
+    }
+    if(a != -1) close(a);
+
+    if(!poll_test_wait(&poll_test.dels, 1)) {
+        fprintf(stderr, "    the first client was not removed ### E R R O R ###\n");
+        errors++;
+    }
+
+    // the second client gets the slot of the first
+    int b = poll_test_connect(&sin);
+    if(b == -1 || !poll_test_wait(&poll_test.adds, 2)) {
+        fprintf(stderr, "    the second client was not added ### E R R O R ###\n");
+        errors++;
+    }
+    else if(poll_test.slot[1] != poll_test.slot[0]) {
+        fprintf(stderr, "    the second client got slot %zu, expected the slot %zu of the first ### E R R O R ###\n", poll_test.slot[1], poll_test.slot[0]);
+        errors++;
+    }
+
+    // give the events of the first socket time to arrive, if it is still watched
+    sleep_usec(100 * USEC_PER_MS);
+
+    if(b == -1 || send(b, "bb", 2, 0) != 2 || !poll_test_wait(&poll_test.received, 3)) {
+        fprintf(stderr, "    the data of the second client were not received ### E R R O R ###\n");
+        errors++;
+    }
+
+    if(poll_test.spurious) {
+        fprintf(stderr, "    the slot of the second client got %zu events without data, of the first client ### E R R O R ###\n", (size_t)poll_test.spurious);
+        errors++;
+    }
+
+    pthread_cancel(thread);
+    pthread_join(thread, NULL);
+    poll_events_backend = saved_backend;
+
+    if(b != -1) close(b);
+    if(poll_test.inherited[0] != -1) close(poll_test.inherited[0]);
+    if(poll_test.inherited[1] != -1) close(poll_test.inherited[1]);
+    close(fd);
+
+    if(!errors)
+        fprintf(stderr, "    2 clients added, removed and their slot reused, without stale events OK\n");
+
+    return errors;
+}
+#endif
+
+int run_all_mockup_tests(void)
+{
+    if(check_number_printing())
+        return 1;
+
+    if(check_rrdcalc_comparisons())
+        return 1;
+
+    if(!test_variable_renames())
+        return 1;
+
+    if(run_test(&test1))
+        return 1;
+
+    if(run_test(&test2))
+        return 1;
+
+    if(run_test(&test3))
+        return 1;
+
+    if(run_test(&test4))
+        return 1;
+
+    if(run_test(&test5))
+        return 1;
+
+    if(run_test(&test6))
+        return 1;
+
+    if(run_test(&test7))
+        return 1;
+
+    if(run_test(&test8))
+        return 1;
+
+    if(run_test(&test9))
+        return 1;
+
+    if(run_test(&test10))
+        return 1;
+
+    if(run_test(&test11))
+        return 1;
+
+    if(run_test(&test12))
+        return 1;
+
+    if(run_test(&test13))
+        return 1;
+
+    if(run_test(&test14))
+        return 1;
+
+    if(run_test(&test14b))
+        return 1;
+
+    if(run_test(&test14c))
+        return 1;
+
+    if(run_test(&test15))
+        return 1;
+
+    if(test_compressed_memory_mode())
+        return 1;
+
+    if(test_tiered_memory_mode())
+        return 1;
+
+    if(test_dbengine_memory_mode())
+        return 1;
+
+    if(test_storage_format_64bit())
+        return 1;
+
+    if(test_rrdset_ring_readers())
+        return 1;
+
+    if(test_slab_set())
+        return 1;
+
+    if(test_string_intern())
+        return 1;
+
+    if(test_rrdr_cache())
+        return 1;
+
+    if(test_rrdr_grouping_methods())
+        return 1;
+
+    if(test_web_api_v1_batch())
+        return 1;
+
+    if(test_rrdcontext_queries())
+        return 1;
+
+    if(test_rrdr2binary())
+        return 1;
+
+    if(test_rrdr_stream())
+        return 1;
+
+    if(test_rrddim_summaries())
+        return 1;
+
+    if(test_web_files_cache())
+        return 1;
+
+#ifdef HIBENCHMARKS_WITH_ZLIB
+    if(test_web_gzip_shared())
+        return 1;
+#endif
+
+    if(test_web_client_pipelining())
+        return 1;
+
+#ifdef HAVE_SYS_EPOLL_H
+    if(test_poll_events_epoll())
+        return 1;
+#endif
+
+    benchmark_rrdset_done(1000, 1000);
+    if(benchmark_rrd_indexes(10000, 10, 10))
         return 1;
+    benchmark_queries(100, 3600, 10);
 
 
 
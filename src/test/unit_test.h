@@ -5,6 +5,7 @@
 extern int unit_test_storage(void);
 extern int unit_test(long delay, long shift);
 extern int run_all_mockup_tests(void);
+extern int benchmark_queries(size_t dimensions, long entries, int loop);
 extern int unit_test_str2ld(void);
 extern int unit_test_buffer(void);
 
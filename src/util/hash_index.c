@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: GPL-3.0+
+#include "include/common.h"
+
+#define hash_index_key(index, item) (*(const char **)((char *)(item) + (index)->key_offset))
+
+// ----------------------------------------------------------------------------
+// the table - the caller has to lock the index
+
+static inline size_t hash_index_find_slot(HASH_INDEX *index, const char *key, uint32_t hash) {
+    size_t mask = index->size - 1, i = hash & mask;
+
+    for(;; i = (i + 1) & mask) {
+        HASH_INDEX_SLOT *slot = &index->slots[i];
+
+        if(!slot->item)
+            return i;
+
+        if(slot->hash == hash && slot->item != HASH_INDEX_DELETED) {
+            const char *k = hash_index_key(index, slot->item);
+            if(likely(k == key || !strcmp(k, key)))
+                return i;
+        }
+    }
+}
+
+static void hash_index_resize(HASH_INDEX *index, size_t size) {
+    HASH_INDEX_SLOT *old = index->slots;
+    size_t i, old_size = index->size;
+
+    index->slots = callocz(size, sizeof(HASH_INDEX_SLOT));
+    index->size = size;
+    index->deleted = 0;
+
+    size_t mask = size - 1;
+    for(i = 0; i < old_size ; i++) {
+        if(!old[i].item || old[i].item == HASH_INDEX_DELETED) continue;
+
+        size_t s = old[i].hash & mask;
+        while(index->slots[s].item) s = (s + 1) & mask;
+        index->slots[s] = old[i];
+    }
+
+    freez(old);
+}
+
+// ----------------------------------------------------------------------------
+// public API
+
+void hash_index_init(HASH_INDEX *index, size_t key_offset) {
+    index->slots = NULL;
+    index->size = 0;
+    index->used = 0;
+    index->deleted = 0;
+    index->key_offset = key_offset;
+    hibenchmarks_rwlock_init(&index->rwlock);
+}
+
+void hash_index_destroy(HASH_INDEX *index) {
+    hibenchmarks_rwlock_wrlock(&index->rwlock);
+    freez(index->slots);
+    index->slots = NULL;
+    index->size = 0;
+    index->used = 0;
+    index->deleted = 0;
+    hibenchmarks_rwlock_unlock(&index->rwlock);
+
+    hibenchmarks_rwlock_destroy(&index->rwlock);
+}
+
+void *hash_index_insert(HASH_INDEX *index, void *item, uint32_t hash) {
+    hibenchmarks_rwlock_wrlock(&index->rwlock);
+
+    // keep at least 1/4 of the slots empty, so that probing stops quickly
+    if(unlikely((index->used + index->deleted + 1) * 4 > index->size * 3)) {
+        size_t size = (index->size) ? index->size : HASH_INDEX_MIN_SIZE;
+        while((index->used + 1) * 2 > size) size *= 2;
+        hash_index_resize(index, size);
+    }
+
+    const char *key = hash_index_key(index, item);
+    size_t mask = index->size - 1, i = hash & mask, insert_at = index->size;
+
+    for(;; i = (i + 1) & mask) {
+        HASH_INDEX_SLOT *slot = &index->slots[i];
+
+        if(!slot->item) {
+            if(insert_at == index->size) insert_at = i;
+            break;
+        }
+
+        if(slot->item == HASH_INDEX_DELETED) {
+            // reuse the first deleted slot, after making sure the key is not in the index
+            if(insert_at == index->size) insert_at = i;
+            continue;
+        }
+
+        if(slot->hash == hash) {
+            const char *k = hash_index_key(index, slot->item);
+            if(k == key || !strcmp(k, key)) {
+                void *existing = slot->item;
+                hibenchmarks_rwlock_unlock(&index->rwlock);
+                return existing;
+            }
+        }
+    }
+
+    if(index->slots[insert_at].item == HASH_INDEX_DELETED)
+        index->deleted--;
+
+    index->slots[insert_at].hash = hash;
+    index->slots[insert_at].item = item;
+    index->used++;
+
+    hibenchmarks_rwlock_unlock(&index->rwlock);
+    return item;
+}
+
+void *hash_index_remove(HASH_INDEX *index, void *item, uint32_t hash) {
+    void *ret = NULL;
+
+    hibenchmarks_rwlock_wrlock(&index->rwlock);
+
+    if(likely(index->size)) {
+        size_t mask = index->size - 1, i = hash & mask;
+
+        for(; index->slots[i].item ; i = (i + 1) & mask) {
+            if(index->slots[i].item == item) {
+                // the next slot is empty - no probing goes through this one
+                if(!index->slots[(i + 1) & mask].item)
+                    index->slots[i].item = NULL;
+                else {
+                    index->slots[i].item = HASH_INDEX_DELETED;
+                    index->deleted++;
+                }
+
+                index->used--;
+                ret = item;
+                break;
+            }
+        }
+    }
+
+    hibenchmarks_rwlock_unlock(&index->rwlock);
+    return ret;
+}
+
+void *hash_index_search(HASH_INDEX *index, const char *key, uint32_t hash) {
+    void *ret = NULL;
+
+    hibenchmarks_rwlock_rdlock(&index->rwlock);
+
+    if(likely(index->size)) {
+        HASH_INDEX_SLOT *slot = &index->slots[hash_index_find_slot(index, key, hash)];
+        ret = slot->item;
+    }
+
+    hibenchmarks_rwlock_unlock(&index->rwlock);
+    return ret;
+}
@@ -0,0 +1,300 @@
+// SPDX-License-Identifier: GPL-3.0+
+#include "include/common.h"
+
+// ----------------------------------------------------------------------------
+// slabs of objects of the same size
+
+#define SLAB_PAGE_HEADER_SIZE ((sizeof(SLAB_PAGE) + SLAB_ALIGN - 1) & ~((size_t)SLAB_ALIGN - 1))
+
+static inline size_t slab_object_size(size_t size) {
+    if(unlikely(size < sizeof(void *))) size = sizeof(void *);
+    return (size + SLAB_ALIGN - 1) & ~((size_t)SLAB_ALIGN - 1);
+}
+
+static inline size_t slab_page_bytes(SLAB *slab, size_t objects) {
+    return SLAB_PAGE_HEADER_SIZE + objects * slab->object_size;
+}
+
+static SLAB *slab_create(size_t object_size) {
+    SLAB *slab = callocz(1, sizeof(SLAB));
+
+    slab->object_size = object_size;
+
+    slab->min_objects_per_page = SLAB_FIRST_PAGE_SIZE / object_size;
+    if(slab->min_objects_per_page < SLAB_MIN_OBJECTS_PER_PAGE)
+        slab->min_objects_per_page = SLAB_MIN_OBJECTS_PER_PAGE;
+
+    slab->max_objects_per_page = SLAB_PAGE_SIZE / object_size;
+    if(slab->max_objects_per_page < slab->min_objects_per_page)
+        slab->max_objects_per_page = slab->min_objects_per_page;
+
+    return slab;
+}
+
+// the pages of a set are indexed by the range of their objects
+// a page that overlaps another is equal to it - so a page of one byte finds the page of an object
+static int slab_page_compare(void *a, void *b) {
+    SLAB_PAGE *p1 = (SLAB_PAGE *)a, *p2 = (SLAB_PAGE *)b;
+
+    if(p1->objects + p1->objects_count * p1->slab->object_size <= p2->objects) return -1;
+    if(p2->objects + p2->objects_count * p2->slab->object_size <= p1->objects) return 1;
+    return 0;
+}
+
+static inline void slab_page_link_first(SLAB *slab, SLAB_PAGE *page) {
+    page->prev = NULL;
+    page->next = slab->pages;
+    if(page->next) page->next->prev = page;
+    slab->pages = page;
+}
+
+static inline void slab_page_link_last(SLAB *slab, SLAB_PAGE *page) {
+    page->next = NULL;
+
+    if(unlikely(!slab->pages)) {
+        page->prev = NULL;
+        slab->pages = page;
+        return;
+    }
+
+    SLAB_PAGE *last;
+    for(last = slab->pages; last->next ; last = last->next) ;
+    last->next = page;
+    page->prev = last;
+}
+
+static inline void slab_page_unlink(SLAB *slab, SLAB_PAGE *page) {
+    if(page->prev) page->prev->next = page->next;
+    else slab->pages = page->next;
+
+    if(page->next) page->next->prev = page->prev;
+
+    page->prev = page->next = NULL;
+}
+
+static SLAB_PAGE *slab_add_page(SLAB_SET *set, SLAB *slab) {
+    // the slab doubles, up to the max page size
+    size_t objects = slab->objects;
+    if(objects < slab->min_objects_per_page) objects = slab->min_objects_per_page;
+    if(objects > slab->max_objects_per_page) objects = slab->max_objects_per_page;
+
+    size_t bytes = slab_page_bytes(slab, objects);
+    SLAB_PAGE *page = mallocz(bytes);
+    page->slab = slab;
+    page->objects = (char *)page + SLAB_PAGE_HEADER_SIZE;
+    page->objects_count = objects;
+    page->used = 0;
+    page->free_objects = NULL;
+
+    // link all the objects of the page to its free list
+    size_t i;
+    for(i = objects; i > 0 ; i--) {
+        void **object = (void **)&page->objects[(i - 1) * slab->object_size];
+        *object = page->free_objects;
+        page->free_objects = object;
+    }
+
+    if(unlikely(avl_insert(&set->pages_index, (avl *)page) != (avl *)page))
+        fatal("SLAB: a new page of %zu bytes overlaps another page", bytes);
+
+    slab_page_link_first(slab, page);
+    slab->pages_count++;
+    slab->memory += bytes;
+
+    return page;
+}
+
+static void slab_release_page(SLAB_SET *set, SLAB *slab, SLAB_PAGE *page) {
+    if(unlikely(avl_remove(&set->pages_index, (avl *)page) != (avl *)page))
+        error("SLAB: a page of objects of size %zu is not in the index", slab->object_size);
+
+    slab_page_unlink(slab, page);
+    slab->pages_count--;
+    slab->memory -= slab_page_bytes(slab, page->objects_count);
+
+    freez(page);
+}
+
+// the caller has to lock the set
+static inline void *slab_alloc(SLAB_SET *set, SLAB *slab) {
+    // the pages with free objects are first
+    SLAB_PAGE *page = slab->pages;
+    if(unlikely(!page || !page->free_objects))
+        page = slab_add_page(set, slab);
+
+    void **object = page->free_objects;
+    page->free_objects = *object;
+    page->used++;
+    slab->objects++;
+
+    if(unlikely(page == slab->spare))
+        slab->spare = NULL;
+
+    // a full page goes last
+    if(unlikely(!page->free_objects && page->next)) {
+        slab_page_unlink(slab, page);
+        slab_page_link_last(slab, page);
+    }
+
+    memset(object, 0, slab->object_size);
+    return object;
+}
+
+// the caller has to lock the set
+static inline void slab_free(SLAB_SET *set, SLAB_PAGE *page, void *ptr) {
+    SLAB *slab = page->slab;
+
+    // a full page goes first, since it has a free object now
+    if(unlikely(!page->free_objects && page != slab->pages)) {
+        slab_page_unlink(slab, page);
+        slab_page_link_first(slab, page);
+    }
+
+    void **object = ptr;
+    *object = page->free_objects;
+    page->free_objects = object;
+    page->used--;
+    slab->objects--;
+
+    // one empty page is kept, so that an object allocated and freed again
+    // and again does not allocate and release a page every time
+    if(unlikely(!page->used)) {
+        if(!slab->spare)
+            slab->spare = page;
+        else
+            slab_release_page(set, slab, page);
+    }
+}
+
+static void slab_destroy(SLAB *slab) {
+    while(slab->pages) {
+        SLAB_PAGE *page = slab->pages;
+        slab->pages = page->next;
+        freez(page);
+    }
+
+    freez(slab);
+}
+
+// the caller has to lock the set
+static inline SLAB *slab_set_find(SLAB_SET *set, size_t object_size) {
+    SLAB *slab;
+    for(slab = set->slabs; slab ; slab = slab->next)
+        if(slab->object_size == object_size)
+            return slab;
+
+    slab = slab_create(object_size);
+    slab->next = set->slabs;
+    set->slabs = slab;
+    return slab;
+}
+
+// the caller has to lock the set
+static inline SLAB_PAGE *slab_set_find_page(SLAB_SET *set, void *ptr) {
+    SLAB slab = { .object_size = 1 };
+    SLAB_PAGE tmp = { .slab = &slab, .objects = ptr, .objects_count = 1 };
+    return (SLAB_PAGE *)avl_search(&set->pages_index, (avl *)&tmp);
+}
+
+// ----------------------------------------------------------------------------
+// slab sets
+
+void slab_set_init(SLAB_SET *set) {
+    set->slabs = NULL;
+    set->destroying = 0;
+    avl_init(&set->pages_index, slab_page_compare);
+    hibenchmarks_mutex_init(&set->mutex);
+}
+
+// the objects freed after this are not returned to their pages
+// slab_set_destroy() releases them with all the pages
+void slab_set_destroy_begin(SLAB_SET *set) {
+    hibenchmarks_mutex_lock(&set->mutex);
+    set->destroying = 1;
+    hibenchmarks_mutex_unlock(&set->mutex);
+}
+
+void slab_set_destroy(SLAB_SET *set) {
+    hibenchmarks_mutex_lock(&set->mutex);
+
+    while(set->slabs) {
+        SLAB *slab = set->slabs;
+        set->slabs = slab->next;
+
+        if(unlikely(slab->objects && !set->destroying))
+            error("SLAB: releasing %zu objects of size %zu that have not been freed", slab->objects, slab->object_size);
+
+        slab_destroy(slab);
+    }
+    set->pages_index.root = NULL;
+
+    hibenchmarks_mutex_unlock(&set->mutex);
+}
+
+void *slab_set_callocz(SLAB_SET *set, size_t size) {
+    size_t object_size = slab_object_size(size);
+
+    hibenchmarks_mutex_lock(&set->mutex);
+    void *ptr = slab_alloc(set, slab_set_find(set, object_size));
+    hibenchmarks_mutex_unlock(&set->mutex);
+
+    return ptr;
+}
+
+void slab_set_freez(SLAB_SET *set, void *ptr, size_t size) {
+    if(unlikely(!ptr)) return;
+
+    size_t object_size = slab_object_size(size);
+
+    hibenchmarks_mutex_lock(&set->mutex);
+
+    // the whole set is released
+    if(unlikely(set->destroying)) {
+        hibenchmarks_mutex_unlock(&set->mutex);
+        return;
+    }
+
+    SLAB_PAGE *page = slab_set_find_page(set, ptr);
+    if(unlikely(!page))
+        error("SLAB: cannot free an object of size %zu that is not allocated from the slabs", size);
+    else if(unlikely(page->slab->object_size != object_size))
+        error("SLAB: cannot free an object of size %zu to the slab of size %zu", size, page->slab->object_size);
+    else
+        slab_free(set, page, ptr);
+
+    hibenchmarks_mutex_unlock(&set->mutex);
+}
+
+char *slab_set_strdupz(SLAB_SET *set, const char *s) {
+    size_t size = strlen(s) + 1;
+    if(unlikely(size > SLAB_STRING_MAX))
+        return strdupz(s);
+
+    char *ptr = slab_set_callocz(set, size);
+    memcpy(ptr, s, size);
+    return ptr;
+}
+
+void slab_set_freez_string(SLAB_SET *set, char *s) {
+    if(unlikely(!s)) return;
+
+    size_t size = strlen(s) + 1;
+    if(unlikely(size > SLAB_STRING_MAX))
+        freez(s);
+    else
+        slab_set_freez(set, s, size);
+}
+
+size_t slab_set_allocated_memory(SLAB_SET *set) {
+    size_t memory = 0;
+
+    hibenchmarks_mutex_lock(&set->mutex);
+
+    SLAB *slab;
+    for(slab = set->slabs; slab ; slab = slab->next)
+        memory += slab->memory;
+
+    hibenchmarks_mutex_unlock(&set->mutex);
+
+    return memory;
+}
@@ -0,0 +1,184 @@
+// SPDX-License-Identifier: GPL-3.0+
+#include "include/common.h"
+
+typedef struct string_entry {
+    struct string_entry *next;
+
+    uint32_t hash;
+    uint32_t length;            // including the terminating zero
+    size_t refcount;
+
+    char str[];
+} STRING_ENTRY;
+
+#define string_entry_from_str(s) ((STRING_ENTRY *)((char *)(s) - offsetof(STRING_ENTRY, str)))
+
+#define STRING_INTERN_INITIAL_SLOTS 4096
+
+static struct string_table {
+    hibenchmarks_rwlock_t rwlock;
+
+    STRING_ENTRY **slots;
+    size_t size;                // always a power of 2
+
+    size_t entries;
+    size_t memory;
+} string_table = {
+        .rwlock = HIBENCHMARKS_RWLOCK_INITIALIZER,
+        .slots = NULL,
+        .size = 0,
+        .entries = 0,
+        .memory = 0
+};
+
+// ----------------------------------------------------------------------------
+// the hash table - the caller has to lock it
+
+static inline STRING_ENTRY *string_table_search(const char *s, uint32_t hash) {
+    if(unlikely(!string_table.slots)) return NULL;
+
+    STRING_ENTRY *se;
+    for(se = string_table.slots[hash & (string_table.size - 1)]; se ; se = se->next)
+        if(se->hash == hash && !strcmp(se->str, s))
+            return se;
+
+    return NULL;
+}
+
+static void string_table_resize(size_t size) {
+    STRING_ENTRY **slots = callocz(size, sizeof(STRING_ENTRY *));
+
+    size_t i;
+    for(i = 0; i < string_table.size ; i++) {
+        STRING_ENTRY *se, *next;
+        for(se = string_table.slots[i]; se ; se = next) {
+            next = se->next;
+            se->next = slots[se->hash & (size - 1)];
+            slots[se->hash & (size - 1)] = se;
+        }
+    }
+
+    freez(string_table.slots);
+    string_table.slots = slots;
+    string_table.size = size;
+}
+
+static STRING_ENTRY *string_table_add(const char *s, uint32_t hash) {
+    if(unlikely(!string_table.slots))
+        string_table_resize(STRING_INTERN_INITIAL_SLOTS);
+
+    else if(unlikely(string_table.entries > string_table.size * 2))
+        string_table_resize(string_table.size * 4);
+
+    size_t length = strlen(s) + 1;
+    STRING_ENTRY *se = mallocz(sizeof(STRING_ENTRY) + length);
+    se->hash = hash;
+    se->length = (uint32_t)length;
+    se->refcount = 0;
+    memcpy(se->str, s, length);
+
+    STRING_ENTRY **slot = &string_table.slots[hash & (string_table.size - 1)];
+    se->next = *slot;
+    *slot = se;
+
+    string_table.entries++;
+    string_table.memory += sizeof(STRING_ENTRY) + length;
+    return se;
+}
+
+static void string_table_del(STRING_ENTRY *se) {
+    STRING_ENTRY **slot = &string_table.slots[se->hash & (string_table.size - 1)];
+    while(*slot && *slot != se)
+        slot = &(*slot)->next;
+
+    if(unlikely(!*slot)) {
+        error("STRING: INTERNAL ERROR: interned string '%s' is not in the table", se->str);
+        return;
+    }
+
+    *slot = se->next;
+
+    string_table.entries--;
+    string_table.memory -= sizeof(STRING_ENTRY) + se->length;
+    freez(se);
+}
+
+// ----------------------------------------------------------------------------
+// public API
+
+const char *string_intern(const char *s) {
+    if(unlikely(!s)) return NULL;
+
+    uint32_t hash = simple_hash(s);
+
+    // most strings are already interned - we find them with a read lock
+    hibenchmarks_rwlock_rdlock(&string_table.rwlock);
+    STRING_ENTRY *se = string_table_search(s, hash);
+    if(likely(se)) __sync_add_and_fetch(&se->refcount, 1);
+    hibenchmarks_rwlock_unlock(&string_table.rwlock);
+
+    if(likely(se)) return se->str;
+
+    hibenchmarks_rwlock_wrlock(&string_table.rwlock);
+    se = string_table_search(s, hash);
+    if(likely(!se)) se = string_table_add(s, hash);
+    __sync_add_and_fetch(&se->refcount, 1);
+    hibenchmarks_rwlock_unlock(&string_table.rwlock);
+
+    return se->str;
+}
+
+const char *string_intern_dup(const char *interned) {
+    if(unlikely(!interned)) return NULL;
+
+    __sync_add_and_fetch(&string_entry_from_str(interned)->refcount, 1);
+    return interned;
+}
+
+void string_intern_release(const char *interned) {
+    if(unlikely(!interned)) return;
+
+    STRING_ENTRY *se = string_entry_from_str(interned);
+
+    // the write lock prevents string_intern() from giving it again while we free it
+    hibenchmarks_rwlock_wrlock(&string_table.rwlock);
+
+    if(unlikely(!se->refcount))
+        error("STRING: INTERNAL ERROR: interned string '%s' is released more times than it was interned", se->str);
+
+    else if(!__sync_sub_and_fetch(&se->refcount, 1))
+        string_table_del(se);
+
+    hibenchmarks_rwlock_unlock(&string_table.rwlock);
+}
+
+const char *string_intern_find(const char *s, uint32_t hash) {
+    if(unlikely(!s)) return NULL;
+    if(unlikely(!hash)) hash = simple_hash(s);
+
+    hibenchmarks_rwlock_rdlock(&string_table.rwlock);
+    STRING_ENTRY *se = string_table_search(s, hash);
+    hibenchmarks_rwlock_unlock(&string_table.rwlock);
+
+    return (se) ? se->str : NULL;
+}
+
+void string_intern_get_stats(struct string_intern_stats *stats) {
+    stats->entries = 0;
+    stats->references = 0;
+    stats->memory = 0;
+
+    hibenchmarks_rwlock_rdlock(&string_table.rwlock);
+
+    size_t i;
+    for(i = 0; i < string_table.size ; i++) {
+        STRING_ENTRY *se;
+        for(se = string_table.slots[i]; se ; se = se->next)
+            stats->references += se->refcount;
+    }
+
+    stats->entries = string_table.entries;
+    stats->memory = string_table.memory + string_table.size * sizeof(STRING_ENTRY *);
+
+    hibenchmarks_rwlock_unlock(&string_table.rwlock);
+}
@@ -12,6 +12,14 @@ static struct {
         , {"sum"            , 0    , GROUP_SUM}
         , {"incremental_sum", 0    , GROUP_INCREMENTAL_SUM}
         , {"incremental-sum", 0    , GROUP_INCREMENTAL_SUM}
+        , {"median"         , 0    , GROUP_MEDIAN}
+        , {"percentile95"   , 0    , GROUP_PERCENTILE95}
+        , {"p95"            , 0    , GROUP_PERCENTILE95}
+        , {"percentile99"   , 0    , GROUP_PERCENTILE99}
+        , {"p99"            , 0    , GROUP_PERCENTILE99}
+        , {"stddev"         , 0    , GROUP_STDDEV}
+        , {"cv"             , 0    , GROUP_CV}
+        , {"rate"           , 0    , GROUP_RATE}
         , {                 NULL, 0, 0}
 };
 
@@ -65,6 +73,7 @@ static struct {
         , {DATASOURCE_FORMAT_JS_ARRAY       , 0 , DATASOURCE_JS_ARRAY}
         , {DATASOURCE_FORMAT_SSV_COMMA      , 0 , DATASOURCE_SSV_COMMA}
         , {DATASOURCE_FORMAT_CSV_JSON_ARRAY , 0 , DATASOURCE_CSV_JSON_ARRAY}
+        , {DATASOURCE_FORMAT_BINARY         , 0 , DATASOURCE_BINARY}
         , {                                 NULL, 0, 0}
 };
 
@@ -167,9 +176,13 @@ inline int web_client_api_request_v1_alarms(RRDHOST *host, struct web_client *w,
         else if(!strcmp(value, "active")) all = 0;
     }
 
+    if(web_client_shared_gzip_find(w, host, NULL))
+        return 200;
+
     buffer_flush(w->response.data);
     w->response.data->contenttype = CT_APPLICATION_JSON;
     health_alarms2json(host, w->response.data, all);
+    web_client_shared_gzip_store(w, host, NULL);
     return 200;
 }
 
@@ -247,9 +260,13 @@ inline int web_client_api_request_v1_alarm_variables(RRDHOST *host, struct web_c
 inline int web_client_api_request_v1_charts(RRDHOST *host, struct web_client *w, char *url) {
     (void)url;
 
+    if(web_client_shared_gzip_find(w, host, NULL))
+        return 200;
+
     buffer_flush(w->response.data);
     w->response.data->contenttype = CT_APPLICATION_JSON;
     rrd_stats_api_v1_charts(host, w->response.data);
+    web_client_shared_gzip_store(w, host, NULL);
     return 200;
 }
 
@@ -315,6 +332,11 @@ inline int web_client_api_request_v1_allmetrics(RRDHOST *host, struct web_client
         }
     }
 
+    // the prometheus responses depend on the state kept for the server asking them
+    const char *client = (format == ALLMETRICS_PROMETHEUS || format == ALLMETRICS_PROMETHEUS_ALL_HOSTS) ? prometheus_server : NULL;
+    if(format && web_client_shared_gzip_find(w, host, client))
+        return 200;
+
     buffer_flush(w->response.data);
     buffer_no_cacheable(w->response.data);
 
@@ -322,28 +344,31 @@ inline int web_client_api_request_v1_allmetrics(RRDHOST *host, struct web_client
         case ALLMETRICS_JSON:
             w->response.data->contenttype = CT_APPLICATION_JSON;
             rrd_stats_api_v1_charts_allmetrics_json(host, w->response.data);
-            return 200;
+            break;
 
         case ALLMETRICS_SHELL:
             w->response.data->contenttype = CT_TEXT_PLAIN;
             rrd_stats_api_v1_charts_allmetrics_shell(host, w->response.data);
-            return 200;
+            break;
 
         case ALLMETRICS_PROMETHEUS:
             w->response.data->contenttype = CT_PROMETHEUS;
             rrd_stats_api_v1_charts_allmetrics_prometheus_single_host(host, w->response.data, prometheus_server, prometheus_prefix, prometheus_options, help, types, names, timestamps);
-            return 200;
+            break;
 
         case ALLMETRICS_PROMETHEUS_ALL_HOSTS:
             w->response.data->contenttype = CT_PROMETHEUS;
             rrd_stats_api_v1_charts_allmetrics_prometheus_all_hosts(host, w->response.data, prometheus_server, prometheus_prefix, prometheus_options, help, types, names, timestamps);
-            return 200;
+            break;
 
         default:
             w->response.data->contenttype = CT_TEXT_PLAIN;
             buffer_strcat(w->response.data, "Which format? '" ALLMETRICS_FORMAT_SHELL "', '" ALLMETRICS_FORMAT_PROMETHEUS "', '" ALLMETRICS_FORMAT_PROMETHEUS_ALL_HOSTS "' and '" ALLMETRICS_FORMAT_JSON "' are currently supported.");
             return 400;
     }
+
+    web_client_shared_gzip_store(w, host, client);
+    return 200;
 }
 
 inline int web_client_api_request_v1_chart(RRDHOST *host, struct web_client *w, char *url) {
@@ -603,6 +628,14 @@ int web_client_api_request_v1_badge(RRDHOST *host, struct web_client *w, char *u
     return ret;
 }
 
+static int web_client_api_request_v1_data_stream_next(void *stream, BUFFER *wb) {
+    return rrdr_stream_next((RRDR_STREAM *)stream, wb);
+}
+
+static void web_client_api_request_v1_data_stream_free(void *stream) {
+    rrdr_stream_free((RRDR_STREAM *)stream);
+}
+
 // returns the HTTP code
 inline int web_client_api_request_v1_data(RRDHOST *host, struct web_client *w, char *url) {
     debug(D_WEB_CLIENT, "%llu: API v1 data with URL '%s'", w->id, url);
@@ -625,9 +658,13 @@ inline int web_client_api_request_v1_data(RRDHOST *host, struct web_client *w, c
     , *before_str = NULL
     , *after_str = NULL
     , *group_time_str = NULL
-    , *points_str = NULL;
+    , *points_str = NULL
+    , *cursor = NULL
+    , *context = NULL
+    , *hosts = NULL
+    , *charts = NULL;
 
-    int group = GROUP_AVERAGE;
+    int group = GROUP_AVERAGE, aggregation = RRDR_AGGREGATION_SUM;
     uint32_t format = DATASOURCE_JSON;
     uint32_t options = 0x00000000;
 
@@ -654,6 +691,16 @@ inline int web_client_api_request_v1_data(RRDHOST *host, struct web_client *w, c
         else if(!strcmp(name, "before")) before_str = value;
         else if(!strcmp(name, "points")) points_str = value;
         else if(!strcmp(name, "gtime")) group_time_str = value;
+        else if(!strcmp(name, "cursor")) cursor = value;
+        else if(!strcmp(name, "context")) context = value;
+        else if(!strcmp(name, "hosts")) hosts = value;
+        else if(!strcmp(name, "charts")) charts = value;
+        else if(!strcmp(name, "aggregation")) {
+            if(!strcmp(value, "average")) aggregation = RRDR_AGGREGATION_AVERAGE;
+            else if(!strcmp(value, "min")) aggregation = RRDR_AGGREGATION_MIN;
+            else if(!strcmp(value, "max")) aggregation = RRDR_AGGREGATION_MAX;
+            else aggregation = RRDR_AGGREGATION_SUM;
+        }
         else if(!strcmp(name, "group")) {
             group = web_client_api_request_v1_data_group(value, GROUP_AVERAGE);
         }
@@ -702,20 +749,25 @@ inline int web_client_api_request_v1_data(RRDHOST *host, struct web_client *w, c
         }
     }
 
+    // without a chart, all the charts of a context are queried
+    RRDSET *st = NULL;
     if(!chart || !*chart) {
-        buffer_sprintf(w->response.data, "No chart id is given at the request.");
-        goto cleanup;
+        if(!context || !*context) {
+            buffer_sprintf(w->response.data, "No chart id or context is given at the request.");
+            goto cleanup;
+        }
     }
-
-    RRDSET *st = rrdset_find(host, chart);
-    if(!st) st = rrdset_find_byname(host, chart);
-    if(!st) {
-        buffer_strcat(w->response.data, "Chart is not found: ");
-        buffer_strcat_htmlescape(w->response.data, chart);
-        ret = 404;
-        goto cleanup;
+    else {
+        st = rrdset_find(host, chart);
+        if(!st) st = rrdset_find_byname(host, chart);
+        if(!st) {
+            buffer_strcat(w->response.data, "Chart is not found: ");
+            buffer_strcat_htmlescape(w->response.data, chart);
+            ret = 404;
+            goto cleanup;
+        }
+        st->last_accessed_time = now_realtime_sec();
     }
-    st->last_accessed_time = now_realtime_sec();
 
     long long before = (before_str && *before_str)?str2l(before_str):0;
     long long after  = (after_str  && *after_str) ?str2l(after_str):0;
@@ -724,7 +776,7 @@ inline int web_client_api_request_v1_data(RRDHOST *host, struct web_client *w, c
 
     debug(D_WEB_CLIENT, "%llu: API command 'data' for chart '%s', dimensions '%s', after '%lld', before '%lld', points '%d', group '%d', format '%u', options '0x%08x'"
           , w->id
-          , chart
+          , (st) ? chart : context
           , (dimensions)?buffer_tostring(dimensions):""
           , after
           , before
@@ -749,7 +801,7 @@ inline int web_client_api_request_v1_data(RRDHOST *host, struct web_client *w, c
 
         buffer_sprintf(w->response.data,
                 "%s({version:'%s',reqId:'%s',status:'ok',sig:'%ld',table:",
-                responseHandler, google_version, google_reqId, st->last_updated.tv_sec);
+                responseHandler, google_version, google_reqId, (st) ? st->last_updated.tv_sec : now_realtime_sec());
     }
     else if(format == DATASOURCE_JSONP) {
         if(responseHandler == NULL)
@@ -759,8 +811,23 @@ inline int web_client_api_request_v1_data(RRDHOST *host, struct web_client *w, c
         buffer_strcat(w->response.data, "(");
     }
 
-    ret = rrdset2anything_api_v1(st, w->response.data, dimensions, format, points, after, before, group, group_time
-                                 , options, &last_timestamp_in_data);
+    RRDR_STREAM *stream = NULL;
+    if(st && !cursor)
+        stream = rrdset2anything_api_v1_stream(st, w->response.data, dimensions, format, points, after, before, group, group_time, options);
+
+    if(stream) {
+        // the web server will generate the rest of the result, while sending it
+        w->response.stream = stream;
+        w->response.stream_next = web_client_api_request_v1_data_stream_next;
+        w->response.stream_free = web_client_api_request_v1_data_stream_free;
+        ret = 200;
+    }
+    else if(st)
+        ret = rrdset2anything_api_v1(st, w->response.data, dimensions, format, points, after, before, group, group_time
+                                     , options, cursor, &last_timestamp_in_data);
+    else
+        ret = rrdcontext2anything_api_v1(host, context, hosts, charts, aggregation, w->response.data, dimensions, format
+                                         , points, after, before, group, group_time, options, &last_timestamp_in_data);
 
     if(format == DATASOURCE_DATATABLE_JSONP) {
         if(google_timestamp < last_timestamp_in_data)
@@ -782,6 +849,171 @@ inline int web_client_api_request_v1_data(RRDHOST *host, struct web_client *w, c
     return ret;
 }
 
+// ----------------------------------------------------------------------------
+// /api/v1/batch - many data queries in one request
+//
+// /api/v1/batch?query=chart:system.cpu;points:300&query=chart:system.load;group:max&after=-600
+//
+// Every query is a list of name:value pairs, separated by ';'. They accept
+// chart, dimensions, after, before, points, group, gtime, options and cursor,
+// like /api/v1/data. The parameters of the request are the defaults of all
+// the queries. The queries are executed in parallel, by the worker threads and
+// the web thread that received them, and their results are returned in one
+// JSON document, in the order they were given.
+
+struct web_api_v1_batch_query {
+    char *chart;
+    RRDSET *st;
+    BUFFER *dimensions;
+    long points;
+    long long after;
+    long long before;
+    int group;
+    long group_time;
+    uint32_t options;
+    char *cursor;
+
+    int ret;
+    BUFFER *wb;
+};
+
+static void web_api_v1_batch_execute(void *data, size_t job) {
+    struct web_api_v1_batch_query *q = &((struct web_api_v1_batch_query *)data)[job];
+    q->wb = buffer_create(1);
+
+    if(unlikely(!q->st)) {
+        q->ret = 404;
+        return;
+    }
+
+    q->st->last_accessed_time = now_realtime_sec();
+    q->ret = rrdset2anything_api_v1(q->st, q->wb, q->dimensions, DATASOURCE_JSON, q->points, q->after, q->before
+                                    , q->group, q->group_time, q->options, q->cursor, NULL);
+}
+
+// set a parameter of a query, or of the defaults
+static void web_api_v1_batch_query_set(struct web_api_v1_batch_query *q, char *name, char *value) {
+    if(!strcmp(name, "chart")) q->chart = value;
+    else if(!strcmp(name, "dimension") || !strcmp(name, "dim") || !strcmp(name, "dimensions") || !strcmp(name, "dims")) {
+        if(!q->dimensions) q->dimensions = buffer_create(100);
+        buffer_strcat(q->dimensions, "|");
+        buffer_strcat(q->dimensions, value);
+    }
+    else if(!strcmp(name, "after")) q->after = str2l(value);
+    else if(!strcmp(name, "before")) q->before = str2l(value);
+    else if(!strcmp(name, "points")) q->points = str2l(value);
+    else if(!strcmp(name, "gtime")) q->group_time = str2l(value);
+    else if(!strcmp(name, "cursor")) q->cursor = value;
+    else if(!strcmp(name, "group")) q->group = web_client_api_request_v1_data_group(value, GROUP_AVERAGE);
+    else if(!strcmp(name, "options")) q->options |= web_client_api_request_v1_data_options(value);
+}
+
+int web_client_api_request_v1_batch(RRDHOST *host, struct web_client *w, char *url) {
+    debug(D_WEB_CLIENT, "%llu: API v1 batch with URL '%s'", w->id, url);
+
+    struct web_api_v1_batch_query defaults = {
+            .group = GROUP_AVERAGE
+    };
+
+    size_t size = 0, count = 0, i;
+    char **strings = NULL;
+
+    buffer_flush(w->response.data);
+
+    while(url) {
+        char *value = mystrsep(&url, "?&");
+        if(!value || !*value) continue;
+
+        char *name = mystrsep(&value, "=");
+        if(!name || !*name) continue;
+        if(!value || !*value) continue;
+
+        if(!strcmp(name, "query")) {
+            if(count == size) {
+                size = (size) ? size * 2 : 16;
+                strings = reallocz(strings, size * sizeof(char *));
+            }
+            strings[count++] = value;
+        }
+        else if(!strcmp(name, "after") || !strcmp(name, "before") || !strcmp(name, "points")
+                || !strcmp(name, "gtime") || !strcmp(name, "group") || !strcmp(name, "options"))
+            web_api_v1_batch_query_set(&defaults, name, value);
+    }
+
+    if(!count) {
+        buffer_strcat(w->response.data, "No queries are given at the request.");
+        freez(strings);
+        return 400;
+    }
+
+    struct web_api_v1_batch_query *queries = mallocz(count * sizeof(struct web_api_v1_batch_query));
+
+    for(i = 0; i < count ; i++) {
+        struct web_api_v1_batch_query *q = &queries[i];
+        *q = defaults;
+
+        char *value = strings[i], *pair;
+        while(value) {
+            pair = mystrsep(&value, ";");
+            if(!pair || !*pair) continue;
+
+            char *name = mystrsep(&pair, ":");
+            if(!name || !*name) continue;
+            if(!pair || !*pair) continue;
+
+            web_api_v1_batch_query_set(q, name, pair);
+        }
+
+        if(q->chart && *q->chart) {
+            q->st = rrdset_find(host, q->chart);
+            if(!q->st) q->st = rrdset_find_byname(host, q->chart);
+        }
+    }
+
+    hibenchmarks_workers_run(count, web_api_v1_batch_execute, queries);
+
+    BUFFER *wb = w->response.data;
+    wb->contenttype = CT_APPLICATION_JSON;
+    buffer_strcat(wb, "{\n\t\"api\": 1,\n\t\"queries\": [");
+
+    for(i = 0; i < count ; i++) {
+        struct web_api_v1_batch_query *q = &queries[i];
+
+        buffer_sprintf(wb, "%s\n\t\t{\n\t\t\t\"status\": %d,\n\t\t\t\"chart\": ", (i) ? "," : "", q->ret);
+
+        if(q->st)
+            buffer_sprintf(wb, "\"%s\"", q->st->id);
+        else if(q->chart) {
+            // the chart is not found, it is given back without the characters JSON would need escaped
+            char *s;
+            for(s = q->chart; *s ; s++)
+                if(*s == '"' || *s == '\\' || iscntrl((unsigned char)*s)) *s = '_';
+
+            buffer_sprintf(wb, "\"%s\"", q->chart);
+        }
+        else
+            buffer_strcat(wb, "null");
+
+        if(q->ret == 200) {
+            buffer_strcat(wb, ",\n\t\t\t\"result\": ");
+            buffer_strcat(wb, buffer_tostring(q->wb));
+        }
+        else
+            buffer_sprintf(wb, ",\n\t\t\t\"error\": \"%s\"", (q->st) ? "the query failed" : "the chart is not found");
+
+        buffer_strcat(wb, "\n\t\t}");
+
+        buffer_free(q->wb);
+        buffer_free(q->dimensions);
+    }
+
+    buffer_strcat(wb, "\n\t]\n}\n");
+
+    freez(queries);
+    freez(strings);
+    return 200;
+}
+
 inline int web_client_api_request_v1_registry(RRDHOST *host, struct web_client *w, char *url) {
     static uint32_t hash_action = 0, hash_access = 0, hash_hello = 0, hash_delete = 0, hash_search = 0,
             hash_switch = 0, hash_machine = 0, hash_url = 0, hash_name = 0, hash_delete_url = 0, hash_for = 0,
@@ -963,6 +1195,7 @@ static struct api_command {
         { "data",            0, WEB_CLIENT_ACL_DASHBOARD, web_client_api_request_v1_data            },
         { "chart",           0, WEB_CLIENT_ACL_DASHBOARD, web_client_api_request_v1_chart           },
         { "charts",          0, WEB_CLIENT_ACL_DASHBOARD, web_client_api_request_v1_charts          },
+        { "batch",           0, WEB_CLIENT_ACL_DASHBOARD, web_client_api_request_v1_batch           },
 
         // registry checks the ACL by itself, so we allow everything
         { "registry",        0, WEB_CLIENT_ACL_NOCHECK,   web_client_api_request_v1_registry        },
@@ -243,17 +243,14 @@ void buffer_rrd_value(BUFFER *wb, calculated_number value)
 {
     buffer_need_bytes(wb, 50);
 
-    if(isnan(value) || isinf(value)) {
-        buffer_strcat(wb, "null");
-        return;
+    // both write the terminating \0
+    if(unlikely(isnan(value) || isinf(value))) {
+        memcpy(&wb->buffer[wb->len], "null", 5);
+        wb->len += 4;
     }
     else
         wb->len += print_calculated_number(&wb->buffer[wb->len], value);
 
-    // terminate it
-    buffer_need_bytes(wb, 1);
-    wb->buffer[wb->len] = '\0';
-
     buffer_overflow_check(wb);
 }
 
@@ -75,7 +75,7 @@ void web_client_request_done(struct web_client *w) {
         struct timeval tv;
         now_realtime_timeval(&tv);
 
-        size_t size = (w->mode == WEB_CLIENT_MODE_FILECOPY)?w->response.rlen:w->response.data->len;
+        size_t size = (w->mode == WEB_CLIENT_MODE_FILECOPY)?w->response.rlen:w->response.data->len + w->response.streamed;
         size_t sent = size;
 #ifdef HIBENCHMARKS_WITH_ZLIB
         if(likely(w->response.zoutput)) sent = (size_t)w->response.zstream.total_out;
@@ -154,6 +154,7 @@ void web_client_request_done(struct web_client *w) {
     w->cookie2[0] = '\0';
     w->origin[0] = '*';
     w->origin[1] = '\0';
+    w->if_none_match[0] = '\0';
 
     freez(w->user_agent); w->user_agent = NULL;
 
@@ -163,11 +164,27 @@ void web_client_request_done(struct web_client *w) {
     web_client_disable_donottrack(w);
     web_client_disable_tracking_required(w);
     web_client_disable_keepalive(w);
-    w->decoded_url[0] = '\0';
+    w->decoded_url = NULL;
+
+    // if the client went away in the middle of a streamed response, release it
+    if(unlikely(w->response.stream)) {
+        w->response.stream_free(w->response.stream);
+        w->response.stream = NULL;
+    }
+    w->response.streamed = 0;
 
     buffer_reset(w->response.header_output);
     buffer_reset(w->response.header);
     buffer_reset(w->response.data);
+
+    // remove the request we responded to - the pipelined ones after it stay
+    if(likely(w->request_len)) {
+        size_t left = (w->request_len < w->request->len) ? w->request->len - w->request_len : 0;
+        if(unlikely(left)) memmove(w->request->buffer, &w->request->buffer[w->request_len], left);
+        w->request->len = left;
+        w->request->buffer[left] = '\0';
+        w->request_len = 0;
+    }
     w->response.rlen = 0;
     w->response.sent = 0;
     w->response.code = 0;
@@ -333,6 +350,45 @@ static inline int access_to_file_is_not_permitted(struct web_client *w, const ch
     return 403;
 }
 
+// respond with a file of the static files cache
+static int web_client_send_cached_file(struct web_client *w, WEB_FILE *f) {
+    // the gzip contents are compressed already
+    int gzip = (w->response.zoutput && f->gzip);
+    w->response.zoutput = 0;
+
+    char etag[WEB_FILE_ETAG_SIZE + 10];
+    snprintfz(etag, WEB_FILE_ETAG_SIZE + 9, "\"%s%s\"", f->etag, (gzip)?"-gz":"");
+
+    w->response.data->contenttype = contenttype_for_filename(f->filename);
+    w->response.data->date = f->mtime;
+    buffer_cacheable(w->response.data);
+    buffer_flush(w->response.data);
+
+    buffer_sprintf(w->response.header, "ETag: %s\r\n", etag);
+    if(f->gzip)
+        buffer_strcat(w->response.header, "Vary: Accept-Encoding\r\n");
+
+    if(w->if_none_match[0] && (strstr(w->if_none_match, etag) || !strcmp(w->if_none_match, "*"))) {
+        debug(D_WEB_CLIENT_ACCESS, "%llu: File '%s' is not modified (ETag %s).", w->id, f->filename, etag);
+        return 304;
+    }
+
+    if(gzip) {
+        buffer_strcat(w->response.header, "Content-Encoding: gzip\r\n");
+        buffer_need_bytes(w->response.data, f->gzip_len);
+        memcpy(w->response.data->buffer, f->gzip, f->gzip_len);
+        w->response.data->len = f->gzip_len;
+    }
+    else {
+        buffer_need_bytes(w->response.data, f->len);
+        memcpy(w->response.data->buffer, f->data, f->len);
+        w->response.data->len = f->len;
+    }
+
+    debug(D_WEB_CLIENT_ACCESS, "%llu: Sending cached file '%s' (%zu bytes%s).", w->id, f->filename, w->response.data->len, (gzip)?", gzip":"");
+    return 200;
+}
+
 int mysendfile(struct web_client *w, char *filename) {
     debug(D_WEB_CLIENT, "%llu: Looking for file '%s/%s'", w->id, hibenchmarks_configured_web_dir, filename);
 
@@ -408,6 +464,14 @@ int mysendfile(struct web_client *w, char *filename) {
         done = 1;
     }
 
+    // the small files are served from memory
+    WEB_FILE *f = web_files_cache_get(webfilename, &statbuf);
+    if(likely(f)) {
+        int code = web_client_send_cached_file(w, f);
+        web_files_cache_release(f);
+        return code;
+    }
+
     // open the file
     w->ifd = open(webfilename, O_NONBLOCK, O_RDONLY);
     if(w->ifd == -1) {
@@ -497,8 +561,232 @@ void web_client_enable_deflate(struct web_client *w, int gzip) {
 
     debug(D_DEFLATE, "%llu: Initialized compression.", w->id);
 }
+
+// compress data in one go, in gzip format
+// returns the compressed length, or 0 when it cannot be compressed
+size_t web_gzip_compress(const char *data, size_t len, int level, char **gzip) {
+    z_stream z = {
+            .zalloc = Z_NULL,
+            .zfree = Z_NULL,
+            .opaque = Z_NULL
+    };
+
+    *gzip = NULL;
+
+    // gzip: windowbits = 15 + 16 = 31
+    if(deflateInit2(&z, level, Z_DEFLATED, 15 + 16, 8, web_gzip_strategy) != Z_OK) {
+        error("Failed to initialize zlib.");
+        return 0;
+    }
+
+    size_t size = deflateBound(&z, (uLong)len);
+    char *out = mallocz(size);
+
+    z.next_in = (Bytef *)data;
+    z.avail_in = (uInt)len;
+    z.next_out = (Bytef *)out;
+    z.avail_out = (uInt)size;
+
+    size_t out_len = 0;
+    if(deflate(&z, Z_FINISH) == Z_STREAM_END) {
+        out_len = z.total_out;
+        *gzip = reallocz(out, out_len);
+    }
+    else
+        freez(out);
+
+    deflateEnd(&z);
+    return out_len;
+}
+
+// ----------------------------------------------------------------------------
+// shared gzip responses
+//
+// The responses of the API calls that are the same for all clients (charts,
+// alarms, allmetrics) are compressed once per second: they are kept by the
+// host, the client (when the response depends on it) and the URL of the
+// request. The clients that ask the same within the same second get the
+// compressed copy, without generating the response again.
+
+int web_gzip_shared_entries = 16;
+int web_gzip_shared_level = 3;
+
+struct web_gzip_shared_response {
+    time_t t;                       // the second the response was generated
+    uint32_t hash;                  // the hash of the key
+    char *key;                      // the host, the client and the URL of the request
+    uint8_t contenttype;
+    uint8_t options;
+    time_t expires;
+    char *gzip;                     // the compressed response
+    size_t gzip_len;
+};
+
+static struct {
+    hibenchmarks_mutex_t mutex;
+    struct web_gzip_shared_response *responses;
+    int entries;
+    int next;                       // the next one to be replaced, when all are used in this second
+} web_gzip_shared = {
+        .mutex = HIBENCHMARKS_MUTEX_INITIALIZER,
+        .responses = NULL,
+        .entries = 0,
+        .next = 0
+};
+
+// put the compressed copy of r to wb
+static inline void web_gzip_shared_copy(BUFFER *wb, struct web_gzip_shared_response *r) {
+    buffer_flush(wb);
+    buffer_need_bytes(wb, r->gzip_len);
+    memcpy(wb->buffer, r->gzip, r->gzip_len);
+    wb->len = r->gzip_len;
+    wb->contenttype = r->contenttype;
+    wb->options = r->options;
+    wb->expires = r->expires;
+}
+
+// the caller has to lock the mutex
+static inline struct web_gzip_shared_response *web_gzip_shared_search(const char *key, uint32_t hash, time_t now) {
+    int i;
+    for(i = 0; i < web_gzip_shared.entries ; i++) {
+        struct web_gzip_shared_response *r = &web_gzip_shared.responses[i];
+        if(r->t == now && r->hash == hash && !strcmp(r->key, key))
+            return r;
+    }
+
+    return NULL;
+}
+
+// put to wb the compressed response of key, generated at now
+// returns 1 when it is found, 0 otherwise
+int web_gzip_shared_find(const char *key, time_t now, BUFFER *wb) {
+    if(unlikely(web_gzip_shared_entries <= 0))
+        return 0;
+
+    uint32_t hash = simple_hash(key);
+
+    hibenchmarks_mutex_lock(&web_gzip_shared.mutex);
+
+    struct web_gzip_shared_response *r = (likely(web_gzip_shared.responses)) ? web_gzip_shared_search(key, hash, now) : NULL;
+    if(r) web_gzip_shared_copy(wb, r);
+
+    hibenchmarks_mutex_unlock(&web_gzip_shared.mutex);
+
+    return (r) ? 1 : 0;
+}
+
+// replace the response in wb with its gzip compressed copy, and keep it
+// for the requests of key in the second now
+// returns 0 when it is compressed, -1 when it is left uncompressed
+int web_gzip_shared_compress(const char *key, time_t now, BUFFER *wb) {
+    if(unlikely(web_gzip_shared_entries <= 0 || !wb->len))
+        return -1;
+
+    // compress it, without holding the mutex
+    char *gzip;
+    size_t gzip_len = web_gzip_compress(wb->buffer, wb->len, web_gzip_shared_level, &gzip);
+    if(unlikely(!gzip_len))
+        return -1;
+
+    uint32_t hash = simple_hash(key);
+
+    hibenchmarks_mutex_lock(&web_gzip_shared.mutex);
+
+    if(unlikely(!web_gzip_shared.responses)) {
+        web_gzip_shared.entries = web_gzip_shared_entries;
+        web_gzip_shared.responses = callocz((size_t)web_gzip_shared.entries, sizeof(struct web_gzip_shared_response));
+    }
+
+    // replace the same one, stored by another client meanwhile,
+    // or one of a previous second, or the oldest one
+    struct web_gzip_shared_response *r = web_gzip_shared_search(key, hash, now);
+
+    int i;
+    for(i = 0; !r && i < web_gzip_shared.entries ; i++) {
+        if(web_gzip_shared.responses[i].t != now)
+            r = &web_gzip_shared.responses[i];
+    }
+
+    if(!r) {
+        r = &web_gzip_shared.responses[web_gzip_shared.next];
+        web_gzip_shared.next = (web_gzip_shared.next + 1) % web_gzip_shared.entries;
+    }
+
+    if(!r->key || r->hash != hash || strcmp(r->key, key) != 0) {
+        freez(r->key);
+        r->key = strdupz(key);
+        r->hash = hash;
+    }
+
+    freez(r->gzip);
+    r->t = now;
+    r->contenttype = wb->contenttype;
+    r->options = wb->options;
+    r->expires = wb->expires;
+    r->gzip = gzip;
+    r->gzip_len = gzip_len;
+
+    web_gzip_shared_copy(wb, r);
+
+    hibenchmarks_mutex_unlock(&web_gzip_shared.mutex);
+    return 0;
+}
+
+#define WEB_GZIP_SHARED_KEY_SIZE (GUID_LEN + NI_MAXHOST + HIBENCHMARKS_WEB_REQUEST_URL_SIZE + 3)
+
+static inline void web_client_shared_gzip_key(struct web_client *w, RRDHOST *host, const char *client, char *key) {
+    snprintfz(key, WEB_GZIP_SHARED_KEY_SIZE, "%s %s %s", host->machine_guid, (client)?client:"", w->last_url);
+}
+
+// the response is sent as it is, compressed once for many clients
+static inline void web_client_send_shared_gzip(struct web_client *w) {
+    w->response.zoutput = 0;
+    buffer_strcat(w->response.header, "Content-Encoding: gzip\r\nVary: Accept-Encoding\r\n");
+}
 #endif // HIBENCHMARKS_WITH_ZLIB
 
+// called by the API calls that can share their response, before generating it
+// client is given when the response depends on the client
+// returns 1 when the compressed response of the same request, in this second, is put to the client
+int web_client_shared_gzip_find(struct web_client *w, RRDHOST *host, const char *client) {
+#ifdef HIBENCHMARKS_WITH_ZLIB
+    if(!w->response.zoutput || web_gzip_shared_entries <= 0)
+        return 0;
+
+    char key[WEB_GZIP_SHARED_KEY_SIZE];
+    web_client_shared_gzip_key(w, host, client, key);
+
+    if(web_gzip_shared_find(key, w->tv_in.tv_sec, w->response.data)) {
+        web_client_send_shared_gzip(w);
+        return 1;
+    }
+#else
+    (void)w;
+    (void)host;
+    (void)client;
+#endif
+
+    return 0;
+}
+
+// called by the API calls that can share their response, after generating it
+void web_client_shared_gzip_store(struct web_client *w, RRDHOST *host, const char *client) {
+#ifdef HIBENCHMARKS_WITH_ZLIB
+    if(!w->response.zoutput || web_gzip_shared_entries <= 0)
+        return;
+
+    char key[WEB_GZIP_SHARED_KEY_SIZE];
+    web_client_shared_gzip_key(w, host, client, key);
+
+    if(web_gzip_shared_compress(key, w->tv_in.tv_sec, w->response.data) == 0)
+        web_client_send_shared_gzip(w);
+#else
+    (void)w;
+    (void)host;
+    (void)client;
+#endif
+}
+
 void buffer_data_options2string(BUFFER *wb, uint32_t options) {
     int count = 0;
 
@@ -583,6 +871,24 @@ const char *group_method2string(int group) {
         case GROUP_INCREMENTAL_SUM:
             return "incremental-sum";
 
+        case GROUP_MEDIAN:
+            return "median";
+
+        case GROUP_PERCENTILE95:
+            return "percentile95";
+
+        case GROUP_PERCENTILE99:
+            return "percentile99";
+
+        case GROUP_STDDEV:
+            return "stddev";
+
+        case GROUP_CV:
+            return "cv";
+
+        case GROUP_RATE:
+            return "rate";
+
         default:
             return "unknown-group-method";
     }
@@ -705,6 +1011,9 @@ const char *web_response_code_to_string(int code) {
         case 200:
             return "OK";
 
+        case 304:
+            return "Not Modified";
+
         case 307:
             return "Temporary Redirect";
 
@@ -741,7 +1050,7 @@ const char *web_response_code_to_string(int code) {
 }
 
 static inline char *http_header_parse(struct web_client *w, char *s, int parse_useragent) {
-    static uint32_t hash_origin = 0, hash_connection = 0, hash_accept_encoding = 0, hash_donottrack = 0, hash_useragent = 0;
+    static uint32_t hash_origin = 0, hash_connection = 0, hash_accept_encoding = 0, hash_donottrack = 0, hash_useragent = 0, hash_if_none_match = 0;
 
     if(unlikely(!hash_origin)) {
         hash_origin = simple_uhash("Origin");
@@ -749,6 +1058,7 @@ static inline char *http_header_parse(struct web_client *w, char *s, int parse_u
         hash_accept_encoding = simple_uhash("Accept-Encoding");
         hash_donottrack = simple_uhash("DNT");
         hash_useragent = simple_uhash("User-Agent");
+        hash_if_none_match = simple_uhash("If-None-Match");
     }
 
     char *e = s;
@@ -791,6 +1101,9 @@ static inline char *http_header_parse(struct web_client *w, char *s, int parse_u
         if(*v == '0') web_client_disable_donottrack(w);
         else if(*v == '1') web_client_enable_donottrack(w);
     }
+    else if(hash == hash_if_none_match && !strcasecmp(s, "If-None-Match"))
+        strncpyz(w->if_none_match, v, HIBENCHMARKS_WEB_REQUEST_IF_NONE_MATCH_SIZE);
+
     else if(parse_useragent && hash == hash_useragent && !strcasecmp(s, "User-Agent")) {
         w->user_agent = strdupz(v);
     }
@@ -825,14 +1138,14 @@ typedef enum {
 } HTTP_VALIDATION;
 
 static inline HTTP_VALIDATION http_request_validate(struct web_client *w) {
-    char *s = (char *)buffer_tostring(w->response.data), *encoded_url = NULL;
+    char *s = (char *)buffer_tostring(w->request), *encoded_url = NULL;
 
     size_t last_pos = w->header_parse_last_size;
     if(last_pos > 4) last_pos -= 4; // allow searching for \r\n\r\n
     else last_pos = 0;
 
     w->header_parse_tries++;
-    w->header_parse_last_size = buffer_strlen(w->response.data);
+    w->header_parse_last_size = buffer_strlen(w->request);
 
     if(w->header_parse_tries > 1) {
         if(w->header_parse_last_size < last_pos)
@@ -840,7 +1153,7 @@ static inline HTTP_VALIDATION http_request_validate(struct web_client *w) {
 
         if(strstr(&s[last_pos], "\r\n\r\n") == NULL) {
             if(w->header_parse_tries > 10) {
-                info("Disabling slow client after %zu attempts to read the request (%zu bytes received)", w->header_parse_tries, buffer_strlen(w->response.data));
+                info("Disabling slow client after %zu attempts to read the request (%zu bytes received)", w->header_parse_tries, buffer_strlen(w->request));
                 w->header_parse_tries = 0;
                 w->header_parse_last_size = 0;
                 web_client_disable_wait_receive(w);
@@ -906,12 +1219,15 @@ static inline HTTP_VALIDATION http_request_validate(struct web_client *w) {
             if(unlikely(*s == '\r' && s[1] == '\n')) {
                 // a valid complete HTTP request found
 
+                // the request ends after this \r\n - anything after it is the
+                // next pipelined request (or, for STREAM, the stream itself)
+                w->request_len = (w->mode == WEB_CLIENT_MODE_STREAM) ? w->request->len : (size_t)(&s[2] - w->request->buffer);
+
+                // decode the URL in place - it only gets shorter
                 *ue = '\0';
-                url_decode_r(w->decoded_url, encoded_url, HIBENCHMARKS_WEB_REQUEST_URL_SIZE + 1);
-                *ue = ' ';
-                
-                // copy the URL - we are going to overwrite parts of it
-                // FIXME -- we should avoid it
+                w->decoded_url = url_decode_r(encoded_url, encoded_url, (size_t)(ue - encoded_url) + 1);
+
+                // copy the URL - the api calls split the decoded one in place
                 strncpyz(w->last_url, w->decoded_url, HIBENCHMARKS_WEB_REQUEST_URL_SIZE);
 
                 w->header_parse_tries = 0;
@@ -933,7 +1249,7 @@ static inline HTTP_VALIDATION http_request_validate(struct web_client *w) {
 }
 
 static inline void web_client_send_http_header(struct web_client *w) {
-    if(unlikely(w->response.code != 200))
+    if(unlikely(w->response.code != 200 && w->response.code != 304))
         buffer_no_cacheable(w->response.data);
 
     // set a proper expiration date, if not already set
@@ -1035,6 +1351,14 @@ static inline void web_client_send_http_header(struct web_client *w) {
                         "Transfer-Encoding: chunked\r\n"
         );
     }
+    else if(unlikely(w->response.stream)) {
+        // we don't know the content length, it will be sent in chunks
+        buffer_strcat(w->response.header_output, "Transfer-Encoding: chunked\r\n");
+    }
+    else if(unlikely(w->response.code == 304)) {
+        // not modified - there is no body
+        ;
+    }
     else {
         if(likely((w->response.data->len || w->response.rlen))) {
             // we know the content length, put it
@@ -1279,6 +1603,53 @@ static inline int web_client_process_url(RRDHOST *host, struct web_client *w, ch
     return mysendfile(w, (tok && *tok)?tok:"/");
 }
 
+// ----------------------------------------------------------------------------
+// streamed responses
+//
+// The api can respond with a stream, having only the first part of the data
+// in the response buffer. When it has been sent, the buffer is flushed and
+// the next part is generated in it. Without compression, each part is sent as
+// an HTTP chunk.
+
+// frame the whole buffer as one HTTP chunk
+static void web_client_stream_chunk(BUFFER *wb) {
+    if(unlikely(!wb->len)) return;
+
+    char hdr[24];
+    size_t hdr_len = (size_t)snprintfz(hdr, 23, "%zX\r\n", wb->len);
+
+    buffer_need_bytes(wb, hdr_len + 2);
+    memmove(&wb->buffer[hdr_len], wb->buffer, wb->len);
+    memcpy(wb->buffer, hdr, hdr_len);
+    wb->len += hdr_len;
+
+    buffer_strcat(wb, "\r\n");
+}
+
+// replace the sent data with the next part of the stream
+static void web_client_stream_refill(struct web_client *w) {
+    w->response.streamed += w->response.data->len;
+    buffer_flush(w->response.data);
+    w->response.sent = 0;
+
+    int more;
+    do {
+        more = w->response.stream_next(w->response.stream, w->response.data);
+    } while(more && !w->response.data->len);
+
+    if(!w->response.zoutput) {
+        web_client_stream_chunk(w->response.data);
+        if(!more) buffer_strcat(w->response.data, "0\r\n\r\n");
+    }
+
+    if(!more) {
+        w->response.stream_free(w->response.stream);
+        w->response.stream = NULL;
+    }
+
+    debug(D_WEB_CLIENT, "%llu: Generated %zu more bytes of the streamed response.", w->id, w->response.data->len);
+}
+
 void web_client_process_request(struct web_client *w) {
 
     // start timing us
@@ -1321,14 +1692,15 @@ void web_client_process_request(struct web_client *w) {
             break;
 
         case HTTP_VALIDATION_INCOMPLETE:
-            if(w->response.data->len > HIBENCHMARKS_WEB_REQUEST_MAX_SIZE) {
+            if(w->request->len > HIBENCHMARKS_WEB_REQUEST_MAX_SIZE) {
                 strcpy(w->last_url, "too big request");
 
-                debug(D_WEB_CLIENT_ACCESS, "%llu: Received request is too big (%zu bytes).", w->id, w->response.data->len);
+                debug(D_WEB_CLIENT_ACCESS, "%llu: Received request is too big (%zu bytes).", w->id, w->request->len);
 
                 buffer_flush(w->response.data);
-                buffer_sprintf(w->response.data, "Received request is too big  (%zu bytes).\r\n", w->response.data->len);
+                buffer_sprintf(w->response.data, "Received request is too big  (%zu bytes).\r\n", w->request->len);
                 w->response.code = 400;
+                w->request_len = w->request->len;
             }
             else {
                 // wait for more data
@@ -1337,11 +1709,12 @@ void web_client_process_request(struct web_client *w) {
             break;
 
         case HTTP_VALIDATION_NOT_SUPPORTED:
-            debug(D_WEB_CLIENT_ACCESS, "%llu: Cannot understand '%s'.", w->id, w->response.data->buffer);
+            debug(D_WEB_CLIENT_ACCESS, "%llu: Cannot understand '%s'.", w->id, w->request->buffer);
 
             buffer_flush(w->response.data);
             buffer_strcat(w->response.data, "I don't understand you...\r\n");
             w->response.code = 400;
+            w->request_len = w->request->len;
             break;
     }
 
@@ -1356,8 +1729,14 @@ void web_client_process_request(struct web_client *w) {
 
     web_client_send_http_header(w);
 
+    // a streamed response is sent in chunks, until the stream ends
+    if(unlikely(w->response.stream)) {
+        if(!w->response.zoutput) web_client_stream_chunk(w->response.data);
+        web_client_enable_wait_send(w);
+    }
+
     // enable sending immediately if we have data
-    if(w->response.data->len) web_client_enable_wait_send(w);
+    else if(w->response.data->len || w->response.code == 304) web_client_enable_wait_send(w);
     else web_client_disable_wait_send(w);
 
     switch(w->mode) {
@@ -1401,6 +1780,17 @@ void web_client_process_request(struct web_client *w) {
     }
 }
 
+// HTTP/1.1 pipelining - the clients may send more requests, without waiting
+// for the responses. They are kept in the request buffer and processed one by
+// one, when the response of the previous one has been sent, so the responses
+// are sent in the order of the requests.
+static inline void web_client_process_pipelined_request(struct web_client *w) {
+    if(unlikely(w->request->len && !web_client_check_dead(w))) {
+        debug(D_WEB_CLIENT, "%llu: Processing the next pipelined request (%zu bytes received).", w->id, w->request->len);
+        web_client_process_request(w);
+    }
+}
+
 ssize_t web_client_send_chunk_header(struct web_client *w, size_t len)
 {
     debug(D_DEFLATE, "%llu: OPEN CHUNK of %zu bytes (hex: %zx).", w->id, len, len);
@@ -1480,13 +1870,20 @@ ssize_t web_client_send_deflate(struct web_client *w)
     debug(D_DEFLATE, "%llu: web_client_send_deflate(): w->response.data->len = %zu, w->response.sent = %zu, w->response.zhave = %zu, w->response.zsent = %zu, w->response.zstream.avail_in = %u, w->response.zstream.avail_out = %u, w->response.zstream.total_in = %lu, w->response.zstream.total_out = %lu.",
         w->id, w->response.data->len, w->response.sent, w->response.zhave, w->response.zsent, w->response.zstream.avail_in, w->response.zstream.avail_out, w->response.zstream.total_in, w->response.zstream.total_out);
 
-    if(w->response.data->len - w->response.sent == 0 && w->response.zstream.avail_in == 0 && w->response.zhave == w->response.zsent && w->response.zstream.avail_out != 0) {
+    // when a stream ends, the compressor has to be finished, even without new data
+    int stream_ended = 0;
+    if(unlikely(w->response.stream && w->response.data->len - w->response.sent == 0 && w->response.zstream.avail_in == 0 && w->response.zhave == w->response.zsent && w->response.zstream.avail_out != 0)) {
+        web_client_stream_refill(w);
+        stream_ended = !w->response.stream;
+    }
+
+    if(!stream_ended && w->response.data->len - w->response.sent == 0 && w->response.zstream.avail_in == 0 && w->response.zhave == w->response.zsent && w->response.zstream.avail_out != 0) {
         // there is nothing to send
 
         debug(D_WEB_CLIENT, "%llu: Out of output data.", w->id);
 
         // finalize the chunk
-        if(w->response.sent != 0) {
+        if(w->response.zstream.total_out != 0) {
             t = web_client_send_chunk_finalize(w);
             if(t < 0) return t;
         }
@@ -1507,6 +1904,7 @@ ssize_t web_client_send_deflate(struct web_client *w)
         // reset the client
         web_client_request_done(w);
         debug(D_WEB_CLIENT, "%llu: Done sending all data on socket.", w->id);
+        web_client_process_pipelined_request(w);
         return t;
     }
 
@@ -1514,7 +1912,7 @@ ssize_t web_client_send_deflate(struct web_client *w)
         // compress more input data
 
         // close the previous open chunk
-        if(w->response.sent != 0) {
+        if(w->response.zstream.total_out != 0) {
             t = web_client_send_chunk_close(w);
             if(t < 0) return t;
         }
@@ -1533,7 +1931,7 @@ ssize_t web_client_send_deflate(struct web_client *w)
 
         // ask for FINISH if we have all the input
         int flush = Z_SYNC_FLUSH;
-        if(w->mode == WEB_CLIENT_MODE_NORMAL
+        if((w->mode == WEB_CLIENT_MODE_NORMAL && !w->response.stream)
             || (w->mode == WEB_CLIENT_MODE_FILECOPY && !web_client_has_wait_receive(w) && w->response.data->len == w->response.rlen)) {
             flush = Z_FINISH;
             debug(D_DEFLATE, "%llu: Requesting Z_FINISH, if possible.", w->id);
@@ -1594,6 +1992,9 @@ ssize_t web_client_send(struct web_client *w) {
 
     ssize_t bytes;
 
+    if(unlikely(w->response.stream && w->response.data->len - w->response.sent == 0))
+        web_client_stream_refill(w);
+
     if(unlikely(w->response.data->len - w->response.sent == 0)) {
         // there is nothing to send
 
@@ -1618,6 +2019,7 @@ ssize_t web_client_send(struct web_client *w) {
 
         web_client_request_done(w);
         debug(D_WEB_CLIENT, "%llu: Done sending all data on socket. Waiting for next request on the same socket.", w->id);
+        web_client_process_pipelined_request(w);
         return 0;
     }
 
@@ -1695,20 +2097,20 @@ ssize_t web_client_receive(struct web_client *w)
         return web_client_read_file(w);
 
     // do we have any space for more data?
-    buffer_need_bytes(w->response.data, HIBENCHMARKS_WEB_REQUEST_RECEIVE_SIZE);
+    buffer_need_bytes(w->request, HIBENCHMARKS_WEB_REQUEST_RECEIVE_SIZE);
 
-    ssize_t left = w->response.data->size - w->response.data->len;
-    ssize_t bytes = recv(w->ifd, &w->response.data->buffer[w->response.data->len], (size_t) (left - 1), MSG_DONTWAIT);
+    ssize_t left = w->request->size - w->request->len;
+    ssize_t bytes = recv(w->ifd, &w->request->buffer[w->request->len], (size_t) (left - 1), MSG_DONTWAIT);
 
     if(likely(bytes > 0)) {
         w->stats_received_bytes += bytes;
 
-        size_t old = w->response.data->len;
-        w->response.data->len += bytes;
-        w->response.data->buffer[w->response.data->len] = '\0';
+        size_t old = w->request->len;
+        w->request->len += bytes;
+        w->request->buffer[w->request->len] = '\0';
 
         debug(D_WEB_CLIENT, "%llu: Received %zd bytes.", w->id, bytes);
-        debug(D_WEB_DATA, "%llu: Received data: '%s'.", w->id, &w->response.data->buffer[old]);
+        debug(D_WEB_DATA, "%llu: Received data: '%s'.", w->id, &w->request->buffer[old]);
     }
     else {
         debug(D_WEB_CLIENT, "%llu: receive data failed.", w->id);
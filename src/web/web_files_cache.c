@@ -0,0 +1,207 @@
+// SPDX-License-Identifier: GPL-3.0+
+#include "include/common.h"
+
+// ----------------------------------------------------------------------------
+// in-memory cache of the static web files
+
+long web_files_cache_mb = 16;
+
+static struct web_files_cache {
+    hibenchmarks_mutex_t mutex;
+
+    WEB_FILE *files;                // the most recently used first
+    struct web_files_cache_stats stats;
+} web_files_cache = {
+        .mutex = HIBENCHMARKS_MUTEX_INITIALIZER,
+        .files = NULL,
+        .stats = { 0 }
+};
+
+#ifdef __APPLE__
+#define web_file_mtime_nsec(st) ((st)->st_mtimespec.tv_nsec)
+#define web_file_mtime_sec(st)  ((st)->st_mtimespec.tv_sec)
+#else
+#define web_file_mtime_nsec(st) ((st)->st_mtim.tv_nsec)
+#define web_file_mtime_sec(st)  ((st)->st_mtim.tv_sec)
+#endif /* __APPLE__ */
+
+static inline size_t web_file_bytes(WEB_FILE *f) {
+    return sizeof(WEB_FILE) + f->len + f->gzip_len;
+}
+
+static inline int web_file_is_the_same(WEB_FILE *f, const struct stat *st) {
+    return f->dev == st->st_dev
+           && f->ino == st->st_ino
+           && f->size == st->st_size
+           && f->mtime == web_file_mtime_sec(st)
+           && f->mtime_nsec == (long)web_file_mtime_nsec(st);
+}
+
+static void web_file_free(WEB_FILE *f) {
+    freez(f->filename);
+    freez(f->data);
+    freez(f->gzip);
+    freez(f);
+}
+
+// remove a file from the cache - it is freed when it is not referenced
+// the caller has to hold the mutex
+static void web_files_cache_unlink_unsafe(WEB_FILE *f) {
+    WEB_FILE **p;
+    for(p = &web_files_cache.files; *p ; p = &(*p)->next) {
+        if(*p == f) {
+            *p = f->next;
+            break;
+        }
+    }
+
+    web_files_cache.stats.files--;
+    web_files_cache.stats.bytes -= web_file_bytes(f);
+
+    f->next = NULL;
+    f->obsolete = 1;
+    if(!f->references)
+        web_file_free(f);
+}
+
+// read a file - NULL when it cannot be read, or it changed while reading it
+static WEB_FILE *web_file_load(const char *filename, uint32_t hash, const struct stat *st) {
+    int fd = open(filename, O_RDONLY);
+    if(fd == -1) {
+        error("WEB FILES CACHE: cannot open file '%s'.", filename);
+        return NULL;
+    }
+
+    WEB_FILE *f = callocz(1, sizeof(WEB_FILE));
+    f->filename = strdupz(filename);
+    f->hash = hash;
+    f->dev = st->st_dev;
+    f->ino = st->st_ino;
+    f->size = st->st_size;
+    f->mtime = web_file_mtime_sec(st);
+    f->mtime_nsec = (long)web_file_mtime_nsec(st);
+    f->data = mallocz((size_t)st->st_size + 1);
+
+    while(f->len < (size_t)st->st_size) {
+        ssize_t bytes = read(fd, &f->data[f->len], (size_t)st->st_size - f->len);
+        if(bytes <= 0) {
+            if(bytes == -1 && errno == EINTR) continue;
+            break;
+        }
+        f->len += bytes;
+    }
+    close(fd);
+
+    if(f->len != (size_t)st->st_size) {
+        error("WEB FILES CACHE: read %zu bytes of file '%s', expected %zu.", f->len, filename, (size_t)st->st_size);
+        web_file_free(f);
+        return NULL;
+    }
+    f->data[f->len] = '\0';
+
+    snprintfz(f->etag, WEB_FILE_ETAG_SIZE, "%llx-%llx-%llx"
+              , (unsigned long long)f->ino
+              , (unsigned long long)f->mtime * 1000000000ULL + (unsigned long long)f->mtime_nsec
+              , (unsigned long long)f->size);
+
+#ifdef HIBENCHMARKS_WITH_ZLIB
+    // compressed once, with the best compression - kept only when it is smaller
+    f->gzip_len = web_gzip_compress(f->data, f->len, Z_BEST_COMPRESSION, &f->gzip);
+    if(f->gzip_len >= f->len) {
+        freez(f->gzip);
+        f->gzip = NULL;
+        f->gzip_len = 0;
+    }
+#endif
+
+    return f;
+}
+
+// the file, from the cache or read now - NULL when it should not be cached
+// st is the lstat() of the file, just done by the caller
+WEB_FILE *web_files_cache_get(const char *filename, const struct stat *st) {
+    size_t max_bytes = (size_t)web_files_cache_mb * 1024 * 1024;
+
+    // the big files are copied from the disk
+    if(unlikely(!max_bytes || (size_t)st->st_size > max_bytes / 4))
+        return NULL;
+
+    uint32_t hash = simple_hash(filename);
+    WEB_FILE *f, **p;
+
+    hibenchmarks_mutex_lock(&web_files_cache.mutex);
+
+    for(p = &web_files_cache.files; (f = *p) ; p = &f->next) {
+        if(f->hash != hash || strcmp(f->filename, filename) != 0)
+            continue;
+
+        if(likely(web_file_is_the_same(f, st))) {
+            // move it first
+            *p = f->next;
+            f->next = web_files_cache.files;
+            web_files_cache.files = f;
+
+            f->references++;
+            web_files_cache.stats.hits++;
+            hibenchmarks_mutex_unlock(&web_files_cache.mutex);
+            return f;
+        }
+
+        // it changed on disk
+        web_files_cache_unlink_unsafe(f);
+        break;
+    }
+
+    web_files_cache.stats.misses++;
+    hibenchmarks_mutex_unlock(&web_files_cache.mutex);
+
+    // read and compress it, without holding the mutex
+    f = web_file_load(filename, hash, st);
+    if(unlikely(!f))
+        return NULL;
+
+    hibenchmarks_mutex_lock(&web_files_cache.mutex);
+
+    // another thread may have read it at the same time
+    WEB_FILE *t;
+    for(t = web_files_cache.files; t ; t = t->next) {
+        if(t->hash == hash && !strcmp(t->filename, filename)) {
+            web_files_cache_unlink_unsafe(t);
+            break;
+        }
+    }
+
+    f->references = 1;
+    f->next = web_files_cache.files;
+    web_files_cache.files = f;
+    web_files_cache.stats.files++;
+    web_files_cache.stats.bytes += web_file_bytes(f);
+
+    // evict the least recently used files
+    while(web_files_cache.stats.bytes > max_bytes) {
+        for(t = web_files_cache.files; t->next ; t = t->next) ;
+        if(t == f) break;
+
+        web_files_cache_unlink_unsafe(t);
+        web_files_cache.stats.evictions++;
+    }
+
+    hibenchmarks_mutex_unlock(&web_files_cache.mutex);
+    return f;
+}
+
+void web_files_cache_release(WEB_FILE *f) {
+    hibenchmarks_mutex_lock(&web_files_cache.mutex);
+
+    f->references--;
+    if(unlikely(!f->references && f->obsolete))
+        web_file_free(f);
+
+    hibenchmarks_mutex_unlock(&web_files_cache.mutex);
+}
+
+void web_files_cache_get_stats(struct web_files_cache_stats *stats) {
+    hibenchmarks_mutex_lock(&web_files_cache.mutex);
+    *stats = web_files_cache.stats;
+    hibenchmarks_mutex_unlock(&web_files_cache.mutex);
+}
@@ -101,11 +101,13 @@ static void web_client_zero(struct web_client *w) {
     BUFFER *b1 = w->response.data;
     BUFFER *b2 = w->response.header;
     BUFFER *b3 = w->response.header_output;
+    BUFFER *b4 = w->request;
 
     // empty the buffers
     buffer_flush(b1);
     buffer_flush(b2);
     buffer_flush(b3);
+    buffer_flush(b4);
 
     freez(w->user_agent);
 
@@ -116,12 +118,14 @@ static void web_client_zero(struct web_client *w) {
     w->response.data = b1;
     w->response.header = b2;
     w->response.header_output = b3;
+    w->request = b4;
 }
 
 static void web_client_free(struct web_client *w) {
     buffer_free(w->response.header_output);
     buffer_free(w->response.header);
     buffer_free(w->response.data);
+    buffer_free(w->request);
     freez(w->user_agent);
     freez(w);
 }
@@ -131,6 +135,7 @@ static struct web_client *web_client_alloc(void) {
     w->response.data = buffer_create(HIBENCHMARKS_WEB_RESPONSE_INITIAL_SIZE);
     w->response.header = buffer_create(HIBENCHMARKS_WEB_RESPONSE_HEADER_SIZE);
     w->response.header_output = buffer_create(HIBENCHMARKS_WEB_RESPONSE_HEADER_SIZE);
+    w->request = buffer_create(HIBENCHMARKS_WEB_REQUEST_RECEIVE_SIZE);
     return w;
 }
 
@@ -337,7 +342,10 @@ static void web_client_release(struct web_client *w) {
 static void web_client_initialize_connection(struct web_client *w) {
     int flag = 1;
 
-    if(unlikely(web_client_check_tcp(w) && setsockopt(w->ifd, IPPROTO_TCP, TCP_NODELAY, (char *) &flag, sizeof(int)) != 0))
+    // the socket type of the client is set after this, so it is tried on all
+    // sockets (it fails on unix sockets) - without it, the small responses of
+    // keep-alive connections wait for the delayed ACK of the previous one
+    if(unlikely(setsockopt(w->ifd, IPPROTO_TCP, TCP_NODELAY, (char *) &flag, sizeof(int)) != 0))
         debug(D_WEB_CLIENT, "%llu: failed to enable TCP_NODELAY on socket fd %d.", w->id, w->ifd);
 
     flag = 1;
@@ -377,7 +385,7 @@ static struct web_client *web_client_create_on_listenfd(int listener) {
     struct web_client *w;
 
     w = web_client_get_from_cache_or_allocate();
-    w->ifd = w->ofd = accept_socket(listener, SOCK_NONBLOCK, w->client_ip, sizeof(w->client_ip), w->client_port, sizeof(w->client_port), web_allow_connections_from);
+    w->ifd = w->ofd = accept_socket(listener, SOCK_NONBLOCK | SOCK_CLOEXEC, w->client_ip, sizeof(w->client_ip), w->client_port, sizeof(w->client_port), web_allow_connections_from);
 
     if(unlikely(!*w->client_ip))   strcpy(w->client_ip,   "-");
     if(unlikely(!*w->client_port)) strcpy(w->client_port, "-");
@@ -906,6 +914,8 @@ struct web_server_static_threaded_worker {
 
     size_t max_sockets;
 
+    LISTEN_SOCKETS sockets;     // the listening sockets of this worker, when it has its own
+
     volatile size_t connected;
     volatile size_t disconnected;
     volatile size_t receptions;
@@ -981,10 +991,14 @@ static int web_server_file_read_callback(POLLINFO *pi, short int *events) {
 
         debug(D_WEB_CLIENT, "%llu: SIGNALING W TO SEND (iFD %d, oFD %d)", w->id, pi->fd, wpi->fd);
         p->fds[wpi->slot].events |= POLLOUT;
+        poll_fd_events_changed(wpi);
     }
 
-    if(unlikely(ret <= 0 || w->ifd == w->ofd)) {
+    // release the file as soon as it has been read, so that the next
+    // (pipelined) request of the client can read another one
+    if(unlikely(ret <= 0 || w->ifd == w->ofd || !web_client_has_wait_receive(w))) {
         debug(D_WEB_CLIENT, "%llu: DONE READING FILE ON FD %d", w->id, pi->fd);
+        if(w->ifd == pi->fd) w->ifd = w->ofd;
         return -1;
     }
 
@@ -1048,6 +1062,41 @@ static void web_server_del_callback(POLLINFO *pi) {
     }
 }
 
+// a request of the client is a file - poll the file too
+static int web_server_add_filecopy_slot(POLLINFO *pi, struct web_client *w) {
+    if(w->pollinfo_filecopy_slot == 0) {
+        debug(D_WEB_CLIENT, "%llu: FILECOPY DETECTED ON FD %d", w->id, pi->fd);
+
+        if (unlikely(w->ifd != -1 && w->ifd != w->ofd && w->ifd != pi->fd)) {
+            // add a new socket to poll_events, with the same
+            debug(D_WEB_CLIENT, "%llu: CREATING FILECOPY SLOT ON FD %d", w->id, pi->fd);
+
+            POLLINFO *fpi = poll_add_fd(
+                    pi->p
+                    , w->ifd
+                    , 0
+                    , POLLINFO_FLAG_CLIENT_SOCKET
+                    , "FILENAME"
+                    , ""
+                    , web_server_file_add_callback
+                    , web_werver_file_del_callback
+                    , web_server_file_read_callback
+                    , web_server_file_write_callback
+                    , (void *) w
+            );
+
+            if(fpi)
+                w->pollinfo_filecopy_slot = fpi->slot;
+            else {
+                error("Failed to add filecopy fd. Closing client.");
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
 static int web_server_rcv_callback(POLLINFO *pi, short int *events) {
     worker_private->receptions++;
 
@@ -1061,35 +1110,8 @@ static int web_server_rcv_callback(POLLINFO *pi, short int *events) {
     web_client_process_request(w);
 
     if(unlikely(w->mode == WEB_CLIENT_MODE_FILECOPY)) {
-        if(w->pollinfo_filecopy_slot == 0) {
-            debug(D_WEB_CLIENT, "%llu: FILECOPY DETECTED ON FD %d", w->id, pi->fd);
-
-            if (unlikely(w->ifd != -1 && w->ifd != w->ofd && w->ifd != fd)) {
-                // add a new socket to poll_events, with the same
-                debug(D_WEB_CLIENT, "%llu: CREATING FILECOPY SLOT ON FD %d", w->id, pi->fd);
-
-                POLLINFO *fpi = poll_add_fd(
-                        pi->p
-                        , w->ifd
-                        , 0
-                        , POLLINFO_FLAG_CLIENT_SOCKET
-                        , "FILENAME"
-                        , ""
-                        , web_server_file_add_callback
-                        , web_werver_file_del_callback
-                        , web_server_file_read_callback
-                        , web_server_file_write_callback
-                        , (void *) w
-                );
-
-                if(fpi)
-                    w->pollinfo_filecopy_slot = fpi->slot;
-                else {
-                    error("Failed to add filecopy fd. Closing client.");
-                    return -1;
-                }
-            }
-        }
+        if(unlikely(web_server_add_filecopy_slot(pi, w) == -1))
+            return -1;
     }
     else {
         if(unlikely(w->ifd == fd && web_client_has_wait_receive(w)))
@@ -1113,6 +1135,10 @@ static int web_server_snd_callback(POLLINFO *pi, short int *events) {
     if(unlikely(web_client_send(w) < 0))
         return -1;
 
+    // the next pipelined request may be a file
+    if(unlikely(w->mode == WEB_CLIENT_MODE_FILECOPY && web_server_add_filecopy_slot(pi, w) == -1))
+        return -1;
+
     if(unlikely(w->ifd == fd && web_client_has_wait_receive(w)))
         *events |= POLLIN;
 
@@ -1180,16 +1206,20 @@ static void socket_listen_main_static_threaded_worker_cleanup(void *ptr) {
             worker_private->sends
     );
 
+    if(worker_private->sockets.opened)
+        listen_sockets_close(&worker_private->sockets);
+
     worker_private->running = 0;
 }
 
 void *socket_listen_main_static_threaded_worker(void *ptr) {
     worker_private = (struct web_server_static_threaded_worker *)ptr;
     worker_private->running = 1;
+    web_worker_statistics_id = worker_private->id;
 
     hibenchmarks_thread_cleanup_push(socket_listen_main_static_threaded_worker_cleanup, ptr);
 
-            poll_events(&api_sockets
+            poll_events((worker_private->sockets.opened) ? &worker_private->sockets : &api_sockets
                         , web_server_add_callback
                         , web_server_del_callback
                         , web_server_rcv_callback
@@ -1273,11 +1303,20 @@ void *socket_listen_main_static_threaded(void *ptr) {
 
             web_server_is_multithreaded = (static_threaded_workers_count > 1);
 
+            // every worker listens on its own SO_REUSEPORT sockets, so that the kernel
+            // spreads the connections among them, instead of waking up all of them
+            int listen_sockets_per_thread = config_get_boolean(CONFIG_SECTION_WEB, "listen sockets per thread", CONFIG_BOOLEAN_YES);
+
+            web_workers_statistics_init((size_t)static_threaded_workers_count);
+
             int i;
             for(i = 1; i < static_threaded_workers_count; i++) {
                 static_workers_private_data[i].id = i;
                 static_workers_private_data[i].max_sockets = max_sockets / static_threaded_workers_count;
 
+                if(listen_sockets_per_thread)
+                    listen_sockets_shard(&static_workers_private_data[i].sockets, &api_sockets);
+
                 char tag[50 + 1];
                 snprintfz(tag, 50, "WEB_SERVER[static%d]", i+1);
 
@@ -4775,6 +4775,10 @@ var HIBENCHMARKS = window.HIBENCHMARKS || {};
             if(this.dimensions)
                 this.data_url += "&dimensions=" + this.dimensions;
 
+            // let the server resume the result of the previous refresh
+            if(this.data !== null && typeof this.data.cursor === 'string')
+                this.data_url += "&cursor=" + this.data.cursor;
+
             if(HIBENCHMARKS.options.debug.chart_data_url === true || this.debug === true)
                 this.log('chartURL(): ' + this.data_url + ' WxH:' + this.chartWidth() + 'x' + this.chartHeight() + ' points: ' + data_points.toString() + ' library: ' + this.library_name);
         };